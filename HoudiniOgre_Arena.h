@@ -0,0 +1,185 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Arena.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_Arena__
+#define __HoudiniOgre_Arena__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+/** Memory handed out from big blocks and given back all at once.
+@remarks
+	Allocations bump a pointer through the current block; nothing is 
+	freed individually, reset() forgets everything in one go (keeping the
+	most recent block for reuse) and the destructor releases the blocks.
+	Objects placed in an arena still need their destructors calling if
+	they own memory elsewhere. Not thread safe.
+*/
+class HoudiniOgre_Arena
+{
+public:
+	explicit HoudiniOgre_Arena(size_t blockSize = 64 * 1024)
+		: mBlocks(0), mCurrent(0), mEnd(0), mBlockSize(blockSize), mAllocated(0) {}
+	~HoudiniOgre_Arena()
+	{
+		release(0);
+	}
+
+	/// Allocate bytes aligned for any type; throws std::bad_alloc
+	void* allocate(size_t bytes)
+	{
+		const size_t align = alignof(std::max_align_t);
+		bytes = (bytes + align - 1) & ~(align - 1);
+		if (static_cast<size_t>(mEnd - mCurrent) < bytes)
+		{
+			// Grow the blocks as the arena fills, up to a few MB each
+			size_t size = (std::max)(mBlockSize, bytes);
+			Block* block = static_cast<Block*>(std::malloc(sizeof(Block) + size));
+			if (!block)
+				throw std::bad_alloc();
+			block->next = mBlocks;
+			block->size = size;
+			mBlocks = block;
+			mCurrent = reinterpret_cast<char*>(block + 1);
+			mEnd = mCurrent + size;
+			mBlockSize = (std::min)(mBlockSize * 2, size_t(4 * 1024 * 1024));
+		}
+		void* ret = mCurrent;
+		mCurrent += bytes;
+		mAllocated += bytes;
+		return ret;
+	}
+
+	/// Forget every allocation, keeping the latest block to reuse
+	void reset()
+	{
+		if (!mBlocks)
+			return;
+		release(mBlocks);
+		mBlocks->next = 0;
+		mCurrent = reinterpret_cast<char*>(mBlocks + 1);
+		mEnd = mCurrent + mBlocks->size;
+		mAllocated = 0;
+	}
+
+	/// Bytes handed out since the last reset
+	size_t getBytesAllocated() const { return mAllocated; }
+
+protected:
+	struct Block
+	{
+		Block* next;
+		size_t size;
+		// pads the header so the data after it stays aligned
+		std::max_align_t align;
+	};
+
+	/// Free the blocks, apart from keep
+	void release(Block* keep)
+	{
+		Block* block = mBlocks;
+		while (block)
+		{
+			Block* next = block->next;
+			if (block != keep)
+				std::free(block);
+			block = next;
+		}
+		if (!keep)
+		{
+			mBlocks = 0;
+			mCurrent = mEnd = 0;
+		}
+	}
+
+	Block* mBlocks;
+	char* mCurrent;
+	char* mEnd;
+	size_t mBlockSize;
+	size_t mAllocated;
+
+private:
+	HoudiniOgre_Arena(const HoudiniOgre_Arena&);
+	HoudiniOgre_Arena& operator=(const HoudiniOgre_Arena&);
+};
+
+/** Standard allocator drawing from a HoudiniOgre_Arena, or from the heap
+	if it has none.
+@remarks
+	Copies of a container get a heap allocator, so they can safely 
+	outlive the arena; swaps and moves take the allocator with the 
+	memory.
+*/
+template <typename T>
+class HoudiniOgre_ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+	template <typename U> struct rebind { typedef HoudiniOgre_ArenaAllocator<U> other; };
+
+	HoudiniOgre_ArenaAllocator(HoudiniOgre_Arena* arena = 0) : mArena(arena) {}
+	template <typename U>
+	HoudiniOgre_ArenaAllocator(const HoudiniOgre_ArenaAllocator<U>& rhs) : mArena(rhs.getArena()) {}
+
+	T* allocate(size_t n)
+	{
+		if (mArena)
+			return static_cast<T*>(mArena->allocate(n * sizeof(T)));
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t)
+	{
+		if (!mArena)
+			::operator delete(p);
+	}
+
+	HoudiniOgre_ArenaAllocator select_on_container_copy_construction() const
+	{
+		return HoudiniOgre_ArenaAllocator();
+	}
+
+	HoudiniOgre_Arena* getArena() const { return mArena; }
+
+protected:
+	HoudiniOgre_Arena* mArena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const HoudiniOgre_ArenaAllocator<T>& a, const HoudiniOgre_ArenaAllocator<U>& b)
+{
+	return a.getArena() == b.getArena();
+}
+template <typename T, typename U>
+inline bool operator!=(const HoudiniOgre_ArenaAllocator<T>& a, const HoudiniOgre_ArenaAllocator<U>& b)
+{
+	return a.getArena() != b.getArena();
+}
+
+#endif
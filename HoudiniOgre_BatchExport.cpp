@@ -0,0 +1,387 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_BatchExport.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+/*
+	Headless exporter converting cached geometry files to .mesh, without
+	starting hbatch or loading a .hip. Geometry files (.bgeo, .geo) are
+	loaded with GU_Detail::load, .obj files with HoudiniOgre_ObjSource, and
+	both go through the same HoudiniOgre_Mesh code as the OgreExport ROP.
+
+	Usage: HoudiniOgre_BatchExport [options] input...
+		-o <dir>          output folder (default .)
+		-j <n>            worker processes (default: one per CPU)
+		-manifest <file>  manifest to write (default <dir>/manifest.xml)
+		-edges            generate edge lists
+		-tangents         generate tangents (in VES_TANGENT)
+		-tangents-uvw     generate tangents (in a texture coordinate set)
+		-tangents-w       store the tangents' handedness in w (4 components)
+
+	Each input becomes <dir>/<input name>.mesh, the name being the file's
+	without its last extension. Inputs which would end up with the same
+	name (eg a/rock.bgeo and b/rock.obj) are warned about and numbered in
+	command line order: rock.mesh, rock_2.mesh and so on. Inputs are shared out
+	between worker processes, each of which loads the Houdini libraries
+	once (they are inherited from the parent through fork) and then
+	converts its files one after another. Every worker records what it
+	did in a manifest fragment, which the parent merges into a single
+	manifest once all workers have finished. The exit code is non-zero if
+	any input failed.
+
+	On Windows there is no fork, so all inputs are converted in-process.
+*/
+#include "HoudiniOgre_Standalone.h"
+#include "HoudiniOgre_Mesh.h"
+#include "HoudiniOgre_GUDetailSource.h"
+#include "HoudiniOgre_ObjSource.h"
+#include "HoudiniOgre_Escape.h"
+
+#include "OgreNoMemoryMacros.h"
+#include <GU/GU_Detail.h>
+#include "OgreMemoryMacros.h"
+
+#include "OgreException.h"
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sys/stat.h>
+#include <thread>
+
+#if OGRE_PLATFORM != OGRE_PLATFORM_WIN32
+#	include <sys/wait.h>
+#	include <unistd.h>
+#	define HOUDINIOGRE_FORK_WORKERS
+#endif
+
+namespace
+{
+	struct Options
+	{
+		Ogre::String outDir;
+		Ogre::String manifest;
+		int workers;
+		bool edgeLists;
+		bool tangents;
+		Ogre::VertexElementSemantic tangentSemantic;
+		bool tangentHandedness;
+		std::vector<Ogre::String> inputs;
+		/// Mesh name (without folder or extension) for each input
+		std::vector<Ogre::String> names;
+
+		Options()
+			: outDir("."), workers(0), edgeLists(false), tangents(false),
+			tangentSemantic(Ogre::VES_TANGENT), tangentHandedness(false) {}
+	};
+
+	/// One manifest line
+	struct ManifestEntry
+	{
+		Ogre::String input;
+		Ogre::String mesh;
+		bool ok;
+		Ogre::String error;
+		int points;
+		int primitives;
+		double seconds;
+
+		ManifestEntry() : ok(false), points(0), primitives(0), seconds(0) {}
+	};
+
+	//---------------------------------------------------------------------
+	void writeEntry(std::ostream& os, const ManifestEntry& e)
+	{
+		os << "\t<export input=\"" << HoudiniOgre_Escape::xml(e.input)
+			<< "\" mesh=\"" << HoudiniOgre_Escape::xml(e.mesh)
+			<< "\" status=\"" << (e.ok ? "ok" : "failed")
+			<< "\" points=\"" << e.points
+			<< "\" primitives=\"" << e.primitives
+			<< "\" seconds=\"" << e.seconds << "\"";
+		if (!e.ok)
+			os << " error=\"" << HoudiniOgre_Escape::xml(e.error) << "\"";
+		os << "/>\n";
+	}
+	//---------------------------------------------------------------------
+	/// Input name without folder or last extension, eg "a/b/rock.v2.bgeo" -> "rock.v2"
+	Ogre::String baseName(const Ogre::String& input)
+	{
+		Ogre::String name, path;
+		Ogre::StringUtil::splitFilename(input, name, path);
+		Ogre::String::size_type dot = name.rfind('.');
+		return dot == Ogre::String::npos || dot == 0 ? name : name.substr(0, dot);
+	}
+	//---------------------------------------------------------------------
+	/** Name the inputs' meshes, numbering any which clash so that no two
+		workers write the same file. Compared ignoring case, for the file
+		systems which do. */
+	void assignNames(Options& opts)
+	{
+		std::set<Ogre::String> used;
+		opts.names.clear();
+		for (size_t i = 0; i < opts.inputs.size(); ++i)
+		{
+			Ogre::String base = baseName(opts.inputs[i]);
+			Ogre::String name = base;
+			Ogre::String key = name;
+			Ogre::StringUtil::toLowerCase(key);
+			for (int n = 2; used.count(key); ++n)
+			{
+				name = base + "_" + Ogre::StringConverter::toString(n);
+				key = name;
+				Ogre::StringUtil::toLowerCase(key);
+			}
+			if (name != base)
+			{
+				std::cerr << "warning: " << opts.inputs[i] << " would also be exported to "
+					<< base << ".mesh, writing " << name << ".mesh instead" << std::endl;
+			}
+			used.insert(key);
+			opts.names.push_back(name);
+		}
+	}
+	//---------------------------------------------------------------------
+	void exportFile(const Options& opts, size_t index, ManifestEntry& entry)
+	{
+		double start = HoudiniOgre_Standalone::now();
+		const Ogre::String& input = opts.inputs[index];
+		const Ogre::String& name = opts.names[index];
+		entry.input = input;
+		entry.mesh = opts.outDir + "/" + name + ".mesh";
+
+		try
+		{
+			// Owned here since the GU_Detail source only refers to it
+			GU_Detail gdp;
+			std::unique_ptr<HoudiniOgre_GeometrySource> source;
+			if (Ogre::StringUtil::endsWith(input, ".obj"))
+			{
+				source.reset(new HoudiniOgre_ObjSource(input));
+			}
+			else
+			{
+				if (gdp.load(input.c_str()) < 0)
+				{
+					OGRE_EXCEPT(Ogre::Exception::ERR_FILE_NOT_FOUND,
+						"Unable to load geometry from '" + input + "'",
+						"HoudiniOgre_BatchExport::exportFile");
+				}
+				source.reset(new HoudiniOgre_GUDetailSource(&gdp, name));
+			}
+			entry.points = source->getPointCount();
+			entry.primitives = source->getPrimitiveCount();
+
+			HoudiniOgre_Mesh mesh;
+			mesh.setTangentHandedness(opts.tangentHandedness);
+			mesh.addGeometry(*source, false, false, 1, 0, 24.0f);
+			mesh.Export(entry.mesh, Ogre::StringUtil::BLANK, opts.edgeLists,
+				opts.tangents, opts.tangentSemantic);
+			entry.ok = true;
+		}
+		catch (Ogre::Exception& e)
+		{
+			entry.error = e.getFullDescription();
+		}
+		catch (std::exception& e)
+		{
+			entry.error = e.what();
+		}
+		entry.seconds = HoudiniOgre_Standalone::now() - start;
+
+		std::cerr << (entry.ok ? "exported " : "FAILED ") << input;
+		if (!entry.ok)
+			std::cerr << ": " << entry.error;
+		std::cerr << std::endl;
+	}
+	//---------------------------------------------------------------------
+	/// Convert every workerCount'th input starting at worker into a fragment
+	int runWorker(const Options& opts, int worker, int workerCount,
+		const Ogre::String& fragment)
+	{
+		HoudiniOgre_Standalone env(opts.outDir + "/HoudiniOgre_BatchExport." +
+			Ogre::StringConverter::toString(worker) + ".log");
+
+		std::ofstream ofs(fragment.c_str());
+		int failures = 0;
+		for (size_t i = worker; i < opts.inputs.size(); i += workerCount)
+		{
+			ManifestEntry entry;
+			exportFile(opts, i, entry);
+			writeEntry(ofs, entry);
+			// keep the fragment usable if a later input brings the worker down
+			ofs.flush();
+			if (!entry.ok)
+				++failures;
+		}
+		return failures ? 1 : 0;
+	}
+	//---------------------------------------------------------------------
+	size_t fileSize(const Ogre::String& file)
+	{
+		struct stat st;
+		return stat(file.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+	}
+	//---------------------------------------------------------------------
+	bool biggerFile(const std::pair<size_t, size_t>& a,
+		const std::pair<size_t, size_t>& b)
+	{
+		return a.first > b.first;
+	}
+	//---------------------------------------------------------------------
+	bool parseArgs(int argc, char** argv, Options& opts)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			if (!strcmp(arg, "-o") && i + 1 < argc)
+				opts.outDir = argv[++i];
+			else if (!strcmp(arg, "-j") && i + 1 < argc)
+				opts.workers = std::max(1, atoi(argv[++i]));
+			else if (!strcmp(arg, "-manifest") && i + 1 < argc)
+				opts.manifest = argv[++i];
+			else if (!strcmp(arg, "-edges"))
+				opts.edgeLists = true;
+			else if (!strcmp(arg, "-tangents"))
+			{
+				opts.tangents = true;
+				opts.tangentSemantic = Ogre::VES_TANGENT;
+			}
+			else if (!strcmp(arg, "-tangents-uvw"))
+			{
+				opts.tangents = true;
+				opts.tangentSemantic = Ogre::VES_TEXTURE_COORDINATES;
+			}
+			else if (!strcmp(arg, "-tangents-w"))
+				opts.tangentHandedness = true;
+			else if (arg[0] == '-')
+				return false;
+			else
+				opts.inputs.push_back(arg);
+		}
+
+		if (opts.manifest.empty())
+			opts.manifest = opts.outDir + "/manifest.xml";
+		if (!opts.workers)
+			opts.workers = std::max(1u, std::thread::hardware_concurrency());
+		opts.workers = std::min(opts.workers, static_cast<int>(opts.inputs.size()));
+		return !opts.inputs.empty();
+	}
+}
+//---------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options opts;
+	if (!parseArgs(argc, argv, opts))
+	{
+		std::cerr << "Usage: " << argv[0] << " [-o dir] [-j workers] [-manifest file] "
+			"[-edges] [-tangents|-tangents-uvw] [-tangents-w] input..." << std::endl;
+		return 1;
+	}
+
+	// Names first, so they follow the command line rather than file sizes
+	assignNames(opts);
+
+	// Biggest files first so that interleaving spreads the work evenly
+	std::vector<std::pair<size_t, size_t> > sized;
+	for (size_t i = 0; i < opts.inputs.size(); ++i)
+		sized.push_back(std::make_pair(fileSize(opts.inputs[i]), i));
+	std::stable_sort(sized.begin(), sized.end(), biggerFile);
+	std::vector<Ogre::String> inputs, names;
+	for (size_t i = 0; i < sized.size(); ++i)
+	{
+		inputs.push_back(opts.inputs[sized[i].second]);
+		names.push_back(opts.names[sized[i].second]);
+	}
+	opts.inputs.swap(inputs);
+	opts.names.swap(names);
+
+	std::vector<Ogre::String> fragments;
+	for (int w = 0; w < opts.workers; ++w)
+		fragments.push_back(opts.manifest + "." + Ogre::StringConverter::toString(w));
+
+	int result = 0;
+#ifdef HOUDINIOGRE_FORK_WORKERS
+	std::vector<pid_t> children;
+	for (int w = 0; w < opts.workers; ++w)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			_exit(runWorker(opts, w, opts.workers, fragments[w]));
+		}
+		else if (pid < 0)
+		{
+			// couldn't fork, do this share ourselves
+			result |= runWorker(opts, w, opts.workers, fragments[w]);
+		}
+		else
+		{
+			children.push_back(pid);
+		}
+	}
+	for (size_t c = 0; c < children.size(); ++c)
+	{
+		int status = 0;
+		if (waitpid(children[c], &status, 0) < 0 ||
+			!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			result = 1;
+		}
+	}
+#else
+	opts.workers = 1;
+	fragments.resize(1);
+	result = runWorker(opts, 0, 1, fragments[0]);
+#endif
+
+	// Merge the fragments; a worker which crashed leaves its inputs missing
+	std::ofstream manifest(opts.manifest.c_str());
+	manifest << "<manifest>\n";
+	size_t entries = 0;
+	for (size_t f = 0; f < fragments.size(); ++f)
+	{
+		std::ifstream ifs(fragments[f].c_str());
+		Ogre::String line;
+		while (std::getline(ifs, line))
+		{
+			manifest << line << "\n";
+			++entries;
+		}
+		ifs.close();
+		std::remove(fragments[f].c_str());
+	}
+	manifest << "</manifest>\n";
+
+	if (entries != opts.inputs.size())
+	{
+		std::cerr << opts.inputs.size() - entries << " input(s) missing from the manifest, "
+			"a worker must have crashed" << std::endl;
+		result = 1;
+	}
+	return result;
+}
@@ -0,0 +1,267 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Benchmark.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+/*
+	Standalone benchmark for the mesh pipeline (welding, baking and
+	serialisation), which needs neither Houdini nor a licence.
+
+	Usage: HoudiniOgre_Benchmark [options]
+		-grid <cells>     add a synthetic grid of cells x cells quads (repeatable)
+		-obj <file>       add a Wavefront .obj file (repeatable)
+		-uvsets <n>       texture coordinate sets on synthetic grids (default 1)
+		-seams <ratio>    fraction of grid columns which are UV seams (default 0.1)
+		-materials <n>    materials on synthetic grids (default 1)
+		-iterations <n>   times each case is run, the best is reported (default 3)
+		-out <dir>        where to write the .mesh files (default .)
+		-outofcore <MB>   keep the mesh in temporary files, with this much
+		                  in memory (default 0, all in memory)
+
+	With no -grid or -obj options, 64, 256 and 1024 cell grids and
+	ReferenceHIP/building-source.obj are used.
+*/
+#include "HoudiniOgre_Standalone.h"
+#include "HoudiniOgre_Mesh.h"
+#include "HoudiniOgre_SyntheticSource.h"
+#include "HoudiniOgre_ObjSource.h"
+#include "HoudiniOgre_MappedStore.h"
+
+#include "OgreException.h"
+#include "OgreStringConverter.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+	/// Exposes the welded vertex count, which is otherwise internal
+	class BenchmarkMesh : public HoudiniOgre_Mesh
+	{
+	public:
+		size_t getUniqueVertexCount() const
+		{
+			size_t count = 0;
+			for (MaterialProtoSubMeshLists::const_iterator mi = mMaterialProtoLists.begin();
+				mi != mMaterialProtoLists.end(); ++mi)
+			{
+				for (ProtoSubMeshList::const_iterator psi = (*mi)->begin();
+					psi != (*mi)->end(); ++psi)
+				{
+					count += (*psi)->uniqueVertices.size();
+				}
+			}
+			return count;
+		}
+	};
+
+	struct Case
+	{
+		Ogre::String name;
+		// grid cells, or 0 for an obj file
+		int cells;
+		Ogre::String file;
+	};
+
+	struct Options
+	{
+		std::vector<Case> cases;
+		size_t uvSets;
+		float seamRatio;
+		size_t materials;
+		int iterations;
+		Ogre::String outDir;
+		/// In bytes
+		size_t outOfCoreBudget;
+
+		Options() : uvSets(1), seamRatio(0.1f), materials(1), iterations(3), outDir("."),
+			outOfCoreBudget(0) {}
+	};
+
+	struct Result
+	{
+		size_t inputVertices;
+		size_t outputVertices;
+		double addTime;
+		double exportTime;
+	};
+
+	//---------------------------------------------------------------------
+	void addGridCase(Options& opts, int cells)
+	{
+		Case c;
+		c.name = "grid" + Ogre::StringConverter::toString(cells);
+		c.cells = cells;
+		opts.cases.push_back(c);
+	}
+	//---------------------------------------------------------------------
+	void addObjCase(Options& opts, const Ogre::String& file)
+	{
+		Case c;
+		Ogre::String path;
+		Ogre::StringUtil::splitFilename(file, c.name, path);
+		c.cells = 0;
+		c.file = file;
+		opts.cases.push_back(c);
+	}
+	//---------------------------------------------------------------------
+	bool parseArgs(int argc, char** argv, Options& opts)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : 0;
+			if (!value)
+				return false;
+			++i;
+
+			if (!strcmp(arg, "-grid"))
+				addGridCase(opts, std::max(1, atoi(value)));
+			else if (!strcmp(arg, "-obj"))
+				addObjCase(opts, value);
+			else if (!strcmp(arg, "-uvsets"))
+				opts.uvSets = static_cast<size_t>(std::max(0, atoi(value)));
+			else if (!strcmp(arg, "-seams"))
+				opts.seamRatio = static_cast<float>(atof(value));
+			else if (!strcmp(arg, "-materials"))
+				opts.materials = static_cast<size_t>(std::max(1, atoi(value)));
+			else if (!strcmp(arg, "-iterations"))
+				opts.iterations = std::max(1, atoi(value));
+			else if (!strcmp(arg, "-out"))
+				opts.outDir = value;
+			else if (!strcmp(arg, "-outofcore"))
+				opts.outOfCoreBudget = static_cast<size_t>(std::max(0, atoi(value))) << 20;
+			else
+				return false;
+		}
+
+		if (opts.cases.empty())
+		{
+			addGridCase(opts, 64);
+			addGridCase(opts, 256);
+			addGridCase(opts, 1024);
+			addObjCase(opts, "ReferenceHIP/building-source.obj");
+		}
+		return true;
+	}
+	//---------------------------------------------------------------------
+	Result runCase(const Case& c, const Options& opts, HoudiniOgre_MappedStore* store)
+	{
+		std::unique_ptr<HoudiniOgre_GeometrySource> source;
+		if (c.cells)
+		{
+			source.reset(new HoudiniOgre_SyntheticSource(c.name, c.cells,
+				opts.uvSets, opts.seamRatio, true, false, opts.materials));
+		}
+		else
+		{
+			source.reset(new HoudiniOgre_ObjSource(c.file));
+		}
+
+		Result res;
+		res.inputVertices = 0;
+		for (int prim = 0; prim < source->getPrimitiveCount(); ++prim)
+		{
+			res.inputVertices += source->getPrimitiveVertexCount(prim);
+		}
+
+		BenchmarkMesh mesh;
+		mesh.setOutOfCore(store);
+		double start = HoudiniOgre_Standalone::now();
+		mesh.addGeometry(*source, false, false, 1, 0, 24.0f);
+		res.addTime = HoudiniOgre_Standalone::now() - start;
+		res.outputVertices = mesh.getUniqueVertexCount();
+
+		start = HoudiniOgre_Standalone::now();
+		mesh.Export(opts.outDir + "/" + c.name + ".mesh", Ogre::StringUtil::BLANK,
+			false, false, Ogre::VES_TANGENT);
+		res.exportTime = HoudiniOgre_Standalone::now() - start;
+
+		return res;
+	}
+}
+//---------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options opts;
+	if (!parseArgs(argc, argv, opts))
+	{
+		std::cerr << "Usage: " << argv[0] << " [-grid cells] [-obj file] [-uvsets n] "
+			"[-seams ratio] [-materials n] [-iterations n] [-out dir] [-outofcore MB]" << std::endl;
+		return 1;
+	}
+
+	HoudiniOgre_Standalone env("HoudiniOgre_Benchmark.log");
+	std::unique_ptr<HoudiniOgre_MappedStore> store;
+	if (opts.outOfCoreBudget)
+	{
+		store.reset(new HoudiniOgre_MappedStore(Ogre::StringUtil::BLANK, opts.outOfCoreBudget));
+		env.getBufferManager()->setStore(store.get());
+	}
+
+	std::cout << std::left << std::setw(28) << "case"
+		<< std::right << std::setw(12) << "in verts"
+		<< std::setw(12) << "out verts"
+		<< std::setw(12) << "add (s)"
+		<< std::setw(12) << "export (s)"
+		<< std::setw(14) << "verts/sec"
+		<< std::setw(14) << "peak MB" << std::endl;
+
+	int failures = 0;
+	for (std::vector<Case>::const_iterator i = opts.cases.begin(); i != opts.cases.end(); ++i)
+	{
+		try
+		{
+			Result best;
+			for (int it = 0; it < opts.iterations; ++it)
+			{
+				Result res = runCase(*i, opts, store.get());
+				if (it == 0 || res.addTime + res.exportTime < best.addTime + best.exportTime)
+					best = res;
+			}
+
+			double total = best.addTime + best.exportTime;
+			std::cout << std::left << std::setw(28) << i->name
+				<< std::right << std::setw(12) << best.inputVertices
+				<< std::setw(12) << best.outputVertices
+				<< std::fixed << std::setprecision(4)
+				<< std::setw(12) << best.addTime
+				<< std::setw(12) << best.exportTime
+				<< std::setprecision(0)
+				<< std::setw(14) << (total > 0 ? best.inputVertices / total : 0.0)
+				<< std::setprecision(1)
+				<< std::setw(14) << HoudiniOgre_Standalone::getPeakMemory() / (1024.0 * 1024.0)
+				<< std::endl;
+		}
+		catch (Ogre::Exception& e)
+		{
+			std::cerr << i->name << ": " << e.getFullDescription() << std::endl;
+			++failures;
+		}
+	}
+
+	return failures ? 1 : 0;
+}
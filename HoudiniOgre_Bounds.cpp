@@ -0,0 +1,318 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Bounds.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_Bounds.h"
+
+#include "OgreException.h"
+
+#include <algorithm>
+#include <fstream>
+
+#undef max
+#undef min
+
+namespace
+{
+	/// Simple box for building, without AxisAlignedBox's null/infinite states
+	struct Box
+	{
+		Ogre::Vector3 min, max;
+
+		Box() : min(Ogre::Math::POS_INFINITY, Ogre::Math::POS_INFINITY, Ogre::Math::POS_INFINITY),
+			max(Ogre::Math::NEG_INFINITY, Ogre::Math::NEG_INFINITY, Ogre::Math::NEG_INFINITY) {}
+
+		void merge(const Ogre::Vector3& p) { min.makeFloor(p); max.makeCeil(p); }
+		void merge(const Box& b) { min.makeFloor(b.min); max.makeCeil(b.max); }
+		Ogre::Real area() const
+		{
+			if (max.x < min.x)
+				return 0;
+			Ogre::Vector3 d = max - min;
+			return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+	};
+
+	/// Bins per axis for the surface area heuristic
+	const int SAH_BINS = 16;
+	/// Cost of visiting a node, relative to testing one triangle
+	const Ogre::Real TRAVERSAL_COST = 1.0f;
+}
+//---------------------------------------------------------------------
+HoudiniOgre_Sphere HoudiniOgre_Sphere::enclose(const std::vector<Ogre::Vector3>& points)
+{
+	HoudiniOgre_Sphere sphere;
+	if (points.empty())
+		return sphere;
+
+	// Ritter: start from two points far apart, then grow over the rest
+	const Ogre::Vector3* y = &points[0];
+	const Ogre::Vector3* z = &points[0];
+	Ogre::Real furthest = 0;
+	for (std::vector<Ogre::Vector3>::const_iterator p = points.begin(); p != points.end(); ++p)
+	{
+		Ogre::Real dist = (*p - points[0]).squaredLength();
+		if (dist > furthest)
+		{
+			furthest = dist;
+			y = &*p;
+		}
+	}
+	furthest = 0;
+	for (std::vector<Ogre::Vector3>::const_iterator p = points.begin(); p != points.end(); ++p)
+	{
+		Ogre::Real dist = (*p - *y).squaredLength();
+		if (dist > furthest)
+		{
+			furthest = dist;
+			z = &*p;
+		}
+	}
+	sphere.centre = (*y + *z) * 0.5f;
+	sphere.radius = (*y - *z).length() * 0.5f;
+	for (std::vector<Ogre::Vector3>::const_iterator p = points.begin(); p != points.end(); ++p)
+	{
+		sphere.grow(*p);
+	}
+
+	// Shrink a little and grow back over the points in a different order;
+	// the result depends on the order, so this often finds a smaller one
+	std::vector<Ogre::Vector3> shuffled(points);
+	HoudiniOgre_Sphere trial = sphere;
+	unsigned int seed = 0x2545F491;
+	for (int iter = 0; iter < 8; ++iter)
+	{
+		trial.radius *= 0.95f;
+		for (size_t i = 0; i < shuffled.size(); ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			size_t j = i + (seed >> 8) % (shuffled.size() - i);
+			std::swap(shuffled[i], shuffled[j]);
+			trial.grow(shuffled[i]);
+		}
+		if (trial.radius < sphere.radius)
+			sphere = trial;
+	}
+
+	// Growing moves the centre, so make sure of the radius
+	Ogre::Real radius2 = 0;
+	for (std::vector<Ogre::Vector3>::const_iterator p = points.begin(); p != points.end(); ++p)
+	{
+		radius2 = std::max(radius2, (*p - sphere.centre).squaredLength());
+	}
+	sphere.radius = Ogre::Math::Sqrt(radius2);
+	return sphere;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Sphere::grow(const Ogre::Vector3& point)
+{
+	Ogre::Vector3 diff = point - centre;
+	Ogre::Real dist2 = diff.squaredLength();
+	if (dist2 > radius * radius)
+	{
+		// move the centre towards the point just enough to take it in
+		Ogre::Real dist = Ogre::Math::Sqrt(dist2);
+		Ogre::Real newRadius = (radius + dist) * 0.5f;
+		centre += diff * ((newRadius - radius) / dist);
+		radius = newRadius;
+	}
+}
+//---------------------------------------------------------------------
+//---------------------------------------------------------------------
+HoudiniOgre_BVH::HoudiniOgre_BVH()
+{
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_BVH::addTriangle(const Ogre::Vector3& v0, const Ogre::Vector3& v1,
+	const Ogre::Vector3& v2, unsigned short subMesh, Ogre::uint32 index)
+{
+	Triangle tri;
+	const Ogre::Vector3* verts[3] = { &v0, &v1, &v2 };
+	for (int v = 0; v < 3; ++v)
+	{
+		tri.v[v*3] = verts[v]->x;
+		tri.v[v*3+1] = verts[v]->y;
+		tri.v[v*3+2] = verts[v]->z;
+	}
+	tri.index = index;
+	tri.subMesh = subMesh;
+	tri.padding = 0;
+	mTriangles.push_back(tri);
+	mCentroids.push_back((v0 + v1 + v2) / 3.0f);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_BVH::build(size_t maxLeafSize)
+{
+	mNodes.clear();
+	if (mTriangles.empty())
+		return;
+
+	mOrder.resize(mTriangles.size());
+	for (size_t i = 0; i < mOrder.size(); ++i)
+		mOrder[i] = static_cast<Ogre::uint32>(i);
+	mNodes.reserve(mTriangles.size() * 2 / std::max(maxLeafSize, size_t(1)) + 1);
+
+	buildNode(0, mTriangles.size(), std::max(maxLeafSize, size_t(1)));
+
+	// Put the triangles in leaf order so each leaf's are contiguous
+	std::vector<Triangle> ordered(mTriangles.size());
+	for (size_t i = 0; i < mOrder.size(); ++i)
+		ordered[i] = mTriangles[mOrder[i]];
+	mTriangles.swap(ordered);
+	mCentroids.clear();
+	mOrder.clear();
+}
+//---------------------------------------------------------------------
+size_t HoudiniOgre_BVH::buildNode(size_t first, size_t count, size_t maxLeafSize)
+{
+	size_t nodeIndex = mNodes.size();
+	mNodes.push_back(Node());
+
+	Box bounds, centroidBounds;
+	for (size_t i = first; i < first + count; ++i)
+	{
+		const Triangle& tri = mTriangles[mOrder[i]];
+		for (int v = 0; v < 3; ++v)
+			bounds.merge(Ogre::Vector3(tri.v[v*3], tri.v[v*3+1], tri.v[v*3+2]));
+		centroidBounds.merge(mCentroids[mOrder[i]]);
+	}
+	Node& node = mNodes[nodeIndex];
+	for (int a = 0; a < 3; ++a)
+	{
+		node.min[a] = bounds.min[a];
+		node.max[a] = bounds.max[a];
+	}
+	node.offset = static_cast<Ogre::uint32>(first);
+	node.count = static_cast<Ogre::uint32>(count);
+	if (count <= maxLeafSize)
+		return nodeIndex;
+
+	// Find the cheapest split between bins on any axis
+	Ogre::Real parentArea = bounds.area();
+	Ogre::Real bestCost = Ogre::Math::POS_INFINITY;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		Ogre::Real extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0)
+			continue;
+		Ogre::Real scale = SAH_BINS / extent;
+
+		Box binBounds[SAH_BINS];
+		size_t binCounts[SAH_BINS] = { 0 };
+		for (size_t i = first; i < first + count; ++i)
+		{
+			int bin = std::min(SAH_BINS - 1, static_cast<int>(
+				(mCentroids[mOrder[i]][axis] - centroidBounds.min[axis]) * scale));
+			const Triangle& tri = mTriangles[mOrder[i]];
+			for (int v = 0; v < 3; ++v)
+				binBounds[bin].merge(Ogre::Vector3(tri.v[v*3], tri.v[v*3+1], tri.v[v*3+2]));
+			++binCounts[bin];
+		}
+
+		// sweep from the right to get the cost of everything above each split
+		Ogre::Real rightCost[SAH_BINS];
+		Box right;
+		size_t rightCount = 0;
+		for (int b = SAH_BINS - 1; b > 0; --b)
+		{
+			right.merge(binBounds[b]);
+			rightCount += binCounts[b];
+			rightCost[b] = right.area() * rightCount;
+		}
+		Box left;
+		size_t leftCount = 0;
+		for (int b = 1; b < SAH_BINS; ++b)
+		{
+			left.merge(binBounds[b - 1]);
+			leftCount += binCounts[b - 1];
+			Ogre::Real cost = TRAVERSAL_COST +
+				(left.area() * leftCount + rightCost[b]) / parentArea;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	size_t mid = first;
+	if (bestAxis >= 0)
+	{
+		// Not worth splitting if testing everything here is cheaper
+		if (bestCost >= count && count <= maxLeafSize * 4)
+			return nodeIndex;
+
+		Ogre::Real scale = SAH_BINS / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+		Ogre::Real minimum = centroidBounds.min[bestAxis];
+		Ogre::uint32* split = std::partition(&mOrder[first], &mOrder[first] + count,
+			[&](Ogre::uint32 t) {
+				return std::min(SAH_BINS - 1, static_cast<int>(
+					(mCentroids[t][bestAxis] - minimum) * scale)) < bestSplit;
+			});
+		mid = split - &mOrder[0];
+	}
+	if (mid == first || mid == first + count)
+	{
+		// All the centroids in one place; just halve the list
+		mid = first + count / 2;
+	}
+
+	buildNode(first, mid - first, maxLeafSize);
+	size_t rightIndex = buildNode(mid, first + count - mid, maxLeafSize);
+	// (the vector may have moved, don't use 'node')
+	mNodes[nodeIndex].offset = static_cast<Ogre::uint32>(rightIndex);
+	mNodes[nodeIndex].count = 0;
+	return nodeIndex;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_BVH::save(const Ogre::String& filename) const
+{
+	std::ofstream ofs(filename.c_str(), std::ios::binary);
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write BVH " + filename,
+			"HoudiniOgre_BVH::save");
+	}
+
+	Ogre::uint32 header[3] = { VERSION,
+		static_cast<Ogre::uint32>(mNodes.size()),
+		static_cast<Ogre::uint32>(mTriangles.size()) };
+	ofs.write("HBVH", 4);
+	ofs.write(reinterpret_cast<const char*>(header), sizeof(header));
+	if (!mNodes.empty())
+		ofs.write(reinterpret_cast<const char*>(&mNodes[0]), mNodes.size() * sizeof(Node));
+	if (!mTriangles.empty())
+		ofs.write(reinterpret_cast<const char*>(&mTriangles[0]), mTriangles.size() * sizeof(Triangle));
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_BVH::clear()
+{
+	mTriangles.clear();
+	mCentroids.clear();
+	mOrder.clear();
+	mNodes.clear();
+}
@@ -0,0 +1,126 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Bounds.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_Bounds__
+#define __HoudiniOgre_Bounds__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "OgreVector3.h"
+#include "OgreAxisAlignedBox.h"
+
+/** A bounding sphere which, unlike the one in a .mesh, need not be
+	centred on the origin. */
+struct HoudiniOgre_Sphere
+{
+	Ogre::Vector3 centre;
+	Ogre::Real radius;
+
+	HoudiniOgre_Sphere() : centre(Ogre::Vector3::ZERO), radius(0) {}
+
+	/** A tight sphere around a set of points.
+	@remarks
+		Ritter's approximation, then a few rounds of shrinking it and
+		growing it back over the points in a shuffled order, keeping the
+		smallest; typically within a percent or two of the minimal sphere.
+	*/
+	static HoudiniOgre_Sphere enclose(const std::vector<Ogre::Vector3>& points);
+	/// Grow to contain a point
+	void grow(const Ogre::Vector3& point);
+};
+
+/** Triangle bounding volume hierarchy, built once at export time so the
+	runtime can raycast and pick against a mesh without building a tree
+	on load.
+@remarks
+	Built top down with the surface area heuristic over binned centroids,
+	and stored flattened in depth first order: a node's first child
+	follows it directly and it records the index of its second, so a
+	traversal mostly walks forwards through memory. Triangles are stored
+	with their positions, in leaf order, so a leaf's triangles are
+	contiguous.
+@par
+	The file written by save() is, in native byte order:
+@code
+	char[4]  "HBVH"
+	uint32   version (1)
+	uint32   node count
+	uint32   triangle count
+	nodes:     float min[3], float max[3],
+	           uint32 offset (inner: second child node, leaf: first triangle),
+	           uint32 count (inner: 0, leaf: number of triangles)
+	triangles: float v0[3], v1[3], v2[3], uint32 triangle index within
+	           the submesh, uint16 submesh index, uint16 padding
+@endcode
+	Nodes are 32 bytes, two to a typical cache line.
+*/
+class HoudiniOgre_BVH
+{
+public:
+	enum { VERSION = 1 };
+
+	HoudiniOgre_BVH();
+
+	/// Add a triangle, from submesh subMesh where it is triangle number index
+	void addTriangle(const Ogre::Vector3& v0, const Ogre::Vector3& v1,
+		const Ogre::Vector3& v2, unsigned short subMesh, Ogre::uint32 index);
+	/// Build the tree over the triangles added so far
+	void build(size_t maxLeafSize = 4);
+	/// Write the tree, throws on failure
+	void save(const Ogre::String& filename) const;
+	/// Forget the triangles and tree
+	void clear();
+
+	size_t getTriangleCount() const { return mTriangles.size(); }
+	size_t getNodeCount() const { return mNodes.size(); }
+
+protected:
+	struct Triangle
+	{
+		float v[9];
+		Ogre::uint32 index;
+		unsigned short subMesh;
+		unsigned short padding;
+	};
+	struct Node
+	{
+		float min[3];
+		float max[3];
+		Ogre::uint32 offset;
+		Ogre::uint32 count;
+	};
+
+	/// Build the node for triangles [first, first + count), returns its index
+	size_t buildNode(size_t first, size_t count, size_t maxLeafSize);
+
+	std::vector<Triangle> mTriangles;
+	/// Triangle centroids, by triangle
+	std::vector<Ogre::Vector3> mCentroids;
+	/// Triangles in the order the leaves use them, partitioned while building
+	std::vector<Ogre::uint32> mOrder;
+	std::vector<Node> mNodes;
+
+};
+
+#endif
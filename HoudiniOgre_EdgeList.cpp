@@ -0,0 +1,317 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_EdgeList.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_EdgeList.h"
+#include "HoudiniOgre_Parallel.h"
+#include "HoudiniOgre_PositionHash.h"
+#include "HoudiniOgre_Trace.h"
+
+#include "OgreMesh.h"
+
+#include <algorithm>
+
+namespace
+{
+	/// Triangles per thread, below which it isn't worth starting one
+	const size_t TRIANGLE_GRAIN = 16384;
+}
+//---------------------------------------------------------------------
+HoudiniOgre_EdgeListBuilder::HoudiniOgre_EdgeListBuilder()
+: mVertexCount(0), mTriangleCount(0)
+{
+}
+//---------------------------------------------------------------------
+size_t HoudiniOgre_EdgeListBuilder::addVertexSet(const Ogre::VertexData* vertexData, 
+	const std::vector<Ogre::Vector3>& positions)
+{
+	mVertexSets.push_back(VertexSet());
+	VertexSet& set = mVertexSets.back();
+	set.vertexData = vertexData;
+	set.positions = positions;
+	set.firstVertex = mVertexCount;
+	mVertexCount += positions.size();
+	return mVertexSets.size() - 1;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_EdgeListBuilder::addIndexSet(size_t vertexSet, 
+	const Ogre::uint32* indexes, size_t count)
+{
+	mIndexSets.push_back(IndexSet());
+	IndexSet& set = mIndexSets.back();
+	set.vertexSet = vertexSet;
+	set.indexes.assign(indexes, indexes + count);
+	set.firstTriangle = mTriangleCount;
+	mTriangleCount += count / 3;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_EdgeListBuilder::clear()
+{
+	mVertexSets.clear();
+	mIndexSets.clear();
+	mVertexCount = 0;
+	mTriangleCount = 0;
+}
+//---------------------------------------------------------------------
+Ogre::EdgeData* HoudiniOgre_EdgeListBuilder::build()
+{
+	if (!mTriangleCount)
+		return 0;
+
+	HoudiniOgre_TraceSpan span("buildEdgeList", "", "triangles", 
+		static_cast<long>(mTriangleCount));
+
+	std::vector<Ogre::uint32> common;
+	findCommonVertices(common);
+
+	Ogre::EdgeData* data = new Ogre::EdgeData();
+	data->triangles.resize(mTriangleCount);
+	data->triangleFaceNormals.resize(mTriangleCount);
+	data->triangleLightFacings.resize(mTriangleCount);
+
+	// Triangles and their (unnormalised) face normals, as Ogre has them
+	HoudiniOgre_Parallel::forRange(mTriangleCount, TRIANGLE_GRAIN, 
+		[&](size_t begin, size_t end) {
+			// index set of the first triangle, the rest follow on
+			size_t s = 0;
+			while (s + 1 < mIndexSets.size() && mIndexSets[s + 1].firstTriangle <= begin)
+				++s;
+			for (size_t t = begin; t < end; ++t)
+			{
+				while (t >= mIndexSets[s].firstTriangle + mIndexSets[s].indexes.size() / 3)
+					++s;
+				const IndexSet& indexSet = mIndexSets[s];
+				const VertexSet& vertexSet = mVertexSets[indexSet.vertexSet];
+				Ogre::EdgeData::Triangle& tri = data->triangles[t];
+				tri.indexSet = s;
+				tri.vertexSet = indexSet.vertexSet;
+				size_t first = (t - indexSet.firstTriangle) * 3;
+				for (size_t v = 0; v < 3; ++v)
+				{
+					tri.vertIndex[v] = indexSet.indexes[first + v];
+					tri.sharedVertIndex[v] = common[vertexSet.firstVertex + tri.vertIndex[v]];
+				}
+				const Ogre::Vector3& v0 = vertexSet.positions[tri.vertIndex[0]];
+				Ogre::Vector3 normal = (vertexSet.positions[tri.vertIndex[1]] - v0).crossProduct(
+					vertexSet.positions[tri.vertIndex[2]] - v0);
+				data->triangleFaceNormals[t] = Ogre::Vector4(normal.x, normal.y, normal.z, 
+					-normal.dotProduct(v0));
+			}
+		});
+
+	// Partition the half edges by their lower vertex, so each edge's
+	// sides all land in the same partition; counted, then scattered
+	const size_t partitionCount = HoudiniOgre_Parallel::getThreadCount() * 4;
+	const size_t rangeCount = HoudiniOgre_Parallel::getThreadCount();
+	std::vector<size_t> offsets(rangeCount * partitionCount, 0);
+	HoudiniOgre_Parallel::forEach(rangeCount, 1, [&](size_t r) {
+		size_t* counts = &offsets[r * partitionCount];
+		for (size_t t = mTriangleCount * r / rangeCount; t < mTriangleCount * (r + 1) / rangeCount; ++t)
+		{
+			const Ogre::EdgeData::Triangle& tri = data->triangles[t];
+			for (size_t v = 0; v < 3; ++v)
+			{
+				++counts[std::min(tri.sharedVertIndex[v], tri.sharedVertIndex[(v + 1) % 3]) 
+					% partitionCount];
+			}
+		}
+	});
+	std::vector<size_t> partitionStarts(partitionCount + 1, 0);
+	size_t total = 0;
+	for (size_t p = 0; p < partitionCount; ++p)
+	{
+		partitionStarts[p] = total;
+		for (size_t r = 0; r < rangeCount; ++r)
+		{
+			size_t count = offsets[r * partitionCount + p];
+			offsets[r * partitionCount + p] = total;
+			total += count;
+		}
+	}
+	partitionStarts[partitionCount] = total;
+	std::vector<HalfEdge> halfEdges(total);
+	HoudiniOgre_Parallel::forEach(rangeCount, 1, [&](size_t r) {
+		size_t* next = &offsets[r * partitionCount];
+		for (size_t t = mTriangleCount * r / rangeCount; t < mTriangleCount * (r + 1) / rangeCount; ++t)
+		{
+			const Ogre::EdgeData::Triangle& tri = data->triangles[t];
+			for (size_t v = 0; v < 3; ++v)
+			{
+				HalfEdge h;
+				h.low = static_cast<Ogre::uint32>(
+					std::min(tri.sharedVertIndex[v], tri.sharedVertIndex[(v + 1) % 3]));
+				h.high = static_cast<Ogre::uint32>(
+					std::max(tri.sharedVertIndex[v], tri.sharedVertIndex[(v + 1) % 3]));
+				h.id = t * 3 + v;
+				halfEdges[next[h.low % partitionCount]++] = h;
+			}
+		}
+	});
+
+	// Sort and pair up each partition
+	const Ogre::uint32 none = ~Ogre::uint32(0);
+	std::vector<Ogre::uint32> creators(mTriangleCount * 3, none);
+	std::vector<std::vector<Ogre::EdgeData::Edge> > partitionEdges(partitionCount);
+	HoudiniOgre_Parallel::forEach(partitionCount, 1, [&](size_t p) {
+		if (partitionStarts[p] == partitionStarts[p + 1])
+			return;
+		HalfEdge* begin = &halfEdges[0] + partitionStarts[p];
+		HalfEdge* end = &halfEdges[0] + partitionStarts[p + 1];
+		std::sort(begin, end);
+		matchHalfEdges(*data, begin, end, partitionEdges[p], creators);
+	});
+
+	// Gather the edges into the group of their first triangle's vertex
+	// set, in the order of the half edge that created them
+	data->edgeGroups.resize(mVertexSets.size());
+	for (size_t s = 0; s < mVertexSets.size(); ++s)
+	{
+		data->edgeGroups[s].vertexSet = s;
+		data->edgeGroups[s].vertexData = mVertexSets[s].vertexData;
+	}
+	for (size_t id = 0; id < creators.size(); ++id)
+	{
+		if (creators[id] == none)
+			continue;
+		const Ogre::EdgeData::Triangle& tri = data->triangles[id / 3];
+		size_t low = std::min(tri.sharedVertIndex[id % 3], tri.sharedVertIndex[(id + 1) % 3]);
+		data->edgeGroups[tri.vertexSet].edges.push_back(
+			partitionEdges[low % partitionCount][creators[id]]);
+	}
+
+	return data;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_EdgeListBuilder::findCommonVertices(std::vector<Ogre::uint32>& common) const
+{
+	// First vertex in each position, in a hash table of chains
+	const Ogre::uint32 none = ~Ogre::uint32(0);
+	size_t bucketCount = 1;
+	while (bucketCount < mVertexCount * 2)
+		bucketCount <<= 1;
+	std::vector<Ogre::uint32> buckets(bucketCount, none);
+	std::vector<Ogre::uint32> chain;
+	std::vector<const Ogre::Vector3*> positions;
+	common.resize(mVertexCount);
+	size_t v = 0;
+	for (std::vector<VertexSet>::const_iterator s = mVertexSets.begin(); s != mVertexSets.end(); ++s)
+	{
+		for (std::vector<Ogre::Vector3>::const_iterator p = s->positions.begin(); 
+			p != s->positions.end(); ++p, ++v)
+		{
+			size_t bucket = HoudiniOgre_PositionHash::hash(*p) & (bucketCount - 1);
+			Ogre::uint32 match = none;
+			for (Ogre::uint32 k = buckets[bucket]; k != none; k = chain[k])
+			{
+				if (*positions[k] == *p)
+				{
+					match = k;
+					break;
+				}
+			}
+			if (match == none)
+			{
+				match = static_cast<Ogre::uint32>(positions.size());
+				positions.push_back(&*p);
+				chain.push_back(buckets[bucket]);
+				buckets[bucket] = match;
+			}
+			common[v] = match;
+		}
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_EdgeListBuilder::matchHalfEdges(const Ogre::EdgeData& data, 
+	const HalfEdge* begin, const HalfEdge* end, 
+	std::vector<Ogre::EdgeData::Edge>& edges, std::vector<Ogre::uint32>& creators)
+{
+	// Edges still waiting for a side running low to high [0] or high to low [1]
+	std::vector<Ogre::uint32> waiting[2];
+	size_t head[2];
+	for (const HalfEdge* run = begin; run != end; )
+	{
+		// all the half edges between the same two vertices, by triangle
+		const HalfEdge* runEnd = run + 1;
+		while (runEnd != end && runEnd->low == run->low && runEnd->high == run->high)
+			++runEnd;
+
+		waiting[0].clear();
+		waiting[1].clear();
+		head[0] = head[1] = 0;
+		for (const HalfEdge* h = run; h != runEnd; ++h)
+		{
+			size_t t = h->id / 3;
+			size_t v = h->id % 3;
+			const Ogre::EdgeData::Triangle& tri = data.triangles[t];
+			// an edge running low to high waits for one running high to low
+			int side = tri.sharedVertIndex[v] == h->low && h->low != h->high ? 1 : 0;
+			if (head[1 - side] < waiting[1 - side].size())
+			{
+				Ogre::EdgeData::Edge& e = edges[waiting[1 - side][head[1 - side]++]];
+				e.triIndex[1] = t;
+				e.degenerate = false;
+			}
+			else
+			{
+				Ogre::EdgeData::Edge e;
+				e.triIndex[0] = e.triIndex[1] = t;
+				e.vertIndex[0] = tri.vertIndex[v];
+				e.vertIndex[1] = tri.vertIndex[(v + 1) % 3];
+				e.sharedVertIndex[0] = tri.sharedVertIndex[v];
+				e.sharedVertIndex[1] = tri.sharedVertIndex[(v + 1) % 3];
+				e.degenerate = true;
+				creators[h->id] = static_cast<Ogre::uint32>(edges.size());
+				waiting[side].push_back(static_cast<Ogre::uint32>(edges.size()));
+				edges.push_back(e);
+			}
+		}
+		run = runEnd;
+	}
+}
+//---------------------------------------------------------------------
+//---------------------------------------------------------------------
+bool HoudiniOgre_MeshSerializer::hasAttachedEdgeList(const Ogre::Mesh* pMesh) const
+{
+	return !pMesh->isEdgeListBuilt() && pMesh->getNumLodLevels() == 1 && 
+		pMesh->getLodLevel(0).edgeData != 0;
+}
+//---------------------------------------------------------------------
+size_t HoudiniOgre_MeshSerializer::calcMeshSize(const Ogre::Mesh* pMesh)
+{
+	size_t size = Ogre::MeshSerializerImpl::calcMeshSize(pMesh);
+	if (hasAttachedEdgeList(pMesh))
+	{
+		size += calcEdgeListSize(pMesh);
+	}
+	return size;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_MeshSerializer::writeMesh(const Ogre::Mesh* pMesh)
+{
+	Ogre::MeshSerializerImpl::writeMesh(pMesh);
+	// chunks are read in any order, so this can follow the rest
+	if (hasAttachedEdgeList(pMesh))
+	{
+		writeEdgeList(pMesh);
+	}
+}
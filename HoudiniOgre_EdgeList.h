@@ -0,0 +1,146 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_EdgeList.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_EdgeList__
+#define __HoudiniOgre_EdgeList__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "OgreVector3.h"
+#include "OgreEdgeListBuilder.h"
+#include "OgreMeshSerializerImpl.h"
+
+/** Builds the edge list (shadow volume and silhouette connectivity) of a
+	mesh from the vertices and indexes the exporter has already baked,
+	in place of Ogre::Mesh::buildEdgeList.
+@remarks
+	Ogre's builder reads every buffer back and matches edges through a
+	map, one at a time. This one is given the positions and indexes as
+	they are baked, and matches by sorting: the half edges of all the
+	triangles are partitioned by their lower vertex, each partition is
+	sorted and paired up on its own thread, and triangles and face
+	normals are filled in parallel too. Only the first LOD is built;
+	the exporter doesn't generate automatic LODs.
+@par
+	The result is identical in layout to Ogre's: vertex sets and index
+	sets are numbered the same way (the mesh's shared vertex data first,
+	if any, then each SubMesh with vertex data of its own; one index set
+	per SubMesh), vertices in the same position are common whatever set
+	they're in, and each edge is in the group of the vertex set of its
+	first triangle, in the order Ogre would have created it. An edge
+	matches the earliest unmatched edge running the other way between
+	the same vertices; one with no match is degenerate, with both
+	triangles the same.
+*/
+class HoudiniOgre_EdgeListBuilder
+{
+public:
+	HoudiniOgre_EdgeListBuilder();
+
+	/** Add the positions of a vertex set.
+	@returns The vertex set's index, in the order added
+	*/
+	size_t addVertexSet(const Ogre::VertexData* vertexData, 
+		const std::vector<Ogre::Vector3>& positions);
+	/// Add a triangle list of count indexes over a vertex set, as the next index set
+	void addIndexSet(size_t vertexSet, const Ogre::uint32* indexes, size_t count);
+	/** Build the edge list of everything added.
+	@returns The edge data, which the caller must delete, or 0 if there
+		were no triangles
+	*/
+	Ogre::EdgeData* build();
+	/// Forget everything added
+	void clear();
+
+	size_t getVertexSetCount() const { return mVertexSets.size(); }
+
+protected:
+	struct VertexSet
+	{
+		const Ogre::VertexData* vertexData;
+		std::vector<Ogre::Vector3> positions;
+		/// Index of the first of this set's vertices among all of them
+		size_t firstVertex;
+	};
+	struct IndexSet
+	{
+		size_t vertexSet;
+		std::vector<Ogre::uint32> indexes;
+		/// Index of the set's first triangle among all of them
+		size_t firstTriangle;
+	};
+	/// One side of an edge, as a triangle sees it
+	struct HalfEdge
+	{
+		/// Common vertices at the ends, lower first
+		Ogre::uint32 low, high;
+		/// triangle * 3 + the edge's place in the triangle
+		size_t id;
+
+		bool operator<(const HalfEdge& rhs) const
+		{
+			if (low != rhs.low)
+				return low < rhs.low;
+			if (high != rhs.high)
+				return high < rhs.high;
+			return id < rhs.id;
+		}
+	};
+
+	/// Number every vertex in the same position the same, across all sets
+	void findCommonVertices(std::vector<Ogre::uint32>& common) const;
+	/** Pair up the sorted half edges of one partition, adding an edge to
+		edges for each which finds nothing to pair with, and recording its
+		index in creators (by half edge id). */
+	static void matchHalfEdges(const Ogre::EdgeData& data, const HalfEdge* begin, 
+		const HalfEdge* end, std::vector<Ogre::EdgeData::Edge>& edges, 
+		std::vector<Ogre::uint32>& creators);
+
+	std::vector<VertexSet> mVertexSets;
+	std::vector<IndexSet> mIndexSets;
+	size_t mVertexCount;
+	size_t mTriangleCount;
+};
+
+/** Mesh serializer which also writes edge lists attached to the mesh
+	from outside.
+@remarks
+	Ogre only writes edge lists the mesh built itself (or loaded), and
+	only Ogre::Mesh's friends can say it has; an edge list from
+	HoudiniOgre_EdgeListBuilder is attached to the LOD usage directly,
+	and this writes it out the same as Ogre would have.
+*/
+class HoudiniOgre_MeshSerializer : public Ogre::MeshSerializerImpl
+{
+public:
+	HoudiniOgre_MeshSerializer() {}
+
+protected:
+	size_t calcMeshSize(const Ogre::Mesh* pMesh);
+	void writeMesh(const Ogre::Mesh* pMesh);
+	/// Has pMesh an edge list Ogre won't write itself?
+	bool hasAttachedEdgeList(const Ogre::Mesh* pMesh) const;
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Escape.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_Escape__
+#define __HoudiniOgre_Escape__
+
+#include "HoudiniOgre_Prerequisites.h"
+
+/** Escaping for names written into the XML and JSON files which go
+	alongside the meshes (material names and file paths may hold any
+	character). */
+struct HoudiniOgre_Escape
+{
+	/// For an XML attribute value (in double quotes)
+	static Ogre::String xml(const Ogre::String& str)
+	{
+		Ogre::String ret;
+		ret.reserve(str.size());
+		for (Ogre::String::const_iterator i = str.begin(); i != str.end(); ++i)
+		{
+			switch (*i)
+			{
+			case '&': ret += "&amp;"; break;
+			case '<': ret += "&lt;"; break;
+			case '>': ret += "&gt;"; break;
+			case '"': ret += "&quot;"; break;
+			default: ret += *i; break;
+			}
+		}
+		return ret;
+	}
+
+	/// For the inside of a JSON string; other control characters become spaces
+	static Ogre::String json(const Ogre::String& str)
+	{
+		Ogre::String ret;
+		ret.reserve(str.size());
+		for (Ogre::String::const_iterator i = str.begin(); i != str.end(); ++i)
+		{
+			char c = *i;
+			switch (c)
+			{
+			case '"': ret += "\\\""; break;
+			case '\\': ret += "\\\\"; break;
+			case '\n': ret += "\\n"; break;
+			case '\r': ret += "\\r"; break;
+			case '\t': ret += "\\t"; break;
+			default:
+				ret += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+			}
+		}
+		return ret;
+	}
+};
+
+#endif
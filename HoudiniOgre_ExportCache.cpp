@@ -0,0 +1,241 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_ExportCache.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_ExportCache.h"
+
+#include "OgreLogManager.h"
+#include "OgreHardwareVertexBuffer.h"
+
+#include <cstdio>
+#include <fstream>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	include <direct.h>
+#else
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+//---------------------------------------------------------------------
+void HoudiniOgre_Hash::addGeometry(const HoudiniOgre_GeometrySource& source,
+	bool useObjectTransforms)
+{
+	add(source.getName());
+	if (useObjectTransforms)
+	{
+		Ogre::Matrix4 xform;
+		Ogre::Matrix3 rot;
+		source.getWorldTransform(xform, rot);
+		add(xform[0], sizeof(Ogre::Real) * 16);
+	}
+	addLocalGeometry(source);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Hash::addLocalGeometry(const HoudiniOgre_GeometrySource& source)
+{
+	add(source.getMaterialName());
+	const HoudiniOgre_GeometrySource::MaterialGroupList& groups = source.getMaterialGroups();
+	add(groups.size());
+	for (HoudiniOgre_GeometrySource::MaterialGroupList::const_iterator g = groups.begin();
+		g != groups.end(); ++g)
+	{
+		add(g->name);
+		add(g->materialName);
+		add(g->primitives.size());
+		if (!g->primitives.empty())
+			add(&g->primitives[0], g->primitives.size() * sizeof(int));
+	}
+
+	bool normals = source.hasNormals();
+	bool colours = source.hasColours();
+	size_t uvSets = source.getUVSetCount();
+	add(normals);
+	add(colours);
+	add(uvSets);
+
+	int pointCount = source.getPointCount();
+	add(pointCount);
+	for (int p = 0; p < pointCount; ++p)
+	{
+		add(source.getPointPosition(p));
+	}
+
+	int primCount = source.getPrimitiveCount();
+	add(primCount);
+	for (int prim = 0; prim < primCount; ++prim)
+	{
+		if (!source.isPolygon(prim))
+		{
+			add(-1);
+			continue;
+		}
+		int vcount = source.getPrimitiveVertexCount(prim);
+		add(vcount);
+		for (int v = 0; v < vcount; ++v)
+		{
+			add(source.getVertexPoint(prim, v));
+			if (normals)
+				add(source.getNormal(prim, v));
+			for (size_t uv = 0; uv < uvSets; ++uv)
+			{
+				float u, w;
+				source.getUV(uv, prim, v, u, w);
+				add(u);
+				add(w);
+			}
+			if (colours)
+			{
+				Ogre::ColourValue col = source.getColour(prim, v);
+				add(col.r);
+				add(col.g);
+				add(col.b);
+				add(col.a);
+			}
+		}
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Hash::addCapture(const HoudiniOgre_GeometrySource& source)
+{
+	size_t regionCount = source.getCaptureRegionCount();
+	add(regionCount);
+	for (size_t r = 0; r < regionCount; ++r)
+	{
+		const OBJ_Bone* bone = source.getCaptureRegionBone(r);
+		add(&bone, sizeof(bone));
+	}
+
+	std::vector<int> regions;
+	std::vector<float> weights;
+	int pointCount = source.getPointCount();
+	for (int p = 0; p < pointCount; ++p)
+	{
+		source.getCaptureWeights(p, regions, weights);
+		add(regions.size());
+		if (!regions.empty())
+		{
+			add(&regions[0], regions.size() * sizeof(int));
+			add(&weights[0], weights.size() * sizeof(float));
+		}
+	}
+}
+//---------------------------------------------------------------------
+Ogre::String HoudiniOgre_Hash::toString() const
+{
+	char buf[17];
+	sprintf(buf, "%016llx", mValue);
+	return buf;
+}
+//---------------------------------------------------------------------
+//---------------------------------------------------------------------
+HoudiniOgre_ExportCache::HoudiniOgre_ExportCache(const Ogre::String& folder)
+: mFolder(folder), mHits(0), mMisses(0)
+{
+	if (!Ogre::StringUtil::endsWith(mFolder, "/"))
+		mFolder += "/";
+
+	// fine if it already exists
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	_mkdir(mFolder.c_str());
+#else
+	mkdir(mFolder.c_str(), 0777);
+#endif
+}
+//---------------------------------------------------------------------
+HoudiniOgre_Hash HoudiniOgre_ExportCache::createKey()
+{
+	HoudiniOgre_Hash key;
+	key.add(static_cast<int>(FORMAT_VERSION));
+	key.add(static_cast<int>(OGRE_VERSION));
+	// colours are written in the render system's preferred order
+	key.add(static_cast<int>(Ogre::VertexElement::getBestColourVertexElementType()));
+	return key;
+}
+//---------------------------------------------------------------------
+Ogre::String HoudiniOgre_ExportCache::getEntryName(const HoudiniOgre_Hash& key,
+	const Ogre::String& filename) const
+{
+	// keep the extension so .mesh and .skeleton entries don't collide; 
+	// all of it, since .chunks.xml and .bounds.xml would otherwise
+	Ogre::String::size_type slash = filename.find_last_of("/\\");
+	Ogre::String::size_type dot = filename.find('.', 
+		slash == Ogre::String::npos ? 0 : slash + 1);
+	Ogre::String ext = dot == Ogre::String::npos ? Ogre::StringUtil::BLANK : filename.substr(dot);
+	return mFolder + key.toString() + ext;
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_ExportCache::retrieve(const HoudiniOgre_Hash& key,
+	const std::vector<Ogre::String>& filenames)
+{
+	for (std::vector<Ogre::String>::const_iterator f = filenames.begin();
+		f != filenames.end(); ++f)
+	{
+		Ogre::String entry = getEntryName(key, *f);
+		if (!copyFile(entry, *f))
+		{
+			++mMisses;
+			return false;
+		}
+		Ogre::LogManager::getSingleton().logMessage(
+			"Export cache hit: " + entry + " -> " + *f);
+	}
+	++mHits;
+	return true;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_ExportCache::store(const HoudiniOgre_Hash& key,
+	const std::vector<Ogre::String>& filenames)
+{
+	for (std::vector<Ogre::String>::const_iterator f = filenames.begin();
+		f != filenames.end(); ++f)
+	{
+		// Copy under a temporary name first so that a concurrent export never
+		// sees half an entry
+		Ogre::String entry = getEntryName(key, *f);
+		Ogre::String temp = entry + ".tmp";
+		if (copyFile(*f, temp))
+		{
+			std::remove(entry.c_str());
+			if (std::rename(temp.c_str(), entry.c_str()) != 0)
+				std::remove(temp.c_str());
+		}
+		else
+		{
+			Ogre::LogManager::getSingleton().logMessage(
+				"Unable to add " + *f + " to the export cache");
+		}
+	}
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_ExportCache::copyFile(const Ogre::String& from, const Ogre::String& to)
+{
+	std::ifstream ifs(from.c_str(), std::ios::binary);
+	if (!ifs)
+		return false;
+	std::ofstream ofs(to.c_str(), std::ios::binary | std::ios::trunc);
+	if (!ofs)
+		return false;
+	ofs << ifs.rdbuf();
+	return ofs.good();
+}
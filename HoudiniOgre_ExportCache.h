@@ -0,0 +1,138 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_ExportCache.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_ExportCache__
+#define __HoudiniOgre_ExportCache__
+
+#include "HoudiniOgre_GeometrySource.h"
+
+/** Incremental 64-bit FNV-1a hash, used to fingerprint export inputs.
+*/
+class HoudiniOgre_Hash
+{
+public:
+	typedef unsigned long long Value;
+
+	HoudiniOgre_Hash() : mValue(14695981039346656037ULL) {}
+
+	void add(const void* data, size_t size)
+	{
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			mValue ^= p[i];
+			mValue *= 1099511628211ULL;
+		}
+	}
+	void add(int val) { add(&val, sizeof(val)); }
+	void add(size_t val) { add(&val, sizeof(val)); }
+	void add(bool val) { add(val ? 1 : 0); }
+	void add(float val) { add(&val, sizeof(val)); }
+	void add(const Ogre::Vector3& val) { add(val.x); add(val.y); add(val.z); }
+	void add(const Ogre::String& val) { add(val.size()); add(val.data(), val.size()); }
+
+	/** Hash everything HoudiniOgre_Mesh::addGeometry reads from a source:
+		topology, positions, the attributes present, materials and names,
+		plus the world transform if it's going to be baked in. */
+	void addGeometry(const HoudiniOgre_GeometrySource& source, bool useObjectTransforms);
+	/** Hash just the geometry in the source's own space, leaving out its
+		name and transform, so that copies of the same object match. */
+	void addLocalGeometry(const HoudiniOgre_GeometrySource& source);
+	/** Hash a source's capture regions and weights, which the bone
+		assignments come from. Bones are identified by address, so these
+		hashes are only comparable within one session. */
+	void addCapture(const HoudiniOgre_GeometrySource& source);
+
+	Value getValue() const { return mValue; }
+	/// The hash as 16 hex digits
+	Ogre::String toString() const;
+
+protected:
+	Value mValue;
+};
+
+/** On-disk cache of exported files, keyed by a hash of their inputs.
+@remarks
+	After an export, the files written are copied into the cache folder
+	named by the hash of what went into them (see HoudiniOgre_Hash); a later
+	export with the same hash copies them back out instead of doing the
+	work again. Entries are never evicted; delete the folder to clear it.
+@par
+	Only geometry without capture weights is cached, since a skeleton's
+	animation depends on bone channels which aren't part of the geometry.
+*/
+class HoudiniOgre_ExportCache
+{
+public:
+	/// Bump this whenever a change to the exporter alters its output
+	enum { FORMAT_VERSION = 7 };
+
+	/// Cache in the given folder, which is created if necessary
+	HoudiniOgre_ExportCache(const Ogre::String& folder);
+
+	/** A key to add the inputs of an export to; it starts off with the
+		exporter and Ogre versions so that upgrades don't reuse old files. */
+	static HoudiniOgre_Hash createKey();
+
+	/// Can exports of this geometry be cached?
+	static bool isCacheable(const HoudiniOgre_GeometrySource& source)
+	{
+		return source.getCaptureRegionCount() == 0;
+	}
+
+	/** Copy the cached file for this key to filename.
+	@returns false if there is no such entry (or it couldn't be copied)
+	*/
+	bool retrieve(const HoudiniOgre_Hash& key, const Ogre::String& filename)
+	{
+		return retrieve(key, std::vector<Ogre::String>(1, filename));
+	}
+	/** Copy the cached files for this key out, all or nothing; an export
+		writing several files counts as one hit or miss.
+	@returns false if any of them is missing (or couldn't be copied)
+	*/
+	bool retrieve(const HoudiniOgre_Hash& key, const std::vector<Ogre::String>& filenames);
+	/// Add a freshly exported file to the cache under this key
+	void store(const HoudiniOgre_Hash& key, const Ogre::String& filename)
+	{
+		store(key, std::vector<Ogre::String>(1, filename));
+	}
+	/// Add freshly exported files to the cache under this key
+	void store(const HoudiniOgre_Hash& key, const std::vector<Ogre::String>& filenames);
+
+	size_t getHits() const { return mHits; }
+	size_t getMisses() const { return mMisses; }
+
+protected:
+	Ogre::String getEntryName(const HoudiniOgre_Hash& key, const Ogre::String& filename) const;
+	static bool copyFile(const Ogre::String& from, const Ogre::String& to);
+
+	Ogre::String mFolder;
+	size_t mHits;
+	size_t mMisses;
+
+};
+
+#endif
@@ -0,0 +1,680 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_GUDetailSource.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_GUDetailSource.h"
+
+#include "OgreNoMemoryMacros.h"
+#include <GU/GU_Detail.h>
+#include <GU/GU_DetailHandle.h>
+#include <GEO/GEO_Primitive.h>
+#include <GEO/GEO_PrimPoly.h>
+#include <GEO/GEO_AttributeHandle.h>
+#include <OP/OP_Node.h>
+#include <OP/OP_Operator.h>
+#include <OP/OP_Director.h>
+#include <OP/OP_Utils.h>
+#include <PRM/PRM_Parm.h>
+#include <SOP/SOP_Node.h>
+#include <SOP/SOP_CaptureData.h>
+#include <GB/GB_Group.h>
+#include <GB/GB_ElementTree.h>
+#include <UT/UT_DMatrix4.h>
+#include <UT/UT_DMatrix3.h>
+#include <OBJ/OBJ_Node.h>
+#include <OBJ/OBJ_Bone.h>
+#include <CH/CH_Manager.h>
+#include "OgreMemoryMacros.h"
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+
+namespace
+{
+	/// The (shared) point a vertex is based on
+	inline const GEO_Point* getPoint(const GU_Detail* detail, const GEO_Vertex& vertex)
+	{
+		return detail->points()(vertex.getBasePt()->getNum());
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_GUDetailSource::HoudiniOgre_GUDetailSource(const OP_Node* objNode,
+													   float frameTime)
+: mObjNode(objNode), mFrameTime(frameTime), mName(objNode->getName()),
+  mLock(0), mDetail(0), mColumns(0), mNormalAttrib(-1), mNormalsOnVertices(false),
+  mDiffuseAttrib(-1), mDiffuseOnVertices(false), mCaptureLock(0), mCaptureDetail(0)
+{
+	mFrame = static_cast<long>(OPgetDirector()->getChannelManager()->getSample(frameTime));
+
+	// First derive the geometry we need to look at.
+	// Originally, I was taking tha geometry pre-deformation if we're animating,
+	// because I wanted the base mesh. However, Houdini only stores 'capture' transforms
+	// on bones, whilst we need capture transforms on everything that could be
+	// affecting those bones too (like nulls acting as centres or mid-skeleton offsets)
+	// This is because we need to recreate the animation, not just sample the
+	// outcomes which is what Houdini expects.
+	// When it comes down to it, skeletal animation is about deltas, so as long
+	// as we are consistent about the 'bind' pose of both mesh and skeleton, we
+	// can pick any pose at all to represent it. So instead, we'll pick a frame
+	// and sample the final mesh and skeleton (with nulls and such) at that point,
+	// and express all animation as a delta to that.
+
+	// Use Display flag (blue) rather than Render flag (purple)
+	mLock = new GU_DetailHandleAutoReadLock(
+		objNode->castToOBJNode()->getDisplayGeometryHandle(frameTime));
+
+	mDetail = const_cast<GU_Detail*> (mLock->getGdp());
+	// const GU_Detail *guDetail = gdl.getGdp();  // SESI prefers this ... but it causes problems later on.
+
+	findAttributes();
+	findMaterials();
+	findCapture();
+}
+//---------------------------------------------------------------------
+HoudiniOgre_GUDetailSource::HoudiniOgre_GUDetailSource(const GU_Detail* detail,
+													   const Ogre::String& name)
+: mObjNode(0), mFrameTime(0), mFrame(0), mName(name),
+  mLock(0), mDetail(const_cast<GU_Detail*>(detail)), mColumns(0), mNormalAttrib(-1), mNormalsOnVertices(false),
+  mDiffuseAttrib(-1), mDiffuseOnVertices(false), mCaptureLock(0), mCaptureDetail(0)
+{
+	findAttributes();
+}
+//---------------------------------------------------------------------
+HoudiniOgre_GUDetailSource::~HoudiniOgre_GUDetailSource()
+{
+	delete mCaptureLock;
+	delete mLock;
+	delete mColumns;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::findAttributes()
+{
+	// try vertices first
+	// NB Houdini doesn't support per-vertex normals yet, but we might as well
+	// cope with this since it's a popular RFE
+	mNormalAttrib = mDetail->findVertexAttrib("N", sizeof(UT_Vector3), GB_ATTRIB_VECTOR);
+	if (mNormalAttrib >= 0)
+	{
+		mNormalsOnVertices = true;
+	}
+	else
+	{
+		mNormalAttrib = mDetail->findPointAttrib("N", sizeof(UT_Vector3), GB_ATTRIB_VECTOR);
+		mNormalsOnVertices = false;
+	}
+
+	mUVAttribs.clear();
+	mUVOnVertices.clear();
+	for (int uvset = 0; uvset < OGRE_MAX_TEXTURE_COORD_SETS; ++uvset)
+	{
+		Ogre::StringUtil::StrStreamType uvname;
+		uvname << "uv";
+		if (uvset > 0) // no uv1, just uv
+		{
+			uvname << (uvset + 1);
+		}
+		// Try to find on vertices first
+		int uvAttrib = mDetail->findVertexAttrib(uvname.str().c_str(),
+			3*sizeof(float), GB_ATTRIB_FLOAT);
+		bool uvsOnVertices = true;
+		if (uvAttrib < 0)
+		{
+			uvsOnVertices = false;
+			uvAttrib = mDetail->findPointAttrib(uvname.str().c_str(),
+				3*sizeof(float), GB_ATTRIB_FLOAT);
+			// no good?
+			if (uvAttrib < 0)
+				break;
+		}
+		mUVAttribs.push_back(uvAttrib);
+		mUVOnVertices.push_back(uvsOnVertices);
+
+	}
+
+	mDiffuseAttrib = mDetail->findVertexAttrib("Cd", 3*sizeof(float), GB_ATTRIB_FLOAT);
+	if (mDiffuseAttrib >= 0)
+	{
+		mDiffuseOnVertices = true;
+	}
+	else
+	{
+		mDiffuseAttrib = mDetail->findPointAttrib("Cd", 3*sizeof(float), GB_ATTRIB_FLOAT);
+		mDiffuseOnVertices = false;
+	}
+
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::findMaterials()
+{
+	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
+
+	// Get global shader name
+	// Houdini's not very good at const correctness, have to cast away const here
+	PRM_Parm& shaderParm = const_cast<PRM_Parm&>(mObjNode->getParm("shop_surfacepath"));
+	UT_String shaderName;
+	shaderParm.getValue(mFrameTime, shaderName, 0, 0);
+
+	mMaterialName = Ogre::String(shaderName);
+	lmgr.logMessage("Object surface shader: " + mMaterialName);
+
+	// Now go looking for 'shop' SOPs which can change materials per poly
+
+	for (int c = 0; c < mObjNode->getNchildren(); ++c)
+	{
+		OP_Node* child = mObjNode->getChild(c);
+		OP_Operator* op = child->getOperator();
+		// Hmm, all nodes appear to be of OpType "SOP", whilst I need to look for
+		// the detail type ie 'shop'
+		lmgr.logMessage("Child " + Ogre::String(child->getName()) + " is of type "
+			+ Ogre::String(child->getOpType()) + " and opname " + Ogre::String(op->getName()));
+
+		// Shader operator can change shaders per sub-object, we must respect that
+		if (op->getName() == "shop")
+		{
+			// You can specify a new shader one of 2 ways, in the generic 'surface'
+			// property (quicksurface) or in the 'Primary' tab 'Surface Shader'
+			// property (surfpath1). To be honest I'm not sure which should 'win'
+			// if both are specified, so I'm going to use the quicksurface if its there
+			PRM_Parm& quicksurface = child->getParm("quicksurface");
+			UT_String val;
+			quicksurface.getValue(mFrameTime, val, 0, 0);
+			if (val == "")
+			{
+				// try surfpath1
+				PRM_Parm& surfpath1 = child->getParm("surfpath1");
+				surfpath1.getValue(mFrameTime, val, 0, 0);
+			}
+
+			if (val != "")
+			{
+				Ogre::String subMaterial(val);
+				// does it differ from main material?
+				if (subMaterial != mMaterialName)
+				{
+					lmgr.logMessage("specialised material: " + subMaterial);
+
+					MaterialGroup group;
+					group.name = Ogre::String(child->getName()); // name submesh based on SOP
+					group.materialName = subMaterial;
+
+					// Get a list of primitive groups that are using this shader
+					SOP_Node* sopNode = child->castToSOPNode();
+					GB_PrimitiveGroup* gbPrim = sopNode->parsePrimitiveGroupsCopy("*", mDetail);
+					GB_ElementTree* tree =  gbPrim->ordered();
+					group.primitives.reserve(gbPrim->entries());
+					Ogre::StringUtil::StrStreamType str;
+					str << "Primitives referenced: ";
+					for (const GB_Element* cur = tree->head(); cur != 0; cur = tree->next(cur))
+					{
+						group.primitives.push_back(cur->getNum());
+						str << cur->getNum() << " ";
+					}
+					lmgr.logMessage(str.str());
+
+					// clean up
+					sopNode->destroyAdhocGroup(gbPrim);
+
+					mMaterialGroups.push_back(group);
+				}
+			}
+
+		}
+
+	}
+
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::findCapture()
+{
+	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
+	lmgr.logMessage("Looking for bone assignments...");
+
+	OP_Node *deformerNode = OPfindOpInput(mObjNode->castToOBJNode()->getDisplaySopPtr(), "deform");
+
+	if (!deformerNode)
+	{
+		lmgr.logMessage("No deform SOP found, no bone assignments.");
+		return;
+	}
+
+	// we want pre-deformation
+	SOP_Node* captureSOP = CAST_SOPNODE(deformerNode->getInput(0));
+	if (!captureSOP)
+	{
+		lmgr.logMessage("No inputs to deform node, no bone assignments.");
+		return;
+	}
+
+	OP_Context tempCtx(0.0);
+	mCaptureLock = new GU_DetailHandleAutoReadLock(captureSOP->getCookedGeoHandle(tempCtx));
+	mCaptureDetail = const_cast<GU_Detail*>(mCaptureLock->getGdp());
+
+	// Now build a capture data helper to assist us getting nodes later.
+	SOP_CaptureData capture_data;
+	capture_data.initialize(captureSOP, mCaptureDetail);
+
+
+	UT_String sop_path, root_path;
+	mCaptureDetail->getCaptureRegionRootPath( root_path );
+	root_path += "/";
+
+	int numRegions = capture_data.getNumRegions();
+	lmgr.logMessage("Number of capture regions: " + Ogre::StringConverter::toString(numRegions));
+	// Probably should never happen, but lets be safe
+	if (numRegions == 0)
+	{
+		lmgr.logMessage("No capture regions found, no bone assignments.");
+		return;
+	}
+
+	for (int b = 0; b < numRegions; ++b)
+	{
+		sop_path = root_path;
+		sop_path += capture_data.getSOPPath(b);
+		// Have to remove trailing digits since this path includes '0' on the end for cregion primitive
+		// which is not part of the cregion object name
+		sop_path.removeTrailingDigits();
+		OP_Node* cregion = captureSOP->findNode(sop_path);
+		OBJ_Bone* bone = cregion->getCreator()->castToOBJNode()->castToOBJBone();
+		//UT_String s = bone->getName();
+		Ogre::StringUtil::StrStreamType msg;
+		msg << "Bone found: " << bone->getName();
+		lmgr.logMessage(msg.str());
+
+		mCaptureBones.push_back(bone);
+	}
+
+}
+//---------------------------------------------------------------------
+int HoudiniOgre_GUDetailSource::getPointCount() const
+{
+	if (mColumns)
+		return static_cast<int>(mColumns->positions.size());
+	return mDetail->points().entries();
+}
+//---------------------------------------------------------------------
+int HoudiniOgre_GUDetailSource::getPrimitiveCount() const
+{
+	if (mColumns)
+		return static_cast<int>(mColumns->primitiveStarts.size()) - 1;
+	return mDetail->primitives().entries();
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_GUDetailSource::isPolygon(int prim) const
+{
+	if (mColumns)
+		return mColumns->primitiveStarts[prim + 1] > mColumns->primitiveStarts[prim];
+	const GEO_Primitive* p = mDetail->primitives()(prim);
+	// only support polys for the moment
+	return p->getPrimitiveId() == GEOPRIMPOLY &&
+		!static_cast<const GEO_PrimPoly*>(p)->isDegenerate();
+}
+//---------------------------------------------------------------------
+int HoudiniOgre_GUDetailSource::getPrimitiveVertexCount(int prim) const
+{
+	if (mColumns)
+		return static_cast<int>(mColumns->primitiveStarts[prim + 1] - mColumns->primitiveStarts[prim]);
+	return static_cast<const GEO_PrimPoly*>(mDetail->primitives()(prim))->getVertexCount();
+}
+//---------------------------------------------------------------------
+int HoudiniOgre_GUDetailSource::getVertexPoint(int prim, int vertex) const
+{
+	if (mColumns)
+		return mColumns->vertexPoints[mColumns->primitiveStarts[prim] + vertex];
+	const GEO_PrimPoly* primPoly = static_cast<const GEO_PrimPoly*>(mDetail->primitives()(prim));
+	// elem->getNum indicates the unique point number on the geom
+	return primPoly->getVertex(vertex).getBasePt()->getNum();
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_GUDetailSource::getPointPosition(int point) const
+{
+	if (mColumns)
+		return mColumns->positions[point];
+	return HoudiniMappings::toVec3(mDetail->points()(point)->getPos());
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_GUDetailSource::getNormal(int prim, int vertex) const
+{
+	if (mColumns)
+		return mColumns->normals[mColumns->primitiveStarts[prim] + vertex];
+	const GEO_PrimPoly* primPoly = static_cast<const GEO_PrimPoly*>(mDetail->primitives()(prim));
+	const GEO_Vertex& hVertex = primPoly->getVertex(vertex);
+	const UT_Vector3* norm;
+	if (mNormalsOnVertices)
+		norm = static_cast<const UT_Vector3*>(hVertex.getAttribData(mNormalAttrib));
+	else
+		norm = static_cast<const UT_Vector3*>(getPoint(mDetail, hVertex)->getAttribData(mNormalAttrib));
+	return HoudiniMappings::toVec3(*norm);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::getUV(size_t uvSet, int prim, int vertex,
+									   float& u, float& v) const
+{
+	if (mColumns)
+	{
+		const float* uv = &mColumns->uvs[uvSet][(mColumns->primitiveStarts[prim] + vertex) * 2];
+		u = uv[0];
+		v = uv[1];
+		return;
+	}
+	const GEO_PrimPoly* primPoly = static_cast<const GEO_PrimPoly*>(mDetail->primitives()(prim));
+	const GEO_Vertex& hVertex = primPoly->getVertex(vertex);
+	const float* uv;
+	// Houdini seems to store 3D UVs all the time even when they're not useful
+	if (mUVOnVertices[uvSet])
+		uv = static_cast<const float*>(hVertex.getAttribData(mUVAttribs[uvSet]));
+	else
+		uv = static_cast<const float*>(getPoint(mDetail, hVertex)->getAttribData(mUVAttribs[uvSet]));
+	u = uv[0];
+	v = uv[1];
+}
+//---------------------------------------------------------------------
+Ogre::ColourValue HoudiniOgre_GUDetailSource::getColour(int prim, int vertex) const
+{
+	if (mColumns)
+		return mColumns->colours[mColumns->primitiveStarts[prim] + vertex];
+	const GEO_PrimPoly* primPoly = static_cast<const GEO_PrimPoly*>(mDetail->primitives()(prim));
+	const GEO_Vertex& hVertex = primPoly->getVertex(vertex);
+	const float* col;
+	if (mDiffuseOnVertices)
+		col = static_cast<const float*>(hVertex.getAttribData(mDiffuseAttrib));
+	else
+		col = static_cast<const float*>(getPoint(mDetail, hVertex)->getAttribData(mDiffuseAttrib));
+	// Cd is RGB only
+	return Ogre::ColourValue(col[0], col[1], col[2], 1.0f);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::logAttributeInfo() const
+{
+	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
+
+	lmgr.logMessage("Number of primitives: " + Ogre::StringConverter::toString(getPrimitiveCount()));
+	lmgr.logMessage("Number of points: " + Ogre::StringConverter::toString(getPointCount()));
+	lmgr.logMessage("Has normals:" + Ogre::StringConverter::toString(hasNormals()) +
+		" on " + (mNormalsOnVertices ? "vertices" : "points"));
+	Ogre::StringUtil::StrStreamType uvstr;
+	uvstr << "Number of UV sets:" << mUVAttribs.size();
+	for (size_t t = 0; t < mUVAttribs.size(); ++t)
+	{
+		uvstr << "(" << (mUVOnVertices[t] ? "vertices" : "points") << ") ";
+	}
+	lmgr.logMessage(uvstr.str());
+	lmgr.logMessage("Has vertex colours:" + Ogre::StringConverter::toString(hasColours()) +
+		" on " + (mDiffuseOnVertices ? "vertices" : "points"));
+}
+//---------------------------------------------------------------------
+const HoudiniOgre_GeometrySource::Columns& HoudiniOgre_GUDetailSource::gather(
+	Columns& storage) const
+{
+	if (mColumns)
+		return *mColumns;
+
+	int pointCount = mDetail->points().entries();
+	storage.positions.resize(pointCount);
+	for (int point = 0; point < pointCount; ++point)
+	{
+		storage.positions[point] = HoudiniMappings::toVec3(mDetail->points()(point)->getPos());
+	}
+
+	// Attributes stored on points are read once per point here, then
+	// copied to each vertex using the point below
+	std::vector<Ogre::Vector3> pointNormals;
+	if (mNormalAttrib >= 0 && !mNormalsOnVertices)
+	{
+		pointNormals.resize(pointCount);
+		for (int point = 0; point < pointCount; ++point)
+		{
+			pointNormals[point] = HoudiniMappings::toVec3(*static_cast<const UT_Vector3*>(
+				mDetail->points()(point)->getAttribData(mNormalAttrib)));
+		}
+	}
+	std::vector<std::vector<float> > pointUVs(mUVAttribs.size());
+	for (size_t i = 0; i < mUVAttribs.size(); ++i)
+	{
+		if (mUVOnVertices[i])
+			continue;
+		pointUVs[i].resize(pointCount * 2);
+		for (int point = 0; point < pointCount; ++point)
+		{
+			const float* uv = static_cast<const float*>(
+				mDetail->points()(point)->getAttribData(mUVAttribs[i]));
+			pointUVs[i][point*2] = uv[0];
+			pointUVs[i][point*2+1] = uv[1];
+		}
+	}
+	std::vector<Ogre::ColourValue> pointColours;
+	if (mDiffuseAttrib >= 0 && !mDiffuseOnVertices)
+	{
+		pointColours.resize(pointCount);
+		for (int point = 0; point < pointCount; ++point)
+		{
+			const float* col = static_cast<const float*>(
+				mDetail->points()(point)->getAttribData(mDiffuseAttrib));
+			pointColours[point] = Ogre::ColourValue(col[0], col[1], col[2], 1.0f);
+		}
+	}
+
+	int primCount = mDetail->primitives().entries();
+	storage.primitiveStarts.resize(primCount + 1);
+	storage.vertexPoints.clear();
+	storage.normals.clear();
+	storage.uvs.assign(mUVAttribs.size(), std::vector<float>());
+	storage.colours.clear();
+	for (int prim = 0; prim < primCount; ++prim)
+	{
+		storage.primitiveStarts[prim] = static_cast<Ogre::uint32>(storage.vertexPoints.size());
+		if (!isPolygon(prim))
+			continue;
+
+		const GEO_PrimPoly* primPoly = static_cast<const GEO_PrimPoly*>(mDetail->primitives()(prim));
+		int vcount = primPoly->getVertexCount();
+		for (int v = 0; v < vcount; ++v)
+		{
+			const GEO_Vertex& hVertex = primPoly->getVertex(v);
+			int point = hVertex.getBasePt()->getNum();
+			storage.vertexPoints.push_back(point);
+
+			if (mNormalAttrib >= 0)
+			{
+				storage.normals.push_back(mNormalsOnVertices ?
+					HoudiniMappings::toVec3(*static_cast<const UT_Vector3*>(
+						hVertex.getAttribData(mNormalAttrib))) :
+					pointNormals[point]);
+			}
+			for (size_t i = 0; i < mUVAttribs.size(); ++i)
+			{
+				const float* uv = mUVOnVertices[i] ?
+					static_cast<const float*>(hVertex.getAttribData(mUVAttribs[i])) :
+					&pointUVs[i][point*2];
+				storage.uvs[i].push_back(uv[0]);
+				storage.uvs[i].push_back(uv[1]);
+			}
+			if (mDiffuseAttrib >= 0)
+			{
+				if (mDiffuseOnVertices)
+				{
+					const float* col = static_cast<const float*>(hVertex.getAttribData(mDiffuseAttrib));
+					storage.colours.push_back(Ogre::ColourValue(col[0], col[1], col[2], 1.0f));
+				}
+				else
+				{
+					storage.colours.push_back(pointColours[point]);
+				}
+			}
+		}
+	}
+	storage.primitiveStarts[primCount] = static_cast<Ogre::uint32>(storage.vertexPoints.size());
+	return storage;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::releaseGeometry()
+{
+	if (mColumns)
+		return;
+
+	Columns* columns = new Columns();
+	gather(*columns);
+	mColumns = columns;
+	delete mLock;
+	mLock = 0;
+	mDetail = 0;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::getWorldTransform(Ogre::Matrix4& xform,
+												   Ogre::Matrix3& rot) const
+{
+	if (!mObjNode)
+	{
+		HoudiniOgre_GeometrySource::getWorldTransform(xform, rot);
+		return;
+	}
+
+	// OP_Context apparantly only uses the myTime param
+	OP_Context context(mFrameTime);
+	// sigh - more const-casting required due to const correctness issues in Houdini
+	const UT_DMatrix4& hxform = const_cast<OP_Node*>(mObjNode)->getWorldTransform(context);
+	xform = HoudiniMappings::toMat4(hxform);
+	UT_DMatrix3 hxrot;
+	hxform.extractRotate(hxrot);
+	rot = HoudiniMappings::toMat3(hxrot);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::getCaptureWeights(int point,
+	std::vector<int>& regions, std::vector<float>& weights) const
+{
+	regions.clear();
+	weights.clear();
+	if (!mCaptureDetail || point >= (int)mCaptureDetail->points().entries())
+		return;
+
+	// You can get the capture attribute like this:
+	// int  blendInfoAttr = guDetail->findPointCaptureAttribute();
+	// And a pointer to the data like this:
+	// float* blendInfoPtr = (float*)guDetail->points()(17)->getAttribData(blendInfoAttr);
+	// - even numbers in the array are region indexes, odds are weights
+	// BUT - no way to find out how many there are? Seems like they are null-terminated
+	// but I'm not entirely sure that's guaranteed, might just be buffer content fluke
+	// Therefore use getCaptureWeights which gives definitive list size
+	UT_IntArray regionArray;
+	UT_FloatArray weightArray;
+	mCaptureDetail->getCaptureWeights(mCaptureDetail->points()(point), regionArray, weightArray);
+	for (int c = 0; c < regionArray.entries(); ++c)
+	{
+		regions.push_back(regionArray(c));
+		weights.push_back(weightArray(c));
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_GUDetailSource::getAnimationCycles(int numFrames, int frameStart,
+	float fps, AnimationList& cycles) const
+{
+	if (!mObjNode)
+		return;
+
+	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
+	// Animations are stored on the objects themselves as a detail attribute
+	// called 'animcycle'. We sample this throughout the timeline and its value
+	// will change when a different attribute is found.
+
+	AnimationEntry animEntry;
+	bool inAnimation = false;
+
+	Ogre::StringUtil::StrStreamType msg;
+	for (int f = frameStart; f < frameStart + numFrames; ++f)
+	{
+		// Convert to frame time
+		float fTime = (float)f / fps;
+
+		// Since detail attributes change per frame, have to 'cook' the data at
+		// each frame to extract it?
+
+		SOP_Node* displaySop = mObjNode->castToOBJNode()->getDisplaySopPtr();
+
+		OP_Context tempCtx(fTime);
+		GU_DetailHandleAutoReadLock gdl(displaySop->getCookedGeoHandle(tempCtx));
+		const GU_Detail *frameGeom = gdl.getGdp();
+
+
+		GEO_AttributeHandle a = frameGeom->getDetailAttribute("animcycle");
+		UT_String val;
+		if (a.getString(val))
+		{
+			Ogre::String animName(val);
+			if (inAnimation)
+			{
+				if (animName == animEntry.animationName)
+				{
+					// just extend
+					animEntry.endFrame = f;
+				}
+				else
+				{
+					// changed, write out old animation
+					animEntry.endFrame = f - 1;
+					cycles.push_back(animEntry);
+					inAnimation = false;
+
+					msg.str(Ogre::StringUtil::BLANK);
+					msg << "Animation detected: '" << animEntry.animationName
+						<< "' startFrame=" << animEntry.startFrame
+						<< " endFrame=" << animEntry.endFrame;
+					lmgr.logMessage(msg.str());
+				}
+			}
+
+			// NB not else since inAnimation can be reset above
+			if (!inAnimation)
+			{
+				// ignore animations called 'none' or blank
+				if (!animName.empty() && animName != "none")
+				{
+					// start new animation
+					animEntry.animationName = animName;
+					animEntry.startFrame = f;
+					inAnimation = true;
+				}
+			}
+
+		}
+	}
+	// mop-up if we had animation right up to last frame
+	if (inAnimation)
+	{
+		animEntry.endFrame = frameStart + numFrames - 1;
+		cycles.push_back(animEntry);
+
+		msg.str(Ogre::StringUtil::BLANK);
+		msg << "Animation detected: '" << animEntry.animationName
+			<< "' startFrame=" << animEntry.startFrame
+			<< " endFrame=" << animEntry.endFrame;
+		lmgr.logMessage(msg.str());
+	}
+
+}
+//---------------------------------------------------------------------
+HoudiniOgre_GeometrySource* HoudiniOgre_GUDetailSource::createAtTime(float frameTime) const
+{
+	if (!mObjNode)
+		return 0;
+	return new HoudiniOgre_GUDetailSource(mObjNode, frameTime);
+}
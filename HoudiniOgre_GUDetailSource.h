@@ -0,0 +1,146 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_GUDetailSource.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_GUDetailSource__
+#define __HoudiniOgre_GUDetailSource__
+
+#include "HoudiniOgre_GeometrySource.h"
+
+// forward decls
+class GU_Detail;
+class GU_DetailHandleAutoReadLock;
+class OP_Node;
+class SOP_Node;
+
+/** Geometry source reading the cooked display geometry of a Houdini object.
+@remarks
+	The object's display geometry is read-locked for the lifetime of this
+	object; geometry passed in directly must simply outlive it. Normals, texture coordinates ('uv', 'uv2', ...) and diffuse
+	colour ('Cd') are looked for on vertices first, then on points. Shop
+	SOPs inside the object provide per-primitive materials, and the capture
+	SOP feeding the object's deform SOP (if any) provides skinning weights.
+*/
+class HoudiniOgre_GUDetailSource : public HoudiniOgre_GeometrySource
+{
+public:
+	/** Read the display geometry of an object at the given time. */
+	HoudiniOgre_GUDetailSource(const OP_Node* objNode, float frameTime);
+	/** Read geometry which doesn't belong to an object, eg loaded from a
+		.bgeo file. There is no material, transform or capture information
+		in this case. */
+	HoudiniOgre_GUDetailSource(const GU_Detail* detail, const Ogre::String& name);
+	virtual ~HoudiniOgre_GUDetailSource();
+
+	const Ogre::String& getName() const { return mName; }
+	long getFrame() const { return mFrame; }
+
+	int getPointCount() const;
+	int getPrimitiveCount() const;
+	bool isPolygon(int prim) const;
+	int getPrimitiveVertexCount(int prim) const;
+	int getVertexPoint(int prim, int vertex) const;
+	Ogre::Vector3 getPointPosition(int point) const;
+
+	bool hasNormals() const { return mNormalAttrib >= 0; }
+	Ogre::Vector3 getNormal(int prim, int vertex) const;
+	size_t getUVSetCount() const { return mUVAttribs.size(); }
+	void getUV(size_t uvSet, int prim, int vertex, float& u, float& v) const;
+	bool hasColours() const { return mDiffuseAttrib >= 0; }
+	Ogre::ColourValue getColour(int prim, int vertex) const;
+	void logAttributeInfo() const;
+	/// Reads each point attribute once per point rather than once per vertex
+	const Columns& gather(Columns& storage) const;
+
+	const Ogre::String& getMaterialName() const { return mMaterialName; }
+	const MaterialGroupList& getMaterialGroups() const { return mMaterialGroups; }
+
+	void getWorldTransform(Ogre::Matrix4& xform, Ogre::Matrix3& rot) const;
+
+	size_t getCaptureRegionCount() const { return mCaptureBones.size(); }
+	OBJ_Bone* getCaptureRegionBone(size_t region) const { return mCaptureBones[region]; }
+	void getCaptureWeights(int point, std::vector<int>& regions,
+		std::vector<float>& weights) const;
+
+	void getAnimationCycles(int numFrames, int frameStart, float fps,
+		AnimationList& cycles) const;
+
+	/// Reads the object again at the given time; 0 for geometry without one
+	HoudiniOgre_GeometrySource* createAtTime(float frameTime) const;
+
+	/// The underlying Houdini geometry, 0 once released
+	const GU_Detail* getDetail() const { return mDetail; }
+
+	/** Gather the geometry and let go of the display geometry's read lock.
+	@remarks
+		Everything except the capture weights and animation cycles is
+		answered from the gathered columns afterwards, and gather() hands
+		them back without copying, so calling this before
+		HoudiniOgre_Mesh::addGeometry lets Houdini cook again while the
+		mesh is built.
+	*/
+	void releaseGeometry();
+
+protected:
+	/// Locate the normal, uv and colour attributes
+	void findAttributes();
+	/// Find shop SOPs which change materials per primitive
+	void findMaterials();
+	/// Find the capture SOP and the bones its regions belong to
+	void findCapture();
+
+	const OP_Node* mObjNode;
+	float mFrameTime;
+	long mFrame;
+	Ogre::String mName;
+	Ogre::String mMaterialName;
+	MaterialGroupList mMaterialGroups;
+
+	GU_DetailHandleAutoReadLock* mLock;
+	GU_Detail* mDetail;
+	/// The gathered geometry once released, otherwise 0
+	Columns* mColumns;
+
+	/// Normal attribute index
+	int mNormalAttrib;
+	/// Are normals on the points or per-vertex (= a point for a specific face)
+	bool mNormalsOnVertices;
+	typedef std::vector<int> AttributeList;
+	AttributeList mUVAttribs;
+	typedef std::vector<bool> BoolList;
+	/// Is each uv on the points or per-vertex (= a point for a specific face)
+	BoolList mUVOnVertices;
+	int mDiffuseAttrib;
+	/// Is diffuse on the points or per-vertex (= a point for a specific face)
+	bool mDiffuseOnVertices;
+
+	/// Pre-deformation geometry holding the capture weights
+	GU_DetailHandleAutoReadLock* mCaptureLock;
+	GU_Detail* mCaptureDetail;
+	/// Bone for each capture region
+	std::vector<OBJ_Bone*> mCaptureBones;
+
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_GeometrySource.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_GeometrySource.h"
+
+//---------------------------------------------------------------------
+const HoudiniOgre_GeometrySource::Columns& HoudiniOgre_GeometrySource::gather(
+	Columns& storage) const
+{
+	int pointCount = getPointCount();
+	storage.positions.resize(pointCount);
+	for (int point = 0; point < pointCount; ++point)
+	{
+		storage.positions[point] = getPointPosition(point);
+	}
+
+	// Vertex layout first, so the attribute columns can be sized once
+	int primCount = getPrimitiveCount();
+	storage.primitiveStarts.resize(primCount + 1);
+	storage.vertexPoints.clear();
+	for (int prim = 0; prim < primCount; ++prim)
+	{
+		storage.primitiveStarts[prim] = static_cast<Ogre::uint32>(storage.vertexPoints.size());
+		if (!isPolygon(prim))
+			continue;
+		int vcount = getPrimitiveVertexCount(prim);
+		for (int v = 0; v < vcount; ++v)
+		{
+			storage.vertexPoints.push_back(getVertexPoint(prim, v));
+		}
+	}
+	storage.primitiveStarts[primCount] = static_cast<Ogre::uint32>(storage.vertexPoints.size());
+
+	size_t vertexCount = storage.vertexPoints.size();
+	storage.normals.resize(hasNormals() ? vertexCount : 0);
+	storage.uvs.resize(getUVSetCount());
+	for (size_t i = 0; i < storage.uvs.size(); ++i)
+	{
+		storage.uvs[i].resize(vertexCount * 2);
+	}
+	storage.colours.resize(hasColours() ? vertexCount : 0);
+
+	for (int prim = 0; prim < primCount; ++prim)
+	{
+		Ogre::uint32 start = storage.primitiveStarts[prim];
+		int vcount = static_cast<int>(storage.primitiveStarts[prim + 1] - start);
+		for (int v = 0; v < vcount; ++v)
+		{
+			size_t c = start + v;
+			if (!storage.normals.empty())
+				storage.normals[c] = getNormal(prim, v);
+			for (size_t i = 0; i < storage.uvs.size(); ++i)
+				getUV(i, prim, v, storage.uvs[i][c*2], storage.uvs[i][c*2+1]);
+			if (!storage.colours.empty())
+				storage.colours[c] = getColour(prim, v);
+		}
+	}
+	return storage;
+}
@@ -0,0 +1,171 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_GeometrySource.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_GeometrySource__
+#define __HoudiniOgre_GeometrySource__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "OgreVector3.h"
+#include "OgreMatrix3.h"
+#include "OgreMatrix4.h"
+
+/** Read-only view of one object's geometry, as consumed by HoudiniOgre_Mesh.
+@remarks
+	HoudiniOgre_Mesh only ever reads geometry through this interface, which
+	keeps the welding, baking and serialisation code free of any dependency
+	on a live Houdini session. HoudiniOgre_GUDetailSource adapts a cooked
+	GU_Detail; other implementations feed the same pipeline from files or
+	synthetic data.
+@par
+	Geometry is described the way Houdini does it: shared points carry
+	positions, and polygon primitives reference points through vertices.
+	Vertices are addressed as (primitive, vertex number within primitive),
+	in the primitive's own winding order (clockwise, like Houdini).
+	Attribute accessors always take a vertex; implementations whose
+	attributes live on points just look up the vertex's point.
+*/
+class HoudiniOgre_GeometrySource
+{
+public:
+	/// A set of primitives which use a material other than the object's one
+	struct MaterialGroup
+	{
+		/// Name to give the submesh these primitives end up in
+		Ogre::String name;
+		/// Material name
+		Ogre::String materialName;
+		/// Primitive indexes
+		std::vector<int> primitives;
+	};
+	typedef std::vector<MaterialGroup> MaterialGroupList;
+
+	/** The geometry and its attributes copied into plain arrays, with
+		attributes expanded to every vertex wherever they were stored. */
+	struct Columns
+	{
+		/** Where each primitive's vertices start in the vertex columns, plus
+			one more entry for the end; primitives which aren't polygons
+			have none */
+		std::vector<Ogre::uint32> primitiveStarts;
+		/// Point of each vertex
+		std::vector<int> vertexPoints;
+		/// Position of each point
+		std::vector<Ogre::Vector3> positions;
+		/// Normal at each vertex (empty without normals)
+		std::vector<Ogre::Vector3> normals;
+		/// Raw u, v pairs at each vertex, one column per texture coordinate set
+		std::vector<std::vector<float> > uvs;
+		/// Colour at each vertex (empty without colours)
+		std::vector<Ogre::ColourValue> colours;
+	};
+
+	virtual ~HoudiniOgre_GeometrySource() {}
+
+	/// Name of the object this geometry belongs to
+	virtual const Ogre::String& getName() const = 0;
+	/// Frame number the geometry was sampled at
+	virtual long getFrame() const { return 0; }
+
+	/// Number of points
+	virtual int getPointCount() const = 0;
+	/// Number of primitives
+	virtual int getPrimitiveCount() const = 0;
+	/// Is this primitive a non-degenerate polygon? (nothing else is exported)
+	virtual bool isPolygon(int prim) const = 0;
+	/// Number of vertices in a primitive
+	virtual int getPrimitiveVertexCount(int prim) const = 0;
+	/// The point referenced by a vertex of a primitive
+	virtual int getVertexPoint(int prim, int vertex) const = 0;
+	/// Position of a point
+	virtual Ogre::Vector3 getPointPosition(int point) const = 0;
+
+	/// Does the geometry have normals?
+	virtual bool hasNormals() const = 0;
+	/// Normal at a vertex
+	virtual Ogre::Vector3 getNormal(int prim, int vertex) const = 0;
+	/// Number of texture coordinate sets
+	virtual size_t getUVSetCount() const = 0;
+	/// Raw (Houdini convention, origin bottom left) 2D texture coordinate at a vertex
+	virtual void getUV(size_t uvSet, int prim, int vertex, float& u, float& v) const = 0;
+	/// Does the geometry have vertex colours?
+	virtual bool hasColours() const = 0;
+	/// Colour at a vertex
+	virtual Ogre::ColourValue getColour(int prim, int vertex) const = 0;
+	/// Log a description of where the attributes were found
+	virtual void logAttributeInfo() const {}
+
+	/** Read everything HoudiniOgre_Mesh::addGeometry needs in one go.
+	@remarks
+		The default goes through the accessors above a vertex at a time;
+		sources which can read their data in bulk override it.
+	@param storage Columns to fill if the source doesn't hold its own
+	@returns The columns, which may be the source's own copy rather
+		than storage
+	*/
+	virtual const Columns& gather(Columns& storage) const;
+
+	/// Material used by primitives which are not in a material group
+	virtual const Ogre::String& getMaterialName() const = 0;
+	/// Groups of primitives assigned other materials
+	virtual const MaterialGroupList& getMaterialGroups() const = 0;
+
+	/** Object to world transform, and its rotation part (for normals).
+		Only used when baking object transforms. */
+	virtual void getWorldTransform(Ogre::Matrix4& xform, Ogre::Matrix3& rot) const
+	{
+		xform = Ogre::Matrix4::IDENTITY;
+		rot = Ogre::Matrix3::IDENTITY;
+	}
+
+	/** Number of capture regions, ie bones the points can be weighted to.
+	@remarks
+		Skinning information is optional; the default is no capture.
+	*/
+	virtual size_t getCaptureRegionCount() const { return 0; }
+	/// Bone driving a capture region
+	virtual OBJ_Bone* getCaptureRegionBone(size_t region) const { return 0; }
+	/// Capture regions and weights for a point
+	virtual void getCaptureWeights(int point, std::vector<int>& regions,
+		std::vector<float>& weights) const
+	{
+		regions.clear();
+		weights.clear();
+	}
+
+	/** Append any named animation cycles found on the geometry over the
+		given frame range. Leaving the list alone means no cycles. */
+	virtual void getAnimationCycles(int numFrames, int frameStart, float fps,
+		AnimationList& cycles) const {}
+
+	/** The same geometry at another time (in seconds), for sampling
+		vertex animation.
+	@returns A new source for the caller to delete, or 0 if this source
+		can't be read at other times (the default)
+	*/
+	virtual HoudiniOgre_GeometrySource* createAtTime(float frameTime) const { return 0; }
+
+};
+
+#endif
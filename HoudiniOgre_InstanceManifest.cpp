@@ -0,0 +1,112 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_InstanceManifest.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_InstanceManifest.h"
+#include "HoudiniOgre_Escape.h"
+
+#include "OgreException.h"
+#include "OgreLogManager.h"
+
+#include <fstream>
+
+//---------------------------------------------------------------------
+HoudiniOgre_InstanceManifest::HoudiniOgre_InstanceManifest()
+: mInstanceCount(0)
+{
+}
+//---------------------------------------------------------------------
+const Ogre::String* HoudiniOgre_InstanceManifest::findMesh(Fingerprint fingerprint) const
+{
+	FingerprintMap::const_iterator i = mFingerprints.find(fingerprint);
+	return i == mFingerprints.end() ? 0 : &mMeshes[i->second].meshFile;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_InstanceManifest::addMesh(Fingerprint fingerprint,
+	const Ogre::String& meshFile)
+{
+	mFingerprints[fingerprint] = mMeshes.size();
+	MeshEntry entry;
+	entry.meshFile = meshFile;
+	mMeshes.push_back(entry);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_InstanceManifest::addInstance(Fingerprint fingerprint,
+	const Ogre::String& name, const Ogre::Matrix4& xform)
+{
+	FingerprintMap::const_iterator i = mFingerprints.find(fingerprint);
+	if (i == mFingerprints.end())
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_ITEM_NOT_FOUND,
+			"No mesh registered for instance " + name,
+			"HoudiniOgre_InstanceManifest::addInstance");
+	}
+
+	Instance inst;
+	inst.name = name;
+	inst.xform = xform;
+	mMeshes[i->second].instances.push_back(inst);
+	++mInstanceCount;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_InstanceManifest::save(const Ogre::String& filename) const
+{
+	std::ofstream ofs(filename.c_str());
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write instance manifest " + filename,
+			"HoudiniOgre_InstanceManifest::save");
+	}
+
+	// enough digits for every float to read back exactly
+	ofs.precision(9);
+	ofs << "<instances>\n";
+	for (std::vector<MeshEntry>::const_iterator m = mMeshes.begin(); m != mMeshes.end(); ++m)
+	{
+		ofs << "\t<mesh file=\"" << HoudiniOgre_Escape::xml(m->meshFile)
+			<< "\" count=\"" << m->instances.size() << "\">\n";
+		for (std::vector<Instance>::const_iterator i = m->instances.begin();
+			i != m->instances.end(); ++i)
+		{
+			ofs << "\t\t<instance name=\"" << HoudiniOgre_Escape::xml(i->name) << "\" transform=\"";
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					if (r || c)
+						ofs << " ";
+					ofs << i->xform[r][c];
+				}
+			}
+			ofs << "\"/>\n";
+		}
+		ofs << "\t</mesh>\n";
+	}
+	ofs << "</instances>\n";
+
+	Ogre::StringUtil::StrStreamType msg;
+	msg << "Wrote " << mInstanceCount << " instances of " << mMeshes.size()
+		<< " meshes to " << filename;
+	Ogre::LogManager::getSingleton().logMessage(msg.str());
+}
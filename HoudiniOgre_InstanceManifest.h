@@ -0,0 +1,95 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_InstanceManifest.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_InstanceManifest__
+#define __HoudiniOgre_InstanceManifest__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "OgreMatrix4.h"
+
+#include <map>
+#include <vector>
+
+/** List of meshes and the places they are instanced, for the runtime to
+	draw with hardware instancing.
+@remarks
+	Meshes are identified by a fingerprint of their local-space geometry
+	(see HoudiniOgre_Hash), so that identical objects share one mesh. The
+	manifest is written as XML, grouped by mesh:
+@code
+<instances>
+	<mesh file="crate.mesh" count="2">
+		<instance name="crate1" transform="m00 m01 m02 m03 m10 ... m23"/>
+		<instance name="crate2" transform="..."/>
+	</mesh>
+</instances>
+@endcode
+	The transform is the top 3 rows of the instance's world matrix, row
+	major, as you'd upload them to an instance buffer.
+*/
+class HoudiniOgre_InstanceManifest
+{
+public:
+	typedef unsigned long long Fingerprint;
+
+	HoudiniOgre_InstanceManifest();
+
+	/** The mesh file registered for a fingerprint.
+	@returns 0 if no mesh has been registered for it yet
+	*/
+	const Ogre::String* findMesh(Fingerprint fingerprint) const;
+	/// Register the mesh file exported for a fingerprint
+	void addMesh(Fingerprint fingerprint, const Ogre::String& meshFile);
+	/// Add an instance of a registered mesh
+	void addInstance(Fingerprint fingerprint, const Ogre::String& name,
+		const Ogre::Matrix4& xform);
+
+	size_t getMeshCount() const { return mMeshes.size(); }
+	size_t getInstanceCount() const { return mInstanceCount; }
+
+	/// Write the manifest, throws on failure
+	void save(const Ogre::String& filename) const;
+
+protected:
+	struct Instance
+	{
+		Ogre::String name;
+		Ogre::Matrix4 xform;
+	};
+	struct MeshEntry
+	{
+		Ogre::String meshFile;
+		std::vector<Instance> instances;
+	};
+	/// Meshes in the order they were registered
+	std::vector<MeshEntry> mMeshes;
+	typedef std::map<Fingerprint, size_t> FingerprintMap;
+	/// Index into mMeshes by fingerprint
+	FingerprintMap mFingerprints;
+	size_t mInstanceCount;
+
+};
+
+#endif
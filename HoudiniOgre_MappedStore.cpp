@@ -0,0 +1,328 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_MappedStore.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_MappedStore.h"
+
+#include "OgreException.h"
+#include "OgreStringConverter.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+#undef max
+#undef min
+
+namespace
+{
+	/** A vertex or index buffer with its data in a mapped store.
+	@remarks
+		Base is Ogre::HardwareVertexBuffer or Ogre::HardwareIndexBuffer,
+		args the arguments of its constructor before the memory flags.
+	*/
+	template <class Base>
+	class MappedBuffer : public Base
+	{
+	public:
+		template <typename... Args>
+		MappedBuffer(HoudiniOgre_MappedStore* store, Args... args)
+			: Base(args..., true, false), mStore(store)
+		{
+			mData = static_cast<unsigned char*>(mStore->allocate(this->mSizeInBytes));
+		}
+		~MappedBuffer()
+		{
+			mStore->deallocate(mData);
+		}
+
+		void readData(size_t offset, size_t length, void* pDest)
+		{
+			memcpy(pDest, mData + offset, length);
+		}
+		// Discarding can't save anything: there's no copy to skip reading
+		// back, the data only lives in the mapping
+		void writeData(size_t offset, size_t length, const void* pSource, 
+			bool /*discardWholeBuffer*/ = false)
+		{
+			memcpy(mData + offset, pSource, length);
+			mStore->used(mData);
+		}
+
+	protected:
+		void* lockImpl(size_t offset, size_t /*length*/, Ogre::HardwareBuffer::LockOptions /*options*/)
+		{
+			return mData + offset;
+		}
+		void unlockImpl()
+		{
+			// the contents are done with for now, so they can go to disk
+			mStore->used(mData);
+		}
+
+		HoudiniOgre_MappedStore* mStore;
+		unsigned char* mData;
+	};
+}
+//---------------------------------------------------------------------
+HoudiniOgre_MappedStore::HoudiniOgre_MappedStore(const Ogre::String& directory, size_t budget)
+: mDirectory(directory), mBudget(budget), mMappedBytes(0), mResidentBytes(0), 
+  mPeakMappedBytes(0), mUseCount(0), mTrimCount(0)
+{
+	if (mDirectory.empty())
+	{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		char temp[MAX_PATH + 1];
+		DWORD len = GetTempPathA(sizeof(temp), temp);
+		mDirectory = len && len < sizeof(temp) ? Ogre::String(temp, len) : Ogre::String(".");
+#else
+		const char* temp = getenv("TMPDIR");
+		mDirectory = temp && *temp ? temp : "/tmp";
+#endif
+	}
+	if (!Ogre::StringUtil::endsWith(mDirectory, "/") && !Ogre::StringUtil::endsWith(mDirectory, "\\"))
+		mDirectory += "/";
+}
+//---------------------------------------------------------------------
+HoudiniOgre_MappedStore::~HoudiniOgre_MappedStore()
+{
+	for (MappingMap::iterator m = mMappings.begin(); m != mMappings.end(); ++m)
+	{
+		unmap(m->first, m->second);
+	}
+}
+//---------------------------------------------------------------------
+void* HoudiniOgre_MappedStore::allocate(size_t bytes)
+{
+	if (bytes < MIN_MAPPING)
+		return ::operator new(bytes);
+
+	Mapping mapping;
+	mapping.bytes = bytes;
+	void* p = 0;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	char name[MAX_PATH + 1];
+	HANDLE file = INVALID_HANDLE_VALUE;
+	if (GetTempFileNameA(mDirectory.c_str(), "hog", 0, name))
+	{
+		// deleted when the last handle to it is closed
+		file = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 
+			FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, 0);
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		ULONGLONG size = bytes;
+		HANDLE fileMapping = CreateFileMappingA(file, 0, PAGE_READWRITE, 
+			static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), 0);
+		if (fileMapping)
+		{
+			p = MapViewOfFile(fileMapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+			if (!p)
+				CloseHandle(fileMapping);
+		}
+		if (p)
+		{
+			mapping.file = file;
+			mapping.mapping = fileMapping;
+		}
+		else
+		{
+			CloseHandle(file);
+		}
+	}
+#else
+	Ogre::String pattern = mDirectory + "HoudiniOgreXXXXXX";
+	std::vector<char> name(pattern.begin(), pattern.end());
+	name.push_back(0);
+	int file = mkstemp(&name[0]);
+	if (file >= 0)
+	{
+		// gone once the descriptor is closed
+		unlink(&name[0]);
+#	if OGRE_PLATFORM == OGRE_PLATFORM_LINUX
+		// reserve the space now, rather than crash on a full disk later
+		bool sized = posix_fallocate(file, 0, bytes) == 0;
+#	else
+		bool sized = ftruncate(file, bytes) == 0;
+#	endif
+		if (sized)
+		{
+			p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			if (p == MAP_FAILED)
+				p = 0;
+		}
+		if (p)
+			mapping.file = file;
+		else
+			close(file);
+	}
+#endif
+	if (!p)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE, 
+			"Unable to map " + Ogre::StringConverter::toString(bytes) + 
+			" bytes of temporary file in " + mDirectory,
+			"HoudiniOgre_MappedStore::allocate");
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mapping.lastUse = ++mUseCount;
+	mMappings[p] = mapping;
+	mMappedBytes += bytes;
+	mResidentBytes += bytes;
+	mPeakMappedBytes = std::max(mPeakMappedBytes, mMappedBytes);
+	return p;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_MappedStore::deallocate(void* p)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		MappingMap::iterator m = mMappings.find(p);
+		if (m != mMappings.end())
+		{
+			mMappedBytes -= m->second.bytes;
+			if (m->second.lastUse)
+				mResidentBytes -= m->second.bytes;
+			Mapping mapping = m->second;
+			mMappings.erase(m);
+			unmap(p, mapping);
+			return;
+		}
+	}
+	::operator delete(p);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_MappedStore::trim()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	trimLocked();
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_MappedStore::used(void* p)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	MappingMap::iterator m = mMappings.find(p);
+	if (m != mMappings.end())
+	{
+		if (!m->second.lastUse)
+			mResidentBytes += m->second.bytes;
+		m->second.lastUse = ++mUseCount;
+	}
+	trimLocked();
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_MappedStore::trimLocked()
+{
+	// mappings are a megabyte or more, so there are few enough to search
+	while (mResidentBytes > mBudget)
+	{
+		MappingMap::iterator oldest = mMappings.end();
+		for (MappingMap::iterator m = mMappings.begin(); m != mMappings.end(); ++m)
+		{
+			if (m->second.lastUse && 
+				(oldest == mMappings.end() || m->second.lastUse < oldest->second.lastUse))
+			{
+				oldest = m;
+			}
+		}
+		if (oldest == mMappings.end())
+			break;
+		drop(oldest->first, oldest->second);
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_MappedStore::drop(void* p, Mapping& mapping)
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	FlushViewOfFile(p, mapping.bytes);
+	// unlocking pages which aren't locked takes them out of the working set
+	VirtualUnlock(p, mapping.bytes);
+#else
+	msync(p, mapping.bytes, MS_SYNC);
+	madvise(p, mapping.bytes, MADV_DONTNEED);
+#	ifdef POSIX_FADV_DONTNEED
+	// and out of the page cache, now they're on disk
+	posix_fadvise(mapping.file, 0, 0, POSIX_FADV_DONTNEED);
+#	endif
+#endif
+	mResidentBytes -= mapping.bytes;
+	mapping.lastUse = 0;
+	++mTrimCount;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_MappedStore::unmap(void* p, const Mapping& mapping)
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	UnmapViewOfFile(p);
+	CloseHandle(mapping.mapping);
+	CloseHandle(mapping.file);
+#else
+	munmap(p, mapping.bytes);
+	close(mapping.file);
+#endif
+}
+//---------------------------------------------------------------------
+//---------------------------------------------------------------------
+HoudiniOgre_MappedBufferManager::HoudiniOgre_MappedBufferManager()
+: mStore(0)
+{
+}
+//---------------------------------------------------------------------
+HoudiniOgre_MappedBufferManager::~HoudiniOgre_MappedBufferManager()
+{
+}
+//---------------------------------------------------------------------
+Ogre::HardwareVertexBufferSharedPtr HoudiniOgre_MappedBufferManager::createVertexBuffer(
+	size_t vertexSize, size_t numVerts, Ogre::HardwareBuffer::Usage usage, bool useShadowBuffer)
+{
+	if (!mStore)
+	{
+		return Ogre::DefaultHardwareBufferManager::createVertexBuffer(
+			vertexSize, numVerts, usage, useShadowBuffer);
+	}
+	return Ogre::HardwareVertexBufferSharedPtr(
+		new MappedBuffer<Ogre::HardwareVertexBuffer>(mStore, vertexSize, numVerts, usage));
+}
+//---------------------------------------------------------------------
+Ogre::HardwareIndexBufferSharedPtr HoudiniOgre_MappedBufferManager::createIndexBuffer(
+	Ogre::HardwareIndexBuffer::IndexType itype, size_t numIndexes, 
+	Ogre::HardwareBuffer::Usage usage, bool useShadowBuffer)
+{
+	if (!mStore)
+	{
+		return Ogre::DefaultHardwareBufferManager::createIndexBuffer(
+			itype, numIndexes, usage, useShadowBuffer);
+	}
+	return Ogre::HardwareIndexBufferSharedPtr(
+		new MappedBuffer<Ogre::HardwareIndexBuffer>(mStore, itype, numIndexes, usage));
+}
@@ -0,0 +1,219 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_MappedStore.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_MappedStore__
+#define __HoudiniOgre_MappedStore__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "OgreDefaultHardwareBufferManager.h"
+
+#include <map>
+#include <mutex>
+#include <type_traits>
+
+/** Memory backed by temporary files, for exports too big to hold in RAM.
+@remarks
+	Each allocation of MIN_MAPPING bytes or more is a temporary file of
+	its own mapped into memory, which goes away when it's freed (or the
+	process exits); smaller ones come from the heap as usual. Mapped
+	memory is used like any other, but trim() can write it back to the
+	files and drop its pages, after which they're read back in as they're
+	touched. Calling trim() between the steps of an export keeps what's
+	resident near the budget, plus whatever the step in progress touches,
+	without the code doing the work knowing where its data lives.
+@par
+	What counts against the budget is the mappings allocated or used
+	(see used()) since their pages were last dropped. Those used least
+	recently are dropped first, and only until the rest fit, so each
+	mapping is written back once each time it's used rather than on 
+	every trim.
+*/
+class HoudiniOgre_MappedStore
+{
+public:
+	/// Allocations smaller than this come from the heap
+	static const size_t MIN_MAPPING = 1024 * 1024;
+
+	/** @param directory Where to create the files, the system's temporary
+		folder if blank
+	@param budget Bytes of resident mappings allowed before trim() drops pages
+	@note Only mappings allocated or reported through used() count. The
+		containers of HoudiniOgre_MappedAllocator don't report their use,
+		so once dropped, whatever pages they touch again are resident but
+		not counted until they're freed; the budget is a target then, not
+		a limit.
+	*/
+	HoudiniOgre_MappedStore(const Ogre::String& directory, size_t budget);
+	~HoudiniOgre_MappedStore();
+
+	/// Allocate bytes, throws if a file can't be created or mapped
+	void* allocate(size_t bytes);
+	/// Free something allocate() returned
+	void deallocate(void* p);
+	/** If the resident mappings add up to more than the budget, write the
+		least recently used back to their files and drop their pages from
+		memory until they don't. */
+	void trim();
+	/** Note that the mapping allocate() returned as p has just been
+		written or read (so is resident again), then trim(). */
+	void used(void* p);
+
+	size_t getBudget() const { return mBudget; }
+	/// Bytes currently mapped
+	size_t getMappedBytes() const { return mMappedBytes; }
+	/// Bytes of mappings allocated or used since their pages were dropped
+	size_t getResidentBytes() const { return mResidentBytes; }
+	/// Most bytes mapped at once
+	size_t getPeakMappedBytes() const { return mPeakMappedBytes; }
+	/// Number of times a mapping has been written back and its pages dropped
+	size_t getTrimCount() const { return mTrimCount; }
+
+protected:
+	struct Mapping
+	{
+		size_t bytes;
+		/// When it was last allocated or used, 0 once its pages are dropped
+		size_t lastUse;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+		void* file;
+		void* mapping;
+#else
+		int file;
+#endif
+	};
+	typedef std::map<void*, Mapping> MappingMap;
+
+	/// Unmap and close (and so delete) a mapping's file
+	void unmap(void* p, const Mapping& mapping);
+	/// Drop least recently used mappings until the budget is met (locked)
+	void trimLocked();
+	/// Write a mapping back to its file and drop its pages (locked)
+	void drop(void* p, Mapping& mapping);
+
+	Ogre::String mDirectory;
+	size_t mBudget;
+	MappingMap mMappings;
+	size_t mMappedBytes;
+	size_t mResidentBytes;
+	size_t mPeakMappedBytes;
+	/// Ticks on every allocation and use, for Mapping::lastUse
+	size_t mUseCount;
+	size_t mTrimCount;
+	/// Containers may be resized from worker threads
+	std::mutex mMutex;
+
+private:
+	HoudiniOgre_MappedStore(const HoudiniOgre_MappedStore&);
+	HoudiniOgre_MappedStore& operator=(const HoudiniOgre_MappedStore&);
+};
+
+/** Standard allocator drawing from a HoudiniOgre_MappedStore, or from the
+	heap if it has none.
+@remarks
+	Copies of a container get a heap allocator; swaps and moves take the
+	allocator with the memory.
+*/
+template <typename T>
+class HoudiniOgre_MappedAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+	template <typename U> struct rebind { typedef HoudiniOgre_MappedAllocator<U> other; };
+
+	HoudiniOgre_MappedAllocator(HoudiniOgre_MappedStore* store = 0) : mStore(store) {}
+	template <typename U>
+	HoudiniOgre_MappedAllocator(const HoudiniOgre_MappedAllocator<U>& rhs) : mStore(rhs.getStore()) {}
+
+	T* allocate(size_t n)
+	{
+		if (mStore)
+			return static_cast<T*>(mStore->allocate(n * sizeof(T)));
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t)
+	{
+		if (mStore)
+			mStore->deallocate(p);
+		else
+			::operator delete(p);
+	}
+
+	HoudiniOgre_MappedAllocator select_on_container_copy_construction() const
+	{
+		return HoudiniOgre_MappedAllocator();
+	}
+
+	HoudiniOgre_MappedStore* getStore() const { return mStore; }
+
+protected:
+	HoudiniOgre_MappedStore* mStore;
+};
+
+template <typename T, typename U>
+inline bool operator==(const HoudiniOgre_MappedAllocator<T>& a, const HoudiniOgre_MappedAllocator<U>& b)
+{
+	return a.getStore() == b.getStore();
+}
+template <typename T, typename U>
+inline bool operator!=(const HoudiniOgre_MappedAllocator<T>& a, const HoudiniOgre_MappedAllocator<U>& b)
+{
+	return a.getStore() != b.getStore();
+}
+
+/** Hardware buffer manager whose vertex and index buffers are kept in a
+	HoudiniOgre_MappedStore, when it's given one.
+@remarks
+	Ogre needs a mesh's buffers built to serialise it, a second copy of
+	everything the export has gathered. With a store, that copy is 
+	written out to the store's files as it's built (each buffer counts as
+	used, and the store is trimmed, as it's unlocked) and the serialiser 
+	reads it back through the mappings.
+*/
+class HoudiniOgre_MappedBufferManager : public Ogre::DefaultHardwareBufferManager
+{
+public:
+	HoudiniOgre_MappedBufferManager();
+	~HoudiniOgre_MappedBufferManager();
+
+	/** Store for buffers created from now on, 0 for the heap; it must
+		outlive the buffers */
+	void setStore(HoudiniOgre_MappedStore* store) { mStore = store; }
+	HoudiniOgre_MappedStore* getStore() const { return mStore; }
+
+	/// Overridden from DefaultHardwareBufferManager
+	Ogre::HardwareVertexBufferSharedPtr createVertexBuffer(size_t vertexSize, 
+		size_t numVerts, Ogre::HardwareBuffer::Usage usage, bool useShadowBuffer = false);
+	/// Overridden from DefaultHardwareBufferManager
+	Ogre::HardwareIndexBufferSharedPtr createIndexBuffer(
+		Ogre::HardwareIndexBuffer::IndexType itype, size_t numIndexes, 
+		Ogre::HardwareBuffer::Usage usage, bool useShadowBuffer = false);
+
+protected:
+	HoudiniOgre_MappedStore* mStore;
+};
+
+#endif
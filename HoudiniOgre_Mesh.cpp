@@ -24,31 +24,11 @@ This file is part of HoudiniOgre
 */
 
 #include "HoudiniOgre_Mesh.h"
-#include "HoudiniOgre_Skeleton.h"
-
-#include "OgreNoMemoryMacros.h"
-#include <GU/GU_Detail.h>
-#include <GU/GU_DetailHandle.h>
-#include <GEO/GEO_Primitive.h>
-#include <GEO/GEO_PrimPoly.h>
-#include <GEO/GEO_CaptureData.h>
-#include <OP/OP_Node.h>
-#include <OP/OP_Operator.h>
-#include <OP/OP_Director.h>
-#include <OP/OP_Utils.h>
-#include <OP/OP_Network.h>
-#include <PRM/PRM_Parm.h>
-#include <SOP/SOP_Node.h>
-#include <SOP/SOP_CaptureData.h>
-#include <GB/GB_Primitive.h>
-#include <GB/GB_Group.h>
-#include <GB/GB_ElementTree.h>
-#include <GEO/GEO_AttributeHandle.h>
-#include <UT/UT_DMatrix4.h>
-#include <UT/UT_DMatrix3.h>
-#include <OBJ/OBJ_Node.h>
-#include <OBJ/OBJ_Bone.h>
-#include "OgreMemoryMacros.h"
+#include "HoudiniOgre_Trace.h"
+#include "HoudiniOgre_Parallel.h"
+#include "HoudiniOgre_Simd.h"
+#include "HoudiniOgre_Escape.h"
+#include "HoudiniOgre_PositionHash.h"
 
 #include "OgreLogManager.h"
 #include "OgreStringConverter.h"
@@ -59,11 +39,138 @@ This file is part of HoudiniOgre
 #include "OgreMatrix4.h"
 #include "OgreMatrix3.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+
 #undef max
 #undef min
+
+namespace
+{
+	/// Vertices or triangles per thread, below which it isn't worth starting one
+	const size_t PARALLEL_GRAIN = 16384;
+
+	/** Normals, colours and texture coordinate dimensions packed into one
+		number: the set count in bits 2-5, then 2 bits per set (dimensions
+		are 1-4, and there are at most OGRE_MAX_TEXTURE_COORD_SETS sets) */
+	Ogre::uint32 packVertexFormat(bool hasNormals, 
+		const std::vector<unsigned short>& texCoordDims, bool hasVertexColours)
+	{
+		Ogre::uint32 key = (hasNormals ? 1 : 0) | (hasVertexColours ? 2 : 0) |
+			static_cast<Ogre::uint32>(texCoordDims.size() << 2);
+		for (size_t t = 0; t < texCoordDims.size(); ++t)
+			key |= static_cast<Ogre::uint32>((texCoordDims[t] - 1) & 3) << (6 + t * 2);
+		return key;
+	}
+
+	/// Make room for extra more elements, still growing geometrically when called repeatedly
+	template <typename V>
+	void reserveExtra(V& v, size_t extra)
+	{
+		size_t needed = v.size() + extra;
+		if (needed > v.capacity())
+			v.reserve(std::max(needed, v.capacity() * 2));
+	}
+
+	/** Write vertices to a buffer laid out the way 
+		HoudiniOgre_Mesh::defineVertexDeclaration lays them out (position, 
+		normal, colour, 2D texture coordinates, tangent), with the elements
+		present fixed at compile time. */
+	template <bool Position, bool Normal, bool Colour, int UVSets, int Tangent, typename Vertex>
+	void writeVertices(char* pBase, size_t vertexSize, const Vertex* src, size_t count)
+	{
+		for (size_t v = 0; v < count; ++v, ++src, pBase += vertexSize)
+		{
+			float* pFloat = reinterpret_cast<float*>(pBase);
+			if (Position)
+			{
+				*pFloat++ = src->position.x;
+				*pFloat++ = src->position.y;
+				*pFloat++ = src->position.z;
+			}
+			if (Normal)
+			{
+				*pFloat++ = src->normal.x;
+				*pFloat++ = src->normal.y;
+				*pFloat++ = src->normal.z;
+			}
+			if (Colour)
+			{
+				*reinterpret_cast<Ogre::RGBA*>(pFloat++) = src->colour;
+			}
+			for (int t = 0; t < UVSets; ++t)
+			{
+				*pFloat++ = src->uv[t].x;
+				*pFloat++ = src->uv[t].y;
+			}
+			if (Tangent)
+			{
+				*pFloat++ = src->tangent.x;
+				*pFloat++ = src->tangent.y;
+				*pFloat++ = src->tangent.z;
+				if (Tangent == 4)
+					*pFloat++ = src->handedness;
+			}
+		}
+	}
+
+	/// Turns a vertex buffer's layout into the writeVertices for it
+	template <typename Vertex>
+	struct VertexWriter
+	{
+		typedef void (*Function)(char*, size_t, const Vertex*, size_t);
+
+		/// 0 if the layout has no specialised writer
+		static Function select(bool position, bool normal, bool colour, int uvSets, int tangent)
+		{
+			return position ? selectNormal<true>(normal, colour, uvSets, tangent) :
+				selectNormal<false>(normal, colour, uvSets, tangent);
+		}
+		template <bool P>
+		static Function selectNormal(bool normal, bool colour, int uvSets, int tangent)
+		{
+			return normal ? selectColour<P, true>(colour, uvSets, tangent) :
+				selectColour<P, false>(colour, uvSets, tangent);
+		}
+		template <bool P, bool N>
+		static Function selectColour(bool colour, int uvSets, int tangent)
+		{
+			return colour ? selectUVs<P, N, true>(uvSets, tangent) :
+				selectUVs<P, N, false>(uvSets, tangent);
+		}
+		template <bool P, bool N, bool C>
+		static Function selectUVs(int uvSets, int tangent)
+		{
+			switch (uvSets)
+			{
+			case 0: return selectTangent<P, N, C, 0>(tangent);
+			case 1: return selectTangent<P, N, C, 1>(tangent);
+			case 2: return selectTangent<P, N, C, 2>(tangent);
+			case 3: return selectTangent<P, N, C, 3>(tangent);
+			case 4: return selectTangent<P, N, C, 4>(tangent);
+			default: return 0;
+			}
+		}
+		template <bool P, bool N, bool C, int U>
+		static Function selectTangent(int tangent)
+		{
+			switch (tangent)
+			{
+			case 0: return &writeVertices<P, N, C, U, 0, Vertex>;
+			case 3: return &writeVertices<P, N, C, U, 3, Vertex>;
+			case 4: return &writeVertices<P, N, C, U, 4, Vertex>;
+			default: return 0;
+			}
+		}
+	};
+}
 //-----------------------------------------------------------------------
 HoudiniOgre_Mesh::UniqueVertex::UniqueVertex()
-: position(Ogre::Vector3::ZERO), normal(Ogre::Vector3::ZERO), colour(0), nextIndex(0)
+: position(Ogre::Vector3::ZERO), normal(Ogre::Vector3::ZERO), colour(0), 
+  tangent(Ogre::Vector3::ZERO), handedness(1), nextIndex(0), sourceGeometry(0), 
+  sourceVertex(0)
 {
 	for (int i = 0; i < OGRE_MAX_TEXTURE_COORD_SETS; ++i)
 		uv[i] = Ogre::Vector3::ZERO;
@@ -73,7 +180,9 @@ bool HoudiniOgre_Mesh::UniqueVertex::operator==(const UniqueVertex& rhs) const
 {
 	bool ret = position == rhs.position && 
 		normal == rhs.normal && 
-		colour == rhs.colour;
+		colour == rhs.colour &&
+		tangent == rhs.tangent &&
+		handedness == rhs.handedness;
 	if (!ret) return ret;
 
 	for (int i = 0; i < OGRE_MAX_TEXTURE_COORD_SETS && ret; ++i)
@@ -88,6 +197,15 @@ bool HoudiniOgre_Mesh::UniqueVertex::operator==(const UniqueVertex& rhs) const
 //-----------------------------------------------------------------------
 //---------------------------------------------------------------------
 HoudiniOgre_Mesh::HoudiniOgre_Mesh()
+: mFrame(0), mCurrentGeometryID(0), mGeometryCount(0), mChunkSize(0), 
+  mHLODLevelCount(0), mHLODTriangleBudget(0), mWeldPosition(0), mWeldNormalCos(1),
+  mWeldUV(0), mWeldColour(0), mWeldedVertexCount(0), mRemoveDegenerates(false),
+  mDegenerateTriangleCount(0), mDuplicateTriangleCount(0), mSharedVertices(false),
+  mGenerateTangents(false), mTangentsSemantic(Ogre::VES_TANGENT), mTangentHandedness(false),
+  mTangentSplitCount(0),
+  mWriteBounds(false), 
+  mWriteBVH(false), mWriteDepthMesh(false), mCollectSidecars(false),
+  mCollectEdgeList(false), mMappedStore(0), mVertexAnimationEnabled(false)
 {
 
 }
@@ -97,560 +215,462 @@ HoudiniOgre_Mesh::~HoudiniOgre_Mesh()
 
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Mesh::addGeometry(const OP_Node* objNode, bool snapshotting,
-								   float frameTime, bool useObjectTransforms, 
-								   int numFrames, int frameStart, 
-								   float fps, float ikSampleRate)
+void HoudiniOgre_Mesh::addGeometry(const HoudiniOgre_GeometrySource& source,
+								   bool snapshotting, bool useObjectTransforms, 
+								   int numFrames, int frameStart, float fps)
 {
+	mFrame = source.getFrame();
+	HoudiniOgre_TraceSpan span("addGeometry", source.getName().c_str(), "frame", mFrame);
+
 	if (mpMesh.isNull())
 	{
 		mpMesh = Ogre::MeshManager::getSingleton().createManual("HoudiniExport", 
 			Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
 	}
 
+	if (!preprocessGeometry(source))
+		return;
 
-	// First derive the geometry we need to look at. 
-	// Originally, I was taking tha geometry pre-deformation if we're animating, 
-	// because I wanted the base mesh. However, Houdini only stores 'capture' transforms
-	// on bones, whilst we need capture transforms on everything that could be 
-	// affecting those bones too (like nulls acting as centres or mid-skeleton offsets)
-	// This is because we need to recreate the animation, not just sample the
-	// outcomes which is what Houdini expects.
-	// When it comes down to it, skeletal animation is about deltas, so as long
-	// as we are consistent about the 'bind' pose of both mesh and skeleton, we
-	// can pick any pose at all to represent it. So instead, we'll pick a frame
-	// and sample the final mesh and skeleton (with nulls and such) at that point,
-	// and express all animation as a delta to that. 
+	source.logAttributeInfo();
 
-	/* This code redundant because of the above 
-	GU_Detail *guDetail;
-	SOP_Node* captureSOP = 0;
-	GU_DetailHandleAutoReadLock* gdl = 0;
-	OP_Node *deformerNode = OPfindOpInput(objNode->castToOBJNode()->getDisplaySopPtr(), "deform");
-	if (snapshotting || !deformerNode)
+	// Copy everything out in one pass, then weld from the plain arrays
+	HoudiniOgre_GeometrySource::Columns storage;
+	const HoudiniOgre_GeometrySource::Columns* columns;
 	{
-		// we want the final geometry
-		guDetail = const_cast<GU_Detail*>(
-			objNode->castToOBJNode()->castToOBJGeometry()->getRenderGeometry(frameTime));
+		HoudiniOgre_TraceSpan gatherSpan("gather", source.getName().c_str());
+		columns = &source.gather(storage);
 	}
-	else
-	{
-		// we want pre-deformation
-		captureSOP = CAST_SOPNODE(deformerNode->getInput(0));
 
-		gdl = new GU_DetailHandleAutoReadLock(captureSOP->getCookedGeoHandle(OP_Context(0.0)));
-		guDetail = const_cast<GU_Detail*>(gdl->getGdp());
-	}*/
-	//GU_Detail *guDetail = const_cast<GU_Detail*>(
-	//	objNode->castToOBJNode()->castToOBJGeometry()->getRenderGeometry(frameTime));
+	PrimitiveBatch batch;
+	batch.columns = columns;
+	prepareBatch(batch, source, useObjectTransforms);
 
-	//GU_DetailHandleAutoReadLock gdl(objNode->castToOBJNode()->castToOBJGeometry()->getRenderGeometryHandle(frameTime));
-
-	// Use Display flag (blue) rather than Render flag (purple)
-	GU_DetailHandleAutoReadLock gdl(objNode->castToOBJNode()->getDisplayGeometryHandle(frameTime));
-
-	GU_Detail *guDetail = const_cast<GU_Detail*> (gdl.getGdp());
-	// const GU_Detail *guDetail = gdl.getGdp();  // SESI prefers this ... but it causes problems later on.
+	reserveProtoStorage(*columns);
+	addPrimitives(batch);
 
-	if (!preprocessGeometry(guDetail, objNode, frameTime))
-		return;
+	// Bounds of the points the polygons use
+	std::vector<bool> used(columns->positions.size(), false);
+	size_t usedCount = 0;
+	for (std::vector<int>::const_iterator p = columns->vertexPoints.begin();
+		p != columns->vertexPoints.end(); ++p)
+	{
+		if (!used[*p])
+		{
+			used[*p] = true;
+			++usedCount;
+		}
+	}
+	if (usedCount)
+	{
+		Ogre::Vector3 min(Ogre::Math::POS_INFINITY, Ogre::Math::POS_INFINITY, Ogre::Math::POS_INFINITY);
+		Ogre::Vector3 max(Ogre::Math::NEG_INFINITY, Ogre::Math::NEG_INFINITY, Ogre::Math::NEG_INFINITY);
+		Ogre::Real squaredRadius = 0.0f;
+		if (usedCount == used.size())
+		{
+			HoudiniOgre_Simd::growBounds(batch.positions, usedCount, min, max, squaredRadius);
+		}
+		else
+		{
+			std::vector<Ogre::Vector3> usedPositions;
+			usedPositions.reserve(usedCount);
+			for (size_t p = 0; p < used.size(); ++p)
+			{
+				if (used[p])
+					usedPositions.push_back(batch.positions[p]);
+			}
+			HoudiniOgre_Simd::growBounds(&usedPositions[0], usedCount, min, max, squaredRadius);
+		}
 
-	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
+		// Merge bounds
+		Ogre::AxisAlignedBox box;
+		box.setExtents(min, max);
+		box.merge(mpMesh->getBounds());
+		mpMesh->_setBounds(box);
+		mpMesh->_setBoundingSphereRadius(
+			std::max(
+			mpMesh->getBoundingSphereRadius(), 
+			Ogre::Math::Sqrt(squaredRadius)));
+	}
 
-	int primCount = guDetail->primitives().entries();
-	int pointCount = guDetail->points().entries();
+	// Vertex animation textures hold the skinned result, so no bones then
+	bool vertexAnimation = mVertexAnimationEnabled && !snapshotting && numFrames > 1;
+	if (!vertexAnimation)
+		processBoneAssignments(source);
 
-	lmgr.logMessage("Number of primitives: " + Ogre::StringConverter::toString(primCount));
-	lmgr.logMessage("Number of points: " + Ogre::StringConverter::toString(pointCount));
-	lmgr.logMessage("Has normals:" + Ogre::StringConverter::toString(mCurrentHasNormals) + 
-		" on " + (mNormalsOnVertices ? "vertices" : "points"));
-	Ogre::StringUtil::StrStreamType uvstr;
-	uvstr << "Number of UV sets:" << mCurrentTextureCoordDimensions.size();
-	for (int t = 0; t < mCurrentTextureCoordDimensions.size(); ++t)
+	// pull out animation cycles IF we're exporting meshes once and not per-frame
+	if (!snapshotting && numFrames > 1)
 	{
-		uvstr << "(" << (mUVOnVertices[t] ? "vertices" : "points") << ") ";
+		processAnimationCycles(source, numFrames, frameStart, fps);
+
+		if (vertexAnimation)
+		{
+			// every object is sampled at the first one's frames, so they
+			// can share the textures' rows
+			if (!mVertexAnimation.hasCycles())
+				mVertexAnimation.setCycles(mAnimList, fps);
+			mVertexAnimation.sample(mCurrentGeometryID, source, *columns, 
+				useObjectTransforms, mMappedStore);
+		}
 	}
-	lmgr.logMessage(uvstr.str()); 
-	lmgr.logMessage("Has vertex colours:" + Ogre::StringConverter::toString(mCurrentHasVertexColours) + 
-		" on " + (mDiffuseOnVertices ? "vertices" : "points"));
 
+	// Post-process the mesh
+	postprocessGeometry(source);
 
-	if (mCurrentTextureCoordDimensions.size() > OGRE_MAX_TEXTURE_COORD_SETS)
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Mesh::reserveProtoStorage(const HoudiniOgre_GeometrySource::Columns& columns)
+{
+	// Indices / vertices going to each proto; consecutive primitives 
+	// usually go to the same one
+	std::map<ProtoSubMesh*, std::pair<size_t, size_t> > counts;
+	ProtoSubMesh* lastProto = 0;
+	std::pair<size_t, size_t>* count = 0;
+	size_t primCount = columns.primitiveStarts.size() - 1;
+	for (size_t prim = 0; prim < primCount; ++prim)
 	{
-		// too many texture coordinates!
-		Ogre::StringUtil::StrStreamType str;
-		str << "Geometry object '" << objNode->getName()
-			<< "' has too many texture coordinate sets (" 
-			<< mCurrentTextureCoordDimensions.size()
-			<< "); the limit is " << OGRE_MAX_TEXTURE_COORD_SETS;
+		size_t vcount = columns.primitiveStarts[prim + 1] - columns.primitiveStarts[prim];
+		if (!vcount)
+			continue;
+		if (mPrimitiveProtos[prim] != lastProto)
+		{
+			lastProto = mPrimitiveProtos[prim];
+			count = &counts[lastProto];
+		}
+		count->first += vcount >= 3 ? (vcount - 2) * 3 : vcount;
+		count->second += vcount;
+	}
 
-		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, str.str(), 
-			"HoudiniOgre_Mesh::addGeometry");
+	for (std::map<ProtoSubMesh*, std::pair<size_t, size_t> >::iterator c = counts.begin();
+		c != counts.end(); ++c)
+	{
+		reserveExtra(c->first->indices, c->second.first);
+		// welding leaves at least a vertex per point, at most one per polygon vertex
+		reserveExtra(c->first->uniqueVertices, std::min(c->second.second, columns.positions.size()));
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Mesh::prepareBatch(PrimitiveBatch& batch, 
+	const HoudiniOgre_GeometrySource& source, bool useObjectTransforms)
+{
+	HoudiniOgre_TraceSpan span("prepareBatch", source.getName().c_str());
+	const HoudiniOgre_GeometrySource::Columns& columns = *batch.columns;
+	size_t pointCount = columns.positions.size();
+	size_t vertexCount = columns.vertexPoints.size();
+
+	batch.positions = pointCount ? &columns.positions[0] : 0;
+	batch.normals = mCurrentHasNormals && vertexCount ? &columns.normals[0] : 0;
+	if (useObjectTransforms)
+	{
+		Ogre::Matrix4 xform;
+		Ogre::Matrix3 rot;
+		source.getWorldTransform(xform, rot);
+
+		batch.transformedPositions.resize(pointCount);
+		if (pointCount)
+		{
+			Ogre::Vector3* out = &batch.transformedPositions[0];
+			HoudiniOgre_Parallel::forRange(pointCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+				HoudiniOgre_Simd::transformPoints(xform, batch.positions + begin, out + begin, end - begin);
+			});
+			batch.positions = out;
+		}
+		if (batch.normals)
+		{
+			batch.transformedNormals.resize(vertexCount);
+			Ogre::Vector3* out = &batch.transformedNormals[0];
+			HoudiniOgre_Parallel::forRange(vertexCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+				HoudiniOgre_Simd::transformVectors(rot, batch.normals + begin, out + begin, end - begin);
+			});
+			batch.normals = out;
+		}
+	}
 
+	batch.uvs.resize(mCurrentTextureCoordDimensions.size());
+	for (size_t i = 0; i < batch.uvs.size(); ++i)
+	{
+		batch.uvs[i].resize(vertexCount * 2);
+		if (!vertexCount)
+			continue;
+		const float* in = &columns.uvs[i][0];
+		float* out = &batch.uvs[i][0];
+		HoudiniOgre_Parallel::forRange(vertexCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+			HoudiniOgre_Simd::flipUVs(in + begin * 2, out + begin * 2, end - begin);
+		});
 	}
 
-	// Bounds calculation
-	Ogre::Real squaredRadius = 0.0f;
-	Ogre::Vector3 min, max;
-	bool first = true;
+	if (mCurrentHasVertexColours && vertexCount)
+	{
+		Ogre::VertexElementType colourType = 
+			Ogre::VertexElement::getBestColourVertexElementType();
+		batch.colours.resize(vertexCount);
+		const Ogre::ColourValue* in = &columns.colours[0];
+		Ogre::RGBA* out = &batch.colours[0];
+		HoudiniOgre_Parallel::forRange(vertexCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+			HoudiniOgre_Simd::packColours(in + begin, out + begin, end - begin, colourType);
+		});
+	}
+}
+//---------------------------------------------------------------------
+template <bool Normals, bool Colours, int UVSets>
+void HoudiniOgre_Mesh::addPrimitives(const PrimitiveBatch& batch)
+{
+	const HoudiniOgre_GeometrySource::Columns& columns = *batch.columns;
+	const size_t uvSets = UVSets < 0 ? mCurrentTextureCoordDimensions.size() : UVSets;
+#if _DEBUG
+	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
+#endif
 	// temp vertex storage
 	UniqueVertex vertex;
 
-
-	// OP_Context apparantly only uses the myTime param
-	OP_Context context(frameTime);
-	// sigh - more const-casting required due to const correctness issues in Houdini
-	const UT_DMatrix4& hxform = const_cast<OP_Node*>(objNode)->getWorldTransform(context);
-	Ogre::Matrix4 xform = HoudiniMappings::toMat4(hxform);
-	UT_DMatrix3 hxrot;
-	hxform.extractRotate(hxrot);
-	Ogre::Matrix3 xrot = HoudiniMappings::toMat3(hxrot);
-
-
 	// Iterate over all the primitives (polygons)
+	int primCount = static_cast<int>(columns.primitiveStarts.size()) - 1;
 	for (int iprim = 0; iprim < primCount; ++iprim)
 	{
-		const GEO_Primitive* prim = guDetail->primitives()(iprim);
 #if _DEBUG
 		lmgr.logMessage("Primitive " + Ogre::StringConverter::toString(iprim));
 #endif
-		// only support polys for the moment
-		if (prim->getPrimitiveId() == GEOPRIMPOLY)
+		// only polys have vertices in the columns
+		Ogre::uint32 primStart = columns.primitiveStarts[iprim];
+		unsigned vcount = columns.primitiveStarts[iprim + 1] - primStart;
+		if (vcount)
 		{
-
-			const GEO_PrimPoly* primPoly = static_cast<const GEO_PrimPoly*>(prim);
-			if (!primPoly->isDegenerate())
-			{
-				unsigned vcount = primPoly->getVertexCount();
 #if _DEBUG
-				lmgr.logMessage("Primitive is a non-degenerate polygon, vertex count=" + Ogre::StringConverter::toString(vcount));
+			lmgr.logMessage("Primitive is a non-degenerate polygon, vertex count=" + Ogre::StringConverter::toString(vcount));
 #endif
-				// Firstly, let's check which proto we're adding this to
-				ProtoSubMesh* currentProto = mMainProtoMesh;
-				PrimitiveToProtoSubMeshList::iterator polyi = 
-					mPrimitiveToProtoSubMeshList.find(iprim);
-				if (polyi != mPrimitiveToProtoSubMeshList.end())
-				{
-					currentProto = polyi->second;
-				}
-				// has this mesh been used in this proto before? if not set offset
-				size_t positionIndexOffset;
-				if (currentProto->lastMeshEntry == guDetail)
+			// Firstly, let's check which proto we're adding this to
+			ProtoSubMesh* currentProto = mPrimitiveProtos[iprim];
+			// has this mesh been used in this proto before? if not set offset
+			size_t positionIndexOffset;
+			if (currentProto->lastMeshEntry == mCurrentGeometryID)
+			{
+				positionIndexOffset = currentProto->lastMeshIndexOffset;
+			}
+			else
+			{
+				// first time this has been used
+				// since we assume we 100% process each polygon mesh before the next,
+				// just use last pointer since faster in this section
+				currentProto->lastMeshEntry = mCurrentGeometryID;
+				positionIndexOffset = currentProto->indices.size();
+				currentProto->lastMeshIndexOffset = positionIndexOffset;
+				// Also have to store this for future reference
+				currentProto->geometryOffsetMap[mCurrentGeometryID] = positionIndexOffset;
+			}
+
+			size_t firstIndex, prevIndex;
+			for (unsigned vi = 0; vi < vcount; ++vi)
+			{
+				// Do the indexes in reverse order since Houdini seems to use
+				// D3D-style vertex winding
+				size_t c = primStart + vcount - vi - 1;
+
+				// Vertex is the unique vertex with attributes used by this poly
+				// but it's based on a point which may be shared between multiple polys
+				int origPointIndex = columns.vertexPoints[c]; // unique position index
+				// adjust index per offset, this makes position indices unique
+				// per polymesh in the same protosubmesh
+				long adjustedPosIndex = origPointIndex + positionIndexOffset;
+
+				// Get position, already transformed
+				vertex.position = batch.positions[origPointIndex];
+				vertex.sourceGeometry = static_cast<Ogre::uint32>(mCurrentGeometryID);
+				vertex.sourceVertex = static_cast<Ogre::uint32>(c);
+
+				// Get normal, if applicable
+				if (Normals)
 				{
-					positionIndexOffset = currentProto->lastMeshIndexOffset;
+					vertex.normal = batch.normals[c];
 				}
-				else
+
+				for (size_t i = 0; i < uvSets; ++i)
 				{
-					// first time this has been used
-					// since we assume we 100% process each polygon mesh before the next,
-					// just use last pointer since faster in this section
-					currentProto->lastMeshEntry = guDetail;
-					positionIndexOffset = currentProto->indices.size();
-					currentProto->lastMeshIndexOffset = positionIndexOffset;
-					// Also have to store this for future reference
-					currentProto->geometryOffsetMap[guDetail] = positionIndexOffset;
+					vertex.uv[i].x = batch.uvs[i][c*2];
+					vertex.uv[i].y = batch.uvs[i][c*2+1];
 				}
 
-				size_t firstIndex, prevIndex;
-				for (unsigned vi = 0; vi < vcount; ++vi)
+				if (Colours)
 				{
-					// Do the indexes in reverse order since Houdini seems to use
-					// D3D-style vertex winding
-					unsigned reverseIndex = vcount - vi - 1;
-
-					// Vertex is the unique vertex with attributes used by this poly
-					// but it's based on a point which may be shared between multiple polys
-					const GEO_Vertex& hVertex = primPoly->getVertex(reverseIndex);
-					// The unique (positional) point
-					GB_Element* elem = hVertex.getBasePt();
-					// elem->getNum indicates the unique point number on the geom
-
-					int origPointIndex = elem->getNum(); // unique position index
-					// adjust index per offset, this makes position indices unique
-					// per polymesh in the same protosubmesh
-					long adjustedPosIndex = origPointIndex + positionIndexOffset;
-
-					// All normal, UV and colour attribs are on point
-					// Vertex (a point on a face) only seems to have point number as an attrib
-					const GEO_Point* point = guDetail->points()(origPointIndex);
-					// Get position
-					vertex.position = HoudiniMappings::toVec3(hVertex.getPos());
-
-					// Apply instance transform
-					if (useObjectTransforms)
-					{
-						vertex.position = xform * vertex.position;
-					}
-
-					// Get normal, if applicable
-					if (mCurrentHasNormals)
-					{
-						UT_Vector3* norm;
-						if (mNormalsOnVertices)
-							norm = static_cast<UT_Vector3*>(hVertex.getAttribData(mNormalAttrib));
-						else
-							norm = static_cast<UT_Vector3*>(point->getAttribData(mNormalAttrib));
-						vertex.normal = HoudiniMappings::toVec3(*norm);
-						// Apply global rotation
-						if (useObjectTransforms)
-						{
-							vertex.normal = xrot * vertex.normal;
-						}
-					}
-
-					for (size_t i = 0; i < mCurrentTextureCoordDimensions.size(); ++i)
-					{
-						float* uv;
-						if (mUVOnVertices[i]) 
-							uv = static_cast<float*>(hVertex.getAttribData(mUVAttribs[i]));
-						else
-							uv = static_cast<float*>(point->getAttribData(mUVAttribs[i]));
-						vertex.uv[i].x = uv[0];
-						vertex.uv[i].y = 1.0 - uv[1];
-
-					}
-
-					if (mCurrentHasVertexColours)
-					{
-						float* col;
-						if (mDiffuseOnVertices)
-							col = static_cast<float*>(hVertex.getAttribData(mDiffseAttrib));
-						else
-							col = static_cast<float*>(point->getAttribData(mDiffseAttrib));
-						vertex.colour = HoudiniMappings::toRGBA(col);
-					}
-
+					vertex.colour = batch.colours[c];
+				}
 
-					size_t index = createOrRetrieveUniqueVertex(
-						currentProto, adjustedPosIndex, true, vertex);
 
-					// Here we need to deal with the fact that Houdini's polygons 
-					// are not triangles, necessarily
-					if (vi >= 3)
-					{
-						// re-issue the first and previous vertices
-						// this creates a fan, we might want to do something more
-						// clever here eventually
-						currentProto->indices.push_back(firstIndex);
-						currentProto->indices.push_back(prevIndex);
-					}
-					currentProto->indices.push_back(index);
-					prevIndex = index;
-					if (vi == 0)
-						firstIndex = index;
+				size_t index = createOrRetrieveUniqueVertex(
+					currentProto, adjustedPosIndex, true, vertex);
 
-					// bounds
-					if (first)
-					{
-						squaredRadius = vertex.position.squaredLength();
-						min = max = vertex.position;
-						first = false;
-					}
-					else
-					{
-						squaredRadius = 
-							std::max(squaredRadius, vertex.position.squaredLength());
-						min.makeFloor(vertex.position);
-						max.makeCeil(vertex.position);
-					}
+				// Here we need to deal with the fact that Houdini's polygons 
+				// are not triangles, necessarily
+				if (vi >= 3)
+				{
+					// re-issue the first and previous vertices
+					// this creates a fan, we might want to do something more
+					// clever here eventually
+					currentProto->indices.push_back(firstIndex);
+					currentProto->indices.push_back(prevIndex);
+				}
+				currentProto->indices.push_back(index);
+				prevIndex = index;
+				if (vi == 0)
+					firstIndex = index;
 
 
 #if _DEBUG
-					Ogre::StringUtil::StrStreamType str;
-					str << "Vertex " << vi << " has base point num " << elem->getNum()
-						<< " and position " << vertex.position << "";
-					lmgr.logMessage(str.str());
+				Ogre::StringUtil::StrStreamType str;
+				str << "Vertex " << vi << " has base point num " << origPointIndex
+					<< " and position " << vertex.position << "";
+				lmgr.logMessage(str.str());
 #endif
 
 
-				}
-
 			}
 
 		}
 	}
 
-	// Merge bounds
-	Ogre::AxisAlignedBox box;
-	box.setExtents(min, max);
-	box.merge(mpMesh->getBounds());
-	mpMesh->_setBounds(box);
-	mpMesh->_setBoundingSphereRadius(
-		std::max(
-		mpMesh->getBoundingSphereRadius(), 
-		Ogre::Math::Sqrt(squaredRadius)));
-
-	processBoneAssignments(objNode, guDetail);
-
-	// pull out animation cycles IF we're exporting meshes once and not per-frame
-	if (!snapshotting && numFrames > 1)
-		processAnimationCycles(objNode, numFrames, frameStart, fps);
-
-	// Post-process the mesh
-	postprocessGeometry(guDetail, objNode);
 
 }
 //---------------------------------------------------------------------
-bool HoudiniOgre_Mesh::preprocessGeometry(GU_Detail* guDetail, const OP_Node* objNode,
-										  float frameTime)
+template <int UVSets>
+void HoudiniOgre_Mesh::addPrimitivesWithUVs(const PrimitiveBatch& batch)
 {
-
-	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
-	// determine the geometry format
-
-	// try vertices first
-	// NB Houdini doesn't support per-vertex normals yet, but we might as well
-	// cope with this since it's a popular RFE
-	mNormalAttrib = guDetail->findVertexAttrib("N", sizeof(UT_Vector3), GB_ATTRIB_VECTOR);
-	if (mNormalAttrib >= 0)
+	if (mCurrentHasNormals)
 	{
-		mCurrentHasNormals = true;
-		mNormalsOnVertices = true;
+		if (mCurrentHasVertexColours)
+			addPrimitives<true, true, UVSets>(batch);
+		else
+			addPrimitives<true, false, UVSets>(batch);
 	}
 	else
 	{
-		mNormalAttrib = guDetail->findPointAttrib("N", sizeof(UT_Vector3), GB_ATTRIB_VECTOR);
-		if (mNormalAttrib >= 0)
-		{
-			mCurrentHasNormals = true;
-			mNormalsOnVertices = false;
-		}
+		if (mCurrentHasVertexColours)
+			addPrimitives<false, true, UVSets>(batch);
 		else
-		{
-			mCurrentHasNormals = false;
-		}
+			addPrimitives<false, false, UVSets>(batch);
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Mesh::addPrimitives(const PrimitiveBatch& batch)
+{
+	// Decide once per object rather than for every vertex
+	switch (mCurrentTextureCoordDimensions.size())
+	{
+	case 0: addPrimitivesWithUVs<0>(batch); break;
+	case 1: addPrimitivesWithUVs<1>(batch); break;
+	case 2: addPrimitivesWithUVs<2>(batch); break;
+	case 3: addPrimitivesWithUVs<3>(batch); break;
+	case 4: addPrimitivesWithUVs<4>(batch); break;
+	default: addPrimitivesWithUVs<-1>(batch); break;
 	}
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_Mesh::preprocessGeometry(const HoudiniOgre_GeometrySource& source)
+{
+	// Each addGeometry call is a distinct set of point numbers
+	mCurrentGeometryID = mGeometryCount++;
 
+	// determine the geometry format
+	mCurrentHasNormals = source.hasNormals();
+	mCurrentHasVertexColours = source.hasColours();
 
-	mCurrentTextureCoordDimensions.clear();
-	mUVAttribs.clear();
-	mUVOnVertices.clear();
-	for (int uvset = 0; uvset < OGRE_MAX_TEXTURE_COORD_SETS; ++uvset)
-	{
-		Ogre::StringUtil::StrStreamType uvname;
-		uvname << "uv";
-		if (uvset > 0) // no uv1, just uv
-		{
-			uvname << (uvset + 1);
-		}
-		// Try to find on vertices first
-		int uvAttrib = guDetail->findVertexAttrib(uvname.str().c_str(), 
-			3*sizeof(float), GB_ATTRIB_FLOAT);
-		bool uvsOnVertices = true;
-		if (uvAttrib < 0)
-		{
-			uvsOnVertices = false;
-			uvAttrib = guDetail->findPointAttrib(uvname.str().c_str(), 
-				3*sizeof(float), GB_ATTRIB_FLOAT);
-			// no good?
-			if (uvAttrib < 0)
-				break;
-		}
-		// TODO: determine actual size of UV sets?
-		// Houdini seems to store 3D UVs all the time even when they're not useful
-		mCurrentTextureCoordDimensions.push_back(2);
-		mUVAttribs.push_back(uvAttrib);
-		mUVOnVertices.push_back(uvsOnVertices);
+	if (source.getUVSetCount() > OGRE_MAX_TEXTURE_COORD_SETS)
+	{
+		// too many texture coordinates!
+		Ogre::StringUtil::StrStreamType str;
+		str << "Geometry object '" << source.getName()
+			<< "' has too many texture coordinate sets (" 
+			<< source.getUVSetCount()
+			<< "); the limit is " << OGRE_MAX_TEXTURE_COORD_SETS;
 
-	}
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, str.str(), 
+			"HoudiniOgre_Mesh::preprocessGeometry");
 
-	mDiffseAttrib = guDetail->findVertexAttrib("Cd", 3*sizeof(float), GB_ATTRIB_FLOAT);
-	if (mDiffseAttrib >= 0)
-	{
-		mCurrentHasVertexColours = true;
-		mDiffuseOnVertices = true;
-	}
-	else
-	{
-		mDiffseAttrib = guDetail->findPointAttrib("Cd", 3*sizeof(float), GB_ATTRIB_FLOAT);
-		if (mDiffseAttrib >= 0)
-		{
-			mCurrentHasVertexColours = true;
-			mDiffuseOnVertices = false;
-		}
-		else
-		{
-			mCurrentHasVertexColours = false;
-		}
 	}
 
+	// TODO: determine actual size of UV sets?
+	// Houdini seems to store 3D UVs all the time even when they're not useful
+	mCurrentTextureCoordDimensions.assign(source.getUVSetCount(), 2);
+
 	// Create any ProtoSubMeshes which don't exist yet for the 
 	// materials in question, and define the PolygonCluster map
 	// Main material (will never exist if not merging submeshes)
-	// Get global shader name
-	// Houdini's not very good at const correctness, have to cast away const here
-	PRM_Parm& shaderParm = const_cast<PRM_Parm&>(objNode->getParm("shop_surfacepath"));
-	UT_String shaderName;
-	shaderParm.getValue(frameTime, shaderName, 0, 0);
-
-	Ogre::String materialName = Ogre::String(shaderName);
-	lmgr.logMessage("Object surface shader: " + materialName);
-
 
 	// TODO: potentially register this material if we want to export it later.
 
 	mMainProtoMesh = createOrRetrieveProtoSubMesh(
-		materialName, 
-		Ogre::String(objNode->getName()),
+		source.getMaterialName(), 
+		source.getName(),
 		mCurrentHasNormals,
 		mCurrentTextureCoordDimensions, 
 		mCurrentHasVertexColours);
+	mPrimitiveProtos.assign(source.getPrimitiveCount(), mMainProtoMesh);
 
-	// Now go looking for 'shop' SOPs which can change materials per poly
-
-	for (int c = 0; c < objNode->getNchildren(); ++c)
+	// Now the groups of primitives which use other materials
+	const HoudiniOgre_GeometrySource::MaterialGroupList& groups = source.getMaterialGroups();
+	for (HoudiniOgre_GeometrySource::MaterialGroupList::const_iterator g = groups.begin();
+		g != groups.end(); ++g)
 	{
-		OP_Node* child = objNode->getChild(c);
-		OP_Operator* op = child->getOperator();
-		// Hmm, all nodes appear to be of OpType "SOP", whilst I need to look for 
-		// the detail type ie 'shop'
-		lmgr.logMessage("Child " + Ogre::String(child->getName()) + " is of type " 
-			+ Ogre::String(child->getOpType()) + " and opname " + Ogre::String(op->getName()));
-
-		// Shader operator can change shaders per sub-object, we must respect that
-		if (op->getName() == "shop")
-		{
-			// You can specify a new shader one of 2 ways, in the generic 'surface'
-			// property (quicksurface) or in the 'Primary' tab 'Surface Shader'
-			// property (surfpath1). To be honest I'm not sure which should 'win'
-			// if both are specified, so I'm going to use the quicksurface if its there
-			PRM_Parm& quicksurface = child->getParm("quicksurface");
-			UT_String val;
-			quicksurface.getValue(frameTime, val, 0, 0);
-			if (val == "")
-			{
-				// try surfpath1
-				PRM_Parm& surfpath1 = child->getParm("surfpath1");
-				surfpath1.getValue(frameTime, val, 0, 0);
-			}
-
-			if (val != "")
-			{
-				Ogre::String subMaterial(val);
-				// does it differ from main material?
-				if (subMaterial != materialName)
-				{
-					lmgr.logMessage("specialised material: " + subMaterial);
-
-					// TODO - register this material if we want to exoprt it later
-
-					ProtoSubMesh* ps = createOrRetrieveProtoSubMesh(
-						subMaterial,
-						Ogre::String(child->getName()), // name submesh based on SOP
-						mCurrentHasNormals,
-						mCurrentTextureCoordDimensions, 
-						mCurrentHasVertexColours);
-
-
-					// Get a list of primitive groups that are using this shader
-					SOP_Node* sopNode = child->castToSOPNode();
-					GB_PrimitiveGroup* gbPrim = sopNode->parsePrimitiveGroupsCopy("*", guDetail);
-					unsigned numEntries = gbPrim->entries();
-					GB_ElementTree* tree =  gbPrim->ordered();
-					Ogre::StringUtil::StrStreamType str;
-					str << "Primitives referenced: ";
-					for (const GB_Element* cur = tree->head(); cur != 0; cur = tree->next(cur))
-					{
-						// Create a mapping from this primitive to the proto
-						mPrimitiveToProtoSubMeshList[cur->getNum()] = ps;
-						str << cur->getNum() << " ";
-					}
-					lmgr.logMessage(str.str());
+		// TODO - register this material if we want to exoprt it later
 
-					// clean up 
-					sopNode->destroyAdhocGroup(gbPrim);
-				}
-			}
+		ProtoSubMesh* ps = createOrRetrieveProtoSubMesh(
+			g->materialName,
+			g->name,
+			mCurrentHasNormals,
+			mCurrentTextureCoordDimensions, 
+			mCurrentHasVertexColours);
 
+		for (std::vector<int>::const_iterator p = g->primitives.begin();
+			p != g->primitives.end(); ++p)
+		{
+			// Route this primitive to the proto
+			if (*p >= 0 && *p < static_cast<int>(mPrimitiveProtos.size()))
+				mPrimitiveProtos[*p] = ps;
 		}
-
 	}
 
 	return true;
 
 }
 //-----------------------------------------------------------------------
-void HoudiniOgre_Mesh::postprocessGeometry(GU_Detail* guDetail, const OP_Node* objNode)
+void HoudiniOgre_Mesh::postprocessGeometry(const HoudiniOgre_GeometrySource& source)
 {
 	// clear all position index remaps, incase merged
-	for (MaterialProtoSubMeshMap::iterator m = mMaterialProtoSubmeshMap.begin();
-		m != mMaterialProtoSubmeshMap.end(); ++m)
+	for (MaterialIDMap::iterator m = mMaterialIDs.begin(); m != mMaterialIDs.end(); ++m)
 	{
+		ProtoSubMeshList* protoList = mMaterialProtoLists[m->second];
 
-		for (ProtoSubMeshList::iterator p = m->second->begin();
-			p != m->second->end(); ++p)
+		for (ProtoSubMeshList::iterator p = protoList->begin();
+			p != protoList->end(); ++p)
 		{
 			ProtoSubMesh* ps = *p;
 			ps->posIndexRemap.clear();
 		}
 	}
+	// which leaves nothing in the scratch arena
+	mScratchArena.reset();
+	// the object is done with, so out of core it can go to disk
+	if (mMappedStore)
+		mMappedStore->trim();
 
-	mPrimitiveToProtoSubMeshList.clear();
+	mPrimitiveProtos.clear();
 	mCurrentTextureCoordDimensions.clear();
-	mUVAttribs.clear();
-	mUVOnVertices.clear();
 
 }
 //-----------------------------------------------------------------------
-void HoudiniOgre_Mesh::processBoneAssignments(const OP_Node* objNode, GU_Detail* origGuDetail)
+void HoudiniOgre_Mesh::processBoneAssignments(const HoudiniOgre_GeometrySource& source)
 {
 	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
-	lmgr.logMessage("Looking for bone assignments...");
-
-	OP_Node *deformerNode = OPfindOpInput(objNode->castToOBJNode()->getDisplaySopPtr(), "deform");
-
-	if (!deformerNode)
-	{
-		lmgr.logMessage("No deform SOP found, no bone assignments.");
-		return;
-	}
 
-	// we want pre-deformation
-	SOP_Node* captureSOP = CAST_SOPNODE(deformerNode->getInput(0));
-	if (!captureSOP)
-	{
-		lmgr.logMessage("No inputs to deform node, no bone assignments.");
-		return;
-	}
-
-	OP_Context tempCtx(0.0);
-	GU_DetailHandleAutoReadLock gdl = 
-		GU_DetailHandleAutoReadLock(captureSOP->getCookedGeoHandle(tempCtx));
-	GU_Detail* guDetail = const_cast<GU_Detail*>(gdl.getGdp());
-
-	// Now build a capture data helper to assist us getting nodes later.
-	SOP_CaptureData capture_data;
-	capture_data.initialize(captureSOP, guDetail);
-
-
-	UT_String sop_path, root_path;
-	guDetail->getCaptureRegionRootPath( root_path );
-	root_path += "/";
-
-	int numRegions = capture_data.getNumRegions();
-	lmgr.logMessage("Number of capture regions: " + Ogre::StringConverter::toString(numRegions));
-	// Probably should never happen, but lets be safe
+	size_t numRegions = source.getCaptureRegionCount();
 	if (numRegions == 0)
 	{
-		lmgr.logMessage("No capture regions found, no bone assignments.");
+		lmgr.logMessage("No capture data, no bone assignments.");
 		return;
 	}
 
 	// mapping from local region index to global bone index
-	unsigned short* globalBoneIndexes = new unsigned short[numRegions];
-	for (int b = 0; b < numRegions; ++b)
-	{
-		sop_path = root_path;
-		sop_path += capture_data.getSOPPath(b);
-		// Have to remove trailing digits since this path includes '0' on the end for cregion primitive
-		// which is not part of the cregion object name
-		sop_path.removeTrailingDigits();
-		OP_Node* cregion = captureSOP->findNode(sop_path);
-		OBJ_Bone* bone = cregion->getCreator()->castToOBJNode()->castToOBJBone();
-		//UT_String s = bone->getName();
-		Ogre::StringUtil::StrStreamType msg;
-		msg << "Bone found: " << bone->getName();
-		lmgr.logMessage(msg.str());
+	std::vector<unsigned short> globalBoneIndexes(numRegions);
+	for (size_t b = 0; b < numRegions; ++b)
+	{
+		OBJ_Bone* bone = source.getCaptureRegionBone(b);
 
 		// locate in list, or add
 		unsigned short boneIndex;
@@ -669,46 +689,34 @@ void HoudiniOgre_Mesh::processBoneAssignments(const OP_Node* objNode, GU_Detail*
 		globalBoneIndexes[b] = boneIndex;
 	}
 
-	// You can get the capture attribute like this:
-	// int  blendInfoAttr = guDetail->findPointCaptureAttribute();
-	// And a pointer to the data like this:
-	// float* blendInfoPtr = (float*)guDetail->points()(17)->getAttribData(blendInfoAttr);
-	// - even numbers in the array are region indexes, odds are weights
-	// BUT - no way to find out how many there are? Seems like they are null-terminated
-	// but I'm not entirely sure that's guaranteed, might just be buffer content fluke
-	// Therefore use getCaptureWeights which gives definitive list size
-
-	
-	UT_IntArray regionArray;
-	UT_FloatArray weightArray;
+	std::vector<int> regionArray;
+	std::vector<float> weightArray;
 
-	unsigned int numPoints = guDetail->points().entries();
-	for (unsigned int p = 0; p < numPoints; ++p)
+	int numPoints = source.getPointCount();
+	for (int pointIndex = 0; pointIndex < numPoints; ++pointIndex)
 	{
-		const GEO_Point* point = guDetail->points()(p);
-		guDetail->getCaptureWeights(point, regionArray, weightArray);
-		int pointIndex = point->getNum();
+		source.getCaptureWeights(pointIndex, regionArray, weightArray);
 
 		// Need to a) translate the region index back to a bone, and b) propagate
 		// this bone assignment to all copies of vertex in proto
 
-		for (int c = 0; c < regionArray.entries(); ++c)
+		for (size_t c = 0; c < regionArray.size(); ++c)
 		{
 			Ogre::VertexBoneAssignment vba;
-			vba.boneIndex = globalBoneIndexes[regionArray(c)];
-			vba.weight = weightArray(c);
+			vba.boneIndex = globalBoneIndexes[regionArray[c]];
+			vba.weight = weightArray[c];
 
 			// Apply this to each vertex derived from this point
 			// Locate ProtoSubMeshes which use this mesh
-			for (MaterialProtoSubMeshMap::iterator mi = mMaterialProtoSubmeshMap.begin();
-				mi != mMaterialProtoSubmeshMap.end(); ++mi)
+			for (MaterialIDMap::iterator mi = mMaterialIDs.begin(); mi != mMaterialIDs.end(); ++mi)
 			{
-				for (ProtoSubMeshList::iterator psi = mi->second->begin();
-					psi != mi->second->end(); ++psi)
+				ProtoSubMeshList* protoList = mMaterialProtoLists[mi->second];
+				for (ProtoSubMeshList::iterator psi = protoList->begin();
+					psi != protoList->end(); ++psi)
 				{
 					ProtoSubMesh* ps = *psi;
 					ProtoSubMesh::GeometryOffsetMap::iterator poli = 
-						ps->geometryOffsetMap.find(origGuDetail);
+						ps->geometryOffsetMap.find(mCurrentGeometryID);
 					if (poli != ps->geometryOffsetMap.end())
 					{
 						// adjust index based on merging
@@ -733,7 +741,6 @@ void HoudiniOgre_Mesh::processBoneAssignments(const OP_Node* objNode, GU_Detail*
 								Ogre::StringUtil::StrStreamType vbaMsg;
 								vbaMsg << "Added bone assignment: point=" << pointIndex
 									<< " vertex=" << vertIndex << " boneIndex=" << vba.boneIndex
-									<< " bone=" << mBoneList[vba.boneIndex]->getName()
 									<< " weight=" << vba.weight;
 								lmgr.logMessage(vbaMsg.str());
 #endif
@@ -757,100 +764,25 @@ void HoudiniOgre_Mesh::processBoneAssignments(const OP_Node* objNode, GU_Detail*
 		}
 
 	}
-	
-	delete [] globalBoneIndexes;
 
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Mesh::processAnimationCycles(const OP_Node* objNode, 
+void HoudiniOgre_Mesh::processAnimationCycles(const HoudiniOgre_GeometrySource& source, 
 											  int numFrames, int frameStart, 
 											  float fps)
 {
 	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
 	// Animations are stored on the objects themselves as a detail attribute
-	// called 'animcycle'. We sample this throughout the timeline and its value
-	// will change when a different attribute is found.
+	// called 'animcycle', which the source picks up for us.
 	// If no animcycle attribute is found, we just bake the entire timeline
 	// as a single animation called 'default'
-
-	AnimationEntry animEntry;
-	bool inAnimation = false;
-	
-	Ogre::StringUtil::StrStreamType msg;
-	for (int f = frameStart; f < frameStart + numFrames; ++f)
-	{
-		// Convert to frame time
-		float fTime = (float)f / fps;
-
-		// Since detail attributes change per frame, have to 'cook' the data at
-		// each frame to extract it?
-
-		SOP_Node* displaySop = objNode->castToOBJNode()->getDisplaySopPtr();
-
-		OP_Context tempCtx(fTime);
-		GU_DetailHandleAutoReadLock gdl(displaySop->getCookedGeoHandle(tempCtx));
-		const GU_Detail *frameGeom = gdl.getGdp();
-
-
-		GEO_AttributeHandle a = frameGeom->getDetailAttribute("animcycle");
-		UT_String val;
-		if (a.getString(val))
-		{
-			Ogre::String animName(val);
-			if (inAnimation)
-			{
-				if (animName == animEntry.animationName)
-				{
-					// just extend
-					animEntry.endFrame = f;
-				}
-				else
-				{
-					// changed, write out old animation
-					animEntry.endFrame = f - 1;
-					mAnimList.push_back(animEntry);
-					inAnimation = false;
-
-					msg.str(Ogre::StringUtil::BLANK);
-					msg << "Animation detected: '" << animEntry.animationName 
-						<< "' startFrame=" << animEntry.startFrame
-						<< " endFrame=" << animEntry.endFrame;
-					lmgr.logMessage(msg.str());
-				}
-			}
-
-			// NB not else since inAnimation can be reset above
-			if (!inAnimation)
-			{
-				// ignore animations called 'none' or blank
-				if (!animName.empty() && animName != "none")
-				{
-					// start new animation
-					animEntry.animationName = animName;
-					animEntry.startFrame = f;
-					inAnimation = true;
-				}
-			}
-
-		}
-	}
-	// mop-up if we had animation right up to last frame
-	if (inAnimation)
-	{
-		animEntry.endFrame = frameStart + numFrames - 1;
-		mAnimList.push_back(animEntry);
-
-		msg.str(Ogre::StringUtil::BLANK);
-		msg << "Animation detected: '" << animEntry.animationName 
-			<< "' startFrame=" << animEntry.startFrame
-			<< " endFrame=" << animEntry.endFrame;
-		lmgr.logMessage(msg.str());
-	}
+	source.getAnimationCycles(numFrames, frameStart, fps, mAnimList);
 
 	// Did we find any animations?
 	if (mAnimList.empty())
 	{
 		// if not, create a default one covering the whole period
+		AnimationEntry animEntry;
 		animEntry.animationName = "default";
 		animEntry.startFrame = frameStart;
 		animEntry.endFrame = frameStart + numFrames - 1;
@@ -868,61 +800,43 @@ HoudiniOgre_Mesh::ProtoSubMesh* HoudiniOgre_Mesh::createOrRetrieveProtoSubMesh(
 	bool createNew = true;
 	ProtoSubMesh* ret = 0;
 	ProtoSubMeshList* protoList = 0;
+	Ogre::uint32 formatKey = packVertexFormat(hasNormals, texCoordDims, hasVertexColours);
 
-	MaterialProtoSubMeshMap::iterator pi = mMaterialProtoSubmeshMap.find(materialName);
-	if (pi == mMaterialProtoSubmeshMap.end())
+	// Intern the material name, the only lookup by name
+	std::pair<MaterialIDMap::iterator, bool> interned = mMaterialIDs.insert(
+		MaterialIDMap::value_type(materialName, mMaterialProtoLists.size()));
+	size_t materialID = interned.first->second;
+	if (interned.second)
 	{
-		protoList = new ProtoSubMeshList();
-		mMaterialProtoSubmeshMap[materialName] = protoList;
+		protoList = new (mProtoArena.allocate(sizeof(ProtoSubMeshList))) 
+			ProtoSubMeshList(ProtoSubMeshList::allocator_type(&mProtoArena));
+		mMaterialProtoLists.push_back(protoList);
 	}
 	else
 	{
 		// Iterate over the protos with the same material
-		protoList = pi->second;
+		protoList = mMaterialProtoLists[materialID];
 
 		for (ProtoSubMeshList::iterator psi = protoList->begin(); psi != protoList->end(); ++psi)
 		{
-			ProtoSubMesh* candidate = *psi;
 			// Check format is compatible
-			if (candidate->textureCoordDimensions.size() != texCoordDims.size())
-			{
-				continue;
-			}
-			if (candidate->hasVertexColours != hasVertexColours)
-			{
-				continue;
-			}
-			if (candidate->hasNormals != hasNormals)
+			if ((*psi)->formatKey == formatKey)
 			{
-				continue;
-			}
-
-			bool compat = true;
-			TextureCoordDimensionList::iterator t = texCoordDims.begin();
-			TextureCoordDimensionList::iterator u = candidate->textureCoordDimensions.begin(); 
-			for (;t != texCoordDims.end(); ++t,++u)
-			{
-				if (*t != *u)
-				{
-					compat = false;
-					break;
-				}
-			}
-
-			if (compat)
-			{
-				createNew = false;
-				ret = candidate;
-				break;
+				createNew = false;
+				ret = *psi;
+				break;
 			}
 		}
 	}
 
 	if (createNew)
 	{
-		ret = new ProtoSubMesh();
+		ret = new (mProtoArena.allocate(sizeof(ProtoSubMesh))) 
+			ProtoSubMesh(&mProtoArena, &mScratchArena, mMappedStore);
 		protoList->push_back(ret);
 		ret->materialName = materialName;
+		ret->materialID = materialID;
+		ret->formatKey = formatKey;
 		ret->name = name;
 		ret->textureCoordDimensions = texCoordDims;
 		ret->hasVertexColours = hasVertexColours;
@@ -1000,69 +914,121 @@ size_t HoudiniOgre_Mesh::createOrRetrieveUniqueVertex(
 	}
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Mesh::Export(const Ogre::String& filename, bool edgeList, 
-							  bool tangents, Ogre::VertexElementSemantic tangentsType, 
-							  int numFrames, int frameStart, 
-							  float fps, float ikSampleRate)
+void HoudiniOgre_Mesh::Export(const Ogre::String& filename, 
+							  const Ogre::String& skeletonName, bool edgeList, 
+							  bool tangents, Ogre::VertexElementSemantic tangentsType)
 {
-	Ogre::LogManager& lmgr = Ogre::LogManager::getSingleton();
+	HoudiniOgre_TraceSpan span("Mesh::Export", filename.c_str(), "frame", mFrame);
 
 	if (!mpMesh.isNull())
 	{
-		// Set up skeleton and link
-		if (!mBoneList.empty())
+		// Link to skeleton
+		if (!skeletonName.empty())
 		{
-			// strip off 'mesh', replace with 'skeleton'
-			Ogre::String skeletonFileName = filename.substr(0, filename.size() - 4) + "skeleton";
-
-			HoudiniOgre_Skeleton skel(mBoneList);
-			skel.Export(skeletonFileName, fps, ikSampleRate, mAnimList);
-
-			// Now trim the skeleton file name down to just filename
-			Ogre::String skeletonName;
-			Ogre::String::size_type startPos = skeletonFileName.rfind('/');
-			if (startPos == Ogre::String::npos)
-			{
-				skeletonName = skeletonFileName;
-			}
-			else
-			{
-				skeletonName = skeletonFileName.substr(startPos + 1);
-			}
-
 			mpMesh->setSkeletonName(skeletonName);
-
 		}
 
 		// Bake any protos that haven't been done yet
+		mWeldedVertexCount = 0;
+		mDegenerateTriangleCount = 0;
+		mDuplicateTriangleCount = 0;
+		mTangentSplitCount = 0;
+		mGenerateTangents = tangents;
+		mTangentsSemantic = tangentsType;
+		mCollectSidecars = mWriteBounds || mWriteBVH || mWriteDepthMesh;
+		mCollectEdgeList = edgeList;
 		bakeProtoSubMeshes();
-
-		if (edgeList)
+		mCollectSidecars = false;
+		if (mWeldPosition > 0)
+		{
+			Ogre::LogManager::getSingleton().logMessage("Welding removed " + 
+				Ogre::StringConverter::toString(mWeldedVertexCount) + " vertices from " + filename);
+		}
+		if (mRemoveDegenerates)
 		{
-			mpMesh->buildEdgeList();
+			Ogre::LogManager::getSingleton().logMessage("Removed " + 
+				Ogre::StringConverter::toString(mDegenerateTriangleCount) + " degenerate and " + 
+				Ogre::StringConverter::toString(mDuplicateTriangleCount) + 
+				" duplicate triangles from " + filename);
 		}
 
 		if (tangents)
 		{
-			unsigned short inTex, outTex;
-			if (mpMesh->suggestTangentVectorBuildParams(tangentsType, inTex, outTex))
-			{
-				mpMesh->buildTangentVectors(tangentsType, inTex, outTex);
-			}
-			else
-			{
-				std::cerr << "Warning: suggestTangentVectorBuildParams failed, aborting tangent generation." << std::endl;
-			}
+			Ogre::LogManager::getSingleton().logMessage("Tangents split " + 
+				Ogre::StringConverter::toString(mTangentSplitCount) + 
+				" vertices at mirrored texture seams in " + filename);
+		}
+		if (mMappedStore)
+		{
+			Ogre::LogManager::getSingleton().logMessage("Out of core: peak of " + 
+				Ogre::StringConverter::toString(mMappedStore->getPeakMappedBytes() >> 20) + 
+				"MB mapped, written back " + 
+				Ogre::StringConverter::toString(mMappedStore->getTrimCount()) + 
+				" times, for " + filename);
+		}
+		if (mVertexAnimation.isStarted())
+		{
+			// the mesh moves on the GPU, so must be bounded wherever it goes
+			Ogre::AxisAlignedBox box = mVertexAnimation.computeBounds();
+			Ogre::Vector3 furthest(
+				std::max(Ogre::Math::Abs(box.getMinimum().x), Ogre::Math::Abs(box.getMaximum().x)),
+				std::max(Ogre::Math::Abs(box.getMinimum().y), Ogre::Math::Abs(box.getMaximum().y)),
+				std::max(Ogre::Math::Abs(box.getMinimum().z), Ogre::Math::Abs(box.getMaximum().z)));
+			box.merge(mpMesh->getBounds());
+			mpMesh->_setBounds(box);
+			mpMesh->_setBoundingSphereRadius(
+				std::max(mpMesh->getBoundingSphereRadius(), furthest.length()));
 		}
 
 
-		Ogre::MeshSerializer serializer;
-		serializer.exportMesh(mpMesh.getPointer(), filename);
+		serializeMesh(filename);
+		mCollectEdgeList = false;
 
+		Ogre::AxisAlignedBox bounds = mpMesh->getBounds();
+		Ogre::Real radius = mpMesh->getBoundingSphereRadius();
 		Ogre::MeshManager::getSingleton().remove(mpMesh->getHandle());
 
 		mpMesh.setNull();
 
+		Ogre::String base = Ogre::StringUtil::endsWith(filename, ".mesh") ?
+			filename.substr(0, filename.size() - 5) : filename;
+		if (mVertexAnimation.isStarted())
+		{
+			mVertexAnimation.save(base);
+			Ogre::LogManager::getSingleton().logMessage("Vertex animation textures of " + 
+				Ogre::StringConverter::toString(mVertexAnimation.getFrameCount()) + 
+				" frames written for " + filename);
+		}
+		// (before the depth mesh, which has no lookups)
+		mVertexAnimation.clear();
+		if (mWriteBounds)
+		{
+			writeBounds(base + ".bounds.xml");
+		}
+		if (mWriteBVH)
+		{
+			HoudiniOgre_TraceSpan bvhSpan("buildBVH", filename.c_str());
+			mBVH.build();
+			mBVH.save(base + ".bvh");
+		}
+		mSubMeshBounds.clear();
+		mBoundsPoints.clear();
+		mBVH.clear();
+		if (mWriteDepthMesh)
+		{
+			exportDepthMesh(base + ".depth.mesh", skeletonName, edgeList, bounds, radius);
+		}
+
+		if (!mChunks.empty())
+		{
+			writeChunkIndex(base + ".chunks.xml");
+			if (!mHLODLevels.empty())
+			{
+				exportHLOD(base);
+			}
+			mChunks.clear();
+		}
+
 		mBoneList.clear();
 		mAnimList.clear();
 	}
@@ -1075,201 +1041,1628 @@ void HoudiniOgre_Mesh::bakeProtoSubMeshes()
 	// Take the list of ProtoSubMesh instances and bake a SubMesh per
 	// instance, then clear the list
 
-	for (MaterialProtoSubMeshMap::iterator mi = mMaterialProtoSubmeshMap.begin();
-		mi != mMaterialProtoSubmeshMap.end(); ++mi)
+	// Every vertex gets its own texel when baking vertex animation, so 
+	// leave them all as they are
+	bool vertexAnimation = mVertexAnimation.hasCycles();
+
+	// Clean up first, and see whether they can all share vertex data
+	bool share = mSharedVertices && mChunkSize <= 0 && !mMappedStore && !vertexAnimation;
+	size_t vertexCount = 0;
+	ProtoSubMesh* format = 0;
+	for (MaterialIDMap::iterator mi = mMaterialIDs.begin(); mi != mMaterialIDs.end(); ++mi)
 	{
-		for (ProtoSubMeshList::iterator psi = mi->second->begin();
-			psi != mi->second->end(); ++psi)
+		ProtoSubMeshList* protoList = mMaterialProtoLists[mi->second];
+		for (ProtoSubMeshList::iterator psi = protoList->begin();
+			psi != protoList->end(); ++psi)
 		{
-			// export each one
-			bakeProtoSubMesh(*psi);
+			if (mWeldPosition > 0 && !vertexAnimation)
+			{
+				mWeldedVertexCount += weldProtoSubMesh(**psi);
+			}
+			if (mRemoveDegenerates && !vertexAnimation)
+			{
+				cleanProtoSubMesh(**psi);
+			}
+			if (mGenerateTangents)
+			{
+				mTangentSplitCount += generateTangents(**psi);
+			}
+			if (!(*psi)->indices.empty())
+			{
+				vertexCount += (*psi)->uniqueVertices.size();
+			}
 
-			// free it
-			delete *psi;
+			if (share && !(*psi)->indices.empty())
+			{
+				if (!format)
+					format = *psi;
+				share = isSameVertexFormat(*format, **psi);
+			}
 		}
-		// delete proto list
-		delete mi->second;
 	}
-	mMaterialProtoSubmeshMap.clear();
-
-}
-//-----------------------------------------------------------------------
-void HoudiniOgre_Mesh::bakeProtoSubMesh(ProtoSubMesh* proto)
-{
-	// Skip protos which have ended up empty
-	if (proto->indices.empty())
-		return;
 
-	Ogre::SubMesh* sm = 0;
-	if (proto->name.empty())
+	share = share && format;
+	if (share)
 	{
-		// anonymous submesh
-		sm = mpMesh->createSubMesh();
+		bakeSharedProtoSubMeshes(*format);
 	}
-	else
+	if (vertexAnimation && vertexCount)
 	{
-		// named submesh
-		sm = mpMesh->createSubMesh(proto->name);
+		mVertexAnimation.begin(vertexCount);
 	}
 
-	// Set material
-	sm->setMaterialName(proto->materialName);
-	// never use shared geometry
-	sm->useSharedVertices = false;
-	sm->vertexData = new Ogre::VertexData();
-	// always do triangle list
-	sm->indexData->indexCount = proto->indices.size();
-
-	sm->vertexData->vertexCount = proto->uniqueVertices.size();
-	// Determine index size
-	bool use32BitIndexes = false;
-	if (proto->uniqueVertices.size() > 65536)
+	for (MaterialIDMap::iterator mi = mMaterialIDs.begin(); mi != mMaterialIDs.end(); ++mi)
 	{
-		use32BitIndexes = true;
+		ProtoSubMeshList* protoList = mMaterialProtoLists[mi->second];
+		for (ProtoSubMeshList::iterator psi = protoList->begin();
+			psi != protoList->end(); ++psi)
+		{
+			// export each one, unless they've all been done together
+			if (!share)
+			{
+				if (mChunkSize > 0 && !vertexAnimation)
+				{
+					bakeChunkedProtoSubMesh(*psi);
+				}
+				else
+				{
+					bakeProtoSubMesh(*psi);
+				}
+			}
+
+			// free what it holds outside the arena
+			(*psi)->~ProtoSubMesh();
+			if (mMappedStore)
+				mMappedStore->trim();
+		}
+		protoList->~ProtoSubMeshList();
 	}
+	mMaterialIDs.clear();
+	mMaterialProtoLists.clear();
+	// then the protos and lists themselves, all at once
+	mProtoArena.reset();
 
-	sm->indexData->indexBuffer = 
-		Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
-		use32BitIndexes ? Ogre::HardwareIndexBuffer::IT_32BIT : Ogre::HardwareIndexBuffer::IT_16BIT,
-		sm->indexData->indexCount,
-		Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-	if (use32BitIndexes)
+}
+//-----------------------------------------------------------------------
+bool HoudiniOgre_Mesh::isSameVertexFormat(const ProtoSubMesh& a, const ProtoSubMesh& b) const
+{
+	// poses are per SubMesh, so need their own vertex data
+	return a.poseList.empty() && b.poseList.empty() &&
+		a.hasNormals == b.hasNormals &&
+		a.hasTangents == b.hasTangents &&
+		a.hasVertexColours == b.hasVertexColours &&
+		a.textureCoordDimensions == b.textureCoordDimensions;
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::bakeSharedProtoSubMeshes(const ProtoSubMesh& format)
+{
+	HoudiniOgre_TraceSpan span("bakeSharedProtoSubMeshes", format.materialName.c_str());
+
+	// All the vertices, those which are identical in several protos (as
+	// on the boundaries between materials) only once. Vertices are found
+	// by their exact position in a hash table of chains.
+	UniqueVertexList shared;
+	Ogre::Mesh::VertexBoneAssignmentList sharedAssignments;
+	std::vector<BoneWeightList> sharedWeights;
+	const Ogre::uint32 none = ~Ogre::uint32(0);
+	size_t totalVertices = 0;
+	for (MaterialIDMap::iterator mi = mMaterialIDs.begin(); mi != mMaterialIDs.end(); ++mi)
 	{
-		uint32* pIdx = static_cast<uint32*>(
-			sm->indexData->indexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
-		writeIndexes(pIdx, proto->indices);
-		sm->indexData->indexBuffer->unlock();
+		ProtoSubMeshList* protoList = mMaterialProtoLists[mi->second];
+		for (ProtoSubMeshList::iterator psi = protoList->begin();
+			psi != protoList->end(); ++psi)
+		{
+			totalVertices += (*psi)->uniqueVertices.size();
+		}
 	}
-	else
+	size_t bucketCount = 1;
+	while (bucketCount < totalVertices * 2)
+		bucketCount <<= 1;
+	std::vector<Ogre::uint32> buckets(bucketCount, none);
+	std::vector<Ogre::uint32> chain;
+	shared.reserve(totalVertices);
+	chain.reserve(totalVertices);
+
+	// SubMeshes are created as we go, their indexes once we know how
+	// many vertices there are
+	std::vector<std::pair<Ogre::SubMesh*, ProtoSubMesh*> > subMeshes;
+	for (MaterialIDMap::iterator mi = mMaterialIDs.begin(); mi != mMaterialIDs.end(); ++mi)
 	{
-		uint16* pIdx = static_cast<uint16*>(
-			sm->indexData->indexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
-		writeIndexes(pIdx, proto->indices);
-		sm->indexData->indexBuffer->unlock();
+		ProtoSubMeshList* protoList = mMaterialProtoLists[mi->second];
+		for (ProtoSubMeshList::iterator psi = protoList->begin();
+			psi != protoList->end(); ++psi)
+		{
+			ProtoSubMesh* proto = *psi;
+			if (proto->indices.empty())
+				continue;
+
+			Ogre::SubMesh* sm = proto->name.empty() ? 
+				mpMesh->createSubMesh() : mpMesh->createSubMesh(proto->name);
+			sm->setMaterialName(proto->materialName);
+			sm->useSharedVertices = true;
+			subMeshes.push_back(std::make_pair(sm, proto));
+			if (mCollectSidecars)
+			{
+				collectSidecars(*proto, mpMesh->getNumSubMeshes() - 1);
+			}
+
+			std::vector<BoneWeightList> weights;
+			getBoneWeights(*proto, weights);
+
+			std::vector<Ogre::uint32> remap(proto->uniqueVertices.size());
+			for (size_t v = 0; v < proto->uniqueVertices.size(); ++v)
+			{
+				const UniqueVertex& vertex = proto->uniqueVertices[v];
+				size_t bucket = HoudiniOgre_PositionHash::hash(vertex.position) & (bucketCount - 1);
+				Ogre::uint32 match = none;
+				for (Ogre::uint32 k = buckets[bucket]; k != none; k = chain[k])
+				{
+					if (shared[k] == vertex && sharedWeights[k] == weights[v])
+					{
+						match = k;
+						break;
+					}
+				}
+				if (match == none)
+				{
+					match = static_cast<Ogre::uint32>(shared.size());
+					shared.push_back(vertex);
+					shared.back().nextIndex = 0;
+					sharedWeights.push_back(weights[v]);
+					chain.push_back(buckets[bucket]);
+					buckets[bucket] = match;
+
+					typedef Ogre::Mesh::VertexBoneAssignmentList::iterator VBAIter;
+					std::pair<VBAIter, VBAIter> range = proto->boneAssignments.equal_range(v);
+					for (VBAIter b = range.first; b != range.second; ++b)
+					{
+						Ogre::VertexBoneAssignment vba = b->second;
+						vba.vertexIndex = match;
+						sharedAssignments.insert(
+							Ogre::Mesh::VertexBoneAssignmentList::value_type(match, vba));
+					}
+				}
+				remap[v] = match;
+			}
+			for (IndexList::iterator i = proto->indices.begin(); i != proto->indices.end(); ++i)
+			{
+				*i = remap[*i];
+			}
+		}
 	}
 
+	Ogre::LogManager::getSingleton().logMessage("Shared vertex data: " + 
+		Ogre::StringConverter::toString(shared.size()) + " vertices, " + 
+		Ogre::StringConverter::toString(totalVertices - shared.size()) + 
+		" fewer than separate vertex data");
 
-	// define vertex declaration
-	unsigned buf = 0;
-	size_t offset = 0;
-	// always add position and normal
-	sm->vertexData->vertexDeclaration->addElement(buf, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-	offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-	// Split vertex data after position if poses present
-	if (!proto->poseList.empty())
+	mpMesh->sharedVertexData = new Ogre::VertexData();
+	mpMesh->sharedVertexData->vertexCount = shared.size();
+	defineVertexDeclaration(mpMesh->sharedVertexData->vertexDeclaration, format,
+		mpMesh->hasSkeleton());
+	for (unsigned short b = 0; b <= mpMesh->sharedVertexData->vertexDeclaration->getMaxSource(); ++b)
 	{
-		buf++;
-		offset = 0;
+		createVertexBuffer(mpMesh->sharedVertexData, b, shared, 
+			format.textureCoordDimensions.size());
 	}
-	// Optional normal
-	if(proto->hasNormals)
+
+	for (size_t i = 0; i < subMeshes.size(); ++i)
 	{
-		sm->vertexData->vertexDeclaration->addElement(buf, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-		offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+		createIndexData(subMeshes[i].first->indexData, subMeshes[i].second->indices, 
+			shared.size());
 	}
-	// split vertex data here if animated
-	if (mpMesh->hasSkeleton())
+
+	if (mCollectEdgeList)
 	{
-		buf++;
-		offset = 0;
+		size_t vertexSet = collectEdgeListVertices(mpMesh->sharedVertexData, shared);
+		for (size_t i = 0; i < subMeshes.size(); ++i)
+		{
+			const IndexList& indices = subMeshes[i].second->indices;
+			mEdgeListBuilder.addIndexSet(vertexSet, indices.data(), indices.size());
+		}
 	}
-	// Optional vertex colour
-	if(proto->hasVertexColours)
+
+	if (!sharedAssignments.empty())
 	{
-		sm->vertexData->vertexDeclaration->addElement(buf, offset, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
-		offset += Ogre::VertexElement::getTypeSize(Ogre::VET_COLOUR);
+		mpMesh->_rationaliseBoneAssignments(shared.size(), sharedAssignments);
+		for (Ogre::Mesh::VertexBoneAssignmentList::iterator bi = sharedAssignments.begin();
+			bi != sharedAssignments.end(); ++bi)
+		{
+			mpMesh->addBoneAssignment(bi->second);
+		}
 	}
-	// Define UVs
-	for (unsigned short uvi = 0; uvi < proto->textureCoordDimensions.size(); ++uvi)
+}
+//-----------------------------------------------------------------------
+size_t HoudiniOgre_Mesh::weldProtoSubMesh(ProtoSubMesh& proto)
+{
+	// poses refer to vertices by index, leave them alone
+	size_t vertexCount = proto.uniqueVertices.size();
+	if (vertexCount < 2 || !proto.poseList.empty())
+		return 0;
+
+	HoudiniOgre_TraceSpan span("weldProtoSubMesh", proto.materialName.c_str());
+
+	// Bone assignments of each vertex, to keep skinned vertices apart
+	std::vector<BoneWeightList> weights;
+	if (!proto.boneAssignments.empty())
 	{
-		Ogre::VertexElementType uvType = 
-			Ogre::VertexElement::multiplyTypeCount(
-			Ogre::VET_FLOAT1, proto->textureCoordDimensions[uvi]);
-		sm->vertexData->vertexDeclaration->addElement(
-			buf, offset, uvType, Ogre::VES_TEXTURE_COORDINATES, uvi);
-		offset += Ogre::VertexElement::getTypeSize(uvType);
+		getBoneWeights(proto, weights);
 	}
 
-	// create & fill buffer(s)
-	for (unsigned short b = 0; b <= sm->vertexData->vertexDeclaration->getMaxSource(); ++b)
+	// Hash grid of the vertices kept so far: a chain of them per bucket,
+	// bucket by the cell they're in. Any vertex within the tolerance is
+	// in one of the 27 cells around, and other cells sharing a bucket just
+	// mean a few more comparisons.
+	const Ogre::uint32 none = ~Ogre::uint32(0);
+	size_t bucketCount = 1;
+	while (bucketCount < vertexCount * 2)
+		bucketCount <<= 1;
+	std::vector<Ogre::uint32> buckets(bucketCount, none);
+	std::vector<Ogre::uint32> chain;
+	chain.reserve(vertexCount);
+	Ogre::Real invCellSize = 1.0f / mWeldPosition;
+	Ogre::Real maxDistance2 = mWeldPosition * mWeldPosition;
+
+	UniqueVertexList kept(proto.uniqueVertices.get_allocator());
+	kept.reserve(vertexCount);
+	std::vector<Ogre::uint32> remap(vertexCount);
+	std::vector<Ogre::uint32> keptFrom;
+	for (size_t i = 0; i < vertexCount; ++i)
 	{
-		createVertexBuffer(sm->vertexData, b, proto->uniqueVertices);
+		const UniqueVertex& vertex = proto.uniqueVertices[i];
+		int cx = static_cast<int>(Ogre::Math::Floor(vertex.position.x * invCellSize));
+		int cy = static_cast<int>(Ogre::Math::Floor(vertex.position.y * invCellSize));
+		int cz = static_cast<int>(Ogre::Math::Floor(vertex.position.z * invCellSize));
+
+		Ogre::uint32 match = none;
+		for (int dx = -1; dx <= 1 && match == none; ++dx)
+		{
+			for (int dy = -1; dy <= 1 && match == none; ++dy)
+			{
+				for (int dz = -1; dz <= 1 && match == none; ++dz)
+				{
+					size_t bucket = ((cx + dx) * 73856093u ^ (cy + dy) * 19349663u ^ 
+						(cz + dz) * 83492791u) & (bucketCount - 1);
+					for (Ogre::uint32 k = buckets[bucket]; k != none; k = chain[k])
+					{
+						const UniqueVertex& candidate = kept[k];
+						if ((candidate.position - vertex.position).squaredLength() <= maxDistance2 &&
+							isWeldable(proto, candidate, vertex) &&
+							(weights.empty() || weights[keptFrom[k]] == weights[i]))
+						{
+							match = k;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (match == none)
+		{
+			match = static_cast<Ogre::uint32>(kept.size());
+			kept.push_back(vertex);
+			kept.back().nextIndex = 0;
+			keptFrom.push_back(static_cast<Ogre::uint32>(i));
+			size_t bucket = (cx * 73856093u ^ cy * 19349663u ^ cz * 83492791u) & (bucketCount - 1);
+			chain.push_back(buckets[bucket]);
+			buckets[bucket] = match;
+		}
+		remap[i] = match;
 	}
 
-	// deal with any bone assignments
-	if (!proto->boneAssignments.empty())
-	{
-		// rationalise first (normalises and strips out any excessive bones)
-		sm->parent->_rationaliseBoneAssignments(
-			sm->vertexData->vertexCount, proto->boneAssignments);
+	size_t removed = vertexCount - kept.size();
+	if (!removed)
+		return 0;
 
-		for (Ogre::Mesh::VertexBoneAssignmentList::iterator bi = proto->boneAssignments.begin();
-			bi != proto->boneAssignments.end(); ++bi)
+	proto.uniqueVertices.swap(kept);
+	for (IndexList::iterator idx = proto.indices.begin(); idx != proto.indices.end(); ++idx)
+	{
+		*idx = remap[*idx];
+	}
+	if (!proto.boneAssignments.empty())
+	{
+		// welded vertices had the same weights, keep the survivor's
+		Ogre::Mesh::VertexBoneAssignmentList assignments;
+		for (Ogre::Mesh::VertexBoneAssignmentList::const_iterator b = proto.boneAssignments.begin();
+			b != proto.boneAssignments.end(); ++b)
 		{
-			sm->addBoneAssignment(bi->second);
+			Ogre::uint32 to = remap[b->first];
+			if (keptFrom[to] != b->first)
+				continue;
+			Ogre::VertexBoneAssignment vba = b->second;
+			vba.vertexIndex = to;
+			assignments.insert(Ogre::Mesh::VertexBoneAssignmentList::value_type(to, vba));
 		}
+		proto.boneAssignments.swap(assignments);
 	}
+	return removed;
 }
-//---------------------------------------------------------------------
 //-----------------------------------------------------------------------
-template <typename T> 
-void HoudiniOgre_Mesh::writeIndexes(T* buf, IndexList& indexes)
+bool HoudiniOgre_Mesh::isWeldable(const ProtoSubMesh& proto, const UniqueVertex& a, 
+	const UniqueVertex& b) const
 {
-	IndexList::const_iterator i, iend;
-	iend = indexes.end();
-	for (i = indexes.begin(); i != iend; ++i)
+	if (proto.hasNormals && a.normal != b.normal)
 	{
-		*buf++ = static_cast<T>(*i);
+		Ogre::Real lengths = a.normal.length() * b.normal.length();
+		if (a.normal.dotProduct(b.normal) < mWeldNormalCos * lengths)
+			return false;
+	}
+	for (size_t t = 0; t < proto.textureCoordDimensions.size(); ++t)
+	{
+		for (unsigned short d = 0; d < proto.textureCoordDimensions[t]; ++d)
+		{
+			if (Ogre::Math::Abs(a.uv[t][d] - b.uv[t][d]) > mWeldUV)
+				return false;
+		}
 	}
+	if (proto.hasVertexColours && a.colour != b.colour)
+	{
+		// compare the packed bytes channel by channel, whatever the order
+		int maxDiff = static_cast<int>(mWeldColour * 255.0f + 0.5f);
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			int ca = (a.colour >> shift) & 0xFF;
+			int cb = (b.colour >> shift) & 0xFF;
+			if (std::abs(ca - cb) > maxDiff)
+				return false;
+		}
+	}
+	return true;
 }
 //-----------------------------------------------------------------------
-void HoudiniOgre_Mesh::createVertexBuffer(Ogre::VertexData* vd, 
-	unsigned short bufIdx, UniqueVertexList& uniqueVertexList)
+void HoudiniOgre_Mesh::cleanProtoSubMesh(ProtoSubMesh& proto)
 {
-	Ogre::HardwareVertexBufferSharedPtr vbuf = 
-		Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-		vd->vertexDeclaration->getVertexSize(bufIdx),
-		vd->vertexCount, 
-		Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-	vd->vertexBufferBinding->setBinding(bufIdx, vbuf);
-	size_t vertexSize = vd->vertexDeclaration->getVertexSize(bufIdx);
+	HoudiniOgre_TraceSpan span("cleanProtoSubMesh", proto.materialName.c_str());
 
-	char* pBase = static_cast<char*>(
-		vbuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+	// A triangle with the same vertices as an earlier one in the same
+	// winding, rotated to start with its lowest index so they compare equal
+	struct TriangleKey
+	{
+		Ogre::uint32 v[3];
+		size_t triangle;
+		bool operator<(const TriangleKey& rhs) const
+		{
+			if (v[0] != rhs.v[0]) return v[0] < rhs.v[0];
+			if (v[1] != rhs.v[1]) return v[1] < rhs.v[1];
+			if (v[2] != rhs.v[2]) return v[2] < rhs.v[2];
+			return triangle < rhs.triangle;
+		}
+		bool sameVertices(const TriangleKey& rhs) const
+		{
+			return v[0] == rhs.v[0] && v[1] == rhs.v[1] && v[2] == rhs.v[2];
+		}
+	};
 
-	Ogre::VertexDeclaration::VertexElementList elems = 
-		vd->vertexDeclaration->findElementsBySource(bufIdx);
-	Ogre::VertexDeclaration::VertexElementList::iterator ei, eiend;
-	eiend = elems.end();
-	float* pFloat;
-	Ogre::RGBA* pRGBA;
+	size_t triangleCount = proto.indices.size() / 3;
+	std::vector<bool> keep(triangleCount, true);
+	std::vector<TriangleKey> keys;
+	keys.reserve(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const Ogre::uint32* idx = &proto.indices[t * 3];
+		if (idx[0] == idx[1] || idx[1] == idx[2] || idx[2] == idx[0])
+		{
+			keep[t] = false;
+			++mDegenerateTriangleCount;
+			continue;
+		}
+		// zero area: the edges are parallel, to within rounding relative
+		// to the triangle's size
+		const Ogre::Vector3& p0 = proto.uniqueVertices[idx[0]].position;
+		Ogre::Vector3 e1 = proto.uniqueVertices[idx[1]].position - p0;
+		Ogre::Vector3 e2 = proto.uniqueVertices[idx[2]].position - p0;
+		Ogre::Real scale = std::max(e1.squaredLength(), e2.squaredLength());
+		if (e1.crossProduct(e2).squaredLength() <= scale * scale * 1e-12f)
+		{
+			keep[t] = false;
+			++mDegenerateTriangleCount;
+			continue;
+		}
 
-	UniqueVertexList::iterator srci = uniqueVertexList.begin();
+		TriangleKey key;
+		int first = idx[0] < idx[1] ? (idx[0] < idx[2] ? 0 : 2) : (idx[1] < idx[2] ? 1 : 2);
+		for (int v = 0; v < 3; ++v)
+			key.v[v] = idx[(first + v) % 3];
+		key.triangle = t;
+		keys.push_back(key);
+	}
 
-	for (size_t v = 0; v < vd->vertexCount; ++v, ++srci)
+	// sorted, repeats are next to each other with the first one leading
+	std::sort(keys.begin(), keys.end());
+	for (size_t k = 1; k < keys.size(); ++k)
 	{
-		for (ei = elems.begin(); ei != eiend; ++ei)
+		if (keys[k].sameVertices(keys[k - 1]))
 		{
-			Ogre::VertexElement& elem = *ei;
-			switch(elem.getSemantic())
+			keep[keys[k].triangle] = false;
+			++mDuplicateTriangleCount;
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		if (keep[t])
+		{
+			if (kept != t)
 			{
-			case Ogre::VES_POSITION:
-				elem.baseVertexPointerToElement(pBase, &pFloat);
-				*pFloat++ = srci->position.x;
-				*pFloat++ = srci->position.y;
-				*pFloat++ = srci->position.z;
-				break;
-			case Ogre::VES_NORMAL:
-				elem.baseVertexPointerToElement(pBase, &pFloat);
-				*pFloat++ = srci->normal.x;
-				*pFloat++ = srci->normal.y;
-				*pFloat++ = srci->normal.z;
-				break;
-			case Ogre::VES_DIFFUSE:
-				elem.baseVertexPointerToElement(pBase, &pRGBA);
+				std::copy(proto.indices.begin() + t * 3, proto.indices.begin() + t * 3 + 3,
+					proto.indices.begin() + kept * 3);
+			}
+			++kept;
+		}
+	}
+	if (kept == triangleCount)
+		return;
+	proto.indices.resize(kept * 3);
+
+	// Drop the vertices only removed triangles used; poses refer to
+	// vertices by index, so leave those alone
+	if (!proto.poseList.empty())
+		return;
+	const Ogre::uint32 unused = ~Ogre::uint32(0);
+	std::vector<Ogre::uint32> remap(proto.uniqueVertices.size(), unused);
+	UniqueVertexList vertices(proto.uniqueVertices.get_allocator());
+	vertices.reserve(proto.uniqueVertices.size());
+	for (IndexList::iterator i = proto.indices.begin(); i != proto.indices.end(); ++i)
+	{
+		if (remap[*i] == unused)
+		{
+			remap[*i] = static_cast<Ogre::uint32>(vertices.size());
+			vertices.push_back(proto.uniqueVertices[*i]);
+			vertices.back().nextIndex = 0;
+		}
+		*i = remap[*i];
+	}
+	proto.uniqueVertices.swap(vertices);
+	if (!proto.boneAssignments.empty())
+	{
+		Ogre::Mesh::VertexBoneAssignmentList assignments;
+		for (Ogre::Mesh::VertexBoneAssignmentList::const_iterator b = proto.boneAssignments.begin();
+			b != proto.boneAssignments.end(); ++b)
+		{
+			Ogre::uint32 to = remap[b->first];
+			if (to == unused)
+				continue;
+			Ogre::VertexBoneAssignment vba = b->second;
+			vba.vertexIndex = to;
+			assignments.insert(Ogre::Mesh::VertexBoneAssignmentList::value_type(to, vba));
+		}
+		proto.boneAssignments.swap(assignments);
+	}
+}
+//-----------------------------------------------------------------------
+size_t HoudiniOgre_Mesh::generateTangents(ProtoSubMesh& proto)
+{
+	size_t uvSet = 0;
+	while (uvSet < proto.textureCoordDimensions.size() && proto.textureCoordDimensions[uvSet] < 2)
+		++uvSet;
+	if (!proto.hasNormals || uvSet == proto.textureCoordDimensions.size())
+	{
+		Ogre::LogManager::getSingleton().logMessage("Warning: no tangents for material " + 
+			proto.materialName + ", they need normals and 2D texture coordinates");
+		return 0;
+	}
+	if (mTangentsSemantic == Ogre::VES_TEXTURE_COORDINATES && 
+		proto.textureCoordDimensions.size() >= OGRE_MAX_TEXTURE_COORD_SETS)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS,
+			"No texture coordinate set left for the tangents in " + 
+			proto.materialName, "HoudiniOgre_Mesh::generateTangents");
+	}
+	proto.hasTangents = true;
+	if (proto.indices.empty())
+		return 0;
+
+	HoudiniOgre_TraceSpan span("generateTangents", proto.materialName.c_str(), 
+		"triangles", static_cast<long>(proto.indices.size() / 3));
+
+	const size_t vertexCount = proto.uniqueVertices.size();
+	const size_t triangleCount = proto.indices.size() / 3;
+
+	// Columns of just what the triangle pass reads
+	std::vector<float> px(vertexCount), py(vertexCount), pz(vertexCount);
+	std::vector<float> tu(vertexCount), tv(vertexCount);
+	HoudiniOgre_Parallel::forRange(vertexCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v)
+		{
+			const UniqueVertex& vertex = proto.uniqueVertices[v];
+			px[v] = vertex.position.x;
+			py[v] = vertex.position.y;
+			pz[v] = vertex.position.z;
+			tu[v] = vertex.uv[uvSet].x;
+			tv[v] = vertex.uv[uvSet].y;
+		}
+	});
+
+	// Each triangle's tangent, scaled by its area, and whether its texture
+	// is mirrored
+	std::vector<float> tx(triangleCount), ty(triangleCount), tz(triangleCount);
+	std::vector<unsigned char> mirrored(triangleCount);
+	HoudiniOgre_Parallel::forRange(triangleCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+		HoudiniOgre_Simd::triangleTangents(&px[0], &py[0], &pz[0], &tu[0], &tv[0],
+			&proto.indices[begin * 3], end - begin,
+			&tx[begin], &ty[begin], &tz[begin], &mirrored[begin]);
+	});
+
+	// The triangles using each vertex
+	std::vector<Ogre::uint32> firstTriangle(vertexCount + 1, 0);
+	for (IndexList::const_iterator i = proto.indices.begin(); i != proto.indices.end(); ++i)
+	{
+		++firstTriangle[*i + 1];
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		firstTriangle[v + 1] += firstTriangle[v];
+	}
+	std::vector<Ogre::uint32> vertexTriangles(proto.indices.size());
+	{
+		std::vector<Ogre::uint32> next(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < proto.indices.size(); ++i)
+		{
+			vertexTriangles[next[proto.indices[i]]++] = static_cast<Ogre::uint32>(i / 3);
+		}
+	}
+
+	// Split vertices used both by mirrored triangles and ones which aren't
+	// (not if there are poses, which are by vertex; they get the average)
+	const Ogre::uint32 none = ~Ogre::uint32(0);
+	std::vector<Ogre::uint32> split(vertexCount, none);
+	if (proto.poseList.empty())
+	{
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			bool seen[2] = { false, false };
+			for (Ogre::uint32 k = firstTriangle[v]; k < firstTriangle[v + 1]; ++k)
+			{
+				seen[mirrored[vertexTriangles[k]]] = true;
+			}
+			if (seen[0] && seen[1])
+			{
+				split[v] = static_cast<Ogre::uint32>(proto.uniqueVertices.size());
+				proto.uniqueVertices.push_back(proto.uniqueVertices[v]);
+
+				typedef Ogre::Mesh::VertexBoneAssignmentList::iterator VBAIter;
+				std::pair<VBAIter, VBAIter> range = proto.boneAssignments.equal_range(v);
+				Ogre::Mesh::VertexBoneAssignmentList added;
+				for (VBAIter b = range.first; b != range.second; ++b)
+				{
+					Ogre::VertexBoneAssignment vba = b->second;
+					vba.vertexIndex = split[v];
+					added.insert(Ogre::Mesh::VertexBoneAssignmentList::value_type(split[v], vba));
+				}
+				proto.boneAssignments.insert(added.begin(), added.end());
+			}
+		}
+	}
+	size_t splitCount = proto.uniqueVertices.size() - vertexCount;
+
+	// Sum into each vertex (or its split) and make it perpendicular to the normal
+	HoudiniOgre_Parallel::forRange(vertexCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v)
+		{
+			Ogre::Vector3 sum[2] = { Ogre::Vector3::ZERO, Ogre::Vector3::ZERO };
+			size_t count[2] = { 0, 0 };
+			for (Ogre::uint32 k = firstTriangle[v]; k < firstTriangle[v + 1]; ++k)
+			{
+				Ogre::uint32 t = vertexTriangles[k];
+				sum[mirrored[t]] += Ogre::Vector3(tx[t], ty[t], tz[t]);
+				++count[mirrored[t]];
+			}
+			if (split[v] == none)
+			{
+				// one side only, or poses; the majority decides
+				count[count[1] > count[0] ? 0 : 1] = 0;
+			}
+			for (int side = 0; side < 2; ++side)
+			{
+				if (!count[side])
+					continue;
+				UniqueVertex& vertex = proto.uniqueVertices[side && split[v] != none ? split[v] : v];
+				Ogre::Vector3 tangent = sum[side] - vertex.normal * vertex.normal.dotProduct(sum[side]);
+				if (tangent.squaredLength() < 1e-20f)
+					tangent = vertex.normal.perpendicular();
+				tangent.normalise();
+				vertex.tangent = tangent;
+				vertex.handedness = side ? -1.0f : 1.0f;
+			}
+		}
+	});
+
+	// Point mirrored triangles at the split vertices
+	if (splitCount)
+	{
+		HoudiniOgre_Parallel::forRange(triangleCount, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t)
+			{
+				if (!mirrored[t])
+					continue;
+				for (size_t c = t * 3; c < t * 3 + 3; ++c)
+				{
+					if (split[proto.indices[c]] != none)
+						proto.indices[c] = split[proto.indices[c]];
+				}
+			}
+		});
+	}
+
+	return splitCount;
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::bakeProtoSubMesh(ProtoSubMesh* proto)
+{
+	// Skip protos which have ended up empty
+	if (proto->indices.empty())
+		return;
+
+	Ogre::SubMesh* sm = 0;
+	if (proto->name.empty())
+	{
+		// anonymous submesh
+		sm = mpMesh->createSubMesh();
+	}
+	else
+	{
+		// named submesh
+		sm = mpMesh->createSubMesh(proto->name);
+	}
+
+	// Set material
+	sm->setMaterialName(proto->materialName);
+
+	// Each vertex looks up its own texel of the vertex animation textures
+	if (mVertexAnimation.isStarted())
+	{
+		unsigned short lookupSet = static_cast<unsigned short>(proto->textureCoordDimensions.size());
+		// a tangent bound as a texture coordinate goes in the set after it
+		bool tangentSet = proto->hasTangents && mTangentsSemantic == Ogre::VES_TEXTURE_COORDINATES;
+		if (lookupSet + (tangentSet ? 1 : 0) >= OGRE_MAX_TEXTURE_COORD_SETS)
+		{
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS,
+				"No texture coordinate set left for the vertex animation lookup in " + 
+				proto->materialName, "HoudiniOgre_Mesh::bakeProtoSubMesh");
+		}
+		proto->textureCoordDimensions.push_back(2);
+		for (UniqueVertexList::iterator v = proto->uniqueVertices.begin(); 
+			v != proto->uniqueVertices.end(); ++v)
+		{
+			v->uv[lookupSet] = mVertexAnimation.addVertex(v->sourceGeometry, 
+				v->sourceVertex, v->position, v->normal);
+		}
+		mVertexAnimation.addSubMesh(mpMesh->getNumSubMeshes() - 1, lookupSet, 
+			proto->hasNormals);
+	}
+
+	// never use shared geometry
+	sm->useSharedVertices = false;
+	sm->vertexData = new Ogre::VertexData();
+	sm->vertexData->vertexCount = proto->uniqueVertices.size();
+	createIndexData(sm->indexData, proto->indices, proto->uniqueVertices.size());
+
+
+	// define vertex declaration
+	defineVertexDeclaration(sm->vertexData->vertexDeclaration, *proto,
+		mpMesh->hasSkeleton());
+
+	// create & fill buffer(s)
+	for (unsigned short b = 0; b <= sm->vertexData->vertexDeclaration->getMaxSource(); ++b)
+	{
+		createVertexBuffer(sm->vertexData, b, proto->uniqueVertices, 
+			proto->textureCoordDimensions.size());
+	}
+
+	// deal with any bone assignments
+	if (!proto->boneAssignments.empty())
+	{
+		// rationalise first (normalises and strips out any excessive bones)
+		sm->parent->_rationaliseBoneAssignments(
+			sm->vertexData->vertexCount, proto->boneAssignments);
+
+		for (Ogre::Mesh::VertexBoneAssignmentList::iterator bi = proto->boneAssignments.begin();
+			bi != proto->boneAssignments.end(); ++bi)
+		{
+			sm->addBoneAssignment(bi->second);
+		}
+	}
+
+	if (mCollectSidecars)
+	{
+		collectSidecars(*proto, mpMesh->getNumSubMeshes() - 1);
+	}
+	if (mCollectEdgeList)
+	{
+		mEdgeListBuilder.addIndexSet(
+			collectEdgeListVertices(sm->vertexData, proto->uniqueVertices), 
+			proto->indices.data(), proto->indices.size());
+	}
+}
+//-----------------------------------------------------------------------
+size_t HoudiniOgre_Mesh::collectEdgeListVertices(const Ogre::VertexData* vertexData,
+	const UniqueVertexList& vertices)
+{
+	std::vector<Ogre::Vector3> positions;
+	positions.reserve(vertices.size());
+	for (UniqueVertexList::const_iterator v = vertices.begin(); v != vertices.end(); ++v)
+	{
+		positions.push_back(v->position);
+	}
+	return mEdgeListBuilder.addVertexSet(vertexData, positions);
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::serializeMesh(const Ogre::String& filename)
+{
+	// The edge list is attached just while the mesh is written; the mesh
+	// doesn't know it has it, so wouldn't free it
+	Ogre::EdgeData* edgeData = 0;
+	if (mCollectEdgeList)
+	{
+		edgeData = mEdgeListBuilder.build();
+		mEdgeListBuilder.clear();
+		mpMesh->setAutoBuildEdgeLists(false);
+		const_cast<Ogre::MeshLodUsage&>(mpMesh->getLodLevel(0)).edgeData = edgeData;
+	}
+
+	HoudiniOgre_MeshSerializer serializer;
+	serializer.exportMesh(mpMesh.getPointer(), filename);
+
+	if (edgeData)
+	{
+		const_cast<Ogre::MeshLodUsage&>(mpMesh->getLodLevel(0)).edgeData = 0;
+		delete edgeData;
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::getBoneWeights(const ProtoSubMesh& proto, 
+	std::vector<BoneWeightList>& weights)
+{
+	weights.assign(proto.uniqueVertices.size(), BoneWeightList());
+	for (Ogre::Mesh::VertexBoneAssignmentList::const_iterator b = proto.boneAssignments.begin();
+		b != proto.boneAssignments.end(); ++b)
+	{
+		weights[b->first].push_back(std::make_pair(b->second.boneIndex, b->second.weight));
+	}
+	for (std::vector<BoneWeightList>::iterator w = weights.begin(); w != weights.end(); ++w)
+	{
+		std::sort(w->begin(), w->end());
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::collectSidecars(const ProtoSubMesh& proto, unsigned short subMeshIndex)
+{
+	if (mWriteBounds || mWriteBVH)
+	{
+		collectBounds(proto, subMeshIndex);
+	}
+	if (mWriteDepthMesh)
+	{
+		mDepthProtos.push_back(ProtoSubMesh());
+		buildDepthProtoSubMesh(proto, mDepthProtos.back());
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::buildDepthProtoSubMesh(const ProtoSubMesh& proto, ProtoSubMesh& depth)
+{
+	depth.name = proto.name;
+	depth.materialName = proto.materialName;
+	depth.hasNormals = false;
+	depth.hasVertexColours = false;
+
+	// Weld by position alone (and skinning), first come first kept
+	std::vector<BoneWeightList> weights;
+	getBoneWeights(proto, weights);
+	std::vector<BoneWeightList> depthWeights;
+	const Ogre::uint32 none = ~Ogre::uint32(0);
+	size_t bucketCount = 1;
+	while (bucketCount < proto.uniqueVertices.size() * 2)
+		bucketCount <<= 1;
+	std::vector<Ogre::uint32> buckets(bucketCount, none);
+	std::vector<Ogre::uint32> chain;
+	std::vector<Ogre::uint32> remap(proto.uniqueVertices.size());
+	for (size_t v = 0; v < proto.uniqueVertices.size(); ++v)
+	{
+		const Ogre::Vector3& position = proto.uniqueVertices[v].position;
+		size_t bucket = HoudiniOgre_PositionHash::hash(position) & (bucketCount - 1);
+		Ogre::uint32 match = none;
+		for (Ogre::uint32 k = buckets[bucket]; k != none; k = chain[k])
+		{
+			if (depth.uniqueVertices[k].position == position && depthWeights[k] == weights[v])
+			{
+				match = k;
+				break;
+			}
+		}
+		if (match == none)
+		{
+			match = static_cast<Ogre::uint32>(depth.uniqueVertices.size());
+			depth.uniqueVertices.push_back(UniqueVertex());
+			depth.uniqueVertices.back().position = position;
+			depthWeights.push_back(weights[v]);
+			chain.push_back(buckets[bucket]);
+			buckets[bucket] = match;
+
+			typedef Ogre::Mesh::VertexBoneAssignmentList::const_iterator VBAIter;
+			std::pair<VBAIter, VBAIter> range = proto.boneAssignments.equal_range(v);
+			for (VBAIter b = range.first; b != range.second; ++b)
+			{
+				Ogre::VertexBoneAssignment vba = b->second;
+				vba.vertexIndex = match;
+				depth.boneAssignments.insert(
+					Ogre::Mesh::VertexBoneAssignmentList::value_type(match, vba));
+			}
+		}
+		remap[v] = match;
+	}
+
+	depth.indices.reserve(proto.indices.size());
+	for (IndexList::const_iterator i = proto.indices.begin(); i != proto.indices.end(); ++i)
+	{
+		depth.indices.push_back(remap[*i]);
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::exportDepthMesh(const Ogre::String& filename, 
+	const Ogre::String& skeletonName, bool edgeList, 
+	const Ogre::AxisAlignedBox& bounds, Ogre::Real radius)
+{
+	HoudiniOgre_TraceSpan span("exportDepthMesh", filename.c_str());
+
+	mpMesh = Ogre::MeshManager::getSingleton().createManual("HoudiniExportDepth", 
+		Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	if (!skeletonName.empty())
+	{
+		mpMesh->setSkeletonName(skeletonName);
+	}
+
+	size_t depthVertices = 0;
+	mCollectEdgeList = edgeList;
+	for (std::vector<ProtoSubMesh>::iterator p = mDepthProtos.begin(); 
+		p != mDepthProtos.end(); ++p)
+	{
+		depthVertices += p->uniqueVertices.size();
+		bakeProtoSubMesh(&*p);
+	}
+	mpMesh->_setBounds(bounds);
+	mpMesh->_setBoundingSphereRadius(radius);
+
+	serializeMesh(filename);
+	mCollectEdgeList = false;
+	Ogre::MeshManager::getSingleton().remove(mpMesh->getHandle());
+	mpMesh.setNull();
+
+	Ogre::LogManager::getSingleton().logMessage("Depth mesh " + filename + " has " + 
+		Ogre::StringConverter::toString(depthVertices) + " vertices");
+	mDepthProtos.clear();
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::collectBounds(const ProtoSubMesh& proto, unsigned short subMeshIndex)
+{
+	if (mSubMeshBounds.size() <= subMeshIndex)
+		mSubMeshBounds.resize(subMeshIndex + 1);
+	Ogre::AxisAlignedBox& box = mSubMeshBounds[subMeshIndex];
+	for (UniqueVertexList::const_iterator v = proto.uniqueVertices.begin();
+		v != proto.uniqueVertices.end(); ++v)
+	{
+		box.merge(v->position);
+	}
+	if (mWriteBounds)
+	{
+		mBoundsPoints.reserve(mBoundsPoints.size() + proto.uniqueVertices.size());
+		for (UniqueVertexList::const_iterator v = proto.uniqueVertices.begin();
+			v != proto.uniqueVertices.end(); ++v)
+		{
+			mBoundsPoints.push_back(v->position);
+		}
+	}
+	if (mWriteBVH)
+	{
+		for (size_t t = 0; t + 2 < proto.indices.size(); t += 3)
+		{
+			mBVH.addTriangle(proto.uniqueVertices[proto.indices[t]].position,
+				proto.uniqueVertices[proto.indices[t+1]].position,
+				proto.uniqueVertices[proto.indices[t+2]].position,
+				subMeshIndex, static_cast<Ogre::uint32>(t / 3));
+		}
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::writeBounds(const Ogre::String& filename) const
+{
+	std::ofstream ofs(filename.c_str());
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write bounds " + filename,
+			"HoudiniOgre_Mesh::writeBounds");
+	}
+
+	HoudiniOgre_Sphere sphere = HoudiniOgre_Sphere::enclose(mBoundsPoints);
+	Ogre::AxisAlignedBox total;
+	for (std::vector<Ogre::AxisAlignedBox>::const_iterator b = mSubMeshBounds.begin();
+		b != mSubMeshBounds.end(); ++b)
+	{
+		total.merge(*b);
+	}
+
+	ofs << "<bounds>\n";
+	ofs << "\t<sphere centre=\"" << sphere.centre.x << " " << sphere.centre.y << " "
+		<< sphere.centre.z << "\" radius=\"" << sphere.radius << "\"/>\n";
+	if (!total.isNull())
+	{
+		const Ogre::Vector3& min = total.getMinimum();
+		const Ogre::Vector3& max = total.getMaximum();
+		ofs << "\t<aabb min=\"" << min.x << " " << min.y << " " << min.z
+			<< "\" max=\"" << max.x << " " << max.y << " " << max.z << "\"/>\n";
+	}
+	for (size_t i = 0; i < mSubMeshBounds.size(); ++i)
+	{
+		const Ogre::AxisAlignedBox& box = mSubMeshBounds[i];
+		if (box.isNull())
+			continue;
+		const Ogre::Vector3& min = box.getMinimum();
+		const Ogre::Vector3& max = box.getMaximum();
+		ofs << "\t<submesh index=\"" << i
+			<< "\" min=\"" << min.x << " " << min.y << " " << min.z
+			<< "\" max=\"" << max.x << " " << max.y << " " << max.z << "\"/>\n";
+	}
+	ofs << "</bounds>\n";
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::bakeChunkedProtoSubMesh(ProtoSubMesh* proto)
+{
+	HoudiniOgre_TraceSpan span("bakeChunkedProtoSubMesh", proto->materialName.c_str());
+
+	// Bucket the triangles by the cell their centre is in
+	typedef std::map<ChunkCell, std::vector<size_t> > CellTriangleMap;
+	CellTriangleMap cells;
+	Ogre::Real invSize = 1.0f / mChunkSize;
+	for (size_t t = 0; t + 2 < proto->indices.size(); t += 3)
+	{
+		Ogre::Vector3 centre = (proto->uniqueVertices[proto->indices[t]].position + 
+			proto->uniqueVertices[proto->indices[t+1]].position + 
+			proto->uniqueVertices[proto->indices[t+2]].position) / 3.0f;
+		ChunkCell cell;
+		cell.x = static_cast<int>(Ogre::Math::Floor(centre.x * invSize));
+		cell.y = static_cast<int>(Ogre::Math::Floor(centre.y * invSize));
+		cell.z = static_cast<int>(Ogre::Math::Floor(centre.z * invSize));
+		cells[cell].push_back(t);
+	}
+
+	// Old vertex index -> index in the current chunk, reset after each chunk
+	const Ogre::uint32 unused = ~Ogre::uint32(0);
+	std::vector<Ogre::uint32> remap(proto->uniqueVertices.size(), unused);
+	std::vector<Ogre::uint32> used;
+
+	for (CellTriangleMap::iterator ci = cells.begin(); ci != cells.end(); ++ci)
+	{
+		const ChunkCell& cell = ci->first;
+		ProtoSubMesh chunk;
+		chunk.materialName = proto->materialName;
+		if (!proto->name.empty())
+		{
+			Ogre::StringUtil::StrStreamType name;
+			name << proto->name << "_" << cell.x << "_" << cell.y << "_" << cell.z;
+			chunk.name = name.str();
+		}
+		chunk.textureCoordDimensions = proto->textureCoordDimensions;
+		chunk.hasVertexColours = proto->hasVertexColours;
+		chunk.hasNormals = proto->hasNormals;
+		chunk.hasTangents = proto->hasTangents;
+
+		ChunkEntry entry;
+		entry.materialName = proto->materialName;
+		entry.cell = cell;
+		entry.triangleCount = ci->second.size();
+
+		chunk.indices.reserve(ci->second.size() * 3);
+		for (std::vector<size_t>::iterator t = ci->second.begin(); t != ci->second.end(); ++t)
+		{
+			for (size_t v = 0; v < 3; ++v)
+			{
+				Ogre::uint32 old = proto->indices[*t + v];
+				if (remap[old] == unused)
+				{
+					remap[old] = static_cast<Ogre::uint32>(chunk.uniqueVertices.size());
+					used.push_back(old);
+					chunk.uniqueVertices.push_back(proto->uniqueVertices[old]);
+					chunk.uniqueVertices.back().nextIndex = 0;
+					entry.bounds.merge(proto->uniqueVertices[old].position);
+
+					// carry the vertex's bone assignments across
+					typedef Ogre::Mesh::VertexBoneAssignmentList::iterator VBAIter;
+					std::pair<VBAIter, VBAIter> range = proto->boneAssignments.equal_range(old);
+					for (VBAIter b = range.first; b != range.second; ++b)
+					{
+						Ogre::VertexBoneAssignment vba = b->second;
+						vba.vertexIndex = remap[old];
+						chunk.boneAssignments.insert(
+							Ogre::Mesh::VertexBoneAssignmentList::value_type(vba.vertexIndex, vba));
+					}
+				}
+				chunk.indices.push_back(remap[old]);
+			}
+		}
+		// reset just the entries this chunk used
+		for (std::vector<Ogre::uint32>::iterator u = used.begin(); u != used.end(); ++u)
+		{
+			remap[*u] = unused;
+		}
+		used.clear();
+
+		bakeProtoSubMesh(&chunk);
+		entry.subMeshIndex = mpMesh->getNumSubMeshes() - 1;
+		mChunks.push_back(entry);
+
+		if (mHLODLevelCount && chunk.boneAssignments.empty())
+		{
+			addToHLOD(chunk, entry);
+		}
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::writeChunkIndex(const Ogre::String& filename) const
+{
+	std::ofstream ofs(filename.c_str());
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write chunk index " + filename,
+			"HoudiniOgre_Mesh::writeChunkIndex");
+	}
+
+	ofs << "<chunks cellSize=\"" << mChunkSize << "\">\n";
+	for (ChunkList::const_iterator c = mChunks.begin(); c != mChunks.end(); ++c)
+	{
+		const Ogre::Vector3& min = c->bounds.getMinimum();
+		const Ogre::Vector3& max = c->bounds.getMaximum();
+		ofs << "\t<chunk submesh=\"" << c->subMeshIndex
+			<< "\" material=\"" << HoudiniOgre_Escape::xml(c->materialName)
+			<< "\" cell=\"" << c->cell.x << " " << c->cell.y << " " << c->cell.z
+			<< "\" triangles=\"" << c->triangleCount
+			<< "\" min=\"" << min.x << " " << min.y << " " << min.z
+			<< "\" max=\"" << max.x << " " << max.y << " " << max.z << "\"/>\n";
+	}
+	ofs << "</chunks>\n";
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::addToHLOD(const ProtoSubMesh& chunk, const ChunkEntry& entry)
+{
+	if (mHLODLevels.empty())
+	{
+		mHLODLevels.resize(mHLODLevelCount);
+	}
+
+	HLODCluster& cluster = mHLODLevels[0][entry.cell.getParent()];
+	cluster.chunks.push_back(entry.subMeshIndex);
+	const Ogre::String& material = 
+		mHLODMaterial.empty() ? chunk.materialName : mHLODMaterial;
+	ProtoSubMesh& proto = cluster.protos[material];
+	proto.materialName = material;
+	appendProtoSubMesh(proto, chunk);
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::appendProtoSubMesh(ProtoSubMesh& dest, const ProtoSubMesh& src)
+{
+	if (dest.uniqueVertices.empty())
+	{
+		dest.textureCoordDimensions = src.textureCoordDimensions;
+		dest.hasVertexColours = src.hasVertexColours;
+		dest.hasNormals = src.hasNormals;
+		dest.hasTangents = src.hasTangents;
+	}
+	else
+	{
+		// only keep what both have
+		if (src.textureCoordDimensions.size() < dest.textureCoordDimensions.size())
+			dest.textureCoordDimensions.resize(src.textureCoordDimensions.size());
+		dest.hasVertexColours = dest.hasVertexColours && src.hasVertexColours;
+		dest.hasNormals = dest.hasNormals && src.hasNormals;
+		dest.hasTangents = dest.hasTangents && src.hasTangents;
+	}
+
+	Ogre::uint32 offset = static_cast<Ogre::uint32>(dest.uniqueVertices.size());
+	dest.uniqueVertices.insert(dest.uniqueVertices.end(), 
+		src.uniqueVertices.begin(), src.uniqueVertices.end());
+	for (UniqueVertexList::iterator v = dest.uniqueVertices.begin() + offset; 
+		v != dest.uniqueVertices.end(); ++v)
+	{
+		v->nextIndex = 0;
+	}
+	dest.indices.reserve(dest.indices.size() + src.indices.size());
+	for (IndexList::const_iterator i = src.indices.begin(); i != src.indices.end(); ++i)
+	{
+		dest.indices.push_back(*i + offset);
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::simplifyProtoSubMesh(ProtoSubMesh& proto, size_t targetTriangles)
+{
+	if (proto.indices.size() / 3 <= targetTriangles || proto.uniqueVertices.empty())
+		return;
+
+	Ogre::AxisAlignedBox box;
+	for (UniqueVertexList::iterator v = proto.uniqueVertices.begin(); 
+		v != proto.uniqueVertices.end(); ++v)
+	{
+		box.merge(v->position);
+	}
+	Ogre::Vector3 size = box.getMaximum() - box.getMinimum();
+	Ogre::Real extent = std::max(size.x, std::max(size.y, size.z));
+	if (extent <= 0)
+		extent = 1;
+
+	// Vertices on either side of a texture seam or hard edge were never
+	// welded, so the triangles fall into charts which share no vertices.
+	// Charts are clustered separately so their texture coordinates and 
+	// normals aren't averaged together.
+	const size_t sourceCount = proto.uniqueVertices.size();
+	std::vector<Ogre::uint32> chart(sourceCount);
+	for (size_t i = 0; i < sourceCount; ++i)
+		chart[i] = static_cast<Ogre::uint32>(i);
+	auto root = [&chart](Ogre::uint32 i) {
+		while (chart[i] != i)
+		{
+			chart[i] = chart[chart[i]];
+			i = chart[i];
+		}
+		return i;
+	};
+	for (size_t t = 0; t + 2 < proto.indices.size(); t += 3)
+	{
+		Ogre::uint32 a = root(proto.indices[t]);
+		for (size_t k = 1; k < 3; ++k)
+		{
+			Ogre::uint32 b = root(proto.indices[t+k]);
+			chart[b] = a;
+		}
+	}
+	for (size_t i = 0; i < sourceCount; ++i)
+		chart[i] = root(static_cast<Ogre::uint32>(i));
+
+	// Vertex clustering: weld everything of a chart in each cell of a grid
+	// into one vertex and drop the triangles which collapse. Positions are
+	// averaged over the whole cell, so charts still meet along the seam.
+	// A surface spanning n cells a side ends up with roughly 2n^2 
+	// triangles, so start there and coarsen until we're under budget.
+	int resolution = std::max(1, 
+		static_cast<int>(Ogre::Math::Sqrt(static_cast<Ogre::Real>(targetTriangles) * 0.5f)));
+	UniqueVertexList vertices;
+	IndexList indices;
+	while (true)
+	{
+		Ogre::Real invCellSize = resolution / extent;
+		std::map<ChunkCell, Ogre::uint32> cells;
+		std::map<std::pair<Ogre::uint32, Ogre::uint32>, Ogre::uint32> clusters;
+		std::vector<Ogre::uint32> vertexCells(sourceCount), vertexClusters(sourceCount);
+		std::vector<Ogre::Vector3> cellPositions;
+		std::vector<size_t> cellCounts, counts;
+		std::vector<Ogre::uint32> clusterCells;
+		vertices.clear();
+		indices.clear();
+
+		for (size_t i = 0; i < sourceCount; ++i)
+		{
+			const UniqueVertex& src = proto.uniqueVertices[i];
+			Ogre::Vector3 rel = (src.position - box.getMinimum()) * invCellSize;
+			ChunkCell cell;
+			cell.x = static_cast<int>(rel.x);
+			cell.y = static_cast<int>(rel.y);
+			cell.z = static_cast<int>(rel.z);
+			std::pair<std::map<ChunkCell, Ogre::uint32>::iterator, bool> cellIns = cells.insert(
+				std::make_pair(cell, static_cast<Ogre::uint32>(cellPositions.size())));
+			if (cellIns.second)
+			{
+				cellPositions.push_back(Ogre::Vector3::ZERO);
+				cellCounts.push_back(0);
+			}
+			Ogre::uint32 cellIndex = cellIns.first->second;
+			cellPositions[cellIndex] += src.position;
+			++cellCounts[cellIndex];
+			vertexCells[i] = cellIndex;
+
+			std::pair<std::map<std::pair<Ogre::uint32, Ogre::uint32>, Ogre::uint32>::iterator, bool> 
+				ins = clusters.insert(std::make_pair(std::make_pair(cellIndex, chart[i]),
+					static_cast<Ogre::uint32>(vertices.size())));
+			if (ins.second)
+			{
+				// first in the cluster, keeps its colour
+				vertices.push_back(src);
+				vertices.back().nextIndex = 0;
+				counts.push_back(1);
+				clusterCells.push_back(cellIndex);
+			}
+			else
+			{
+				UniqueVertex& dest = vertices[ins.first->second];
+				dest.normal += src.normal;
+				for (int t = 0; t < OGRE_MAX_TEXTURE_COORD_SETS; ++t)
+					dest.uv[t] += src.uv[t];
+				++counts[ins.first->second];
+			}
+			vertexClusters[i] = ins.first->second;
+		}
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			vertices[i].position = cellPositions[clusterCells[i]] / 
+				static_cast<Ogre::Real>(cellCounts[clusterCells[i]]);
+			Ogre::Real inv = 1.0f / counts[i];
+			for (int t = 0; t < OGRE_MAX_TEXTURE_COORD_SETS; ++t)
+				vertices[i].uv[t] *= inv;
+			if (vertices[i].normal.squaredLength() > 0)
+				vertices[i].normal.normalise();
+		}
+
+		// Keep triangles whose corners are still in three cells, once each
+		// way round (two sided geometry keeps both faces, as
+		// cleanProtoSubMesh does): keys are rotated to start with the
+		// lowest cluster, which keeps the winding
+		struct TriangleKey
+		{
+			Ogre::uint32 v[3];
+			bool operator<(const TriangleKey& rhs) const
+			{
+				if (v[0] != rhs.v[0]) return v[0] < rhs.v[0];
+				if (v[1] != rhs.v[1]) return v[1] < rhs.v[1];
+				return v[2] < rhs.v[2];
+			}
+		};
+		std::set<TriangleKey> seen;
+		for (size_t t = 0; t + 2 < proto.indices.size(); t += 3)
+		{
+			Ogre::uint32 i0 = proto.indices[t], i1 = proto.indices[t+1], i2 = proto.indices[t+2];
+			if (vertexCells[i0] == vertexCells[i1] || vertexCells[i1] == vertexCells[i2] || 
+				vertexCells[i0] == vertexCells[i2])
+				continue;
+			Ogre::uint32 corners[3] = { vertexClusters[i0], vertexClusters[i1], vertexClusters[i2] };
+			TriangleKey key;
+			int first = corners[0] < corners[1] ? (corners[0] < corners[2] ? 0 : 2) :
+				(corners[1] < corners[2] ? 1 : 2);
+			for (int v = 0; v < 3; ++v)
+				key.v[v] = corners[(first + v) % 3];
+			if (!seen.insert(key).second)
+				continue;
+			indices.push_back(corners[0]);
+			indices.push_back(corners[1]);
+			indices.push_back(corners[2]);
+		}
+
+		if (indices.size() / 3 <= targetTriangles || resolution == 1)
+			break;
+		resolution = std::min(resolution - 1, resolution * 3 / 4);
+	}
+
+	proto.uniqueVertices.swap(vertices);
+	proto.indices.swap(indices);
+
+	// the kept tangents were for the old triangles
+	if (proto.hasTangents)
+	{
+		generateTangents(proto);
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::exportHLOD(const Ogre::String& baseName)
+{
+	HoudiniOgre_TraceSpan span("exportHLOD", baseName.c_str());
+
+	Ogre::String hierarchyFile = baseName + ".hlod.xml";
+	std::ofstream ofs(hierarchyFile.c_str());
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write HLOD hierarchy " + hierarchyFile,
+			"HoudiniOgre_Mesh::exportHLOD");
+	}
+	ofs << "<hlod chunkSize=\"" << mChunkSize << "\" levels=\"" << mHLODLevels.size()
+		<< "\" triangleBudget=\"" << mHLODTriangleBudget << "\">\n";
+
+	// mesh files are referred to relative to the hierarchy
+	Ogre::String path, meshPrefix;
+	Ogre::StringUtil::splitFilename(baseName, meshPrefix, path);
+
+	for (size_t level = 0; level < mHLODLevels.size(); ++level)
+	{
+		HLODClusterMap& clusters = mHLODLevels[level];
+		for (HLODClusterMap::iterator ci = clusters.begin(); ci != clusters.end(); ++ci)
+		{
+			const ChunkCell& cell = ci->first;
+			HLODCluster& cluster = ci->second;
+
+			// share the budget between materials in proportion to their size
+			size_t total = 0;
+			for (std::map<Ogre::String, ProtoSubMesh>::iterator p = cluster.protos.begin();
+				p != cluster.protos.end(); ++p)
+			{
+				total += p->second.indices.size() / 3;
+			}
+			for (std::map<Ogre::String, ProtoSubMesh>::iterator p = cluster.protos.begin();
+				p != cluster.protos.end(); ++p)
+			{
+				size_t share = total ? 
+					mHLODTriangleBudget * (p->second.indices.size() / 3) / total : 0;
+				simplifyProtoSubMesh(p->second, std::max(share, size_t(1)));
+			}
+
+			// the next level up is built from this one
+			if (level + 1 < mHLODLevels.size())
+			{
+				HLODCluster& parent = mHLODLevels[level + 1][cell.getParent()];
+				parent.chunks.insert(parent.chunks.end(), 
+					cluster.chunks.begin(), cluster.chunks.end());
+				for (std::map<Ogre::String, ProtoSubMesh>::iterator p = cluster.protos.begin();
+					p != cluster.protos.end(); ++p)
+				{
+					ProtoSubMesh& proto = parent.protos[p->first];
+					proto.materialName = p->second.materialName;
+					appendProtoSubMesh(proto, p->second);
+				}
+			}
+
+			Ogre::StringUtil::StrStreamType meshName;
+			meshName << meshPrefix << "_hlod" << level + 1 << "_" 
+				<< cell.x << "_" << cell.y << "_" << cell.z << ".mesh";
+
+			mpMesh = Ogre::MeshManager::getSingleton().createManual("HoudiniExportHLOD", 
+				Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+			Ogre::AxisAlignedBox bounds;
+			Ogre::Real squaredRadius = 0;
+			size_t triangles = 0;
+			for (std::map<Ogre::String, ProtoSubMesh>::iterator p = cluster.protos.begin();
+				p != cluster.protos.end(); ++p)
+			{
+				bakeProtoSubMesh(&p->second);
+				triangles += p->second.indices.size() / 3;
+				for (UniqueVertexList::iterator v = p->second.uniqueVertices.begin();
+					v != p->second.uniqueVertices.end(); ++v)
+				{
+					bounds.merge(v->position);
+					squaredRadius = std::max(squaredRadius, v->position.squaredLength());
+				}
+			}
+			mpMesh->_setBounds(bounds);
+			mpMesh->_setBoundingSphereRadius(Ogre::Math::Sqrt(squaredRadius));
+			serializeMesh(path + meshName.str());
+			Ogre::MeshManager::getSingleton().remove(mpMesh->getHandle());
+			mpMesh.setNull();
+
+			const Ogre::Vector3& min = bounds.getMinimum();
+			const Ogre::Vector3& max = bounds.getMaximum();
+			ofs << "\t<cluster level=\"" << level + 1
+				<< "\" cell=\"" << cell.x << " " << cell.y << " " << cell.z
+				<< "\" mesh=\"" << HoudiniOgre_Escape::xml(meshName.str())
+				<< "\" triangles=\"" << triangles
+				<< "\" min=\"" << min.x << " " << min.y << " " << min.z
+				<< "\" max=\"" << max.x << " " << max.y << " " << max.z << "\">\n";
+			for (std::vector<unsigned short>::iterator c = cluster.chunks.begin();
+				c != cluster.chunks.end(); ++c)
+			{
+				ofs << "\t\t<chunk submesh=\"" << *c << "\"/>\n";
+			}
+			ofs << "\t</cluster>\n";
+
+			// done with the geometry, the level above has its own copy
+			cluster.protos.clear();
+		}
+	}
+	ofs << "</hlod>\n";
+
+	mHLODLevels.clear();
+}
+//---------------------------------------------------------------------
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::defineVertexDeclaration(Ogre::VertexDeclaration* decl,
+	const ProtoSubMesh& proto, bool hasSkeleton)
+{
+	unsigned buf = 0;
+	size_t offset = 0;
+	// always add position and normal
+	decl->addElement(buf, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+	offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+	// Split vertex data after position if poses present
+	if (!proto.poseList.empty())
+	{
+		buf++;
+		offset = 0;
+	}
+	// Optional normal
+	if(proto.hasNormals)
+	{
+		decl->addElement(buf, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+		offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+	}
+	// split vertex data here if animated
+	if (hasSkeleton)
+	{
+		buf++;
+		offset = 0;
+	}
+	// Optional vertex colour
+	if(proto.hasVertexColours)
+	{
+		decl->addElement(buf, offset, Ogre::VET_COLOUR, Ogre::VES_DIFFUSE);
+		offset += Ogre::VertexElement::getTypeSize(Ogre::VET_COLOUR);
+	}
+	// Define UVs
+	for (unsigned short uvi = 0; uvi < proto.textureCoordDimensions.size(); ++uvi)
+	{
+		Ogre::VertexElementType uvType = 
+			Ogre::VertexElement::multiplyTypeCount(
+			Ogre::VET_FLOAT1, proto.textureCoordDimensions[uvi]);
+		decl->addElement(
+			buf, offset, uvType, Ogre::VES_TEXTURE_COORDINATES, uvi);
+		offset += Ogre::VertexElement::getTypeSize(uvType);
+	}
+	// Tangent, optionally with handedness in w
+	if (proto.hasTangents)
+	{
+		Ogre::VertexElementType tangentType = 
+			mTangentHandedness ? Ogre::VET_FLOAT4 : Ogre::VET_FLOAT3;
+		decl->addElement(buf, offset, tangentType, mTangentsSemantic, 
+			mTangentsSemantic == Ogre::VES_TEXTURE_COORDINATES ? 
+				static_cast<unsigned short>(proto.textureCoordDimensions.size()) : 0);
+		offset += Ogre::VertexElement::getTypeSize(tangentType);
+	}
+}
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::createIndexData(Ogre::IndexData* indexData, IndexList& indexes, 
+	size_t vertexCount)
+{
+	// always do triangle list
+	indexData->indexCount = indexes.size();
+	// Determine index size
+	bool use32BitIndexes = false;
+	if (vertexCount > 65536)
+	{
+		use32BitIndexes = true;
+	}
+
+	indexData->indexBuffer = 
+		Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+		use32BitIndexes ? Ogre::HardwareIndexBuffer::IT_32BIT : Ogre::HardwareIndexBuffer::IT_16BIT,
+		indexData->indexCount,
+		Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+	if (use32BitIndexes)
+	{
+		uint32* pIdx = static_cast<uint32*>(
+			indexData->indexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+		writeIndexes(pIdx, indexes);
+		indexData->indexBuffer->unlock();
+	}
+	else
+	{
+		uint16* pIdx = static_cast<uint16*>(
+			indexData->indexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+		writeIndexes(pIdx, indexes);
+		indexData->indexBuffer->unlock();
+	}
+}
+//-----------------------------------------------------------------------
+template <typename T> 
+void HoudiniOgre_Mesh::writeIndexes(T* buf, IndexList& indexes)
+{
+	IndexList::const_iterator i, iend;
+	iend = indexes.end();
+	for (i = indexes.begin(); i != iend; ++i)
+	{
+		*buf++ = static_cast<T>(*i);
+	}
+}
+// instantiate the index sizes Ogre supports
+template void HoudiniOgre_Mesh::writeIndexes<Ogre::uint16>(Ogre::uint16*, IndexList&);
+template void HoudiniOgre_Mesh::writeIndexes<Ogre::uint32>(Ogre::uint32*, IndexList&);
+//-----------------------------------------------------------------------
+void HoudiniOgre_Mesh::createVertexBuffer(Ogre::VertexData* vd, 
+	unsigned short bufIdx, UniqueVertexList& uniqueVertexList, size_t uvSetCount)
+{
+	Ogre::HardwareVertexBufferSharedPtr vbuf = 
+		Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
+		vd->vertexDeclaration->getVertexSize(bufIdx),
+		vd->vertexCount, 
+		Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+	vd->vertexBufferBinding->setBinding(bufIdx, vbuf);
+	size_t vertexSize = vd->vertexDeclaration->getVertexSize(bufIdx);
+
+	char* pBase = static_cast<char*>(
+		vbuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+
+	Ogre::VertexDeclaration::VertexElementList elems = 
+		vd->vertexDeclaration->findElementsBySource(bufIdx);
+	Ogre::VertexDeclaration::VertexElementList::iterator ei, eiend;
+	eiend = elems.end();
+
+	// Work out whether the buffer is one of the usual layouts, packed in
+	// the order defineVertexDeclaration adds the elements
+	bool position = false, normal = false, colour = false;
+	int uvSets = 0, tangent = 0;
+	bool usual = true;
+	size_t offset = 0;
+	for (ei = elems.begin(); ei != eiend && usual; ++ei)
+	{
+		usual = ei->getOffset() == offset && !tangent;
+		offset += ei->getSize();
+		switch(ei->getSemantic())
+		{
+		case Ogre::VES_POSITION:
+			usual = usual && !normal && !colour && !uvSets && ei->getType() == Ogre::VET_FLOAT3;
+			position = true;
+			break;
+		case Ogre::VES_NORMAL:
+			usual = usual && !colour && !uvSets && ei->getType() == Ogre::VET_FLOAT3;
+			normal = true;
+			break;
+		case Ogre::VES_DIFFUSE:
+			usual = usual && !uvSets && ei->getSize() == sizeof(Ogre::RGBA);
+			colour = true;
+			break;
+		case Ogre::VES_TEXTURE_COORDINATES:
+			if (ei->getIndex() >= uvSetCount)
+			{
+				tangent = Ogre::VertexElement::getTypeCount(ei->getType());
+			}
+			else
+			{
+				usual = usual && ei->getIndex() == uvSets && ei->getType() == Ogre::VET_FLOAT2;
+				++uvSets;
+			}
+			break;
+		case Ogre::VES_TANGENT:
+			tangent = Ogre::VertexElement::getTypeCount(ei->getType());
+			break;
+		default:
+			usual = false;
+			break;
+		}
+	}
+	VertexWriter<UniqueVertex>::Function writer = 0;
+	if (usual && offset == vertexSize)
+		writer = VertexWriter<UniqueVertex>::select(position, normal, colour, uvSets, tangent);
+	if (writer && vd->vertexCount)
+	{
+		writer(pBase, vertexSize, &uniqueVertexList[0], vd->vertexCount);
+		vbuf->unlock();
+		return;
+	}
+
+	// Anything else element by element
+	float* pFloat;
+	Ogre::RGBA* pRGBA;
+
+	UniqueVertexList::iterator srci = uniqueVertexList.begin();
+
+	for (size_t v = 0; v < vd->vertexCount; ++v, ++srci)
+	{
+		for (ei = elems.begin(); ei != eiend; ++ei)
+		{
+			Ogre::VertexElement& elem = *ei;
+			switch(elem.getSemantic())
+			{
+			case Ogre::VES_POSITION:
+				elem.baseVertexPointerToElement(pBase, &pFloat);
+				*pFloat++ = srci->position.x;
+				*pFloat++ = srci->position.y;
+				*pFloat++ = srci->position.z;
+				break;
+			case Ogre::VES_NORMAL:
+				elem.baseVertexPointerToElement(pBase, &pFloat);
+				*pFloat++ = srci->normal.x;
+				*pFloat++ = srci->normal.y;
+				*pFloat++ = srci->normal.z;
+				break;
+			case Ogre::VES_DIFFUSE:
+				elem.baseVertexPointerToElement(pBase, &pRGBA);
 				*pRGBA = srci->colour;
 				break;
 			case Ogre::VES_TEXTURE_COORDINATES:
+				if (elem.getIndex() >= uvSetCount)
+				{
+					// the tangent, bound as a texture coordinate
+					elem.baseVertexPointerToElement(pBase, &pFloat);
+					*pFloat++ = srci->tangent.x;
+					*pFloat++ = srci->tangent.y;
+					*pFloat++ = srci->tangent.z;
+					if (Ogre::VertexElement::getTypeCount(elem.getType()) == 4)
+						*pFloat++ = srci->handedness;
+					break;
+				}
 				elem.baseVertexPointerToElement(pBase, &pFloat);
 				for (int t = 0; t < Ogre::VertexElement::getTypeCount(elem.getType()); ++t)
 				{
@@ -1277,6 +2670,14 @@ void HoudiniOgre_Mesh::createVertexBuffer(Ogre::VertexData* vd,
 					*pFloat++ = val;
 				}
 				break;
+			case Ogre::VES_TANGENT:
+				elem.baseVertexPointerToElement(pBase, &pFloat);
+				*pFloat++ = srci->tangent.x;
+				*pFloat++ = srci->tangent.y;
+				*pFloat++ = srci->tangent.z;
+				if (Ogre::VertexElement::getTypeCount(elem.getType()) == 4)
+					*pFloat++ = srci->handedness;
+				break;
 			}
 		}
 		pBase += vertexSize;
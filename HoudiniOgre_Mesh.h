@@ -27,21 +27,16 @@ This file is part of HoudiniOgre
 #define __HoudiniOgre_Mesh__
 
 #include "HoudiniOgre_Prerequisites.h"
+#include "HoudiniOgre_GeometrySource.h"
+#include "HoudiniOgre_Bounds.h"
+#include "HoudiniOgre_EdgeList.h"
+#include "HoudiniOgre_Arena.h"
+#include "HoudiniOgre_MappedStore.h"
+#include "HoudiniOgre_VertexAnimation.h"
 #include "OgreCommon.h"
 #include "OgreVector3.h"
 #include "OgreMesh.h"
 
-// forward decls
-class UT_String;
-class GU_Detail;
-class OP_Node;
-class OBJ_Bone;
-class SOP_Node;
-
-#include "OgreNoMemoryMacros.h"
-#include <GB/GB_AttributeHandle.h>
-#include "OgreMemoryMacros.h"
-
 
 /** Deals with exporting Houdini geometry objects into a Mesh.
 @remarks
@@ -56,6 +51,11 @@ class SOP_Node;
 	Ogre::Mesh - including separate SubMesh instances for differing materials.
 	If you actually want to export more than one mesh, then instantiate this class
 	more than once corresponding to where you want the divisions to be.
+@par
+	Geometry is only read through HoudiniOgre_GeometrySource, so this class
+	has no dependency on Houdini itself. Bones found in capture data are
+	collected but not exported here; the caller exports the skeleton (see
+	HoudiniOgre_Skeleton) and tells Export() its name.
 */
 class HoudiniOgre_Mesh
 {
@@ -67,18 +67,191 @@ public:
 
 	/** Add a set of geometry to this mesh.
 	*/
-	void addGeometry(const OP_Node* objNode, bool snapshotting, float frameTime,
-		bool useObjectTransforms, int numFrames, int frameStart, 
-		float fps, float ikSampleRate);
+	void addGeometry(const HoudiniOgre_GeometrySource& source, bool snapshotting,
+		bool useObjectTransforms, int numFrames, int frameStart, float fps);
+
+	/** Export the built mesh contents to a file. 
+	@param skeletonName Name of the skeleton to link the mesh to; if the
+		mesh has bone assignments this skeleton should have been exported
+		from getBoneList() first.
+	@param tangents Generate tangents (see generateTangents), stored in
+		tangentsType; a texture coordinate binding uses the first set
+		after those exported.
+	*/
+	void Export(const Ogre::String& filename, const Ogre::String& skeletonName,
+		bool edgeList, bool tangents, Ogre::VertexElementSemantic tangentsType);
+
+	/** Split the geometry of each material into chunks on a grid with
+		cells of this size (0, the default, to leave it whole).
+	@remarks
+		Triangles go to the cell their centre lies in, and each cell of
+		each material becomes a SubMesh of its own, so the runtime can cull
+		them separately. Export() writes an index of the chunks and their
+		bounds next to the mesh, in <mesh name>.chunks.xml.
+	*/
+	void setChunkSize(Ogre::Real size) { mChunkSize = size; }
+
+	/** Build hierarchical LODs of the chunks (see setChunkSize).
+	@remarks
+		Level 1 clusters the chunks in each 2x2x2 block of grid cells, level
+		2 the level 1 clusters in each 2x2x2 block of those, and so on. The
+		geometry of each cluster is merged and simplified by vertex
+		clustering until it fits the triangle budget, and exported as
+		<mesh name>_hlod<level>_<x>_<y>_<z>.mesh; each level is built from
+		the simplified level below it. <mesh name>.hlod.xml lists the
+		clusters and the chunks they stand in for. Skinned geometry is
+		left out.
+	@param levels Number of levels (0, the default, for none)
+	@param triangleBudget Maximum triangles in a cluster's mesh
+	@param material If not blank, a cluster's geometry is merged into a
+		single SubMesh using this material rather than one per material
+	*/
+	void setHLOD(size_t levels, size_t triangleBudget, const Ogre::String& material)
+	{
+		mHLODLevelCount = levels;
+		mHLODTriangleBudget = triangleBudget;
+		mHLODMaterial = material;
+	}
+
+	/** Weld vertices which are nearly, rather than exactly, the same.
+	@remarks
+		Fusing, booleans and baking transforms leave vertices a rounding
+		error apart which the exact comparison in addGeometry won't merge;
+		they cost vertices and break the connectivity edge lists need.
+		With a position tolerance above 0, Export() makes a pass over each
+		SubMesh's vertices before baking them, using a hash grid with cells
+		the size of the position tolerance, and merges each vertex into the
+		first one found within all of the tolerances. Vertices with
+		different bone assignments are never merged.
+	@param position Distance apart positions may be (0, the default, for
+		no welding)
+	@param normalAngle Angle apart normals may be
+	@param uv Difference allowed in each texture coordinate
+	@param colour Difference allowed in each colour channel, 0 to 1
+	*/
+	void setWeld(Ogre::Real position, const Ogre::Radian& normalAngle, 
+		Ogre::Real uv, Ogre::Real colour)
+	{
+		mWeldPosition = position;
+		mWeldNormalCos = Ogre::Math::Cos(normalAngle);
+		mWeldUV = uv;
+		mWeldColour = colour;
+	}
+	/// Vertices removed by welding in the last Export()
+	size_t getWeldedVertexCount() const { return mWeldedVertexCount; }
+
+	/** Remove degenerate and duplicate triangles before baking.
+	@remarks
+		Drops triangles which have collapsed to a line or a point (after
+		welding, or from fan triangulating polygons with collinear points)
+		and triangles which repeat another with the same vertices in the
+		same winding, then any vertices no longer used. Such triangles cost
+		GPU time for nothing and upset edge list and tangent building.
+		Opposite windings are both kept, they're how a two sided surface
+		is modelled. Counts of what was removed are logged by Export().
+	*/
+	void setRemoveDegenerates(bool remove) { mRemoveDegenerates = remove; }
+
+	/** Put the vertices of all SubMeshes in the mesh's shared vertex data.
+	@remarks
+		Where an object is split into several materials the vertices on
+		the boundaries are otherwise in each SubMesh's vertex data, and
+		each SubMesh binds buffers of its own. With this on, if every
+		SubMesh has the same vertex format (and none has poses), their
+		vertices go into one shared set, with identical vertices stored
+		once, and each SubMesh just has its own indexes. Not used with
+		chunking (see setChunkSize), where each chunk is kept separate.
+	*/
+	void setSharedVertices(bool shared) { mSharedVertices = shared; }
+
+	/** Store generated tangents with 4 components, the handedness in w.
+	@remarks
+		Off by default, giving 3 component tangents as 
+		Mesh::buildTangentVectors does. With it on shaders can get the 
+		binormal right where the texture is mirrored (binormal = 
+		cross(normal, tangent.xyz) * tangent.w), but they must declare the
+		tangent as a float4. Vertices on mirrored seams are split either
+		way (see generateTangents).
+	*/
+	void setTangentHandedness(bool handedness) { mTangentHandedness = handedness; }
+
+	/** Write extra bounding information alongside the mesh.
+	@remarks
+		A .mesh can only record a box and a radius about the origin, which
+		is a poor fit for geometry away from the origin. With bounds on,
+		Export() writes <mesh name>.bounds.xml with a tight sphere around
+		the geometry, the overall box and the box of each SubMesh; with
+		bvh on it writes <mesh name>.bvh, a triangle BVH for raycasts and
+		picking (see HoudiniOgre_BVH for the format). Both cover the main
+		mesh only, not HLOD meshes.
+	*/
+	void setSidecars(bool bounds, bool bvh)
+	{
+		mWriteBounds = bounds;
+		mWriteBVH = bvh;
+	}
+
+	/** Write a position-only copy of the mesh for depth and shadow passes.
+	@remarks
+		Vertices which differ only by normal, texture coordinates or
+		colour (at seams) are needed for shading, but a depth prepass or
+		shadow map only reads positions. With this on, Export() also
+		writes <mesh name>.depth.mesh, with the same SubMeshes, materials,
+		skeleton and bounds, but only positions, welded by position alone,
+		so those passes process fewer, smaller vertices. Its SubMeshes use
+		the same materials, so passes that need texture coordinates (alpha
+		testing, say) still need the full mesh.
+	*/
+	void setDepthMesh(bool depth) { mWriteDepthMesh = depth; }
+
+	/** Keep the vertices and indices gathered for the mesh in a mapped 
+		store rather than on the heap (0, the default, for the heap).
+	@remarks
+		For merged exports too big to fit in memory. Each SubMesh's
+		vertex and index lists are mapped temporary files, and the store
+		is trimmed as each object is added and each SubMesh is baked, so
+		that finished geometry is written out and only what's being worked
+		on stays in memory. Give the HoudiniOgre_MappedBufferManager the
+		same store so the buffers Ogre serialises from are mapped too.
+		Sharing vertex data (see setSharedVertices) gathers every vertex
+		at once, so is skipped; the sidecars (see setSidecars and
+		setDepthMesh) are still built in memory. The lists don't report
+		their use to the store, so pages of a list that has been trimmed
+		and is touched again aren't counted against the budget. The store
+		must outlive the Export() calls.
+	*/
+	void setOutOfCore(HoudiniOgre_MappedStore* store) { mMappedStore = store; }
+
+	/** Bake the animation into vertex animation textures (see
+		HoudiniOgre_VertexAnimation) rather than leaving it to snapshots.
+	@remarks
+		Geometry added over more than one frame (not snapshotting) is
+		sampled at every frame of the first one's animation cycles, and
+		Export() gives every SubMesh an extra 2D texture coordinate set
+		looking up its vertices' texels, then writes the textures next to
+		the mesh. Each vertex needs its own texel, so with this on the
+		vertices aren't welded, degenerate triangles are kept, and vertex
+		data isn't shared or chunked. Skinned geometry is sampled after
+		deformation, so gets no bones. The mesh's bounds take in every
+		frame, but the sidecars (see setSidecars and setDepthMesh) only
+		describe the frame the mesh was built from.
+	*/
+	void setVertexAnimation(bool enable, bool halfFloat)
+	{
+		mVertexAnimationEnabled = enable;
+		mVertexAnimation.setHalfFloat(halfFloat);
+	}
 
-	/** Export the built mesh contents to a file. */
-	void Export(const Ogre::String& filename, bool edgeList, bool tangents, 
-		Ogre::VertexElementSemantic tangentsType, int numFrames, int frameStart, 
-		float fps, float ikSampleRate);
+	/// Bones found to be of interest in the geometry added so far
+	const BoneList& getBoneList() const { return mBoneList; }
+	/// Animation cycles found in the geometry added so far
+	const AnimationList& getAnimationList() const { return mAnimList; }
 
 protected:
 
 	Ogre::MeshPtr mpMesh;
+	/// Frame number the most recent geometry was sampled at (for tracing)
+	long mFrame;
 
 	/** This struct represents a unique vertex, identified from a unique 
 	combination of components.
@@ -90,19 +263,26 @@ protected:
 		Ogre::Vector3 normal;
 		Ogre::Vector3 uv[OGRE_MAX_TEXTURE_COORD_SETS];
 		Ogre::RGBA colour;
+		Ogre::Vector3 tangent;
+		/// 1, or -1 where the texture is mirrored (binormal = normal x tangent * handedness)
+		Ogre::Real handedness;
 		// The index of the next component with the same base details
 		// but with some variation
 		size_t nextIndex;
+		// Geometry ID and vertex column this came from (not compared)
+		Ogre::uint32 sourceGeometry;
+		Ogre::uint32 sourceVertex;
 
 		UniqueVertex();
 		bool operator==(const UniqueVertex& rhs) const;
 
 	};
-	typedef std::vector<UniqueVertex> UniqueVertexList;
+	typedef std::vector<UniqueVertex, HoudiniOgre_MappedAllocator<UniqueVertex> > UniqueVertexList;
 	// dynamic index list; 32-bit until we know the max vertex index
-	typedef std::vector<Ogre::uint32> IndexList;
+	typedef std::vector<Ogre::uint32, HoudiniOgre_MappedAllocator<Ogre::uint32> > IndexList;
 
-	typedef std::map<size_t, size_t> IndexRemap;
+	typedef std::map<size_t, size_t, std::less<size_t>, 
+		HoudiniOgre_ArenaAllocator<std::pair<const size_t, size_t> > > IndexRemap;
 	/** Working area which will become a submesh once we've finished figuring
 	out what goes in there.
 	*/
@@ -120,14 +300,21 @@ protected:
 		bool hasVertexColours;
 		// Normals?
 		bool hasNormals;
+		// Tangents (generated)?
+		bool hasTangents;
+		// Normals, colours and texture coordinate dimensions packed together,
+		// equal for protos whose vertices are compatible
+		Ogre::uint32 formatKey;
+		// Interned material name
+		size_t materialID;
 		// Last geometry object added to this proto (re-use base index)
-		GU_Detail* lastMeshEntry;
+		size_t lastMeshEntry;
 		// Index offset for last geometry object entry
 		size_t lastMeshIndexOffset;
 		// index list
 		IndexList indices;
-		// map of polygon mesh -> position index offset (only > 0 when submeshes merged)
-		typedef std::map<GU_Detail*, size_t> GeometryOffsetMap;
+		// map of geometry ID -> position index offset (only > 0 when submeshes merged)
+		typedef IndexRemap GeometryOffsetMap;
 		GeometryOffsetMap geometryOffsetMap;
 		// map original position index (+any PM offset) -> first real instance in this one
 		IndexRemap posIndexRemap;
@@ -135,22 +322,39 @@ protected:
 		/// By-value pose list, build up ready for transfer later
 		std::list<Ogre::Pose> poseList;
 
-		ProtoSubMesh() : lastMeshEntry(0), lastMeshIndexOffset(0) {}
+		/** The maps' nodes come from arena, except the position remap's, 
+			which is cleared after every object and uses scratch; the 
+			vertices and indices come from store, if there is one */
+		explicit ProtoSubMesh(HoudiniOgre_Arena* arena = 0, HoudiniOgre_Arena* scratch = 0,
+			HoudiniOgre_MappedStore* store = 0)
+			: uniqueVertices(UniqueVertexList::allocator_type(store)),
+			  hasTangents(false), formatKey(0), materialID(0), lastMeshEntry(~size_t(0)), lastMeshIndexOffset(0),
+			  indices(IndexList::allocator_type(store)),
+			  geometryOffsetMap(std::less<size_t>(), arena), 
+			  posIndexRemap(std::less<size_t>(), scratch) {}
 
 
 	};
 
 	/// List of ProtoSubMeshes that use the same material but are not geometrically compatible
-	typedef std::list<ProtoSubMesh*> ProtoSubMeshList;
-
-	/// List of proto submeshes by material
-	typedef std::map<Ogre::String, ProtoSubMeshList*> MaterialProtoSubMeshMap;
-	/// List of proto submeshes by material
-	MaterialProtoSubMeshMap mMaterialProtoSubmeshMap;
-	/// List of deviant proto submeshes by primitive index 
-	typedef std::map<int, ProtoSubMesh*> PrimitiveToProtoSubMeshList;
-	/// List of deviant proto submeshes by primitive index
-	PrimitiveToProtoSubMeshList mPrimitiveToProtoSubMeshList;
+	typedef std::list<ProtoSubMesh*, HoudiniOgre_ArenaAllocator<ProtoSubMesh*> > ProtoSubMeshList;
+
+	/// Protos, their lists and map nodes, released in one go after each export
+	HoudiniOgre_Arena mProtoArena;
+	/// Position remap nodes, released in one go after each object
+	HoudiniOgre_Arena mScratchArena;
+	/// Interned material IDs by material name
+	typedef std::map<Ogre::String, size_t> MaterialIDMap;
+	/** Interned material IDs by material name; iterated to visit the 
+		protos in material name order */
+	MaterialIDMap mMaterialIDs;
+	/// List of proto submeshes by material ID
+	typedef std::vector<ProtoSubMeshList*> MaterialProtoSubMeshLists;
+	/// List of proto submeshes by material ID
+	MaterialProtoSubMeshLists mMaterialProtoLists;
+	/** Proto each primitive of the current geometry goes to, the main
+		one unless a material group says otherwise */
+	std::vector<ProtoSubMesh*> mPrimitiveProtos;
 	/// Primary ProtoSubMesh (the one used by the geometry object by default)
 	ProtoSubMesh* mMainProtoMesh;
 	// Current PolygonMesh texture coord information
@@ -160,20 +364,102 @@ protected:
 	bool mCurrentHasVertexColours;
 	// Current geometry has normals?
 	bool mCurrentHasNormals;
-	// Attribute linking
-	/// Normal attribute index
-	int mNormalAttrib;
-	/// Are normals on the points or per-vertex (= a point for a specific face)
-	bool mNormalsOnVertices;
-	typedef std::vector<int> AttributeList;
-	AttributeList mUVAttribs;
-	typedef std::vector<bool> BoolList;
-	/// Is each uv on the points or per-vertex (= a point for a specific face)
-	BoolList mUVOnVertices;
-	int mDiffseAttrib;
-	/// Is diffuse on the points or per-vertex (= a point for a specific face)
-	bool mDiffuseOnVertices;
+	/// ID of the geometry currently being added (one per addGeometry call)
+	size_t mCurrentGeometryID;
+	/// Number of geometry sets added so far
+	size_t mGeometryCount;
+	/// Grid cell size to chunk geometry by, 0 for none
+	Ogre::Real mChunkSize;
+
+	/// Grid cell a chunk covers
+	struct ChunkCell
+	{
+		int x, y, z;
+		bool operator<(const ChunkCell& rhs) const
+		{
+			if (x != rhs.x) return x < rhs.x;
+			if (y != rhs.y) return y < rhs.y;
+			return z < rhs.z;
+		}
+		/// The cell twice the size containing this one
+		ChunkCell getParent() const
+		{
+			ChunkCell parent;
+			parent.x = x >= 0 ? x / 2 : -((1 - x) / 2);
+			parent.y = y >= 0 ? y / 2 : -((1 - y) / 2);
+			parent.z = z >= 0 ? z / 2 : -((1 - z) / 2);
+			return parent;
+		}
+	};
+	/// A chunk which has been baked into a SubMesh
+	struct ChunkEntry
+	{
+		unsigned short subMeshIndex;
+		Ogre::String materialName;
+		ChunkCell cell;
+		Ogre::AxisAlignedBox bounds;
+		size_t triangleCount;
+	};
+	typedef std::vector<ChunkEntry> ChunkList;
+	/// Chunks baked so far
+	ChunkList mChunks;
 
+	/// A group of neighbouring chunks, merged for a distant LOD
+	struct HLODCluster
+	{
+		/// Indexes of the chunk SubMeshes the cluster stands in for
+		std::vector<unsigned short> chunks;
+		/// Geometry by material (just one if there's an HLOD material)
+		std::map<Ogre::String, ProtoSubMesh> protos;
+	};
+	typedef std::map<ChunkCell, HLODCluster> HLODClusterMap;
+	/// Clusters by cell at each level, only the first is filled while baking
+	std::vector<HLODClusterMap> mHLODLevels;
+	size_t mHLODLevelCount;
+	size_t mHLODTriangleBudget;
+	Ogre::String mHLODMaterial;
+
+	/// Weld tolerances, no welding if mWeldPosition is 0
+	Ogre::Real mWeldPosition;
+	Ogre::Real mWeldNormalCos;
+	Ogre::Real mWeldUV;
+	Ogre::Real mWeldColour;
+	size_t mWeldedVertexCount;
+
+	bool mRemoveDegenerates;
+	/// Triangles removed in the last Export() for being collapsed / repeats
+	size_t mDegenerateTriangleCount;
+	size_t mDuplicateTriangleCount;
+
+	bool mSharedVertices;
+
+	/// Tangent generation settings for the Export() in progress
+	bool mGenerateTangents;
+	Ogre::VertexElementSemantic mTangentsSemantic;
+	/// Tangents are 4 floats, the handedness in w, rather than 3
+	bool mTangentHandedness;
+	/// Vertices split at mirrored texture seams in the last Export()
+	size_t mTangentSplitCount;
+
+	bool mWriteBounds;
+	bool mWriteBVH;
+	bool mWriteDepthMesh;
+	/// Whether SubMeshes being baked belong to the main mesh's sidecars
+	bool mCollectSidecars;
+	/// Box of each SubMesh baked, by index
+	std::vector<Ogre::AxisAlignedBox> mSubMeshBounds;
+	/// Positions of every SubMesh baked, for the bounding sphere
+	std::vector<Ogre::Vector3> mBoundsPoints;
+	HoudiniOgre_BVH mBVH;
+	/// Position-only versions of each SubMesh baked, by index
+	std::vector<ProtoSubMesh> mDepthProtos;
+	/// Whether SubMeshes being baked are to be given to mEdgeListBuilder
+	bool mCollectEdgeList;
+	/// Where the protos' vertices and indices go, 0 for the heap
+	HoudiniOgre_MappedStore* mMappedStore;
+	HoudiniOgre_EdgeListBuilder mEdgeListBuilder;
+	bool mVertexAnimationEnabled;
+	HoudiniOgre_VertexAnimation mVertexAnimation;
 
 
 	/** Try to look up an existing vertex with the same information, or
@@ -201,14 +487,54 @@ protected:
 		size_t positionIndex, bool positionIndexIsOriginal,
 		const UniqueVertex& vertex);
 
+	/** An object's gathered geometry on its way through addPrimitives,
+		converted to what the vertex buffers hold a whole column at a time
+		(see HoudiniOgre_Simd). */
+	struct PrimitiveBatch
+	{
+		const HoudiniOgre_GeometrySource::Columns* columns;
+		/// Positions by point and normals by vertex, transformed if need be
+		const Ogre::Vector3* positions;
+		const Ogre::Vector3* normals;
+		/// Storage for the transformed copies
+		std::vector<Ogre::Vector3> transformedPositions;
+		std::vector<Ogre::Vector3> transformedNormals;
+		/// u, v pairs by vertex, flipped to Ogre's origin
+		std::vector<std::vector<float> > uvs;
+		/// Colours by vertex, packed for the vertex buffer
+		std::vector<Ogre::RGBA> colours;
+	};
+	/// Convert gathered geometry for addPrimitives
+	void prepareBatch(PrimitiveBatch& batch, const HoudiniOgre_GeometrySource& source,
+		bool useObjectTransforms);
+	/** Weld an object's polygons into the proto submeshes, using the
+		addPrimitives specialised for the current geometry's attributes. */
+	void addPrimitives(const PrimitiveBatch& batch);
+	/// Pick the addPrimitives for a number of texture coordinate sets
+	template <int UVSets>
+	void addPrimitivesWithUVs(const PrimitiveBatch& batch);
+	/** The loop over an object's polygons, with the attributes it copies
+		fixed at compile time so that the per-vertex work doesn't branch
+		on them.
+	@remarks
+		UVSets < 0 is the generic version, which reads the number of texture
+		coordinate sets at run time.
+	*/
+	template <bool Normals, bool Colours, int UVSets>
+	void addPrimitives(const PrimitiveBatch& batch);
+
+	/** Make room in the protos for an object's indices and vertices up 
+		front, rather than growing them a vertex at a time. */
+	void reserveProtoStorage(const HoudiniOgre_GeometrySource::Columns& columns);
+
 	/// Perform initial preprocessing on geometry object (returns false if aborted)
-	bool preprocessGeometry(GU_Detail* guDetail, const OP_Node* objNode, float frameTime);
+	bool preprocessGeometry(const HoudiniOgre_GeometrySource& source);
 	/// Perform final postprocessing on geometry object
-	void postprocessGeometry(GU_Detail* guDetail, const OP_Node* objNode);
+	void postprocessGeometry(const HoudiniOgre_GeometrySource& source);
 	/// Build a list of bone assignments and construct a list of bones of interest
-	void processBoneAssignments(const OP_Node* objNode, GU_Detail* origGuDetail);
+	void processBoneAssignments(const HoudiniOgre_GeometrySource& source);
 	/// Look for animation cycle attributes to build animation list
-	void processAnimationCycles(const OP_Node* objNode,
+	void processAnimationCycles(const HoudiniOgre_GeometrySource& source,
 		int numFrames, int frameStart, float fps);
 
 	/// Retrieve a ProtoSubMesh for the given material name 
@@ -221,11 +547,81 @@ protected:
 
 	/// Bake the current list of proto submeshes, and clear list
 	void bakeProtoSubMeshes();
+	/// Weld near-identical vertices of a proto, returns the number removed
+	size_t weldProtoSubMesh(ProtoSubMesh& proto);
+	/// Are two vertices of a proto within the weld tolerances?
+	bool isWeldable(const ProtoSubMesh& proto, const UniqueVertex& a, 
+		const UniqueVertex& b) const;
+	/// Remove degenerate and duplicate triangles and unused vertices from a proto
+	void cleanProtoSubMesh(ProtoSubMesh& proto);
+	/** Generate a tangent for each vertex of a proto, from its first 2D
+		texture coordinate set.
+	@remarks
+		Each triangle's tangent (scaled by its area) is summed into its
+		vertices, then made perpendicular to the vertex normal. Where a
+		vertex is shared by triangles whose texture is mirrored and ones
+		whose isn't, which would cancel out, the vertex is split in two,
+		one for each; nowhere else. Triangles are processed as columns of
+		floats, and both passes are split across threads.
+		Tangents bound as texture coordinates take the set after the last
+		one used, and an exception is thrown if there isn't one.
+	@returns The number of vertices added by splitting
+	*/
+	size_t generateTangents(ProtoSubMesh& proto);
+	/// Can two protos use the same vertex data?
+	bool isSameVertexFormat(const ProtoSubMesh& a, const ProtoSubMesh& b) const;
+	/// Bake all the protos into SubMeshes using the mesh's shared vertex data
+	void bakeSharedProtoSubMeshes(const ProtoSubMesh& format);
 	/// Bake a single ProtoSubMesh 
 	void bakeProtoSubMesh(ProtoSubMesh* proto);
-	/** Create and fill a vertex buffer */
+	/// Split a ProtoSubMesh into grid cells and bake each of them
+	void bakeChunkedProtoSubMesh(ProtoSubMesh* proto);
+	/// Bone index and weight pairs of a vertex, sorted
+	typedef std::vector<std::pair<unsigned short, Ogre::Real> > BoneWeightList;
+	/// The bone weights of each vertex of a proto
+	static void getBoneWeights(const ProtoSubMesh& proto, std::vector<BoneWeightList>& weights);
+	/// Give the positions of vertex data just baked to the edge list builder
+	size_t collectEdgeListVertices(const Ogre::VertexData* vertexData,
+		const UniqueVertexList& vertices);
+	/** Write mpMesh to filename, with the edge list of the SubMeshes
+		collected if there is one. */
+	void serializeMesh(const Ogre::String& filename);
+	/// Record what the sidecars need of a SubMesh just baked from proto
+	void collectSidecars(const ProtoSubMesh& proto, unsigned short subMeshIndex);
+	/// Make a position-only copy of proto welded by position
+	void buildDepthProtoSubMesh(const ProtoSubMesh& proto, ProtoSubMesh& depth);
+	/// Bake the depth protos collected into a mesh and export it
+	void exportDepthMesh(const Ogre::String& filename, const Ogre::String& skeletonName,
+		bool edgeList, const Ogre::AxisAlignedBox& bounds, Ogre::Real radius);
+	/// Record the bounds and triangles of a SubMesh just baked from proto
+	void collectBounds(const ProtoSubMesh& proto, unsigned short subMeshIndex);
+	/// Write the bounding sphere and boxes collected to filename
+	void writeBounds(const Ogre::String& filename) const;
+	/// Write the list of chunks for the mesh being exported to filename
+	void writeChunkIndex(const Ogre::String& filename) const;
+	/// Add a baked chunk to its level 1 HLOD cluster
+	void addToHLOD(const ProtoSubMesh& chunk, const ChunkEntry& entry);
+	/// Add the vertices and triangles of one proto to another
+	void appendProtoSubMesh(ProtoSubMesh& dest, const ProtoSubMesh& src);
+	/// Reduce a proto to at most the given number of triangles
+	void simplifyProtoSubMesh(ProtoSubMesh& proto, size_t targetTriangles);
+	/** Simplify and export every HLOD level.
+	@param baseName The mesh file name without the .mesh extension
+	*/
+	void exportHLOD(const Ogre::String& baseName);
+	/** Define the vertex layout for a ProtoSubMesh; positions are split into
+		their own buffer if there are poses, and the rest of the data after
+		normals if the mesh is skeletally animated. */
+	void defineVertexDeclaration(Ogre::VertexDeclaration* decl,
+		const ProtoSubMesh& proto, bool hasSkeleton);
+	/** Create and fill an index buffer, 16 bit if the vertex count allows */
+	void createIndexData(Ogre::IndexData* indexData, IndexList& indexes, size_t vertexCount);
+	/** Create and fill a vertex buffer; texture coordinate sets from
+		uvSetCount on hold the tangent. Buffers laid out as 
+		defineVertexDeclaration does are filled by a loop specialised for 
+		the elements they hold, anything else an element at a time. */
 	void createVertexBuffer(Ogre::VertexData* vd, unsigned short bufIdx, 
-		UniqueVertexList& uniqueVertexList);
+		UniqueVertexList& uniqueVertexList, size_t uvSetCount);
 	/** Templatised method for writing indexes */
 	template <typename T> void writeIndexes(T* buf, IndexList& indexes);
 
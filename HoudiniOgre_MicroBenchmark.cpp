@@ -0,0 +1,564 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_MicroBenchmark.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+/*
+	Micro-benchmarks for the exporter's inner loops. Unlike
+	HoudiniOgre_Benchmark this links the HDK (for the UT matrix types used
+	by HoudiniMappings and HoudiniOgre_Skeleton), but it is a standalone
+	program: it needs no licence, no scene and no display.
+
+	Usage: HoudiniOgre_MicroBenchmark [options]
+		-filter <text>    only run benchmarks whose name contains text
+		-min-time <secs>  minimum measured time per repetition (default 0.25)
+		-repetitions <n>  repetitions per benchmark, the median is reported (default 5)
+		-out <file>       write the JSON results here instead of stdout
+
+	Results are written as JSON using the same layout as Google Benchmark
+	("context" plus a "benchmarks" array with name, iterations, real_time,
+	time_unit and items_per_second), so runs can be compared with its
+	compare.py or any JSON diff.
+*/
+#include "HoudiniOgre_Standalone.h"
+#include "HoudiniOgre_Escape.h"
+#include "HoudiniOgre_Mesh.h"
+#include "HoudiniOgre_Simd.h"
+#include "HoudiniOgre_Skeleton.h"
+#include "HoudiniOgre_SyntheticSource.h"
+
+#include "OgreNoMemoryMacros.h"
+#include <UT/UT_DMatrix4.h>
+#include "OgreMemoryMacros.h"
+
+#include "OgreHardwareBufferManager.h"
+#include "OgreVertexIndexData.h"
+#include "OgreMath.h"
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+	/// Stops the compiler optimising away results we don't otherwise use
+	volatile float gSink = 0;
+
+	struct Options
+	{
+		Ogre::String filter;
+		double minTime;
+		int repetitions;
+		Ogre::String outFile;
+
+		Options() : minTime(0.25), repetitions(5) {}
+	};
+
+	struct Result
+	{
+		Ogre::String name;
+		size_t iterations;
+		/// Median nanoseconds per iteration
+		double nsPerIteration;
+		size_t itemsPerIteration;
+	};
+	typedef std::vector<Result> ResultList;
+
+	/** A benchmark body does its own set-up, then times the work being
+		measured and returns the elapsed time in seconds. */
+	typedef std::function<double()> Body;
+
+	//---------------------------------------------------------------------
+	void run(const Options& opts, ResultList& results, const Ogre::String& name,
+		size_t itemsPerIteration, const Body& body)
+	{
+		if (!opts.filter.empty() && name.find(opts.filter) == Ogre::String::npos)
+			return;
+
+		// warm up and find how many iterations fill the minimum time
+		size_t iterations = 1;
+		double elapsed = body();
+		if (elapsed < opts.minTime)
+		{
+			iterations = static_cast<size_t>(opts.minTime / std::max(elapsed, 1e-9)) + 1;
+		}
+
+		std::vector<double> samples;
+		for (int r = 0; r < opts.repetitions; ++r)
+		{
+			double total = 0;
+			for (size_t i = 0; i < iterations; ++i)
+				total += body();
+			samples.push_back(total * 1e9 / iterations);
+		}
+		std::sort(samples.begin(), samples.end());
+
+		Result res;
+		res.name = name;
+		res.iterations = iterations;
+		res.nsPerIteration = samples[samples.size() / 2];
+		res.itemsPerIteration = itemsPerIteration;
+		results.push_back(res);
+
+		std::cerr << name << ": " << res.nsPerIteration << " ns" << std::endl;
+	}
+	//---------------------------------------------------------------------
+	/// Exposes the protected mesh hot paths
+	class BenchMesh : public HoudiniOgre_Mesh
+	{
+	public:
+		typedef HoudiniOgre_Mesh::ProtoSubMesh ProtoSubMesh;
+		typedef HoudiniOgre_Mesh::UniqueVertex UniqueVertex;
+		typedef HoudiniOgre_Mesh::UniqueVertexList UniqueVertexList;
+		typedef HoudiniOgre_Mesh::IndexList IndexList;
+
+		using HoudiniOgre_Mesh::createOrRetrieveUniqueVertex;
+		using HoudiniOgre_Mesh::writeIndexes;
+		using HoudiniOgre_Mesh::defineVertexDeclaration;
+		using HoudiniOgre_Mesh::createVertexBuffer;
+	};
+	//---------------------------------------------------------------------
+	/// Skeleton whose single bone follows a procedural path instead of a node
+	class MockSkeleton : public HoudiniOgre_Skeleton
+	{
+	public:
+		MockSkeleton()
+			: HoudiniOgre_Skeleton(msNoBones), mEntry(0)
+		{
+			mEntry.invBindXform.identity();
+		}
+
+		void sample(KeyList& keys, float startTime, float endTime, float sampleFreq)
+		{
+			sampleTrack(keys, mEntry, startTime, endTime, sampleFreq);
+		}
+
+	protected:
+		void getBoneTransform(const BoneEntry& be, float time, UT_DMatrix4& xform)
+		{
+			Ogre::Matrix4 m;
+			Ogre::Quaternion rot(Ogre::Radian(time), Ogre::Vector3::UNIT_Y);
+			m.makeTransform(Ogre::Vector3(time, 0, 1), Ogre::Vector3(1, 1 + time * 0.1f, 1), rot);
+			// Houdini's matrices are transposed compared to Ogres
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c)
+					xform(r, c) = m[c][r];
+		}
+
+		static BoneList msNoBones;
+		BoneEntry mEntry;
+	};
+	BoneList MockSkeleton::msNoBones;
+
+	//---------------------------------------------------------------------
+	/// Vertex stream of a grid, in the order addGeometry would weld it
+	void buildVertexStream(float seamRatio, std::vector<size_t>& points,
+		BenchMesh::UniqueVertexList& vertices)
+	{
+		HoudiniOgre_SyntheticSource grid("grid", 256, 1, seamRatio);
+		for (int prim = 0; prim < grid.getPrimitiveCount(); ++prim)
+		{
+			for (int v = 0; v < grid.getPrimitiveVertexCount(prim); ++v)
+			{
+				BenchMesh::UniqueVertex vert;
+				int point = grid.getVertexPoint(prim, v);
+				vert.position = grid.getPointPosition(point);
+				vert.normal = grid.getNormal(prim, v);
+				float uv[2];
+				grid.getUV(0, prim, v, uv[0], uv[1]);
+				vert.uv[0].x = uv[0];
+				vert.uv[0].y = 1.0f - uv[1];
+				points.push_back(point);
+				vertices.push_back(vert);
+			}
+		}
+	}
+	//---------------------------------------------------------------------
+	void benchUniqueVertex(const Options& opts, ResultList& results)
+	{
+		static const float seamRatios[] = { 0.0f, 0.1f, 0.5f, 1.0f };
+		for (size_t s = 0; s < sizeof(seamRatios) / sizeof(seamRatios[0]); ++s)
+		{
+			std::vector<size_t> points;
+			BenchMesh::UniqueVertexList vertices;
+			buildVertexStream(seamRatios[s], points, vertices);
+
+			std::ostringstream name;
+			name << "createOrRetrieveUniqueVertex/seams:" << seamRatios[s];
+			BenchMesh mesh;
+			run(opts, results, name.str(), vertices.size(), [&]() -> double
+			{
+				BenchMesh::ProtoSubMesh proto;
+				double start = HoudiniOgre_Standalone::now();
+				size_t sum = 0;
+				for (size_t i = 0; i < vertices.size(); ++i)
+					sum += mesh.createOrRetrieveUniqueVertex(&proto, points[i], true, vertices[i]);
+				double elapsed = HoudiniOgre_Standalone::now() - start;
+				gSink = static_cast<float>(sum);
+				return elapsed;
+			});
+		}
+	}
+	//---------------------------------------------------------------------
+	template <typename T>
+	void benchWriteIndexes(const Options& opts, ResultList& results, const char* name)
+	{
+		BenchMesh::IndexList indexes(3 << 20);
+		for (size_t i = 0; i < indexes.size(); ++i)
+			indexes[i] = static_cast<Ogre::uint32>((i * 7919) & 0xFFFF);
+		std::vector<T> buf(indexes.size());
+
+		BenchMesh mesh;
+		run(opts, results, name, indexes.size(), [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			mesh.writeIndexes(&buf[0], indexes);
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = static_cast<float>(buf[buf.size() / 2]);
+			return elapsed;
+		});
+	}
+	//---------------------------------------------------------------------
+	/// Describe a vertex layout, eg "pos|nrm|col,uv0" ('|' between buffers)
+	Ogre::String describeLayout(Ogre::VertexDeclaration* decl)
+	{
+		Ogre::String ret;
+		for (unsigned short b = 0; b <= decl->getMaxSource(); ++b)
+		{
+			if (b)
+				ret += "|";
+			Ogre::VertexDeclaration::VertexElementList elems = decl->findElementsBySource(b);
+			for (Ogre::VertexDeclaration::VertexElementList::iterator ei = elems.begin();
+				ei != elems.end(); ++ei)
+			{
+				if (ei != elems.begin())
+					ret += ",";
+				switch (ei->getSemantic())
+				{
+				case Ogre::VES_POSITION: ret += "pos"; break;
+				case Ogre::VES_NORMAL: ret += "nrm"; break;
+				case Ogre::VES_DIFFUSE: ret += "col"; break;
+				case Ogre::VES_TEXTURE_COORDINATES:
+					ret += "uv" + Ogre::StringConverter::toString(ei->getIndex());
+					break;
+				default: ret += "?"; break;
+				}
+			}
+		}
+		return ret;
+	}
+	//---------------------------------------------------------------------
+	void benchCreateVertexBuffer(const Options& opts, ResultList& results)
+	{
+		const size_t vertexCount = 65536;
+		std::set<Ogre::String> done;
+
+		// Every combination of the inputs bakeProtoSubMesh looks at
+		for (int combo = 0; combo < 48; ++combo)
+		{
+			bool poses = (combo & 1) != 0;
+			bool skeleton = (combo & 2) != 0;
+			bool normals = (combo & 4) != 0;
+			bool colours = (combo & 8) != 0;
+			size_t uvSets = combo / 16;
+
+			BenchMesh::ProtoSubMesh proto;
+			proto.hasNormals = normals;
+			proto.hasVertexColours = colours;
+			proto.textureCoordDimensions.assign(uvSets, 2);
+			if (poses)
+				proto.poseList.push_back(Ogre::Pose(1, "bench"));
+			proto.uniqueVertices.resize(vertexCount);
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				BenchMesh::UniqueVertex& vert = proto.uniqueVertices[v];
+				vert.position = Ogre::Vector3(static_cast<Ogre::Real>(v), 0, 1);
+				vert.normal = Ogre::Vector3::UNIT_Y;
+				vert.colour = static_cast<Ogre::RGBA>(v * 2654435761u);
+				vert.uv[0] = vert.uv[1] = Ogre::Vector3(0.5f, 0.25f, 0);
+			}
+
+			BenchMesh mesh;
+			Ogre::VertexData layout;
+			mesh.defineVertexDeclaration(layout.vertexDeclaration, proto, skeleton);
+			Ogre::String name = describeLayout(layout.vertexDeclaration);
+			// Different inputs can give the same layout; and poses plus a
+			// skeleton without normals would leave an empty buffer, which
+			// can't be created, so there is nothing to measure
+			if (!done.insert(name).second || name.find("||") != Ogre::String::npos)
+				continue;
+
+			run(opts, results, "createVertexBuffer/" + name, vertexCount, [&]() -> double
+			{
+				Ogre::VertexData vd;
+				vd.vertexCount = vertexCount;
+				mesh.defineVertexDeclaration(vd.vertexDeclaration, proto, skeleton);
+				double start = HoudiniOgre_Standalone::now();
+				for (unsigned short b = 0; b <= vd.vertexDeclaration->getMaxSource(); ++b)
+					mesh.createVertexBuffer(&vd, b, proto.uniqueVertices, uvSets);
+				return HoudiniOgre_Standalone::now() - start;
+			});
+		}
+	}
+	//---------------------------------------------------------------------
+	void benchMappings(const Options& opts, ResultList& results)
+	{
+		const size_t count = 4096;
+		std::vector<UT_DMatrix4> matrices(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			Ogre::Matrix4 m;
+			Ogre::Quaternion rot(Ogre::Radian(i * 0.01f), Ogre::Vector3(1, 2, 3).normalisedCopy());
+			m.makeTransform(Ogre::Vector3(i * 1.0f, 2, 3), Ogre::Vector3(1, 2, 1), rot);
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c)
+					matrices[i](r, c) = m[c][r];
+		}
+		std::vector<float> colours(count * 4);
+		for (size_t i = 0; i < colours.size(); ++i)
+			colours[i] = (i % 256) / 255.0f;
+
+		run(opts, results, "HoudiniMappings::toRGBA", count, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			Ogre::RGBA sum = 0;
+			for (size_t i = 0; i < count; ++i)
+				sum += HoudiniMappings::toRGBA(&colours[i * 4]);
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = static_cast<float>(sum);
+			return elapsed;
+		});
+		run(opts, results, "HoudiniMappings::toMat4", count, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			Ogre::Real sum = 0;
+			for (size_t i = 0; i < count; ++i)
+				sum += HoudiniMappings::toMat4(matrices[i])[0][3];
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = sum;
+			return elapsed;
+		});
+		run(opts, results, "HoudiniMappings::explode", count, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			Ogre::Real sum = 0;
+			Ogre::Vector3 scl, trans;
+			Ogre::Quaternion rot;
+			for (size_t i = 0; i < count; ++i)
+			{
+				HoudiniMappings::explode(matrices[i], scl, rot, trans);
+				sum += scl.y + rot.w + trans.x;
+			}
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = sum;
+			return elapsed;
+		});
+	}
+	//---------------------------------------------------------------------
+	void benchSimd(const Options& opts, ResultList& results)
+	{
+		const size_t count = 65536;
+		std::vector<Ogre::Vector3> points(count), transformed(count);
+		std::vector<float> uvs(count * 2), flipped(count * 2);
+		std::vector<Ogre::ColourValue> colours(count);
+		std::vector<Ogre::RGBA> packed(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			points[i] = Ogre::Vector3(static_cast<Ogre::Real>(i), 1, -2);
+			uvs[i * 2] = uvs[i * 2 + 1] = (i % 256) / 255.0f;
+			colours[i] = Ogre::ColourValue((i % 256) / 255.0f, 0.5f, 0.25f);
+		}
+		Ogre::Matrix4 xform;
+		xform.makeTransform(Ogre::Vector3(1, 2, 3), Ogre::Vector3(1, 2, 1),
+			Ogre::Quaternion(Ogre::Radian(0.5f), Ogre::Vector3::UNIT_Y));
+		Ogre::Matrix3 rot;
+		xform.extract3x3Matrix(rot);
+		Ogre::String suffix = HoudiniOgre_Simd::isAccelerated() ? "" : " (scalar)";
+
+		run(opts, results, "HoudiniOgre_Simd::transformPoints" + suffix, count, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			HoudiniOgre_Simd::transformPoints(xform, &points[0], &transformed[0], count);
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = transformed[count / 2].x;
+			return elapsed;
+		});
+		run(opts, results, "HoudiniOgre_Simd::transformVectors" + suffix, count, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			HoudiniOgre_Simd::transformVectors(rot, &points[0], &transformed[0], count);
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = transformed[count / 2].x;
+			return elapsed;
+		});
+		run(opts, results, "HoudiniOgre_Simd::flipUVs" + suffix, count, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			HoudiniOgre_Simd::flipUVs(&uvs[0], &flipped[0], count);
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = flipped[count];
+			return elapsed;
+		});
+		run(opts, results, "HoudiniOgre_Simd::packColours" + suffix, count, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			HoudiniOgre_Simd::packColours(&colours[0], &packed[0], count,
+				Ogre::VertexElement::getBestColourVertexElementType());
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = static_cast<float>(packed[count / 2]);
+			return elapsed;
+		});
+		run(opts, results, "HoudiniOgre_Simd::growBounds" + suffix, count, [&]() -> double
+		{
+			Ogre::Vector3 min(Ogre::Math::POS_INFINITY, Ogre::Math::POS_INFINITY, Ogre::Math::POS_INFINITY);
+			Ogre::Vector3 max(Ogre::Math::NEG_INFINITY, Ogre::Math::NEG_INFINITY, Ogre::Math::NEG_INFINITY);
+			Ogre::Real squaredRadius = 0;
+			double start = HoudiniOgre_Standalone::now();
+			HoudiniOgre_Simd::growBounds(&points[0], count, min, max, squaredRadius);
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			gSink = squaredRadius;
+			return elapsed;
+		});
+	}
+	//---------------------------------------------------------------------
+	void benchSampleTrack(const Options& opts, ResultList& results)
+	{
+		// 10 seconds at 24fps
+		const float sampleFreq = 1.0f / 24.0f;
+		MockSkeleton mock;
+		HoudiniOgre_SkeletonWriter::KeyList keys;
+		mock.sample(keys, 0.0f, 10.0f, sampleFreq);
+		size_t keyCount = keys.size();
+		keys.clear();
+
+		run(opts, results, "HoudiniOgre_Skeleton::sampleTrack", keyCount, [&]() -> double
+		{
+			double start = HoudiniOgre_Standalone::now();
+			mock.sample(keys, 0.0f, 10.0f, sampleFreq);
+			double elapsed = HoudiniOgre_Standalone::now() - start;
+			keys.clear();
+			return elapsed;
+		});
+	}
+	//---------------------------------------------------------------------
+	void writeJSON(std::ostream& os, const char* executable, const ResultList& results)
+	{
+		char date[64];
+		time_t t = time(0);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&t));
+
+		os << "{\n  \"context\": {\n"
+			<< "    \"date\": \"" << date << "\",\n"
+			<< "    \"executable\": \"" << HoudiniOgre_Escape::json(executable) << "\",\n"
+			<< "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+			<< "    \"library_build_type\": \"release\"\n"
+#else
+			<< "    \"library_build_type\": \"debug\"\n"
+#endif
+			<< "  },\n  \"benchmarks\": [";
+
+		for (ResultList::const_iterator i = results.begin(); i != results.end(); ++i)
+		{
+			os << (i == results.begin() ? "\n" : ",\n")
+				<< "    {\n"
+				<< "      \"name\": \"" << HoudiniOgre_Escape::json(i->name) << "\",\n"
+				<< "      \"run_name\": \"" << HoudiniOgre_Escape::json(i->name) << "\",\n"
+				<< "      \"iterations\": " << i->iterations << ",\n"
+				<< "      \"real_time\": " << i->nsPerIteration << ",\n"
+				<< "      \"time_unit\": \"ns\",\n"
+				<< "      \"items_per_second\": "
+				<< (i->nsPerIteration > 0 ? i->itemsPerIteration * 1e9 / i->nsPerIteration : 0.0) << "\n"
+				<< "    }";
+		}
+		os << "\n  ]\n}\n";
+	}
+	//---------------------------------------------------------------------
+	bool parseArgs(int argc, char** argv, Options& opts)
+	{
+		for (int i = 1; i < argc; i += 2)
+		{
+			if (i + 1 >= argc)
+				return false;
+			const char* arg = argv[i];
+			const char* value = argv[i + 1];
+
+			if (!strcmp(arg, "-filter"))
+				opts.filter = value;
+			else if (!strcmp(arg, "-min-time"))
+				opts.minTime = std::max(0.0, atof(value));
+			else if (!strcmp(arg, "-repetitions"))
+				opts.repetitions = std::max(1, atoi(value));
+			else if (!strcmp(arg, "-out"))
+				opts.outFile = value;
+			else
+				return false;
+		}
+		return true;
+	}
+}
+//---------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	Options opts;
+	if (!parseArgs(argc, argv, opts))
+	{
+		std::cerr << "Usage: " << argv[0] << " [-filter text] [-min-time secs] "
+			"[-repetitions n] [-out file]" << std::endl;
+		return 1;
+	}
+
+	HoudiniOgre_Standalone env("HoudiniOgre_MicroBenchmark.log");
+
+	ResultList results;
+	benchUniqueVertex(opts, results);
+	benchWriteIndexes<Ogre::uint16>(opts, results, "writeIndexes<uint16>");
+	benchWriteIndexes<Ogre::uint32>(opts, results, "writeIndexes<uint32>");
+	benchCreateVertexBuffer(opts, results);
+	benchMappings(opts, results);
+	benchSimd(opts, results);
+	benchSampleTrack(opts, results);
+
+	if (opts.outFile.empty())
+	{
+		writeJSON(std::cout, argv[0], results);
+	}
+	else
+	{
+		std::ofstream ofs(opts.outFile.c_str());
+		if (!ofs)
+		{
+			std::cerr << "Unable to write " << opts.outFile << std::endl;
+			return 1;
+		}
+		writeJSON(ofs, argv[0], results);
+	}
+	return 0;
+}
@@ -0,0 +1,218 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_ObjSource.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_ObjSource.h"
+
+#include "OgreException.h"
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+
+#include <fstream>
+#include <cstdlib>
+
+//---------------------------------------------------------------------
+HoudiniOgre_ObjSource::HoudiniOgre_ObjSource(const Ogre::String& filename)
+: mCurrentGroup(-1)
+{
+	std::ifstream ifs(filename.c_str());
+	if (!ifs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_FILE_NOT_FOUND,
+			"Unable to open '" + filename + "'",
+			"HoudiniOgre_ObjSource::HoudiniOgre_ObjSource");
+	}
+
+	// Name the object after the file
+	Ogre::String path;
+	Ogre::StringUtil::splitFilename(filename, mName, path);
+	Ogre::String::size_type dot = mName.rfind('.');
+	if (dot != Ogre::String::npos)
+	{
+		mName = mName.substr(0, dot);
+	}
+
+	mFaceStarts.push_back(0);
+
+	Ogre::String line;
+	while (std::getline(ifs, line))
+	{
+		if (line.size() < 2)
+			continue;
+
+		const char* str = line.c_str();
+		if (str[0] == 'v' && str[1] == ' ')
+		{
+			char* end;
+			float x = static_cast<float>(std::strtod(str + 2, &end));
+			float y = static_cast<float>(std::strtod(end, &end));
+			float z = static_cast<float>(std::strtod(end, &end));
+			mPositions.push_back(Ogre::Vector3(x, y, z));
+		}
+		else if (str[0] == 'v' && str[1] == 'n')
+		{
+			char* end;
+			float x = static_cast<float>(std::strtod(str + 2, &end));
+			float y = static_cast<float>(std::strtod(end, &end));
+			float z = static_cast<float>(std::strtod(end, &end));
+			mNormals.push_back(Ogre::Vector3(x, y, z));
+		}
+		else if (str[0] == 'v' && str[1] == 't')
+		{
+			char* end;
+			float u = static_cast<float>(std::strtod(str + 2, &end));
+			float v = static_cast<float>(std::strtod(end, &end));
+			mUVs.push_back(std::make_pair(u, v));
+		}
+		else if (str[0] == 'f' && str[1] == ' ')
+		{
+			parseFace(line);
+		}
+		else if (line.compare(0, 7, "usemtl ") == 0)
+		{
+			Ogre::String material = line.substr(7);
+			Ogre::StringUtil::trim(material);
+
+			if (mFaceStarts.size() == 1 && mMaterialGroups.empty())
+			{
+				// nothing yet, this is the object's material
+				mMaterialName = material;
+				mCurrentGroup = -1;
+			}
+			else if (material == mMaterialName)
+			{
+				mCurrentGroup = -1;
+			}
+			else
+			{
+				mCurrentGroup = -1;
+				for (size_t g = 0; g < mMaterialGroups.size(); ++g)
+				{
+					if (mMaterialGroups[g].materialName == material)
+					{
+						mCurrentGroup = static_cast<int>(g);
+						break;
+					}
+				}
+				if (mCurrentGroup < 0)
+				{
+					MaterialGroup group;
+					group.name = mName + "_" + material;
+					group.materialName = material;
+					mCurrentGroup = static_cast<int>(mMaterialGroups.size());
+					mMaterialGroups.push_back(group);
+				}
+			}
+		}
+	}
+
+	Ogre::StringUtil::StrStreamType msg;
+	msg << "Loaded '" << filename << "': " << mPositions.size() << " points, "
+		<< getPrimitiveCount() << " faces, " << mMaterialGroups.size() + 1 << " materials";
+	Ogre::LogManager::getSingleton().logMessage(msg.str());
+}
+//---------------------------------------------------------------------
+HoudiniOgre_ObjSource::~HoudiniOgre_ObjSource()
+{
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_ObjSource::parseFace(const Ogre::String& line)
+{
+	// Each corner is v, v/vt, v//vn or v/vt/vn
+	const char* str = line.c_str() + 2;
+	char* end;
+	for (;;)
+	{
+		while (*str == ' ' || *str == '\t')
+			++str;
+		if (*str == '\0' || *str == '\r' || *str == '\n')
+			break;
+
+		Vertex v;
+		v.uv = -1;
+		v.normal = -1;
+		v.point = resolveIndex(std::strtol(str, &end, 10), mPositions.size());
+		str = end;
+		if (*str == '/')
+		{
+			++str;
+			if (*str != '/')
+			{
+				v.uv = resolveIndex(std::strtol(str, &end, 10), mUVs.size());
+				str = end;
+			}
+			if (*str == '/')
+			{
+				++str;
+				v.normal = resolveIndex(std::strtol(str, &end, 10), mNormals.size());
+				str = end;
+			}
+		}
+		// skip anything we don't understand
+		while (*str && *str != ' ' && *str != '\t')
+			++str;
+
+		mVertices.push_back(v);
+	}
+
+	int prim = getPrimitiveCount();
+	mFaceStarts.push_back(mVertices.size());
+	if (mCurrentGroup >= 0)
+	{
+		mMaterialGroups[mCurrentGroup].primitives.push_back(prim);
+	}
+}
+//---------------------------------------------------------------------
+int HoudiniOgre_ObjSource::resolveIndex(int index, size_t count) const
+{
+	// 1-based, negative values are relative to the end of the list so far
+	int ret = index < 0 ? static_cast<int>(count) + index : index - 1;
+	if (ret < 0 || ret >= static_cast<int>(count))
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS,
+			"Face index " + Ogre::StringConverter::toString(index) + " out of range in '" + mName + "'",
+			"HoudiniOgre_ObjSource::resolveIndex");
+	}
+	return ret;
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_ObjSource::getNormal(int prim, int vertex) const
+{
+	int n = getVertex(prim, vertex).normal;
+	return n < 0 ? Ogre::Vector3::ZERO : mNormals[n];
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_ObjSource::getUV(size_t uvSet, int prim, int vertex,
+								  float& u, float& v) const
+{
+	int t = getVertex(prim, vertex).uv;
+	if (t < 0)
+	{
+		u = v = 0.0f;
+	}
+	else
+	{
+		u = mUVs[t].first;
+		v = mUVs[t].second;
+	}
+}
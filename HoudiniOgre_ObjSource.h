@@ -0,0 +1,99 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_ObjSource.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_ObjSource__
+#define __HoudiniOgre_ObjSource__
+
+#include "HoudiniOgre_GeometrySource.h"
+
+/** Geometry source reading a Wavefront .obj file.
+@remarks
+	Supports positions, one set of texture coordinates, normals and
+	'usemtl' material switches; everything else in the file is ignored.
+	Texture coordinates and normals are treated as per-vertex attributes.
+	Faces are presented in Houdini's (clockwise) winding.
+*/
+class HoudiniOgre_ObjSource : public HoudiniOgre_GeometrySource
+{
+public:
+	/** Load the given file, throws if it can't be read. */
+	HoudiniOgre_ObjSource(const Ogre::String& filename);
+	virtual ~HoudiniOgre_ObjSource();
+
+	const Ogre::String& getName() const { return mName; }
+
+	int getPointCount() const { return static_cast<int>(mPositions.size()); }
+	int getPrimitiveCount() const { return static_cast<int>(mFaceStarts.size()) - 1; }
+	bool isPolygon(int prim) const { return getPrimitiveVertexCount(prim) >= 3; }
+	int getPrimitiveVertexCount(int prim) const
+	{
+		return static_cast<int>(mFaceStarts[prim + 1] - mFaceStarts[prim]);
+	}
+	int getVertexPoint(int prim, int vertex) const { return getVertex(prim, vertex).point; }
+	Ogre::Vector3 getPointPosition(int point) const { return mPositions[point]; }
+
+	bool hasNormals() const { return !mNormals.empty(); }
+	Ogre::Vector3 getNormal(int prim, int vertex) const;
+	size_t getUVSetCount() const { return mUVs.empty() ? 0 : 1; }
+	void getUV(size_t uvSet, int prim, int vertex, float& u, float& v) const;
+	bool hasColours() const { return false; }
+	Ogre::ColourValue getColour(int prim, int vertex) const { return Ogre::ColourValue::White; }
+
+	const Ogre::String& getMaterialName() const { return mMaterialName; }
+	const MaterialGroupList& getMaterialGroups() const { return mMaterialGroups; }
+
+protected:
+	/// A face corner; attribute indexes are -1 when not specified
+	struct Vertex
+	{
+		int point;
+		int uv;
+		int normal;
+	};
+
+	const Vertex& getVertex(int prim, int vertex) const
+	{
+		// reverse the winding to match Houdini
+		return mVertices[mFaceStarts[prim + 1] - vertex - 1];
+	}
+	void parseFace(const Ogre::String& line);
+	int resolveIndex(int index, size_t count) const;
+
+	Ogre::String mName;
+	Ogre::String mMaterialName;
+	MaterialGroupList mMaterialGroups;
+	/// Index into mMaterialGroups of the current 'usemtl', -1 for the object material
+	int mCurrentGroup;
+
+	std::vector<Ogre::Vector3> mPositions;
+	std::vector<Ogre::Vector3> mNormals;
+	std::vector<std::pair<float, float> > mUVs;
+	std::vector<Vertex> mVertices;
+	/// Index of the first vertex of each face, plus one past the end
+	std::vector<size_t> mFaceStarts;
+
+};
+
+#endif
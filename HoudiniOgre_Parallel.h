@@ -0,0 +1,114 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Parallel.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_Parallel__
+#define __HoudiniOgre_Parallel__
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+/** Splits loops over independent items across threads.
+@remarks
+	There's no pool; threads are started for each call and joined before
+	it returns, which is cheap next to the mesh-sized work this is used
+	for. The calling thread takes the first range itself. An exception
+	thrown by any range is rethrown on the calling thread once all the
+	ranges have finished.
+*/
+class HoudiniOgre_Parallel
+{
+public:
+	/// Number of threads a loop is split over
+	static size_t getThreadCount()
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	/** Call func(begin, end) over [0, count), split into contiguous
+		ranges of at least grain items, one per thread.
+	*/
+	template <typename F>
+	static void forRange(size_t count, size_t grain, F func)
+	{
+		size_t ranges = std::min(getThreadCount(), 
+			(count + std::max(grain, size_t(1)) - 1) / std::max(grain, size_t(1)));
+		if (ranges <= 1)
+		{
+			if (count)
+				func(size_t(0), count);
+			return;
+		}
+
+		std::vector<std::exception_ptr> errors(ranges);
+		std::vector<std::thread> threads;
+		threads.reserve(ranges - 1);
+		for (size_t r = 1; r < ranges; ++r)
+		{
+			size_t begin = count * r / ranges;
+			size_t end = count * (r + 1) / ranges;
+			threads.push_back(std::thread([&func, &errors, r, begin, end]() {
+				try
+				{
+					func(begin, end);
+				}
+				catch (...)
+				{
+					errors[r] = std::current_exception();
+				}
+			}));
+		}
+		try
+		{
+			func(size_t(0), count / ranges);
+		}
+		catch (...)
+		{
+			errors[0] = std::current_exception();
+		}
+		for (size_t t = 0; t < threads.size(); ++t)
+		{
+			threads[t].join();
+		}
+		for (size_t r = 0; r < ranges; ++r)
+		{
+			if (errors[r])
+				std::rethrow_exception(errors[r]);
+		}
+	}
+
+	/// Call func(i) for each i in [0, count), a range of at least grain per thread
+	template <typename F>
+	static void forEach(size_t count, size_t grain, F func)
+	{
+		forRange(count, grain, [&func](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				func(i);
+		});
+	}
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_PositionHash.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_PositionHash__
+#define __HoudiniOgre_PositionHash__
+
+#include "HoudiniOgre_Prerequisites.h"
+
+/** Hashing of positions for the tables which find coincident vertices
+	(welding, shared edges), so every table buckets the same way. */
+struct HoudiniOgre_PositionHash
+{
+	/// Hash of a position's exact bit pattern
+	static size_t hash(const Ogre::Vector3& position)
+	{
+		const Ogre::uint32* bits = reinterpret_cast<const Ogre::uint32*>(&position.x);
+		return bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u;
+	}
+};
+
+#endif
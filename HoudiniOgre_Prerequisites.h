@@ -25,8 +25,7 @@ This file is part of HoudiniOgre
 #ifndef __HoudiniOgre_Prerequisites_H__
 #define __HoudiniOgre_Prerequisites_H__
 // Things that all classes need
-#include <UT/UT_Vector4.h>
-
+// NB no Houdini headers here, the mesh pipeline must build without them
 #include "OgreColourValue.h"
 #include "OgreString.h"
 
@@ -39,23 +39,41 @@ This file is part of HoudiniOgre
 #include <ROP/ROP_Error.h>
 #include <MOT/MOT_Director.h>
 #include <FS/FS_Info.h>
+#include <CH/CH_Manager.h>
 #include "OgreMemoryMacros.h"
 
 #include "HoudiniOgre_Mesh.h"
+#include "HoudiniOgre_GUDetailSource.h"
+#include "HoudiniOgre_Skeleton.h"
+#include "HoudiniOgre_Trace.h"
+#include "HoudiniOgre_ExportCache.h"
+#include "HoudiniOgre_MappedStore.h"
+#include "HoudiniOgre_SnapshotStore.h"
+#include "HoudiniOgre_InstanceManifest.h"
+#include "HoudiniOgre_RepeatedPieces.h"
+#include "HoudiniOgre_SubsetSource.h"
 #include "OgreStringConverter.h"
 
+#include <algorithm>
+#include <memory>
+
 
 
 //---------------------------------------------------------------------
 HoudiniOgre_ROP::HoudiniOgre_ROP(OP_Network *net, const char *name, OP_Operator *entry)
-: ROP_Node(net, name, entry), mLogMgr(0), mResMgr(0), mMeshMgr(0), mSkelMgr(0), mMatMgr(0), mBufMgr(0)
+: ROP_Node(net, name, entry), mLogMgr(0), mResMgr(0), mMeshMgr(0), mSkelMgr(0), mMatMgr(0), mBufMgr(0),
+  mExportCache(0), mMappedStore(0), mOutOfCoreBudget(0), mSnapshotStore(0)
 {
 
 }
 //---------------------------------------------------------------------
 HoudiniOgre_ROP::~HoudiniOgre_ROP()
 {
-
+	// in case a render failed before reaching endRender
+	cleanUpSingletons();
+	delete mExportCache;
+	delete mMappedStore;
+	delete mSnapshotStore;
 }
 //---------------------------------------------------------------------
 //---------------------------------------------------------------------
@@ -111,14 +129,49 @@ static PRM_Name exportModeParamName("exportMode", "Export Mode");
 static PRM_Name objectTransformsParamName("transformMode", "Bake Object Transforms");
 static PRM_Name generateTangentsName("genTangents", "Generate Tangents");
 static PRM_Name tangentsTypeName("tangentsType", "Tangent VertexElement");
+static PRM_Name tangentHandednessName("tangentHandedness", "Tangent Handedness in W");
 static PRM_Name generateEdgeListsName("genEdgeLists", "Generate Edge Lists");
 static PRM_Name ikSampleRateName("iksamplerate", "IK Sample Rate");
+static PRM_Name traceFileName("traceFile", "Trace File");
+static PRM_Name exportCacheName("exportCache", "Export Cache");
+static PRM_Name instancePiecesName("instancePieces", "Instance Repeated Pieces");
+static PRM_Name pieceToleranceName("pieceTolerance", "Piece Tolerance");
+static PRM_Name pieceMinCountName("pieceMinCount", "Minimum Piece Repeats");
+static PRM_Name chunkSizeName("chunkSize", "Merged Chunk Size");
+static PRM_Name hlodLevelsName("hlodLevels", "HLOD Levels");
+static PRM_Name hlodBudgetName("hlodBudget", "HLOD Triangle Budget");
+static PRM_Name hlodMaterialName("hlodMaterial", "HLOD Material");
+static PRM_Name weldToleranceName("weldTolerance", "Weld Tolerance");
+static PRM_Name weldNormalAngleName("weldNormalAngle", "Weld Normal Angle");
+static PRM_Name weldUVToleranceName("weldUVTolerance", "Weld UV Tolerance");
+static PRM_Name weldColourToleranceName("weldColourTolerance", "Weld Colour Tolerance");
+static PRM_Name removeDegeneratesName("removeDegenerates", "Remove Degenerate Triangles");
+static PRM_Name sharedVerticesName("sharedVertices", "Shared Vertex Data");
+static PRM_Name boundsSidecarName("boundsSidecar", "Bounds Sidecar");
+static PRM_Name bvhSidecarName("bvhSidecar", "BVH Sidecar");
+static PRM_Name depthMeshName("depthMesh", "Depth Mesh");
+static PRM_Name outOfCoreBudgetName("outOfCoreBudget", "Out Of Core Budget (MB)");
+static PRM_Name outOfCoreDirName("outOfCoreDir", "Out Of Core Folder");
+static PRM_Name snapshotDedupName("snapshotDedup", "Unchanged Snapshots");
+static PRM_Name vertexAnimationName("vertexAnimation", "Vertex Animation Textures");
 
 //static PRM_Default outputDefault(0.0, "$HIP/");
 static PRM_Default tangentsTypeDefault(0.0, "tangent");
 static PRM_Default exportModeDefault(0.0, "each");
 //static PRM_Default ikSampleRateDefault(5.0, "");
 static PRM_Default ikSampleRateDefault(0.0, "5");
+static PRM_Default pieceToleranceDefault(0.0, "0.001");
+static PRM_Default pieceMinCountDefault(0.0, "8");
+static PRM_Default chunkSizeDefault(0.0, "0");
+static PRM_Default hlodLevelsDefault(0.0, "0");
+static PRM_Default hlodBudgetDefault(0.0, "5000");
+static PRM_Default weldToleranceDefault(0.0, "0");
+static PRM_Default weldNormalAngleDefault(0.0, "1");
+static PRM_Default weldUVToleranceDefault(0.0, "0.0001");
+static PRM_Default weldColourToleranceDefault(0.0, "0.004");
+static PRM_Default outOfCoreBudgetDefault(0.0, "0");
+static PRM_Default snapshotDedupDefault(0.0, "off");
+static PRM_Default vertexAnimationDefault(0.0, "off");
 static PRM_Default selectedDefault(1.0);
 
 static PRM_Name tangentsChoices[] = { 
@@ -129,10 +182,25 @@ static PRM_Name tangentsChoices[] = {
 static PRM_Name exportModeChoices[] = { 
 	PRM_Name("each", "One Mesh Per Object"),
 	PRM_Name("all", "Single Merged Mesh"),
+	PRM_Name("instance", "Instanced Meshes"),
+	PRM_Name() // terminator
+};
+static PRM_Name snapshotDedupChoices[] = { 
+	PRM_Name("off", "Export Every Frame"),
+	PRM_Name("link", "Link To First Export"),
+	PRM_Name("manifest", "List In Frame Manifest"),
+	PRM_Name() // terminator
+};
+static PRM_Name vertexAnimationChoices[] = { 
+	PRM_Name("off", "Off"),
+	PRM_Name("half", "Half Float"),
+	PRM_Name("float", "Float"),
 	PRM_Name() // terminator
 };
 static PRM_ChoiceList tangentsTypeChoice(PRM_CHOICELIST_SINGLE, tangentsChoices);
 static PRM_ChoiceList exportModeChoice(PRM_CHOICELIST_SINGLE, exportModeChoices);
+static PRM_ChoiceList snapshotDedupChoice(PRM_CHOICELIST_SINGLE, snapshotDedupChoices);
+static PRM_ChoiceList vertexAnimationChoice(PRM_CHOICELIST_SINGLE, vertexAnimationChoices);
 
 static PRM_Range ikSampleRateRange(PRM_RANGE_UI, 1.0f, PRM_RANGE_UI, 100.0f);
 
@@ -143,9 +211,32 @@ static PRM_Template customTemplate[] = {
 	PRM_Template(PRM_TOGGLE, 1, &objectTransformsParamName, &selectedDefault),
 	PRM_Template(PRM_TOGGLE, 1, &generateTangentsName),
 	PRM_Template(PRM_STRING, 1, &tangentsTypeName, &tangentsTypeDefault, &tangentsTypeChoice),
+	PRM_Template(PRM_TOGGLE, 1, &tangentHandednessName),
 	PRM_Template(PRM_TOGGLE, 1, &generateEdgeListsName, &selectedDefault),
 	//PRM_Template(PRM_INT, 1, &ikSampleRateName, &ikSampleRateDefault, 0, &ikSampleRateRange),
 	PRM_Template(PRM_STRING, 1, &ikSampleRateName, &ikSampleRateDefault),
+	PRM_Template(PRM_FILE, 1, &traceFileName),
+	PRM_Template(PRM_FILE, 1, &exportCacheName),
+	PRM_Template(PRM_TOGGLE, 1, &instancePiecesName),
+	PRM_Template(PRM_STRING, 1, &pieceToleranceName, &pieceToleranceDefault),
+	PRM_Template(PRM_STRING, 1, &pieceMinCountName, &pieceMinCountDefault),
+	PRM_Template(PRM_STRING, 1, &chunkSizeName, &chunkSizeDefault),
+	PRM_Template(PRM_STRING, 1, &hlodLevelsName, &hlodLevelsDefault),
+	PRM_Template(PRM_STRING, 1, &hlodBudgetName, &hlodBudgetDefault),
+	PRM_Template(PRM_STRING, 1, &hlodMaterialName),
+	PRM_Template(PRM_STRING, 1, &weldToleranceName, &weldToleranceDefault),
+	PRM_Template(PRM_STRING, 1, &weldNormalAngleName, &weldNormalAngleDefault),
+	PRM_Template(PRM_STRING, 1, &weldUVToleranceName, &weldUVToleranceDefault),
+	PRM_Template(PRM_STRING, 1, &weldColourToleranceName, &weldColourToleranceDefault),
+	PRM_Template(PRM_TOGGLE, 1, &removeDegeneratesName, &selectedDefault),
+	PRM_Template(PRM_TOGGLE, 1, &sharedVerticesName),
+	PRM_Template(PRM_TOGGLE, 1, &boundsSidecarName),
+	PRM_Template(PRM_TOGGLE, 1, &bvhSidecarName),
+	PRM_Template(PRM_TOGGLE, 1, &depthMeshName),
+	PRM_Template(PRM_STRING, 1, &outOfCoreBudgetName, &outOfCoreBudgetDefault),
+	PRM_Template(PRM_FILE, 1, &outOfCoreDirName),
+	PRM_Template(PRM_STRING, 1, &snapshotDedupName, &snapshotDedupDefault, &snapshotDedupChoice),
+	PRM_Template(PRM_STRING, 1, &vertexAnimationName, &vertexAnimationDefault, &vertexAnimationChoice),
 
 	PRM_Template() }; 
 	//---------------------------------------------------------------------
@@ -193,6 +284,68 @@ static PRM_Template customTemplate[] = {
 		if (!extractParams())
 			return 0;
 
+		// Optional timeline of the export
+		if (mTraceFile != "")
+		{
+			UT_String expandedTrace;
+			OPgetDirector()->getChannelManager()->expandString(mTraceFile, expandedTrace, tStart);
+			mLogMgr->logMessage("Recording trace to: " + Ogre::String(expandedTrace));
+			HoudiniOgre_Trace::start(Ogre::String(expandedTrace));
+		}
+
+		// Optional cache of previous exports
+		delete mExportCache;
+		mExportCache = 0;
+		if (mExportCacheDir != "")
+		{
+			UT_String expandedCache;
+			OPgetDirector()->getChannelManager()->expandString(mExportCacheDir, expandedCache, tStart);
+			mLogMgr->logMessage("Using export cache: " + Ogre::String(expandedCache));
+			mExportCache = new HoudiniOgre_ExportCache(Ogre::String(expandedCache));
+		}
+
+		// Optional out-of-core storage for a merged mesh too big for memory
+		delete mMappedStore;
+		mMappedStore = 0;
+		if (mOutOfCoreBudget && !mExportMeshPerObject)
+		{
+			UT_String expandedDir;
+			OPgetDirector()->getChannelManager()->expandString(mOutOfCoreDir, expandedDir, tStart);
+			mMappedStore = new HoudiniOgre_MappedStore(Ogre::String(expandedDir), mOutOfCoreBudget);
+			mLogMgr->logMessage("Out of core, with a budget of " + 
+				Ogre::StringConverter::toString(mOutOfCoreBudget >> 20) + "MB");
+		}
+		mBufMgr->setStore(mMappedStore);
+
+		// Optional reuse of unchanged exports between snapshots
+		delete mSnapshotStore;
+		mSnapshotStore = 0;
+		if (mSnapshotPerFrame && mSnapshotDedup)
+		{
+			mSnapshotStore = new HoudiniOgre_SnapshotStore(mSnapshotLinks ? 
+				HoudiniOgre_SnapshotStore::MODE_LINK : HoudiniOgre_SnapshotStore::MODE_MANIFEST);
+
+			// The manifest goes alongside the first frame's files
+			UT_String expandedOutput;
+			OPgetDirector()->getChannelManager()->expandString(mOutputPath, expandedOutput, tStart);
+			mSnapshotManifest = Ogre::String(expandedOutput);
+			FS_Info outputInfo(expandedOutput);
+			if (outputInfo.getIsDirectory())
+			{
+				if (!Ogre::StringUtil::endsWith(mSnapshotManifest, "/"))
+				{
+					mSnapshotManifest += "/";
+				}
+			}
+			else
+			{
+				Ogre::String::size_type slash = mSnapshotManifest.find_last_of('/');
+				mSnapshotManifest = slash == Ogre::String::npos ? 
+					Ogre::StringUtil::BLANK : mSnapshotManifest.substr(0, slash + 1);
+			}
+			mSnapshotManifest += getHipBaseName() + ".frames.xml";
+		}
+
 		// Derive FPS
 		mFps = (float)(nFrames-1) / (tEnd - tStart);
 
@@ -237,10 +390,18 @@ static PRM_Template customTemplate[] = {
 		if (exportMode == "each")
 		{
 			mExportMeshPerObject = true;
+			mInstanceObjects = false;
+		}
+		else if (exportMode == "instance")
+		{
+			// still one mesh per object, but only one per unique object
+			mExportMeshPerObject = true;
+			mInstanceObjects = true;
 		}
 		else
 		{
 			mExportMeshPerObject = false;
+			mInstanceObjects = false;
 		}
 
 		PRM_Parm& objectTransformsParm = this->getParm(objectTransformsParamName.getToken());
@@ -265,6 +426,11 @@ static PRM_Template customTemplate[] = {
 			mTangentsSemantic = Ogre::VES_TEXTURE_COORDINATES;
 		}
 
+		PRM_Parm& tangentHandednessParm = this->getParm(tangentHandednessName.getToken());
+		int tangentHandedness;
+		tangentHandednessParm.getValue(0, tangentHandedness, 0);
+		mTangentHandedness = tangentHandedness != 0;
+
 		PRM_Parm& genEdgeListsParm = this->getParm(generateEdgeListsName.getToken());
 		int genEdgeLists;
 		genEdgeListsParm.getValue(0, genEdgeLists, 0);
@@ -281,6 +447,137 @@ static PRM_Template customTemplate[] = {
 			mIkSampleRate = 5.0f;
 		}
 
+		PRM_Parm& traceFileParm = this->getParm(traceFileName.getToken());
+		traceFileParm.getValue(0, mTraceFile, 0, 0);
+
+		PRM_Parm& exportCacheParm = this->getParm(exportCacheName.getToken());
+		exportCacheParm.getValue(0, mExportCacheDir, 0, 0);
+
+		PRM_Parm& instancePiecesParm = this->getParm(instancePiecesName.getToken());
+		int instancePieces;
+		instancePiecesParm.getValue(0, instancePieces, 0);
+		mInstancePieces = instancePieces != 0;
+
+		// string fallbacks again, as for the IK sample rate
+		PRM_Parm& pieceToleranceParm = this->getParm(pieceToleranceName.getToken());
+		UT_String pieceTolerance;
+		pieceToleranceParm.getValue(0, pieceTolerance, 0, 0);
+		mPieceTolerance = Ogre::StringConverter::parseReal(Ogre::String(pieceTolerance));
+
+		PRM_Parm& pieceMinCountParm = this->getParm(pieceMinCountName.getToken());
+		UT_String pieceMinCount;
+		pieceMinCountParm.getValue(0, pieceMinCount, 0, 0);
+		mPieceMinCount = std::max(2, Ogre::StringConverter::parseInt(Ogre::String(pieceMinCount)));
+
+		PRM_Parm& chunkSizeParm = this->getParm(chunkSizeName.getToken());
+		UT_String chunkSize;
+		chunkSizeParm.getValue(0, chunkSize, 0, 0);
+		mChunkSize = std::max(0.0f, Ogre::StringConverter::parseReal(Ogre::String(chunkSize)));
+
+		PRM_Parm& hlodLevelsParm = this->getParm(hlodLevelsName.getToken());
+		UT_String hlodLevels;
+		hlodLevelsParm.getValue(0, hlodLevels, 0, 0);
+		mHLODLevels = std::max(0, Ogre::StringConverter::parseInt(Ogre::String(hlodLevels)));
+
+		PRM_Parm& hlodBudgetParm = this->getParm(hlodBudgetName.getToken());
+		UT_String hlodBudget;
+		hlodBudgetParm.getValue(0, hlodBudget, 0, 0);
+		mHLODTriangleBudget = std::max(1, Ogre::StringConverter::parseInt(Ogre::String(hlodBudget)));
+
+		PRM_Parm& hlodMaterialParm = this->getParm(hlodMaterialName.getToken());
+		hlodMaterialParm.getValue(0, mHLODMaterial, 0, 0);
+
+		if (mHLODLevels && (mExportMeshPerObject || mChunkSize <= 0))
+		{
+			addWarning(ROP_MESSAGE, "HLOD Levels needs a Single Merged Mesh with a Merged Chunk Size, no HLODs will be built");
+		}
+
+		PRM_Parm& weldToleranceParm = this->getParm(weldToleranceName.getToken());
+		UT_String weldTolerance;
+		weldToleranceParm.getValue(0, weldTolerance, 0, 0);
+		mWeldTolerance = std::max(0.0f, Ogre::StringConverter::parseReal(Ogre::String(weldTolerance)));
+
+		PRM_Parm& weldNormalAngleParm = this->getParm(weldNormalAngleName.getToken());
+		UT_String weldNormalAngle;
+		weldNormalAngleParm.getValue(0, weldNormalAngle, 0, 0);
+		mWeldNormalAngle = std::max(0.0f, Ogre::StringConverter::parseReal(Ogre::String(weldNormalAngle)));
+
+		PRM_Parm& weldUVToleranceParm = this->getParm(weldUVToleranceName.getToken());
+		UT_String weldUVTolerance;
+		weldUVToleranceParm.getValue(0, weldUVTolerance, 0, 0);
+		mWeldUVTolerance = std::max(0.0f, Ogre::StringConverter::parseReal(Ogre::String(weldUVTolerance)));
+
+		PRM_Parm& weldColourToleranceParm = this->getParm(weldColourToleranceName.getToken());
+		UT_String weldColourTolerance;
+		weldColourToleranceParm.getValue(0, weldColourTolerance, 0, 0);
+		mWeldColourTolerance = std::max(0.0f, Ogre::StringConverter::parseReal(Ogre::String(weldColourTolerance)));
+
+		PRM_Parm& removeDegeneratesParm = this->getParm(removeDegeneratesName.getToken());
+		int removeDegenerates;
+		removeDegeneratesParm.getValue(0, removeDegenerates, 0);
+		mRemoveDegenerates = removeDegenerates != 0;
+
+		PRM_Parm& sharedVerticesParm = this->getParm(sharedVerticesName.getToken());
+		int sharedVertices;
+		sharedVerticesParm.getValue(0, sharedVertices, 0);
+		mSharedVertices = sharedVertices != 0;
+
+		PRM_Parm& boundsSidecarParm = this->getParm(boundsSidecarName.getToken());
+		int boundsSidecar;
+		boundsSidecarParm.getValue(0, boundsSidecar, 0);
+		mBoundsSidecar = boundsSidecar != 0;
+
+		PRM_Parm& bvhSidecarParm = this->getParm(bvhSidecarName.getToken());
+		int bvhSidecar;
+		bvhSidecarParm.getValue(0, bvhSidecar, 0);
+		mBVHSidecar = bvhSidecar != 0;
+
+		PRM_Parm& depthMeshParm = this->getParm(depthMeshName.getToken());
+		int depthMesh;
+		depthMeshParm.getValue(0, depthMesh, 0);
+		mDepthMesh = depthMesh != 0;
+
+		PRM_Parm& outOfCoreBudgetParm = this->getParm(outOfCoreBudgetName.getToken());
+		UT_String outOfCoreBudget;
+		outOfCoreBudgetParm.getValue(0, outOfCoreBudget, 0, 0);
+		mOutOfCoreBudget = static_cast<size_t>(std::max(0.0f, 
+			Ogre::StringConverter::parseReal(Ogre::String(outOfCoreBudget)))) << 20;
+
+		PRM_Parm& outOfCoreDirParm = this->getParm(outOfCoreDirName.getToken());
+		outOfCoreDirParm.getValue(0, mOutOfCoreDir, 0, 0);
+
+		if (mOutOfCoreBudget && mExportMeshPerObject)
+		{
+			addWarning(ROP_MESSAGE, "Out Of Core Budget only applies to a Single Merged Mesh, everything will be kept in memory");
+		}
+
+		PRM_Parm& snapshotDedupParm = this->getParm(snapshotDedupName.getToken());
+		UT_String snapshotDedup;
+		snapshotDedupParm.getValue(0, snapshotDedup, 0, 0);
+		mSnapshotDedup = snapshotDedup != "off";
+		mSnapshotLinks = snapshotDedup == "link";
+
+		PRM_Parm& vertexAnimationParm = this->getParm(vertexAnimationName.getToken());
+		UT_String vertexAnimation;
+		vertexAnimationParm.getValue(0, vertexAnimation, 0, 0);
+		mVertexAnimation = vertexAnimation != "off";
+		mVertexAnimationHalf = vertexAnimation == "half";
+
+		if (mVertexAnimation && mSnapshotPerFrame)
+		{
+			addWarning(ROP_MESSAGE, "Vertex Animation Textures replace per-frame ($F) snapshots, no textures will be written");
+			mVertexAnimation = false;
+		}
+		if (mVertexAnimation && mDepthMesh)
+		{
+			addWarning(ROP_MESSAGE, "A Depth Mesh can't follow Vertex Animation Textures, it won't be written");
+			mDepthMesh = false;
+		}
+		if (mVertexAnimation && !mExportMeshPerObject && mChunkSize > 0)
+		{
+			addWarning(ROP_MESSAGE, "Merged Chunk Size is ignored with Vertex Animation Textures, the mesh won't be split");
+		}
+
 		return 1;
 
 	}
@@ -299,11 +596,56 @@ static PRM_Template customTemplate[] = {
 		// for outputpath containing spaces (such as Windows desktop), log to check that Houdini isn't adding surrounding quotes (DEE)
 		Ogre::LogManager::getSingleton().logMessage("Expanded Output (Houdini): " + Ogre::String(expandedOutput));
 
+		long frame = static_cast<long>(OPgetDirector()->getChannelManager()->getSample(t));
+		HoudiniOgre_TraceSpan span("exportGeometries", expandedOutput, "frame", frame);
+		span.addArg("frames", numFrames);
+		if (mSnapshotStore)
+		{
+			mSnapshotStore->setFrame(frame);
+		}
 
 		try
 		{
 
 			HoudiniOgre_Mesh mesh;
+			mesh.setWeld(mWeldTolerance, Ogre::Degree(mWeldNormalAngle), 
+				mWeldUVTolerance, mWeldColourTolerance);
+			mesh.setRemoveDegenerates(mRemoveDegenerates);
+			mesh.setSharedVertices(mSharedVertices);
+			mesh.setTangentHandedness(mTangentHandedness);
+			mesh.setSidecars(mBoundsSidecar, mBVHSidecar);
+			mesh.setDepthMesh(mDepthMesh);
+			mesh.setVertexAnimation(mVertexAnimation, mVertexAnimationHalf);
+			if (!mExportMeshPerObject)
+			{
+				mesh.setChunkSize(mChunkSize);
+				mesh.setHLOD(mHLODLevels, mHLODTriangleBudget, Ogre::String(mHLODMaterial));
+				mesh.setOutOfCore(mMappedStore);
+			}
+
+			// When merging with a cache, all the geometry has to be hashed
+			// before we know whether the mesh needs building at all; only 
+			// the objects are kept, and read again if it does
+			std::vector<OP_Node*> mergedObjects;
+			HoudiniOgre_Hash mergedKey;
+			// (the key only covers the current frame, not vertex animation's)
+			bool mergedCacheable = mExportCache != 0 && !mVertexAnimation;
+			bool mergedSkinned = false;
+			if (mExportCache || mSnapshotStore)
+			{
+				mergedKey = createCacheKey(snapshotting, mObjectTransforms);
+			}
+
+			// Per-object files are named by appending to the output path
+			Ogre::String objectPrefix(expandedOutput);  // verified no surrounding quotes (DEE)
+			FS_Info outputInfo(expandedOutput);
+			if (outputInfo.getIsDirectory() && !Ogre::StringUtil::endsWith(objectPrefix, "/"))
+			{
+				objectPrefix += "/";
+			}
+
+			// Objects sharing geometry share a mesh when instancing
+			HoudiniOgre_InstanceManifest instances;
 
 			// We want all object instances
 			OP_Node* objectsNode = OPgetDirector()->getChild("obj");
@@ -323,34 +665,94 @@ static PRM_Template customTemplate[] = {
 					if (geo && geo->getDisplay() == 1)
 					{
 						Ogre::LogManager::getSingleton().logMessage("Parsing geo: " + Ogre::String(childObj->getName()));
-						mesh.addGeometry(childObj, snapshotting, t, mObjectTransforms, 
-							numFrames, frameStart, mFps, mIkSampleRate);
+						std::unique_ptr<HoudiniOgre_GUDetailSource> source(
+							new HoudiniOgre_GUDetailSource(childObj, t));
 
-						// If we're exporting each object...
-						if (mExportMeshPerObject)
+						// Split off repeated pieces, the rest of the object carries on as usual
+						const HoudiniOgre_GeometrySource* objectSource = source.get();
+						std::unique_ptr<HoudiniOgre_GeometrySource> remainder;
+						if (mExportMeshPerObject && mInstancePieces && 
+							!source->getCaptureRegionCount() && !mVertexAnimation)
 						{
-							Ogre::String filename(expandedOutput);  // verified no surrounding quotes (DEE)
-							FS_Info fsinfo(expandedOutput);
-
-							if (fsinfo.getIsDirectory())
+							Ogre::Matrix4 xform = Ogre::Matrix4::IDENTITY;
+							if (mInstanceObjects || mObjectTransforms)
+							{
+								Ogre::Matrix3 rot;
+								source->getWorldTransform(xform, rot);
+							}
+							remainder.reset(exportRepeatedPieces(mesh, *source, objectPrefix, 
+								xform, instances, snapshotting, numFrames, frameStart));
+							if (remainder.get())
 							{
-								if (!Ogre::StringUtil::endsWith(filename, "/"))
+								if (!remainder->getPrimitiveCount())
 								{
-									filename += "/";
+									continue;
 								}
+								objectSource = remainder.get();
 							}
-							filename += childObj->getName();
-							filename += ".mesh";
+						}
 
-							mesh.Export(filename, mGenerateEdgeLists, 
-								mGenerateTangents, mTangentsSemantic, 
-								numFrames, frameStart, mFps, mIkSampleRate);
+						// If we're instancing objects...
+						if (mInstanceObjects)
+						{
+							HoudiniOgre_Hash fingerprint;
+							fingerprint.addLocalGeometry(*objectSource);
+							// skinned or vertex animated objects move in their own way,
+							// never share them
+							if (objectSource->getCaptureRegionCount() || mVertexAnimation)
+							{
+								fingerprint.add(objectSource->getName());
+							}
+
+							// the first object with this geometry names the mesh
+							if (!instances.findMesh(fingerprint.getValue()))
+							{
+								Ogre::String meshName = Ogre::String(childObj->getName()) + ".mesh";
+								exportObject(mesh, *objectSource, objectPrefix + meshName, 
+									snapshotting, false, numFrames, frameStart);
+								instances.addMesh(fingerprint.getValue(), meshName);
+							}
+							Ogre::Matrix4 xform;
+							Ogre::Matrix3 rot;
+							objectSource->getWorldTransform(xform, rot);
+							instances.addInstance(fingerprint.getValue(), objectSource->getName(), xform);
+						}
+						// If we're exporting each object...
+						else if (mExportMeshPerObject)
+						{
+							Ogre::String filename = objectPrefix + childObj->getName() + ".mesh";
+							exportObject(mesh, *objectSource, filename, snapshotting, mObjectTransforms, 
+								numFrames, frameStart);
+						}
+						else if (mExportCache || mSnapshotStore)
+						{
+							mergedCacheable = mergedCacheable && 
+								HoudiniOgre_ExportCache::isCacheable(*source);
+							mergedKey.addGeometry(*source, mObjectTransforms);
+							if (source->getCaptureRegionCount())
+							{
+								// (never cached, this only matters to snapshots)
+								mergedKey.addCapture(*source);
+								mergedSkinned = true;
+							}
+							mergedObjects.push_back(childObj);
+						}
+						else
+						{
+							source->releaseGeometry();
+							mesh.addGeometry(*source, snapshotting, mObjectTransforms, 
+								numFrames, frameStart, mFps);
 						}
 					}
 
 				}
 			}
 
+			if (mInstanceObjects || instances.getInstanceCount())
+			{
+				instances.save(objectPrefix + getHipBaseName() + ".instances.xml");
+			}
+
 			// Exporting for the entire scene?
 			if (!mExportMeshPerObject)
 			{
@@ -365,33 +767,55 @@ static PRM_Template customTemplate[] = {
 						filename += "/";
 					}
 					// add the basename of the .hip
-					MOT_Director *mot = dynamic_cast<MOT_Director *>(OPgetDirector());
-					// UT_PathFile / UT_PathFileInfo are undocumented and don't seem to give me the
-					// base name without the path easily, just do it with strings
-					Ogre::String hipFile(mot->getFileName());
-					Ogre::String::size_type spos = hipFile.find_last_of('/');
-					if (spos != Ogre::String::npos)
+					filename += getHipBaseName();
+				}
+				if (!Ogre::StringUtil::endsWith(filename, ".mesh"))
+				{
+					filename += ".mesh";
+				}
+
+				// HLOD meshes aren't cached, so the whole lot has to be exported
+				bool hlod = mHLODLevels && mChunkSize > 0;
+				bool cacheable = mergedCacheable && !mergedObjects.empty() && !hlod;
+				bool dedup = mSnapshotStore && !mergedObjects.empty() && !hlod;
+				std::vector<Ogre::String> files;
+				getExportedFiles(filename, files);
+				std::vector<Ogre::String> snapshotFiles;
+				if (dedup)
+				{
+					getSnapshotFiles(filename, mergedSkinned, snapshotFiles);
+					if (mSnapshotStore->reuse(mergedKey, snapshotFiles))
 					{
-						hipFile = hipFile.substr(spos+1);
+						return 1;
 					}
-					if (Ogre::StringUtil::endsWith(hipFile, ".hip"))
+				}
+				if (!cacheable || !mExportCache->retrieve(mergedKey, files))
+				{
+					for (size_t o = 0; o < mergedObjects.size(); ++o)
 					{
-						hipFile = hipFile.substr(0, hipFile.size() - 4);
+						HoudiniOgre_GUDetailSource source(mergedObjects[o], t);
+						source.releaseGeometry();
+						mesh.addGeometry(source, snapshotting, mObjectTransforms, 
+							numFrames, frameStart, mFps);
+					}
+
+					exportMesh(mesh, filename);
+
+					if (cacheable)
+					{
+						mExportCache->store(mergedKey, files);
 					}
-					filename += hipFile;
 				}
-				if (!Ogre::StringUtil::endsWith(filename, ".mesh"))
+				if (dedup)
 				{
-					filename += ".mesh";
+					mSnapshotStore->store(mergedKey, snapshotFiles);
 				}
-				mesh.Export(filename, mGenerateEdgeLists, mGenerateTangents, mTangentsSemantic, 
-					numFrames, frameStart, mFps, mIkSampleRate);
 			}
 		}
 		catch (Ogre::Exception& e)
 		{
+			// the singletons stay for endRender, which still logs through them
 			addError(ROP_RENDER_ERROR, e.getFullDescription().c_str());
-			cleanUpSingletons();
 
 			return 0;
 		}
@@ -400,6 +824,201 @@ static PRM_Template customTemplate[] = {
 
 	}
 	//---------------------------------------------------------------------
+	void HoudiniOgre_ROP::exportObject(HoudiniOgre_Mesh& mesh, 
+		const HoudiniOgre_GeometrySource& source, const Ogre::String& filename, 
+		bool snapshotting, bool useObjectTransforms, int numFrames, int frameStart)
+	{
+		HoudiniOgre_Hash key;
+		bool cacheable = mExportCache && !mVertexAnimation &&
+			HoudiniOgre_ExportCache::isCacheable(source);
+		std::vector<Ogre::String> files;
+		getExportedFiles(filename, files);
+		if (cacheable || mSnapshotStore)
+		{
+			key = createCacheKey(snapshotting, useObjectTransforms);
+			key.addGeometry(source, useObjectTransforms);
+		}
+
+		// An unchanged snapshot needn't even come out of the cache
+		HoudiniOgre_Hash snapshotKey(key);
+		std::vector<Ogre::String> snapshotFiles;
+		if (mSnapshotStore)
+		{
+			bool skinned = source.getCaptureRegionCount() != 0;
+			if (skinned)
+			{
+				snapshotKey.addCapture(source);
+			}
+			getSnapshotFiles(filename, skinned, snapshotFiles);
+			if (mSnapshotStore->reuse(snapshotKey, snapshotFiles))
+			{
+				return;
+			}
+		}
+
+		if (!cacheable || !mExportCache->retrieve(key, files))
+		{
+			mesh.addGeometry(source, snapshotting, useObjectTransforms, 
+				numFrames, frameStart, mFps);
+			exportMesh(mesh, filename);
+
+			if (cacheable)
+			{
+				mExportCache->store(key, files);
+			}
+		}
+
+		if (mSnapshotStore)
+		{
+			mSnapshotStore->store(snapshotKey, snapshotFiles);
+		}
+	}
+	//---------------------------------------------------------------------
+	void HoudiniOgre_ROP::getExportedFiles(const Ogre::String& filename, 
+		std::vector<Ogre::String>& files) const
+	{
+		Ogre::String base = filename.substr(0, filename.size() - 5);
+		files.push_back(filename);
+		if (!mExportMeshPerObject && mChunkSize > 0)
+		{
+			files.push_back(base + ".chunks.xml");
+		}
+		if (mBoundsSidecar)
+		{
+			files.push_back(base + ".bounds.xml");
+		}
+		if (mBVHSidecar)
+		{
+			files.push_back(base + ".bvh");
+		}
+		if (mDepthMesh)
+		{
+			files.push_back(base + ".depth.mesh");
+		}
+	}
+	//---------------------------------------------------------------------
+	void HoudiniOgre_ROP::getSnapshotFiles(const Ogre::String& filename, bool skinned,
+		std::vector<Ogre::String>& files) const
+	{
+		getExportedFiles(filename, files);
+		if (skinned)
+		{
+			// as exportMesh names it
+			files.push_back(filename.substr(0, filename.size() - 4) + "skeleton");
+		}
+	}
+	//---------------------------------------------------------------------
+	HoudiniOgre_GeometrySource* HoudiniOgre_ROP::exportRepeatedPieces(HoudiniOgre_Mesh& mesh, 
+		const HoudiniOgre_GeometrySource& source, const Ogre::String& prefix, 
+		const Ogre::Matrix4& xform, HoudiniOgre_InstanceManifest& instances, 
+		bool snapshotting, int numFrames, int frameStart)
+	{
+		HoudiniOgre_RepeatedPieces pieces(source, mPieceTolerance, mPieceMinCount);
+		const HoudiniOgre_RepeatedPieces::PieceGroupList& groups = pieces.getGroups();
+		if (groups.empty())
+		{
+			return 0;
+		}
+
+		for (size_t g = 0; g < groups.size(); ++g)
+		{
+			const HoudiniOgre_RepeatedPieces::PieceGroup& group = groups[g];
+			Ogre::String pieceName = source.getName() + "_piece" + 
+				Ogre::StringConverter::toString(g);
+			// the first piece, moved to its canonical frame
+			HoudiniOgre_SubsetSource base(source, pieceName, group.basePrimitives, 
+				group.baseInverse);
+
+			// identical pieces in other objects can share the mesh
+			HoudiniOgre_Hash fingerprint;
+			fingerprint.addLocalGeometry(base);
+			if (!instances.findMesh(fingerprint.getValue()))
+			{
+				exportObject(mesh, base, prefix + pieceName + ".mesh", 
+					snapshotting, false, numFrames, frameStart);
+				instances.addMesh(fingerprint.getValue(), pieceName + ".mesh");
+			}
+			for (std::vector<Ogre::Matrix4>::const_iterator i = group.transforms.begin();
+				i != group.transforms.end(); ++i)
+			{
+				instances.addInstance(fingerprint.getValue(), pieceName, xform * (*i));
+			}
+		}
+
+		return new HoudiniOgre_SubsetSource(source, source.getName(), pieces.getRemainder());
+	}
+	//---------------------------------------------------------------------
+	Ogre::String HoudiniOgre_ROP::getHipBaseName() const
+	{
+		MOT_Director *mot = dynamic_cast<MOT_Director *>(OPgetDirector());
+		// UT_PathFile / UT_PathFileInfo are undocumented and don't seem to give me the
+		// base name without the path easily, just do it with strings
+		Ogre::String hipFile(mot->getFileName());
+		Ogre::String::size_type spos = hipFile.find_last_of('/');
+		if (spos != Ogre::String::npos)
+		{
+			hipFile = hipFile.substr(spos+1);
+		}
+		if (Ogre::StringUtil::endsWith(hipFile, ".hip"))
+		{
+			hipFile = hipFile.substr(0, hipFile.size() - 4);
+		}
+		return hipFile;
+	}
+	//---------------------------------------------------------------------
+	HoudiniOgre_Hash HoudiniOgre_ROP::createCacheKey(bool snapshotting, 
+		bool useObjectTransforms) const
+	{
+		// Everything other than the geometry which changes what's written
+		HoudiniOgre_Hash key = HoudiniOgre_ExportCache::createKey();
+		key.add(snapshotting);
+		key.add(useObjectTransforms);
+		key.add(mGenerateEdgeLists);
+		key.add(mGenerateTangents);
+		key.add(static_cast<int>(mTangentsSemantic));
+		key.add(mTangentHandedness);
+		key.add(mExportMeshPerObject ? 0.0f : mChunkSize);
+		key.add(mWeldTolerance);
+		if (mWeldTolerance > 0)
+		{
+			key.add(mWeldNormalAngle);
+			key.add(mWeldUVTolerance);
+			key.add(mWeldColourTolerance);
+		}
+		key.add(mRemoveDegenerates);
+		key.add(mSharedVertices);
+		return key;
+	}
+	//---------------------------------------------------------------------
+	void HoudiniOgre_ROP::exportMesh(HoudiniOgre_Mesh& mesh, const Ogre::String& filename)
+	{
+		Ogre::String skeletonName;
+
+		// Set up skeleton and link
+		if (!mesh.getBoneList().empty())
+		{
+			// strip off 'mesh', replace with 'skeleton'
+			Ogre::String skeletonFileName = filename.substr(0, filename.size() - 4) + "skeleton";
+
+			HoudiniOgre_Skeleton skel(mesh.getBoneList());
+			skel.Export(skeletonFileName, mFps, mIkSampleRate, mesh.getAnimationList());
+
+			// Now trim the skeleton file name down to just filename
+			Ogre::String::size_type startPos = skeletonFileName.rfind('/');
+			if (startPos == Ogre::String::npos)
+			{
+				skeletonName = skeletonFileName;
+			}
+			else
+			{
+				skeletonName = skeletonFileName.substr(startPos + 1);
+			}
+		}
+
+		mesh.Export(filename, skeletonName, mGenerateEdgeLists, 
+			mGenerateTangents, mTangentsSemantic);
+	}
+	//---------------------------------------------------------------------
 	ROP_RENDER_CODE HoudiniOgre_ROP::renderFrame(float t, UT_Interrupt*)
 	{
 		// If we're exporting per-frame...
@@ -416,7 +1035,39 @@ static PRM_Template customTemplate[] = {
 	//---------------------------------------------------------------------
 	ROP_RENDER_CODE HoudiniOgre_ROP::endRender()
 	{
+		if (HoudiniOgre_Trace::isEnabled() && !HoudiniOgre_Trace::stop())
+		{
+			addWarning(ROP_MESSAGE, "Unable to write the trace file");
+		}
+
+		if (mExportCache)
+		{
+			Ogre::StringUtil::StrStreamType msg;
+			msg << "Export cache: " << mExportCache->getHits() << " reused, "
+				<< mExportCache->getMisses() << " exported";
+			mLogMgr->logMessage(msg.str());
+		}
+
+		// Saving logs through the LogManager, so this has to come before the
+		// singletons go, even when a frame failed
+		if (mSnapshotStore)
+		{
+			try
+			{
+				mSnapshotStore->save(mSnapshotManifest);
+			}
+			catch (Ogre::Exception& e)
+			{
+				addWarning(ROP_MESSAGE, e.getFullDescription().c_str());
+			}
+			delete mSnapshotStore;
+			mSnapshotStore = 0;
+		}
+
 		cleanUpSingletons();
+		// after the buffers it holds have gone with the meshes
+		delete mMappedStore;
+		mMappedStore = 0;
 
 		return ROP_CONTINUE_RENDER;
 	}
@@ -434,7 +1085,7 @@ static PRM_Template customTemplate[] = {
 		if (!mMatMgr)
 			mMatMgr = new Ogre::MaterialManager();
 		if (!mBufMgr)
-			mBufMgr = new Ogre::DefaultHardwareBufferManager();
+			mBufMgr = new HoudiniOgre_MappedBufferManager();
 
 	}
 	//---------------------------------------------------------------------
@@ -44,6 +44,14 @@ class OP_OperatorTable;
 class OP_Operator;
 class PRM_TemplatePair;
 class IFD_RenderDefinition;
+class HoudiniOgre_Mesh;
+class HoudiniOgre_Hash;
+class HoudiniOgre_GeometrySource;
+class HoudiniOgre_InstanceManifest;
+class HoudiniOgre_ExportCache;
+class HoudiniOgre_MappedStore;
+class HoudiniOgre_MappedBufferManager;
+class HoudiniOgre_SnapshotStore;
 
 
 
@@ -84,6 +92,34 @@ protected:
 
 	int extractParams();
 	int exportGeometries(float t, bool snapshotting, int numFrames = 1, int frameStart = 0);
+	/// Export a mesh, and the skeleton it uses if it has bones
+	void exportMesh(HoudiniOgre_Mesh& mesh, const Ogre::String& filename);
+	/** Export one object to its own mesh, or copy it out of the export
+		cache if it hasn't changed. */
+	void exportObject(HoudiniOgre_Mesh& mesh, const HoudiniOgre_GeometrySource& source, 
+		const Ogre::String& filename, bool snapshotting, bool useObjectTransforms, 
+		int numFrames, int frameStart);
+	/** Export the pieces repeated within an object once each, adding their
+		copies to the instance manifest (transformed by xform).
+	@returns The rest of the object (to be deleted by the caller), or 0 
+		if there were no repeated pieces
+	*/
+	HoudiniOgre_GeometrySource* exportRepeatedPieces(HoudiniOgre_Mesh& mesh, 
+		const HoudiniOgre_GeometrySource& source, const Ogre::String& prefix, 
+		const Ogre::Matrix4& xform, HoudiniOgre_InstanceManifest& instances, 
+		bool snapshotting, int numFrames, int frameStart);
+	/** The files an export to the mesh filename writes (besides any
+		skeleton), which go in and out of the export cache together. */
+	void getExportedFiles(const Ogre::String& filename, 
+		std::vector<Ogre::String>& files) const;
+	/** The files a snapshot reuses together: the exported files plus the
+		skeleton, if the mesh is skinned. */
+	void getSnapshotFiles(const Ogre::String& filename, bool skinned,
+		std::vector<Ogre::String>& files) const;
+	/// Name of the .hip file without folder or extension
+	Ogre::String getHipBaseName() const;
+	/// Start an export cache key with the options affecting the output
+	HoudiniOgre_Hash createCacheKey(bool snapshotting, bool useObjectTransforms) const;
 	void createSingletons();
 	void cleanUpSingletons();
 
@@ -93,14 +129,59 @@ protected:
 	Ogre::MeshManager* mMeshMgr;	
 	Ogre::SkeletonManager* mSkelMgr;	
 	Ogre::MaterialManager* mMatMgr;	
-	Ogre::DefaultHardwareBufferManager* mBufMgr;
+	HoudiniOgre_MappedBufferManager* mBufMgr;
 
 	UT_String mOutputPath;
+	UT_String mTraceFile;
+	UT_String mExportCacheDir;
+	/// Cache of previous exports, if enabled
+	HoudiniOgre_ExportCache* mExportCache;
+	/// Out-of-core storage for the merged mesh, if enabled
+	HoudiniOgre_MappedStore* mMappedStore;
+	UT_String mOutOfCoreDir;
+	/// In bytes, 0 to keep everything in memory
+	size_t mOutOfCoreBudget;
+	/// Reuse unchanged exports between $F snapshots, if enabled
+	HoudiniOgre_SnapshotStore* mSnapshotStore;
+	bool mSnapshotDedup;
+	/// Link repeated snapshots' files rather than only listing them
+	bool mSnapshotLinks;
+	Ogre::String mSnapshotManifest;
 	bool mExportMeshPerObject;
+	/// Export each distinct object once, plus a manifest of where it's used
+	bool mInstanceObjects;
+	/// Export pieces repeated within an object as instances
+	bool mInstancePieces;
+	float mPieceTolerance;
+	int mPieceMinCount;
+	/// Grid cell size to split merged meshes by, 0 for none
+	float mChunkSize;
+	/// Hierarchical LODs of the merged mesh's chunks
+	int mHLODLevels;
+	int mHLODTriangleBudget;
+	UT_String mHLODMaterial;
+	/// Welding tolerances, no welding if mWeldTolerance is 0
+	float mWeldTolerance;
+	/// In degrees
+	float mWeldNormalAngle;
+	float mWeldUVTolerance;
+	float mWeldColourTolerance;
+	bool mRemoveDegenerates;
+	/// Share vertex data between an object's SubMeshes where possible
+	bool mSharedVertices;
+	/// Write bounding volume / BVH files next to each mesh
+	bool mBoundsSidecar;
+	bool mBVHSidecar;
+	/// Write a position-only copy of each mesh for depth / shadow passes
+	bool mDepthMesh;
 	bool mSnapshotPerFrame;
+	/// Bake animation into vertex animation textures, as half or full floats
+	bool mVertexAnimation;
+	bool mVertexAnimationHalf;
 	bool mObjectTransforms;
 	bool mGenerateTangents;
 	Ogre::VertexElementSemantic mTangentsSemantic;
+	bool mTangentHandedness;
 	bool mGenerateEdgeLists;
 	float mFps;
 	float mIkSampleRate;
@@ -0,0 +1,402 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_RepeatedPieces.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_RepeatedPieces.h"
+#include "HoudiniOgre_ExportCache.h"
+#include "HoudiniOgre_Trace.h"
+
+#include "OgreLogManager.h"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+	/// How far apart texture coordinates, colours and unit normals may be
+	const Ogre::Real ATTRIBUTE_TOLERANCE = 1e-3f;
+	/// Relative gap below which principal axes are considered ambiguous
+	const Ogre::Real AXIS_GAP = 1e-3f;
+
+	int findRoot(std::vector<int>& parents, int point)
+	{
+		while (parents[point] != point)
+		{
+			parents[point] = parents[parents[point]];
+			point = parents[point];
+		}
+		return point;
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_RepeatedPieces::HoudiniOgre_RepeatedPieces(
+	const HoudiniOgre_GeometrySource& source, Ogre::Real tolerance, size_t minCount)
+: mSource(source), mTolerance(tolerance)
+{
+	HoudiniOgre_TraceSpan span("findRepeatedPieces", source.getName().c_str());
+
+	mPrimitiveGroups.assign(source.getPrimitiveCount(), -1);
+	const HoudiniOgre_GeometrySource::MaterialGroupList& groups = source.getMaterialGroups();
+	for (size_t g = 0; g < groups.size(); ++g)
+	{
+		for (std::vector<int>::const_iterator p = groups[g].primitives.begin();
+			p != groups[g].primitives.end(); ++p)
+		{
+			mPrimitiveGroups[*p] = static_cast<int>(g);
+		}
+	}
+
+	findPieces();
+
+	// Match each piece against the first piece of each group with the same
+	// topology, starting a new group if none fit
+	std::vector<Candidate> candidates;
+	typedef std::map<unsigned long long, std::vector<size_t> > CandidateBuckets;
+	CandidateBuckets buckets;
+	for (size_t i = 0; i < mPieces.size(); ++i)
+	{
+		const Piece& piece = mPieces[i];
+		std::vector<size_t>& bucket = buckets[piece.signature];
+		bool found = false;
+		for (std::vector<size_t>::iterator c = bucket.begin(); c != bucket.end(); ++c)
+		{
+			if (matches(candidates[*c], piece))
+			{
+				candidates[*c].members.push_back(i);
+				found = true;
+				break;
+			}
+		}
+		if (found)
+			continue;
+
+		Candidate cand;
+		cand.basePiece = i;
+		cand.members.push_back(i);
+		Ogre::Matrix4 inverse = piece.frame.inverse();
+		for (std::vector<int>::const_iterator p = piece.points.begin(); p != piece.points.end(); ++p)
+		{
+			cand.positions.push_back(inverse * source.getPointPosition(*p));
+		}
+		if (source.hasNormals())
+		{
+			Ogre::Matrix3 rot;
+			inverse.extract3x3Matrix(rot);
+			for (std::vector<int>::const_iterator p = piece.primitives.begin();
+				p != piece.primitives.end(); ++p)
+			{
+				int vcount = source.getPrimitiveVertexCount(*p);
+				for (int v = 0; v < vcount; ++v)
+				{
+					cand.normals.push_back(rot * source.getNormal(*p, v));
+				}
+			}
+		}
+		bucket.push_back(candidates.size());
+		candidates.push_back(cand);
+	}
+
+	size_t repeated = 0;
+	for (std::vector<Candidate>::iterator c = candidates.begin(); c != candidates.end(); ++c)
+	{
+		if (c->members.size() < std::max(minCount, size_t(2)))
+		{
+			for (std::vector<size_t>::iterator m = c->members.begin(); m != c->members.end(); ++m)
+			{
+				const std::vector<int>& prims = mPieces[*m].primitives;
+				mRemainder.insert(mRemainder.end(), prims.begin(), prims.end());
+			}
+			continue;
+		}
+
+		PieceGroup group;
+		const Piece& base = mPieces[c->basePiece];
+		group.basePrimitives = base.primitives;
+		group.baseInverse = base.frame.inverse();
+		for (std::vector<size_t>::iterator m = c->members.begin(); m != c->members.end(); ++m)
+		{
+			group.transforms.push_back(mPieces[*m].frame);
+		}
+		repeated += c->members.size();
+		mGroups.push_back(group);
+	}
+	std::sort(mRemainder.begin(), mRemainder.end());
+	mPieces.clear();
+
+	Ogre::StringUtil::StrStreamType msg;
+	msg << source.getName() << ": " << repeated << " repeated pieces in "
+		<< mGroups.size() << " groups, " << mRemainder.size() << " primitives left over";
+	Ogre::LogManager::getSingleton().logMessage(msg.str());
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_RepeatedPieces::findPieces()
+{
+	int pointCount = mSource.getPointCount();
+	int primCount = mSource.getPrimitiveCount();
+
+	// Union the points of each polygon
+	std::vector<int> parents(pointCount);
+	for (int p = 0; p < pointCount; ++p)
+		parents[p] = p;
+	for (int prim = 0; prim < primCount; ++prim)
+	{
+		if (!mSource.isPolygon(prim))
+			continue;
+		int first = findRoot(parents, mSource.getVertexPoint(prim, 0));
+		int vcount = mSource.getPrimitiveVertexCount(prim);
+		for (int v = 1; v < vcount; ++v)
+		{
+			int root = findRoot(parents, mSource.getVertexPoint(prim, v));
+			if (root != first)
+				parents[root] = first;
+		}
+	}
+
+	std::vector<int> pieceIndexes(pointCount, -1);
+	for (int prim = 0; prim < primCount; ++prim)
+	{
+		if (!mSource.isPolygon(prim))
+		{
+			mRemainder.push_back(prim);
+			continue;
+		}
+		int root = findRoot(parents, mSource.getVertexPoint(prim, 0));
+		if (pieceIndexes[root] < 0)
+		{
+			pieceIndexes[root] = static_cast<int>(mPieces.size());
+			mPieces.push_back(Piece());
+		}
+		mPieces[pieceIndexes[root]].primitives.push_back(prim);
+	}
+
+	for (std::vector<Piece>::iterator i = mPieces.begin(); i != mPieces.end(); ++i)
+	{
+		computeSignature(*i);
+		computeFrame(*i);
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_RepeatedPieces::computeSignature(Piece& piece) const
+{
+	// Points are numbered by first use, so copies of a piece hash the same
+	std::map<int, int> localPoints;
+	HoudiniOgre_Hash hash;
+	hash.add(piece.primitives.size());
+	for (std::vector<int>::const_iterator p = piece.primitives.begin();
+		p != piece.primitives.end(); ++p)
+	{
+		int vcount = mSource.getPrimitiveVertexCount(*p);
+		hash.add(vcount);
+		hash.add(mPrimitiveGroups[*p]);
+		for (int v = 0; v < vcount; ++v)
+		{
+			int point = mSource.getVertexPoint(*p, v);
+			std::pair<std::map<int, int>::iterator, bool> ins = localPoints.insert(
+				std::make_pair(point, static_cast<int>(piece.points.size())));
+			if (ins.second)
+				piece.points.push_back(point);
+			hash.add(ins.first->second);
+		}
+	}
+	piece.signature = hash.getValue();
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_RepeatedPieces::computeFrame(Piece& piece) const
+{
+	size_t n = piece.points.size();
+	std::vector<Ogre::Vector3> offsets(n);
+	Ogre::Vector3 centre = Ogre::Vector3::ZERO;
+	for (size_t i = 0; i < n; ++i)
+	{
+		offsets[i] = mSource.getPointPosition(piece.points[i]);
+		centre += offsets[i];
+	}
+	centre /= static_cast<Ogre::Real>(n);
+
+	Ogre::Matrix3 covariance = Ogre::Matrix3::ZERO;
+	for (size_t i = 0; i < n; ++i)
+	{
+		offsets[i] -= centre;
+		for (int r = 0; r < 3; ++r)
+			for (int c = 0; c < 3; ++c)
+				covariance[r][c] += offsets[i][r] * offsets[i][c];
+	}
+
+	Ogre::Real values[3];
+	Ogre::Vector3 vectors[3];
+	covariance.EigenSolveSymmetric(values, vectors);
+	// largest first
+	for (int i = 0; i < 2; ++i)
+	{
+		for (int j = i + 1; j < 3; ++j)
+		{
+			if (values[j] > values[i])
+			{
+				std::swap(values[i], values[j]);
+				std::swap(vectors[i], vectors[j]);
+			}
+		}
+	}
+
+	Ogre::Vector3 axes[2];
+	Ogre::Real gap = values[0] * AXIS_GAP;
+	if (values[0] - values[1] > gap && values[1] - values[2] > gap)
+	{
+		// Principal axes, pointing at the first point well off their plane
+		for (int a = 0; a < 2; ++a)
+		{
+			axes[a] = vectors[a].normalisedCopy();
+			for (size_t i = 0; i < n; ++i)
+			{
+				Ogre::Real d = offsets[i].dotProduct(axes[a]);
+				if (Ogre::Math::Abs(d) > mTolerance)
+				{
+					if (d < 0)
+						axes[a] = -axes[a];
+					break;
+				}
+			}
+		}
+	}
+	else
+	{
+		// Symmetric enough that the axes could point anywhere; use the
+		// first point away from the centre, then the first one off that line
+		axes[0] = Ogre::Vector3::UNIT_X;
+		axes[1] = Ogre::Vector3::UNIT_Y;
+		size_t i = 0;
+		for (; i < n; ++i)
+		{
+			if (offsets[i].length() > mTolerance)
+			{
+				axes[0] = offsets[i].normalisedCopy();
+				axes[1] = axes[0].perpendicular();
+				break;
+			}
+		}
+		for (; i < n; ++i)
+		{
+			Ogre::Vector3 off = offsets[i] - axes[0] * offsets[i].dotProduct(axes[0]);
+			if (off.length() > mTolerance)
+			{
+				axes[1] = off.normalisedCopy();
+				break;
+			}
+		}
+	}
+
+	Ogre::Matrix3 rot;
+	rot.FromAxes(axes[0], axes[1], axes[0].crossProduct(axes[1]));
+	piece.frame = Ogre::Matrix4::IDENTITY;
+	piece.frame = rot;
+	piece.frame.setTrans(centre);
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_RepeatedPieces::matches(const Candidate& candidate, const Piece& piece) const
+{
+	const Piece& base = mPieces[candidate.basePiece];
+	if (base.points.size() != piece.points.size() ||
+		base.primitives.size() != piece.primitives.size())
+		return false;
+
+	// Topology and materials; the signature only says they're probably equal
+	for (size_t p = 0; p < piece.primitives.size(); ++p)
+	{
+		int basePrim = base.primitives[p];
+		int prim = piece.primitives[p];
+		if (mPrimitiveGroups[basePrim] != mPrimitiveGroups[prim])
+			return false;
+		int vcount = mSource.getPrimitiveVertexCount(prim);
+		if (mSource.getPrimitiveVertexCount(basePrim) != vcount)
+			return false;
+	}
+	std::map<int, int> localPoints;
+	for (size_t i = 0; i < piece.points.size(); ++i)
+		localPoints[piece.points[i]] = static_cast<int>(i);
+	std::map<int, int> baseLocalPoints;
+	for (size_t i = 0; i < base.points.size(); ++i)
+		baseLocalPoints[base.points[i]] = static_cast<int>(i);
+	for (size_t p = 0; p < piece.primitives.size(); ++p)
+	{
+		int vcount = mSource.getPrimitiveVertexCount(piece.primitives[p]);
+		for (int v = 0; v < vcount; ++v)
+		{
+			if (localPoints[mSource.getVertexPoint(piece.primitives[p], v)] !=
+				baseLocalPoints[mSource.getVertexPoint(base.primitives[p], v)])
+				return false;
+		}
+	}
+
+	// Positions, through this piece's frame
+	Ogre::Real tolerance2 = mTolerance * mTolerance;
+	for (size_t i = 0; i < piece.points.size(); ++i)
+	{
+		Ogre::Vector3 pos = piece.frame * candidate.positions[i];
+		if ((pos - mSource.getPointPosition(piece.points[i])).squaredLength() > tolerance2)
+			return false;
+	}
+
+	// Vertex attributes
+	Ogre::Matrix3 rot;
+	piece.frame.extract3x3Matrix(rot);
+	bool normals = mSource.hasNormals();
+	bool colours = mSource.hasColours();
+	size_t uvSets = mSource.getUVSetCount();
+	size_t vertex = 0;
+	for (size_t p = 0; p < piece.primitives.size(); ++p)
+	{
+		int basePrim = base.primitives[p];
+		int prim = piece.primitives[p];
+		int vcount = mSource.getPrimitiveVertexCount(prim);
+		for (int v = 0; v < vcount; ++v, ++vertex)
+		{
+			if (normals)
+			{
+				Ogre::Vector3 normal = rot * candidate.normals[vertex];
+				if (!normal.positionEquals(mSource.getNormal(prim, v), ATTRIBUTE_TOLERANCE))
+					return false;
+			}
+			for (size_t uv = 0; uv < uvSets; ++uv)
+			{
+				float bu, bv, pu, pv;
+				mSource.getUV(uv, basePrim, v, bu, bv);
+				mSource.getUV(uv, prim, v, pu, pv);
+				if (Ogre::Math::Abs(bu - pu) > ATTRIBUTE_TOLERANCE ||
+					Ogre::Math::Abs(bv - pv) > ATTRIBUTE_TOLERANCE)
+					return false;
+			}
+			if (colours)
+			{
+				Ogre::ColourValue bc = mSource.getColour(basePrim, v);
+				Ogre::ColourValue pc = mSource.getColour(prim, v);
+				if (Ogre::Math::Abs(bc.r - pc.r) > ATTRIBUTE_TOLERANCE ||
+					Ogre::Math::Abs(bc.g - pc.g) > ATTRIBUTE_TOLERANCE ||
+					Ogre::Math::Abs(bc.b - pc.b) > ATTRIBUTE_TOLERANCE ||
+					Ogre::Math::Abs(bc.a - pc.a) > ATTRIBUTE_TOLERANCE)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,113 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_RepeatedPieces.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_RepeatedPieces__
+#define __HoudiniOgre_RepeatedPieces__
+
+#include "HoudiniOgre_GeometrySource.h"
+
+/** Finds pieces which are repeated within one object, such as the bolts
+	or leaves a copy SOP produces, so they can be instanced.
+@remarks
+	The object is split into connected pieces (primitives sharing points).
+	Each piece is given a canonical frame: its centroid plus the principal
+	axes of its points, with the signs of the axes fixed by the first point
+	lying off each axis. Where the principal axes are ambiguous (the piece
+	is as wide one way as another) the frame is built from the first points
+	instead. Two pieces match if they have the same topology, point order
+	and materials, and one piece mapped through the other's frame lands on
+	it within the tolerance, with the same normals, texture coordinates and
+	colours. That is always true of rigidly transformed copies.
+@par
+	Pieces repeated at least the minimum number of times are reported in
+	groups; everything else, including primitives which aren't polygons, is
+	left over for the ordinary export path.
+*/
+class HoudiniOgre_RepeatedPieces
+{
+public:
+	struct PieceGroup
+	{
+		/// Primitives of the first piece, which becomes the base mesh
+		std::vector<int> basePrimitives;
+		/// Object space to the canonical frame of the base piece
+		Ogre::Matrix4 baseInverse;
+		/// Canonical frame to object space for every piece (including the first)
+		std::vector<Ogre::Matrix4> transforms;
+	};
+	typedef std::vector<PieceGroup> PieceGroupList;
+
+	/** Analyse the geometry.
+	@param source Geometry to look through
+	@param tolerance Distance points of matching pieces may be apart
+	@param minCount Minimum number of copies worth instancing
+	*/
+	HoudiniOgre_RepeatedPieces(const HoudiniOgre_GeometrySource& source,
+		Ogre::Real tolerance, size_t minCount);
+
+	/// Groups of repeated pieces
+	const PieceGroupList& getGroups() const { return mGroups; }
+	/// Primitives not in any group, in order
+	const std::vector<int>& getRemainder() const { return mRemainder; }
+
+protected:
+	/// A connected piece
+	struct Piece
+	{
+		std::vector<int> primitives;
+		/// Points in the order the primitives first use them
+		std::vector<int> points;
+		/// Canonical frame to object space
+		Ogre::Matrix4 frame;
+		/// Hash of topology and materials, for bucketing
+		unsigned long long signature;
+	};
+	/// A group being built up
+	struct Candidate
+	{
+		size_t basePiece;
+		/// Base piece points in its canonical frame
+		std::vector<Ogre::Vector3> positions;
+		/// Base piece normals in its canonical frame, vertex by vertex
+		std::vector<Ogre::Vector3> normals;
+		std::vector<size_t> members;
+	};
+
+	void findPieces();
+	void computeFrame(Piece& piece) const;
+	void computeSignature(Piece& piece) const;
+	bool matches(const Candidate& candidate, const Piece& piece) const;
+
+	const HoudiniOgre_GeometrySource& mSource;
+	Ogre::Real mTolerance;
+	/// Material group of each primitive, -1 for the object material
+	std::vector<int> mPrimitiveGroups;
+	std::vector<Piece> mPieces;
+	PieceGroupList mGroups;
+	std::vector<int> mRemainder;
+
+};
+
+#endif
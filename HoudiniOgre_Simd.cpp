@@ -0,0 +1,335 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Simd.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_Simd.h"
+
+#include <algorithm>
+
+#if !defined(HOUDINIOGRE_NO_SIMD) && OGRE_DOUBLE_PRECISION == 0 && \
+	(defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	define HOUDINIOGRE_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace
+{
+	inline float clampUnit(float x)
+	{
+		// NaN goes to 0, the same as the SSE2 max / min
+		return x > 0 ? (x < 1 ? x : 1) : 0;
+	}
+
+	inline Ogre::uint32 toByte(float x)
+	{
+		return static_cast<Ogre::uint32>(clampUnit(x) * 255);
+	}
+
+#ifdef HOUDINIOGRE_SSE2
+	/// Load 4 consecutive Vector3s as x, y and z columns
+	inline void load4(const Ogre::Vector3* p, __m128& x, __m128& y, __m128& z)
+	{
+		const float* f = &p->x;
+		__m128 a = _mm_loadu_ps(f);     // x0 y0 z0 x1
+		__m128 b = _mm_loadu_ps(f + 4); // y1 z1 x2 y2
+		__m128 c = _mm_loadu_ps(f + 8); // z2 x3 y3 z3
+		__m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2));
+		x = _mm_shuffle_ps(a, bc, _MM_SHUFFLE(3, 0, 3, 0));
+		y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 2, 1)),
+			_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+			_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+	}
+
+	/// Store x, y and z columns as 4 consecutive Vector3s
+	inline void store4(Ogre::Vector3* p, __m128 x, __m128 y, __m128 z)
+	{
+		float* f = &p->x;
+		__m128 xy0 = _mm_unpacklo_ps(x, y); // x0 y0 x1 y1
+		__m128 xy2 = _mm_unpackhi_ps(x, y); // x2 y2 x3 y3
+		_mm_storeu_ps(f, _mm_shuffle_ps(xy0,
+			_mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+		_mm_storeu_ps(f + 4, _mm_shuffle_ps(
+			_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), xy2, _MM_SHUFFLE(1, 0, 2, 0)));
+		_mm_storeu_ps(f + 8, _mm_shuffle_ps(
+			_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),
+			_mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+
+	/// Horizontal min / max of the 4 lanes
+	inline float reduceMin(__m128 v)
+	{
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(v);
+	}
+	inline float reduceMax(__m128 v)
+	{
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(v);
+	}
+#endif
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_Simd::isAccelerated()
+{
+#ifdef HOUDINIOGRE_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Simd::transformPoints(const Ogre::Matrix4& xform, 
+	const Ogre::Vector3* in, Ogre::Vector3* out, size_t count)
+{
+	if (xform[3][0] != 0 || xform[3][1] != 0 || xform[3][2] != 0 || xform[3][3] != 1)
+	{
+		// projective, needs the divide by w
+		for (size_t i = 0; i < count; ++i)
+			out[i] = xform * in[i];
+		return;
+	}
+
+	size_t i = 0;
+#ifdef HOUDINIOGRE_SSE2
+	__m128 m[3][4];
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 4; ++c)
+			m[r][c] = _mm_set1_ps(xform[r][c]);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x, y, z;
+		load4(in + i, x, y, z);
+		__m128 res[3];
+		for (int r = 0; r < 3; ++r)
+		{
+			res[r] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(m[r][0], x), _mm_mul_ps(m[r][1], y)), 
+				_mm_mul_ps(m[r][2], z)), m[r][3]);
+		}
+		store4(out + i, res[0], res[1], res[2]);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const Ogre::Vector3& v = in[i];
+		out[i] = Ogre::Vector3(
+			xform[0][0] * v.x + xform[0][1] * v.y + xform[0][2] * v.z + xform[0][3],
+			xform[1][0] * v.x + xform[1][1] * v.y + xform[1][2] * v.z + xform[1][3],
+			xform[2][0] * v.x + xform[2][1] * v.y + xform[2][2] * v.z + xform[2][3]);
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Simd::transformVectors(const Ogre::Matrix3& rot, 
+	const Ogre::Vector3* in, Ogre::Vector3* out, size_t count)
+{
+	size_t i = 0;
+#ifdef HOUDINIOGRE_SSE2
+	__m128 m[3][3];
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 3; ++c)
+			m[r][c] = _mm_set1_ps(rot[r][c]);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x, y, z;
+		load4(in + i, x, y, z);
+		__m128 res[3];
+		for (int r = 0; r < 3; ++r)
+		{
+			res[r] = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(m[r][0], x), _mm_mul_ps(m[r][1], y)), 
+				_mm_mul_ps(m[r][2], z));
+		}
+		store4(out + i, res[0], res[1], res[2]);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const Ogre::Vector3& v = in[i];
+		out[i] = Ogre::Vector3(
+			rot[0][0] * v.x + rot[0][1] * v.y + rot[0][2] * v.z,
+			rot[1][0] * v.x + rot[1][1] * v.y + rot[1][2] * v.z,
+			rot[2][0] * v.x + rot[2][1] * v.y + rot[2][2] * v.z);
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Simd::flipUVs(const float* in, float* out, size_t pairCount)
+{
+	size_t i = 0;
+	size_t count = pairCount * 2;
+#ifdef HOUDINIOGRE_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+	// all bits set in the v lanes
+	const __m128 vMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, -1, 0));
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 uv = _mm_loadu_ps(in + i);
+		__m128 flipped = _mm_sub_ps(one, uv);
+		_mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(vMask, flipped), _mm_andnot_ps(vMask, uv)));
+	}
+#endif
+	for (; i < count; i += 2)
+	{
+		out[i] = in[i];
+		out[i + 1] = 1.0f - in[i + 1];
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Simd::packColours(const Ogre::ColourValue* in, Ogre::RGBA* out,
+	size_t count, Ogre::VertexElementType type)
+{
+	// the same choice convertColourValue makes for other types
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	bool argb = type != Ogre::VET_COLOUR_ABGR;
+#else
+	bool argb = type == Ogre::VET_COLOUR_ARGB;
+#endif
+
+	size_t i = 0;
+#ifdef HOUDINIOGRE_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i c[4];
+		for (int j = 0; j < 4; ++j)
+		{
+			__m128 col = _mm_loadu_ps(&in[i + j].r);
+			// lanes become the bytes in memory order, r g b a for ABGR
+			if (argb)
+				col = _mm_shuffle_ps(col, col, _MM_SHUFFLE(3, 0, 1, 2));
+			col = _mm_min_ps(_mm_max_ps(col, zero), one);
+			c[j] = _mm_cvttps_epi32(_mm_mul_ps(col, scale));
+		}
+		__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const Ogre::ColourValue& col = in[i];
+		if (argb)
+			out[i] = toByte(col.a) << 24 | toByte(col.r) << 16 | toByte(col.g) << 8 | toByte(col.b);
+		else
+			out[i] = toByte(col.a) << 24 | toByte(col.b) << 16 | toByte(col.g) << 8 | toByte(col.r);
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Simd::growBounds(const Ogre::Vector3* points, size_t count,
+	Ogre::Vector3& min, Ogre::Vector3& max, Ogre::Real& squaredRadius)
+{
+	size_t i = 0;
+#ifdef HOUDINIOGRE_SSE2
+	if (count >= 4)
+	{
+		__m128 minX = _mm_set1_ps(min.x), minY = _mm_set1_ps(min.y), minZ = _mm_set1_ps(min.z);
+		__m128 maxX = _mm_set1_ps(max.x), maxY = _mm_set1_ps(max.y), maxZ = _mm_set1_ps(max.z);
+		__m128 radius = _mm_set1_ps(squaredRadius);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			load4(points + i, x, y, z);
+			// (the running value second, so NaNs are skipped like makeFloor does)
+			minX = _mm_min_ps(x, minX);
+			minY = _mm_min_ps(y, minY);
+			minZ = _mm_min_ps(z, minZ);
+			maxX = _mm_max_ps(x, maxX);
+			maxY = _mm_max_ps(y, maxY);
+			maxZ = _mm_max_ps(z, maxZ);
+			radius = _mm_max_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), radius);
+		}
+		min = Ogre::Vector3(reduceMin(minX), reduceMin(minY), reduceMin(minZ));
+		max = Ogre::Vector3(reduceMax(maxX), reduceMax(maxY), reduceMax(maxZ));
+		squaredRadius = reduceMax(radius);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		min.makeFloor(points[i]);
+		max.makeCeil(points[i]);
+		squaredRadius = std::max(squaredRadius, points[i].squaredLength());
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Simd::triangleTangents(const float* px, const float* py, const float* pz,
+	const float* tu, const float* tv, const Ogre::uint32* indices, size_t triangleCount,
+	float* tx, float* ty, float* tz, unsigned char* mirrored)
+{
+	size_t t = 0;
+#ifdef HOUDINIOGRE_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	for (; t + 4 <= triangleCount; t += 4)
+	{
+		const Ogre::uint32* idx = indices + t * 3;
+		// corner k of the 4 triangles, one per lane
+		__m128 p[3][3], uv[3][2];
+		for (int k = 0; k < 3; ++k)
+		{
+			Ogre::uint32 a = idx[k], b = idx[3 + k], c = idx[6 + k], d = idx[9 + k];
+			p[k][0] = _mm_set_ps(px[d], px[c], px[b], px[a]);
+			p[k][1] = _mm_set_ps(py[d], py[c], py[b], py[a]);
+			p[k][2] = _mm_set_ps(pz[d], pz[c], pz[b], pz[a]);
+			uv[k][0] = _mm_set_ps(tu[d], tu[c], tu[b], tu[a]);
+			uv[k][1] = _mm_set_ps(tv[d], tv[c], tv[b], tv[a]);
+		}
+		__m128 du1 = _mm_sub_ps(uv[1][0], uv[0][0]), dv1 = _mm_sub_ps(uv[1][1], uv[0][1]);
+		__m128 du2 = _mm_sub_ps(uv[2][0], uv[0][0]), dv2 = _mm_sub_ps(uv[2][1], uv[0][1]);
+		__m128 det = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+		__m128 negative = _mm_cmplt_ps(det, zero);
+		// multiplying by -1 just flips the sign bit
+		__m128 flip = _mm_and_ps(negative, signBit);
+		__m128 res[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			__m128 e1 = _mm_sub_ps(p[1][c], p[0][c]);
+			__m128 e2 = _mm_sub_ps(p[2][c], p[0][c]);
+			res[c] = _mm_xor_ps(_mm_sub_ps(_mm_mul_ps(e1, dv2), _mm_mul_ps(e2, dv1)), flip);
+		}
+		_mm_storeu_ps(tx + t, res[0]);
+		_mm_storeu_ps(ty + t, res[1]);
+		_mm_storeu_ps(tz + t, res[2]);
+		int mask = _mm_movemask_ps(negative);
+		for (int j = 0; j < 4; ++j)
+			mirrored[t + j] = (mask >> j) & 1;
+	}
+#endif
+	for (; t < triangleCount; ++t)
+	{
+		Ogre::uint32 i0 = indices[t*3], i1 = indices[t*3+1], i2 = indices[t*3+2];
+		float e1x = px[i1] - px[i0], e1y = py[i1] - py[i0], e1z = pz[i1] - pz[i0];
+		float e2x = px[i2] - px[i0], e2y = py[i2] - py[i0], e2z = pz[i2] - pz[i0];
+		float du1 = tu[i1] - tu[i0], dv1 = tv[i1] - tv[i0];
+		float du2 = tu[i2] - tu[i0], dv2 = tv[i2] - tv[i0];
+		float det = du1 * dv2 - du2 * dv1;
+		float sign = det < 0 ? -1.0f : 1.0f;
+		tx[t] = (e1x * dv2 - e2x * dv1) * sign;
+		ty[t] = (e1y * dv2 - e2y * dv1) * sign;
+		tz[t] = (e1z * dv2 - e2z * dv1) * sign;
+		mirrored[t] = det < 0;
+	}
+}
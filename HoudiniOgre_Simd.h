@@ -0,0 +1,84 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Simd.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_Simd__
+#define __HoudiniOgre_Simd__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "OgreVector3.h"
+#include "OgreMatrix3.h"
+#include "OgreMatrix4.h"
+#include "OgreColourValue.h"
+#include "OgreHardwareVertexBuffer.h"
+
+/** Whole-array versions of the conversions HoudiniOgre_Mesh applies to
+	gathered geometry.
+@remarks
+	Built with SSE2, four elements at a time, when the compiler targets a
+	CPU which has it (every x64 build does) and Ogre::Real is float; 
+	otherwise, or if HOUDINIOGRE_NO_SIMD is defined, with plain loops. 
+	Both do the same arithmetic in the same order, so give the same 
+	results. Outputs must not overlap inputs.
+*/
+class HoudiniOgre_Simd
+{
+public:
+	/// Is the SSE2 version built in?
+	static bool isAccelerated();
+
+	/// out[i] = xform * in[i]
+	static void transformPoints(const Ogre::Matrix4& xform, const Ogre::Vector3* in,
+		Ogre::Vector3* out, size_t count);
+	/// out[i] = rot * in[i]
+	static void transformVectors(const Ogre::Matrix3& rot, const Ogre::Vector3* in,
+		Ogre::Vector3* out, size_t count);
+	/** Turn u, v pairs from Houdini's origin (bottom left) to Ogre's (top
+		left), ie (u, 1 - v). */
+	static void flipUVs(const float* in, float* out, size_t pairCount);
+	/** Pack colours for a vertex buffer like 
+		Ogre::VertexElement::convertColourValue, except that the components
+		are clamped to [0, 1] rather than wrapping. */
+	static void packColours(const Ogre::ColourValue* in, Ogre::RGBA* out, size_t count,
+		Ogre::VertexElementType type);
+	/** Grow a box, and the largest squared distance from the origin, to
+		take in some points. */
+	static void growBounds(const Ogre::Vector3* points, size_t count,
+		Ogre::Vector3& min, Ogre::Vector3& max, Ogre::Real& squaredRadius);
+	/** The tangent of each triangle, scaled by its area, and whether its
+		texture is mirrored.
+	@remarks
+		Positions and texture coordinates are columns by vertex, indices
+		three per triangle. Each tangent is (e1 * dv2 - e2 * dv1) for the
+		edges from the first corner, negated where the texture is mirrored
+		(du1 * dv2 - du2 * dv1 < 0) so it always follows increasing u. SSE2
+		has no gather, so the corners are loaded one by one and the rest
+		is done four triangles at a time.
+	*/
+	static void triangleTangents(const float* px, const float* py, const float* pz,
+		const float* tu, const float* tv, const Ogre::uint32* indices, size_t triangleCount,
+		float* tx, float* ty, float* tz, unsigned char* mirrored);
+};
+
+#endif
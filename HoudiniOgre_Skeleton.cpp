@@ -23,6 +23,7 @@ This file is part of HoudiniOgre
 -----------------------------------------------------------------------------
 */
 #include "HoudiniOgre_Skeleton.h"
+#include "HoudiniOgre_Trace.h"
 
 #include "OgreNoMemoryMacros.h"
 #include <UT/UT_DMatrix4.h>
@@ -32,13 +33,7 @@ This file is part of HoudiniOgre
 #include "OgreMemoryMacros.h"
 
 #include "OgreLogManager.h"
-#include "OgreSkeletonSerializer.h"
-#include "OgreSkeleton.h"
-#include "OgreBone.h"
-#include "OgreSkeletonManager.h"
-#include "OgreAnimation.h"
-#include "OgreAnimationTrack.h"
-#include "OgreKeyFrame.h"
+#include "OgreStringConverter.h"
 //---------------------------------------------------------------------
 HoudiniOgre_Skeleton::HoudiniOgre_Skeleton(const BoneList& bones)
 : mOrigBoneList(bones)
@@ -54,31 +49,41 @@ HoudiniOgre_Skeleton::~HoudiniOgre_Skeleton()
 void HoudiniOgre_Skeleton::Export(const Ogre::String& filename, float framesPerSecond, 
 							 float ikSampleRate, const AnimationList& animList)
 {
-	Ogre::SkeletonSerializer ser;
-
-
-	Ogre::SkeletonPtr skeleton = Ogre::SkeletonManager::getSingleton().create(
-		"export", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+	HoudiniOgre_TraceSpan span("Skeleton::Export", filename.c_str());
+	if (!animList.empty())
+	{
+		long startFrame = animList.front().startFrame;
+		long endFrame = animList.front().endFrame;
+		for (AnimationList::const_iterator i = animList.begin(); i != animList.end(); ++i)
+		{
+			startFrame = std::min(startFrame, i->startFrame);
+			endFrame = std::max(endFrame, i->endFrame);
+		}
+		span.addArg("startFrame", startFrame);
+		span.addArg("endFrame", endFrame);
+	}
 
+	HoudiniOgre_SkeletonWriter writer(filename);
 
-	buildBoneStructure(skeleton.get());
+	buildBoneStructure();
 
 	establishInitialTransforms();
 
-	sampleAnimations(skeleton.get(), animList, framesPerSecond, ikSampleRate);
-
-	skeleton->optimiseAllAnimations();
-
-	// export
-	ser.exportSkeleton(skeleton.get(), filename);
+	writer.writeBones(mBoneRecords);
 
+	// Each animation is optimised and written as soon as it is sampled
+	sampleAnimations(writer, animList, framesPerSecond, ikSampleRate);
 
-	Ogre::SkeletonManager::getSingleton().remove(skeleton->getHandle());
+	writer.close();
 
+	span.addArg("keys", static_cast<long>(writer.getKeysWritten()));
+	Ogre::LogManager::getSingleton().logMessage("Skeleton keyframes written: " + 
+		Ogre::StringConverter::toString(writer.getKeysWritten()) + ", optimised away: " + 
+		Ogre::StringConverter::toString(writer.getKeysDropped()));
 
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Skeleton::buildBoneStructure(Ogre::Skeleton* skel)
+void HoudiniOgre_Skeleton::buildBoneStructure()
 {
 	Ogre::LogManager::getSingleton().logMessage("Building the skeleton structure...");
 	/* Apart from the bones themselves, other objects may form part of a 
@@ -91,11 +96,8 @@ void HoudiniOgre_Skeleton::buildBoneStructure(Ogre::Skeleton* skel)
 	unsigned short boneID = 0;
 	for (BoneList::const_iterator i = mOrigBoneList.begin(); i != mOrigBoneList.end(); ++i)
 	{
-		Ogre::Bone* ogreBone = 
-			skel->createBone(Ogre::String((*i)->getName()), boneID);
-
 		mBoneEntryMap.insert(BoneEntryMap::value_type(*i, 
-			BoneEntry(boneID++, *i, ogreBone)));
+			BoneEntry(boneID++, *i)));
 	}
 
 	// Now iterate over the same list again (not our new list since we'll add to that)
@@ -103,7 +105,7 @@ void HoudiniOgre_Skeleton::buildBoneStructure(Ogre::Skeleton* skel)
 	for (BoneList::const_iterator i = mOrigBoneList.begin(); i != mOrigBoneList.end(); ++i)
 	{
 		OBJ_Bone* bone = *i;
-		ascendBoneHierarchy(skel, bone);
+		ascendBoneHierarchy(bone);
 	}
 
 	// Log and link together
@@ -125,7 +127,7 @@ void HoudiniOgre_Skeleton::buildBoneStructure(Ogre::Skeleton* skel)
 
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Skeleton::ascendBoneHierarchy(Ogre::Skeleton* skel, OBJ_Node* bone)
+void HoudiniOgre_Skeleton::ascendBoneHierarchy(OBJ_Node* bone)
 {
 	BoneEntryMap::iterator bi = mBoneEntryMap.find(bone);
 	assert (bi != mBoneEntryMap.end());
@@ -151,20 +153,16 @@ void HoudiniOgre_Skeleton::ascendBoneHierarchy(Ogre::Skeleton* skel, OBJ_Node* b
 				OBJ_Bone* parentBone = parentObjNode->castToOBJBone();
 
 				// Create parent bone and link
-				Ogre::Bone* ogreParentBone = skel->createBone(
-					Ogre::String(parentObjNode->getName()), newBoneID);
-				ogreParentBone->addChild(thisBoneEntry.ogreBone);
-
 				if (parentBone)
 				{
 					mBoneEntryMap.insert(BoneEntryMap::value_type(parentNode, 
-						BoneEntry(newBoneID, parentBone, ogreParentBone)));
+						BoneEntry(newBoneID, parentBone)));
 				}
 				else
 				{
 					// some other kind of node
 					mBoneEntryMap.insert(BoneEntryMap::value_type(parentNode, 
-						BoneEntry(newBoneID, parentObjNode, ogreParentBone)));
+						BoneEntry(newBoneID, parentObjNode)));
 				}
 
 				thisBoneEntry.parent = parentObjNode;
@@ -181,7 +179,6 @@ void HoudiniOgre_Skeleton::ascendBoneHierarchy(Ogre::Skeleton* skel, OBJ_Node* b
 				{
 					thisBoneEntry.parent = parentObjNode;
 					thisBoneEntry.parentID = pi->second.boneID;
-					pi->second.ogreBone->addChild(thisBoneEntry.ogreBone);
 
 				}
 			}
@@ -189,7 +186,7 @@ void HoudiniOgre_Skeleton::ascendBoneHierarchy(Ogre::Skeleton* skel, OBJ_Node* b
 
 
 			// Keep going up
-			ascendBoneHierarchy(skel, parentObjNode);
+			ascendBoneHierarchy(parentObjNode);
 		}
 	}
 
@@ -201,6 +198,8 @@ void HoudiniOgre_Skeleton::establishInitialTransforms()
 	// GJ - make temporary so that Linux build is happy
 	OP_Context tempCtx(0.0);
 
+	mBoneRecords.clear();
+	mBoneRecords.resize(mBoneEntryMap.size());
 	for (BoneEntryMap::iterator i = mBoneEntryMap.begin(); i != mBoneEntryMap.end(); ++i)
 	{
 		BoneEntry& be = i->second;
@@ -220,14 +219,11 @@ void HoudiniOgre_Skeleton::establishInitialTransforms()
 		// Invert
 		be.invBindXform.invert();
 
-		Ogre::Vector3 scl, trans;
-		Ogre::Quaternion rot;
-		HoudiniMappings::explode(be.invBindXform, scl, rot, trans);
-
-		be.ogreBone->setScale(scl);
-		be.ogreBone->setOrientation(rot);
-		be.ogreBone->setPosition(trans);
-		be.ogreBone->setBindingPose();
+		HoudiniOgre_SkeletonWriter::Bone& bone = mBoneRecords[be.boneID];
+		bone.name = be.node->getName();
+		bone.handle = be.boneID;
+		bone.parent = be.parent ? be.parentID : HoudiniOgre_SkeletonWriter::NO_PARENT;
+		HoudiniMappings::explode(be.invBindXform, bone.scale, bone.orientation, bone.position);
 		
 
 	}
@@ -235,15 +231,16 @@ void HoudiniOgre_Skeleton::establishInitialTransforms()
 
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Skeleton::sampleAnimations(Ogre::Skeleton* skel, const AnimationList& animList, 
-											float fps, float sampleRate)
+void HoudiniOgre_Skeleton::sampleAnimations(HoudiniOgre_SkeletonWriter& writer, 
+	const AnimationList& animList, float fps, float sampleRate)
 {
+	// One track per bone, reused (capacity and all) for every animation
+	HoudiniOgre_SkeletonWriter::TrackList tracks(mBoneEntryMap.size());
 	for (AnimationList::const_iterator i = animList.begin(); i != animList.end(); ++i)
 	{
 		const AnimationEntry& animEntry =  *i;
 		float len = static_cast<float>(animEntry.endFrame - animEntry.startFrame + 1)
 			/ fps;
-		Ogre::Animation* anim = skel->createAnimation(animEntry.animationName, len);
 
 		float startTime = ((float)animEntry.startFrame) / fps;
 		float endTime = startTime + len;
@@ -252,39 +249,62 @@ void HoudiniOgre_Skeleton::sampleAnimations(Ogre::Skeleton* skel, const Animatio
 		for (BoneEntryMap::iterator bi = mBoneEntryMap.begin(); bi != mBoneEntryMap.end(); ++bi)
 		{
 			const BoneEntry& bEntry = bi->second;
-			Ogre::NodeAnimationTrack* track = anim->createNodeTrack(bEntry.boneID, bEntry.ogreBone);
+			HoudiniOgre_SkeletonWriter::Track& track = tracks[bEntry.boneID];
+			track.handle = bEntry.boneID;
+			track.keys.clear();
 
-			sampleTrack(track, bEntry, startTime, endTime, sampleFreq);
+			sampleTrack(track.keys, bEntry, startTime, endTime, sampleFreq);
 		}
 
+		writer.writeAnimation(animEntry.animationName, len, tracks);
+
 
 	}
 
 
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Skeleton::sampleTrack(Ogre::NodeAnimationTrack* track, 
+void HoudiniOgre_Skeleton::sampleTrack(KeyList& keys, 
 	const BoneEntry& be, float startTime, float endTime, float sampleFreq)
 {
+	if (sampleFreq > 0)
+		keys.reserve(keys.size() + static_cast<size_t>((endTime - startTime) / sampleFreq) + 2);
+
 	for (float t = startTime; t < endTime; t += sampleFreq)
 	{
 		// Sample bones at this point
 		float keyTime = t - startTime;
 
-		sampleKeyframe(track, be, keyTime);
+		sampleKeyframe(keys, be, keyTime);
 
 	}
 
 	// Sample final frame always
-	sampleKeyframe(track, be, endTime);
+	sampleKeyframe(keys, be, endTime);
 
 }
 //---------------------------------------------------------------------
-void HoudiniOgre_Skeleton::sampleKeyframe(Ogre::NodeAnimationTrack* track, 
+void HoudiniOgre_Skeleton::sampleKeyframe(KeyList& keys, 
 	const BoneEntry& be, float keyTime)
 {
-	OP_Context ctx(keyTime);
 	UT_DMatrix4 xform;
+	getBoneTransform(be, keyTime, xform);
+
+	// Make relative to bind transform
+	// Remember Houdini uses transposed matrix layout to Ogre
+	UT_DMatrix4 relativeToBindXform = xform * be.invBindXform;
+
+	keys.push_back(HoudiniOgre_SkeletonWriter::Key());
+	HoudiniOgre_SkeletonWriter::Key& key = keys.back();
+	key.time = keyTime;
+	HoudiniMappings::explode(relativeToBindXform, key.scale, key.rotation, key.translate);
+
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Skeleton::getBoneTransform(const BoneEntry& be, float time, 
+	UT_DMatrix4& xform)
+{
+	OP_Context ctx(time);
 
 	// Get transforms at frame 0, which is the point at which the mesh will
 	// be exported in the case of animation
@@ -296,21 +316,5 @@ void HoudiniOgre_Skeleton::sampleKeyframe(Ogre::NodeAnimationTrack* track,
 	{
 		xform = be.node->getTransform(ctx);
 	}
-
-	// Make relative to bind transform
-	// Remember Houdini uses transposed matrix layout to Ogre
-	UT_DMatrix4 relativeToBindXform = xform * be.invBindXform;
-
-	Ogre::Vector3 scl, trans;
-	Ogre::Quaternion rot;
-	HoudiniMappings::explode(relativeToBindXform, scl, rot, trans);
-
-	Ogre::TransformKeyFrame* kf = track->createNodeKeyFrame(keyTime);
-
-	kf->setScale(scl);
-	kf->setRotation(rot);
-	kf->setTranslate(trans);
-
 }
 
-
@@ -27,19 +27,21 @@ This file is part of HoudiniOgre
 #define __HoudiniOgre_Skeleton__
 
 #include "HoudiniOgre_Prerequisites.h"
+#include "HoudiniOgre_SkeletonWriter.h"
 
 class OP_Node;
 class OBJ_Node;
 class OBJ_Bone;
-class Ogre::Skeleton;
-class Ogre::Bone;
-class Ogre::NodeAnimationTrack;
 
 #include "OgreNoMemoryMacros.h"
 #include <OBJ/OBJ_Bone.h>
 #include <UT/UT_DMatrix4.h>
 #include "OgreMemoryMacros.h"
 /** Class to perform the export of a .skeleton file.
+@remarks
+	Bones and keys are gathered into plain arrays and streamed out by
+	HoudiniOgre_SkeletonWriter, an animation at a time, rather than built
+	into an Ogre::Skeleton first.
 */
 class HoudiniOgre_Skeleton
 {
@@ -64,20 +66,18 @@ protected:
 		unsigned short parentID;
 		std::set<unsigned short> childIDs;
 		OBJ_Node* node;
-		Ogre::Bone* ogreBone;
 		bool isObjBone;
 		UT_DMatrix4 invBindXform;
 
-		BoneEntry(unsigned short ID) : boneID(ID), parent(0), node(0), 
-			ogreBone(0)
+		BoneEntry(unsigned short ID) : boneID(ID), parent(0), node(0)
 		{
 		}
-		BoneEntry(unsigned short ID, OBJ_Bone* b, Ogre::Bone* ob) 
-			: boneID(ID), parent(0), node(b), ogreBone(ob), isObjBone(true)
+		BoneEntry(unsigned short ID, OBJ_Bone* b) 
+			: boneID(ID), parent(0), node(b), isObjBone(true)
 		{
 		}
-		BoneEntry(unsigned short ID, OBJ_Node* n, Ogre::Bone* ob) 
-			: boneID(ID), parent(0), node(n), ogreBone(ob), isObjBone(false)
+		BoneEntry(unsigned short ID, OBJ_Node* n) 
+			: boneID(ID), parent(0), node(n), isObjBone(false)
 		{
 		}
 	};    
@@ -87,15 +87,23 @@ protected:
 	typedef std::map<OP_Node*, BoneEntry> BoneEntryMap;
 	BoneEntryMap mBoneEntryMap;
 
-	void ascendBoneHierarchy(Ogre::Skeleton* skel, OBJ_Node* bone);
-	void buildBoneStructure(Ogre::Skeleton* skel);
+	typedef HoudiniOgre_SkeletonWriter::KeyList KeyList;
+	/// Binding poses, by bone ID
+	HoudiniOgre_SkeletonWriter::BoneRecordList mBoneRecords;
+
+	void ascendBoneHierarchy(OBJ_Node* bone);
+	void buildBoneStructure();
 	void establishInitialTransforms();
-	void sampleAnimations(Ogre::Skeleton* skel, const AnimationList& animList, 
+	void sampleAnimations(HoudiniOgre_SkeletonWriter& writer, const AnimationList& animList, 
 		float fps, float sampleRate);
-	void sampleTrack(Ogre::NodeAnimationTrack* track, const BoneEntry& boneEntry, 
+	void sampleTrack(KeyList& keys, const BoneEntry& boneEntry, 
 		float startTime, float endTime, float sampleFreq);
-	void sampleKeyframe(Ogre::NodeAnimationTrack* track, const BoneEntry& boneEntry, 
+	void sampleKeyframe(KeyList& keys, const BoneEntry& boneEntry, 
 		float time);
+	/** Get a bone's transform (relative to its parent, if any) at a given
+		time. Virtual so that the sampling can be driven without a scene. */
+	virtual void getBoneTransform(const BoneEntry& boneEntry, float time, 
+		UT_DMatrix4& xform);
 
 };
 
@@ -0,0 +1,283 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SkeletonWriter.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_SkeletonWriter.h"
+
+#include "OgreException.h"
+#include "OgreSkeleton.h"
+
+#include <cassert>
+
+namespace
+{
+	// Chunk IDs, as in OgreSkeletonFileFormat.h
+	const unsigned short HEADER_CHUNK_ID = 0x1000;
+	const unsigned short SKELETON_BONE = 0x2000;
+	const unsigned short SKELETON_BONE_PARENT = 0x3000;
+	const unsigned short SKELETON_ANIMATION = 0x4000;
+	const unsigned short SKELETON_ANIMATION_TRACK = 0x4100;
+	const unsigned short SKELETON_ANIMATION_TRACK_KEYFRAME = 0x4110;
+
+	const char* const SKELETON_VERSION = "[Serializer_v1.10]";
+
+	/// Chunk ID plus size
+	const size_t CHUNK_OVERHEAD = sizeof(unsigned short) + sizeof(Ogre::uint32);
+	const size_t VECTOR_SIZE = sizeof(float) * 3;
+	const size_t QUATERNION_SIZE = sizeof(float) * 4;
+
+	/** Same tolerance as NodeAnimationTrack::optimise and 
+		hasNonZeroKeyFrames use, in radians for rotations */
+	const Ogre::Real KEY_TOLERANCE = 1e-3f;
+
+	bool sameKey(const HoudiniOgre_SkeletonWriter::Key& a, 
+		const HoudiniOgre_SkeletonWriter::Key& b)
+	{
+		return a.translate.positionEquals(b.translate, KEY_TOLERANCE) &&
+			a.scale.positionEquals(b.scale, KEY_TOLERANCE) &&
+			a.rotation.equals(b.rotation, Ogre::Radian(KEY_TOLERANCE));
+	}
+
+	size_t keySize(const HoudiniOgre_SkeletonWriter::Key& key)
+	{
+		size_t size = CHUNK_OVERHEAD + sizeof(float) + QUATERNION_SIZE + VECTOR_SIZE;
+		if (key.scale != Ogre::Vector3::UNIT_SCALE)
+			size += VECTOR_SIZE;
+		return size;
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_SkeletonWriter::HoudiniOgre_SkeletonWriter(const Ogre::String& filename)
+: mFilename(filename), mStream(filename.c_str(), std::ios::binary), mBonesWritten(false),
+  mKeysWritten(0), mKeysDropped(0)
+{
+	if (!mStream)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write skeleton " + filename,
+			"HoudiniOgre_SkeletonWriter::HoudiniOgre_SkeletonWriter");
+	}
+
+	writeShorts(&HEADER_CHUNK_ID, 1);
+	writeString(SKELETON_VERSION);
+}
+//---------------------------------------------------------------------
+HoudiniOgre_SkeletonWriter::~HoudiniOgre_SkeletonWriter()
+{
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeBones(const BoneRecordList& bones)
+{
+	assert(!mBonesWritten && "Bones have already been written");
+	if (bones.size() > OGRE_MAX_NUM_BONES)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS,
+			"Too many bones for a skeleton in " + mFilename,
+			"HoudiniOgre_SkeletonWriter::writeBones");
+	}
+
+	// The serializer writes bones by handle, then the links
+	std::vector<const Bone*> byHandle(bones.size(), static_cast<const Bone*>(0));
+	for (BoneRecordList::const_iterator i = bones.begin(); i != bones.end(); ++i)
+	{
+		if (i->handle >= bones.size() || byHandle[i->handle])
+		{
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS,
+				"Bone handles are not contiguous in " + mFilename,
+				"HoudiniOgre_SkeletonWriter::writeBones");
+		}
+		byHandle[i->handle] = &*i;
+	}
+
+	for (std::vector<const Bone*>::iterator i = byHandle.begin(); i != byHandle.end(); ++i)
+	{
+		const Bone& bone = **i;
+		bool scaled = bone.scale != Ogre::Vector3::UNIT_SCALE;
+		writeChunkHeader(SKELETON_BONE, CHUNK_OVERHEAD + bone.name.size() + 1 +
+			sizeof(unsigned short) + VECTOR_SIZE + QUATERNION_SIZE + (scaled ? VECTOR_SIZE : 0));
+		writeString(bone.name);
+		writeShorts(&bone.handle, 1);
+		writeVector(bone.position);
+		writeQuaternion(bone.orientation);
+		if (scaled)
+			writeVector(bone.scale);
+	}
+
+	for (std::vector<const Bone*>::iterator i = byHandle.begin(); i != byHandle.end(); ++i)
+	{
+		const Bone& bone = **i;
+		if (bone.parent == NO_PARENT)
+			continue;
+
+		unsigned short link[2] = { bone.handle, bone.parent };
+		writeChunkHeader(SKELETON_BONE_PARENT, CHUNK_OVERHEAD + sizeof(link));
+		writeShorts(link, 2);
+	}
+
+	mBonesWritten = true;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeAnimation(const Ogre::String& name, float length, 
+	TrackList& tracks)
+{
+	assert(mBonesWritten && "Bones must be written before animations");
+
+	// Optimise first, the chunk sizes have to be known before writing
+	size_t animSize = CHUNK_OVERHEAD + name.size() + 1 + sizeof(float);
+	for (TrackList::iterator t = tracks.begin(); t != tracks.end(); ++t)
+	{
+		size_t before = t->keys.size();
+		if (isIdentity(t->keys))
+			t->keys.clear();
+		else
+			optimise(t->keys);
+		mKeysDropped += before - t->keys.size();
+
+		if (t->keys.empty())
+			continue;
+		animSize += CHUNK_OVERHEAD + sizeof(unsigned short);
+		for (KeyList::const_iterator k = t->keys.begin(); k != t->keys.end(); ++k)
+			animSize += keySize(*k);
+	}
+
+	writeChunkHeader(SKELETON_ANIMATION, animSize);
+	writeString(name);
+	writeFloats(&length, 1);
+
+	for (TrackList::const_iterator t = tracks.begin(); t != tracks.end(); ++t)
+	{
+		// dropped as identity
+		if (t->keys.empty())
+			continue;
+
+		size_t trackSize = CHUNK_OVERHEAD + sizeof(unsigned short);
+		for (KeyList::const_iterator k = t->keys.begin(); k != t->keys.end(); ++k)
+			trackSize += keySize(*k);
+		writeChunkHeader(SKELETON_ANIMATION_TRACK, trackSize);
+		writeShorts(&t->handle, 1);
+
+		for (KeyList::const_iterator k = t->keys.begin(); k != t->keys.end(); ++k)
+		{
+			size_t size = keySize(*k);
+			writeChunkHeader(SKELETON_ANIMATION_TRACK_KEYFRAME, size);
+			writeFloats(&k->time, 1);
+			writeQuaternion(k->rotation);
+			writeVector(k->translate);
+			if (size > CHUNK_OVERHEAD + sizeof(float) + QUATERNION_SIZE + VECTOR_SIZE)
+				writeVector(k->scale);
+		}
+		mKeysWritten += t->keys.size();
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::close()
+{
+	mStream.close();
+	if (mStream.fail())
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Error writing skeleton " + mFilename,
+			"HoudiniOgre_SkeletonWriter::close");
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::optimise(KeyList& keys)
+{
+	if (keys.size() < 5)
+		return;
+
+	// Compare against the first key of each run, like the track does, and
+	// drop everything but its first two and last two keys
+	size_t out = 0;
+	size_t runStart = 0;
+	for (size_t k = 0; k <= keys.size(); ++k)
+	{
+		if (k < keys.size() && sameKey(keys[k], keys[runStart]))
+			continue;
+
+		// run is [runStart, k)
+		size_t runLength = k - runStart;
+		for (size_t r = runStart; r < k; ++r)
+		{
+			if (runLength <= 4 || r < runStart + 2 || r >= k - 2)
+				keys[out++] = keys[r];
+		}
+		runStart = k;
+	}
+	keys.resize(out);
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_SkeletonWriter::isIdentity(const KeyList& keys)
+{
+	for (KeyList::const_iterator k = keys.begin(); k != keys.end(); ++k)
+	{
+		Ogre::Radian angle;
+		Ogre::Vector3 axis;
+		k->rotation.ToAngleAxis(angle, axis);
+		if (!k->scale.positionEquals(Ogre::Vector3::UNIT_SCALE, KEY_TOLERANCE) ||
+			!k->translate.positionEquals(Ogre::Vector3::ZERO, KEY_TOLERANCE) ||
+			!Ogre::Math::RealEqual(angle.valueRadians(), 0.0f, KEY_TOLERANCE))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeChunkHeader(unsigned short id, size_t size)
+{
+	Ogre::uint32 size32 = static_cast<Ogre::uint32>(size);
+	writeShorts(&id, 1);
+	mStream.write(reinterpret_cast<const char*>(&size32), sizeof(size32));
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeString(const Ogre::String& str)
+{
+	// newline terminated, as Serializer::writeString
+	mStream.write(str.c_str(), str.size());
+	mStream.put('\n');
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeShorts(const unsigned short* vals, size_t count)
+{
+	mStream.write(reinterpret_cast<const char*>(vals), sizeof(unsigned short) * count);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeFloats(const float* vals, size_t count)
+{
+	mStream.write(reinterpret_cast<const char*>(vals), sizeof(float) * count);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeVector(const Ogre::Vector3& v)
+{
+	// Ogre::Real may be a double
+	float vals[3] = { static_cast<float>(v.x), static_cast<float>(v.y), static_cast<float>(v.z) };
+	writeFloats(vals, 3);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SkeletonWriter::writeQuaternion(const Ogre::Quaternion& q)
+{
+	float vals[4] = { static_cast<float>(q.x), static_cast<float>(q.y), 
+		static_cast<float>(q.z), static_cast<float>(q.w) };
+	writeFloats(vals, 4);
+}
@@ -0,0 +1,128 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SkeletonWriter.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_SkeletonWriter__
+#define __HoudiniOgre_SkeletonWriter__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "OgreVector3.h"
+#include "OgreQuaternion.h"
+
+#include <fstream>
+
+/** Writes a binary .skeleton file directly from plain bone and key arrays.
+@remarks
+	Going through Ogre::Skeleton means a Bone per bone and a TransformKeyFrame
+	per key per bone, all on the heap, before SkeletonSerializer walks them
+	again; for long mocap takes that is millions of small objects. This
+	writes the same chunks as the 1.4 SkeletonSerializer ([Serializer_v1.10])
+	straight from the caller's arrays, an animation at a time, so only one
+	animation's keys ever need to be held.
+@par
+	Bones must be written before any animation. Each animation's tracks are
+	optimised in place the way Skeleton::optimiseAllAnimations does: runs of
+	identical keys are thinned out and tracks which never move their bone
+	are dropped.
+*/
+class HoudiniOgre_SkeletonWriter
+{
+public:
+	/// Handle used for a bone without a parent
+	static const unsigned short NO_PARENT = 0xFFFF;
+
+	/// A bone's binding pose, relative to its parent
+	struct Bone
+	{
+		Ogre::String name;
+		unsigned short handle;
+		unsigned short parent;
+		Ogre::Vector3 position;
+		Ogre::Quaternion orientation;
+		Ogre::Vector3 scale;
+
+		Bone() : handle(0), parent(NO_PARENT), position(Ogre::Vector3::ZERO),
+			orientation(Ogre::Quaternion::IDENTITY), scale(Ogre::Vector3::UNIT_SCALE) {}
+	};
+	typedef std::vector<Bone> BoneRecordList;
+
+	/// A key relative to the bone's binding pose
+	struct Key
+	{
+		float time;
+		Ogre::Quaternion rotation;
+		Ogre::Vector3 translate;
+		Ogre::Vector3 scale;
+	};
+	typedef std::vector<Key> KeyList;
+
+	/// The keys of one bone in one animation
+	struct Track
+	{
+		unsigned short handle;
+		KeyList keys;
+
+		Track() : handle(0) {}
+	};
+	typedef std::vector<Track> TrackList;
+
+	/// Opens the file and writes the header, throws on failure
+	HoudiniOgre_SkeletonWriter(const Ogre::String& filename);
+	~HoudiniOgre_SkeletonWriter();
+
+	/** Write the bones and their parent links. Handles must be contiguous
+		from 0, in any order. */
+	void writeBones(const BoneRecordList& bones);
+	/** Write an animation, optimising its tracks first (which changes 
+		them, so they are not const). */
+	void writeAnimation(const Ogre::String& name, float length, TrackList& tracks);
+	/// Flush and close the file, throws if anything failed to write
+	void close();
+
+	/** Thin out runs of identical keys, keeping the first two and last two
+		of each run so spline interpolation through them is unchanged. */
+	static void optimise(KeyList& keys);
+	/// Whether no key moves the bone away from its binding pose
+	static bool isIdentity(const KeyList& keys);
+
+	size_t getKeysWritten() const { return mKeysWritten; }
+	size_t getKeysDropped() const { return mKeysDropped; }
+
+protected:
+	void writeChunkHeader(unsigned short id, size_t size);
+	void writeString(const Ogre::String& str);
+	void writeShorts(const unsigned short* vals, size_t count);
+	void writeFloats(const float* vals, size_t count);
+	void writeVector(const Ogre::Vector3& v);
+	void writeQuaternion(const Ogre::Quaternion& q);
+
+	Ogre::String mFilename;
+	std::ofstream mStream;
+	bool mBonesWritten;
+	size_t mKeysWritten;
+	size_t mKeysDropped;
+
+};
+
+#endif
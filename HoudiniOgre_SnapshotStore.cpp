@@ -0,0 +1,191 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SnapshotStore.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_SnapshotStore.h"
+#include "HoudiniOgre_Escape.h"
+
+#include "OgreException.h"
+#include "OgreLogManager.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+#undef max
+#undef min
+
+namespace
+{
+	/// filename relative to folder (ending in a slash) if it's inside it
+	Ogre::String relativeTo(const Ogre::String& folder, const Ogre::String& filename)
+	{
+		if (!folder.empty() && Ogre::StringUtil::startsWith(filename, folder, false))
+			return filename.substr(folder.size());
+		return filename;
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_SnapshotStore::HoudiniOgre_SnapshotStore(Mode mode)
+: mMode(mode), mFrame(0), mReused(0), mStored(0)
+{
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_SnapshotStore::reuse(const HoudiniOgre_Hash& key, 
+	const std::vector<Ogre::String>& filenames)
+{
+	EntryMap::const_iterator e = mEntries.find(key.getValue());
+	if (e == mEntries.end() || e->second.size() != filenames.size())
+		return false;
+	const std::vector<Ogre::String>& sources = e->second;
+
+	if (mMode == MODE_LINK)
+	{
+		for (size_t f = 0; f < filenames.size(); ++f)
+		{
+			// the same frame can ask for the entry's own files
+			if (filenames[f] == sources[f])
+				continue;
+			LinkType type = linkFile(sources[f], filenames[f]);
+			if (type == LINK_NONE)
+			{
+				Ogre::LogManager::getSingleton().logMessage(
+					"Unable to link " + filenames[f] + " to " + sources[f] + ", exporting it");
+				return false;
+			}
+			if (type == LINK_COPY)
+			{
+				Ogre::LogManager::getSingleton().logMessage(
+					"Links aren't supported for " + filenames[f] + ", copied it instead");
+			}
+		}
+	}
+
+	for (size_t f = 0; f < filenames.size(); ++f)
+	{
+		FrameFile ff;
+		ff.frame = mFrame;
+		ff.name = filenames[f];
+		ff.source = sources[f];
+		mFrameFiles.push_back(ff);
+	}
+	Ogre::LogManager::getSingleton().logMessage("Snapshot unchanged, reusing " + 
+		sources.front() + " for " + filenames.front());
+	++mReused;
+	return true;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SnapshotStore::store(const HoudiniOgre_Hash& key, 
+	const std::vector<Ogre::String>& filenames)
+{
+	// keep the first, it's the one other frames may already refer to
+	if (!mEntries.insert(EntryMap::value_type(key.getValue(), filenames)).second)
+		return;
+
+	for (std::vector<Ogre::String>::const_iterator f = filenames.begin();
+		f != filenames.end(); ++f)
+	{
+		FrameFile ff;
+		ff.frame = mFrame;
+		ff.name = *f;
+		ff.source = *f;
+		mFrameFiles.push_back(ff);
+	}
+	++mStored;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SnapshotStore::save(const Ogre::String& filename) const
+{
+	std::ofstream ofs(filename.c_str());
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write frame manifest " + filename,
+			"HoudiniOgre_SnapshotStore::save");
+	}
+
+	Ogre::String::size_type slash = filename.find_last_of("/\\");
+	Ogre::String folder = slash == Ogre::String::npos ? 
+		Ogre::StringUtil::BLANK : filename.substr(0, slash + 1);
+
+	// files are recorded frame by frame, so just group the runs
+	ofs << "<frames>\n";
+	for (std::vector<FrameFile>::const_iterator f = mFrameFiles.begin(); f != mFrameFiles.end(); ++f)
+	{
+		if (f == mFrameFiles.begin() || f->frame != (f - 1)->frame)
+		{
+			if (f != mFrameFiles.begin())
+				ofs << "\t</frame>\n";
+			ofs << "\t<frame number=\"" << f->frame << "\">\n";
+		}
+		ofs << "\t\t<file name=\"" << HoudiniOgre_Escape::xml(relativeTo(folder, f->name))
+			<< "\" source=\"" << HoudiniOgre_Escape::xml(relativeTo(folder, f->source)) << "\"/>\n";
+	}
+	if (!mFrameFiles.empty())
+		ofs << "\t</frame>\n";
+	ofs << "</frames>\n";
+
+	Ogre::StringUtil::StrStreamType msg;
+	msg << "Wrote frame manifest " << filename << ": " << mStored << " exports, " 
+		<< mReused << " reused";
+	Ogre::LogManager::getSingleton().logMessage(msg.str());
+}
+//---------------------------------------------------------------------
+HoudiniOgre_SnapshotStore::LinkType HoudiniOgre_SnapshotStore::linkFile(
+	const Ogre::String& from, const Ogre::String& to)
+{
+	// replace whatever a previous render left there
+	std::remove(to.c_str());
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	if (CreateHardLinkA(to.c_str(), from.c_str(), 0))
+		return LINK_HARD;
+	// symbolic links need extra privileges on Windows, don't bother
+	if (CopyFileA(from.c_str(), to.c_str(), FALSE))
+		return LINK_COPY;
+#else
+	if (link(from.c_str(), to.c_str()) == 0)
+		return LINK_HARD;
+	// eg across file systems; absolute, so it works from any folder
+	char* target = realpath(from.c_str(), 0);
+	if (target)
+	{
+		bool linked = symlink(target, to.c_str()) == 0;
+		free(target);
+		if (linked)
+			return LINK_SYMBOLIC;
+	}
+	std::ifstream ifs(from.c_str(), std::ios::binary);
+	std::ofstream ofs(to.c_str(), std::ios::binary | std::ios::trunc);
+	if (ifs && ofs && (ofs << ifs.rdbuf()) && ofs.flush())
+		return LINK_COPY;
+#endif
+	return LINK_NONE;
+}
@@ -0,0 +1,120 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SnapshotStore.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_SnapshotStore__
+#define __HoudiniOgre_SnapshotStore__
+
+#include "HoudiniOgre_ExportCache.h"
+
+#include <map>
+#include <vector>
+
+/** Content-addressed store of the files written by a per-frame ($F)
+	export, so that an object which doesn't change over a range of frames
+	is only serialized once.
+@remarks
+	Each export is keyed by a hash of everything its files are built from
+	(see HoudiniOgre_Hash). The first frame with a given key writes its
+	files as usual and they become that key's entry; a later frame with
+	the same key reuses the entry instead of exporting. In MODE_LINK the
+	frame's files are hard links to the entry's (or symbolic links, or
+	copies, where the file system won't hard link); in MODE_MANIFEST
+	nothing is written for the frame at all, and the runtime finds its
+	files through the manifest.
+@par
+	Entries only last for the render; HoudiniOgre_ExportCache is what
+	keeps files between renders. The manifest written by save() lists
+	every file asked for on each frame and the file holding its contents:
+@code
+<frames>
+	<frame number="12">
+		<file name="crate.12.mesh" source="crate.1.mesh"/>
+	</frame>
+</frames>
+@endcode
+	Names are relative to the manifest's folder where they are inside it.
+*/
+class HoudiniOgre_SnapshotStore
+{
+public:
+	enum Mode
+	{
+		/// Link repeated frames' files to the first ones
+		MODE_LINK,
+		/// Write nothing for repeated frames, just list them in the manifest
+		MODE_MANIFEST
+	};
+
+	HoudiniOgre_SnapshotStore(Mode mode);
+
+	/// Frame the following reuse() / store() calls belong to
+	void setFrame(long frame) { mFrame = frame; }
+
+	/** Reference the files already exported for this key from filenames,
+		which must be in the same order as when they were stored.
+	@returns false if nothing has been stored for the key (or it couldn't
+		be linked), in which case the caller should export as usual
+	*/
+	bool reuse(const HoudiniOgre_Hash& key, const std::vector<Ogre::String>& filenames);
+	/// Make freshly exported files the entry for this key
+	void store(const HoudiniOgre_Hash& key, const std::vector<Ogre::String>& filenames);
+
+	/// Write the frame manifest, throws on failure
+	void save(const Ogre::String& filename) const;
+
+	Mode getMode() const { return mMode; }
+	/// Exports skipped because an identical one had been done
+	size_t getReused() const { return mReused; }
+	size_t getStored() const { return mStored; }
+
+protected:
+	/// How a file was reused
+	enum LinkType
+	{
+		LINK_NONE,
+		LINK_HARD,
+		LINK_SYMBOLIC,
+		LINK_COPY
+	};
+	static LinkType linkFile(const Ogre::String& from, const Ogre::String& to);
+
+	struct FrameFile
+	{
+		long frame;
+		Ogre::String name;
+		Ogre::String source;
+	};
+
+	Mode mMode;
+	long mFrame;
+	typedef std::map<HoudiniOgre_Hash::Value, std::vector<Ogre::String> > EntryMap;
+	EntryMap mEntries;
+	std::vector<FrameFile> mFrameFiles;
+	size_t mReused;
+	size_t mStored;
+
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Standalone.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_Standalone.h"
+#include "HoudiniOgre_MappedStore.h"
+
+#include "OgreLogManager.h"
+#include "OgreMeshManager.h"
+#include "OgreMaterialManager.h"
+#include "OgreSkeletonManager.h"
+
+#include <chrono>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+//---------------------------------------------------------------------
+HoudiniOgre_Standalone::HoudiniOgre_Standalone(const Ogre::String& logFile,
+	bool logToConsole)
+{
+	mLogMgr = new Ogre::LogManager();
+	mLogMgr->createLog(logFile, true, logToConsole);
+	mResMgr = new Ogre::ResourceGroupManager();
+	mMeshMgr = new Ogre::MeshManager();
+	mSkelMgr = new Ogre::SkeletonManager();
+	mMatMgr = new Ogre::MaterialManager();
+	mBufMgr = new HoudiniOgre_MappedBufferManager();
+}
+//---------------------------------------------------------------------
+HoudiniOgre_Standalone::~HoudiniOgre_Standalone()
+{
+	delete mBufMgr;
+	delete mMatMgr;
+	delete mSkelMgr;
+	delete mMeshMgr;
+	delete mResMgr;
+	delete mLogMgr;
+}
+//---------------------------------------------------------------------
+double HoudiniOgre_Standalone::now()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//---------------------------------------------------------------------
+size_t HoudiniOgre_Standalone::getPeakMemory()
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#	if OGRE_PLATFORM == OGRE_PLATFORM_APPLE
+	// bytes on OS X
+	return static_cast<size_t>(usage.ru_maxrss);
+#	else
+	// kilobytes on Linux
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#	endif
+#endif
+}
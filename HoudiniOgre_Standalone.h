@@ -0,0 +1,78 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Standalone.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_Standalone__
+#define __HoudiniOgre_Standalone__
+
+#include "HoudiniOgre_Prerequisites.h"
+
+namespace Ogre
+{
+	class LogManager;
+	class ResourceGroupManager;
+	class MeshManager;
+	class SkeletonManager;
+	class MaterialManager;
+}
+class HoudiniOgre_MappedBufferManager;
+
+/** Sets up the Ogre singletons the exporter needs, outside of Houdini.
+@remarks
+	This is the command line tools' equivalent of what HoudiniOgre_ROP does
+	around a render; create one of these at the top of main().
+*/
+class HoudiniOgre_Standalone
+{
+public:
+	/** Constructor.
+	@param logFile Ogre log file name
+	@param logToConsole Whether log messages are echoed to stdout
+	*/
+	HoudiniOgre_Standalone(const Ogre::String& logFile, bool logToConsole = false);
+	~HoudiniOgre_Standalone();
+
+	/// Wall clock time in seconds, for timing
+	static double now();
+	/// Peak resident memory of this process so far, in bytes
+	static size_t getPeakMemory();
+
+	/// For giving the buffers a mapped store, to export out of core
+	HoudiniOgre_MappedBufferManager* getBufferManager() const { return mBufMgr; }
+
+protected:
+	Ogre::LogManager* mLogMgr;
+	Ogre::ResourceGroupManager* mResMgr;
+	Ogre::MeshManager* mMeshMgr;
+	Ogre::SkeletonManager* mSkelMgr;
+	Ogre::MaterialManager* mMatMgr;
+	HoudiniOgre_MappedBufferManager* mBufMgr;
+
+private:
+	HoudiniOgre_Standalone(const HoudiniOgre_Standalone&);
+	HoudiniOgre_Standalone& operator=(const HoudiniOgre_Standalone&);
+
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SubsetSource.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_SubsetSource.h"
+
+#include <algorithm>
+#include <map>
+
+//---------------------------------------------------------------------
+HoudiniOgre_SubsetSource::HoudiniOgre_SubsetSource(
+	const HoudiniOgre_GeometrySource& parent, const Ogre::String& name,
+	const std::vector<int>& primitives, const Ogre::Matrix4& xform)
+: mParent(parent)
+, mName(name)
+, mPrimitives(primitives)
+, mTransform(xform != Ogre::Matrix4::IDENTITY)
+, mXform(xform)
+{
+	xform.extract3x3Matrix(mRot);
+
+	// Renumber the points we use in order of first use
+	std::map<int, int> pointRemap;
+	mVertexStarts.reserve(mPrimitives.size() + 1);
+	for (size_t p = 0; p < mPrimitives.size(); ++p)
+	{
+		mVertexStarts.push_back(mVertexPoints.size());
+		int vcount = mParent.getPrimitiveVertexCount(mPrimitives[p]);
+		for (int v = 0; v < vcount; ++v)
+		{
+			int parentPoint = mParent.getVertexPoint(mPrimitives[p], v);
+			std::pair<std::map<int, int>::iterator, bool> ins = pointRemap.insert(
+				std::make_pair(parentPoint, static_cast<int>(mPoints.size())));
+			if (ins.second)
+			{
+				mPoints.push_back(parentPoint);
+			}
+			mVertexPoints.push_back(ins.first->second);
+		}
+	}
+	mVertexStarts.push_back(mVertexPoints.size());
+
+	// Cut the material groups down to our primitives
+	const MaterialGroupList& groups = mParent.getMaterialGroups();
+	if (!groups.empty())
+	{
+		std::map<int, int> primRemap;
+		for (size_t p = 0; p < mPrimitives.size(); ++p)
+		{
+			primRemap[mPrimitives[p]] = static_cast<int>(p);
+		}
+		for (MaterialGroupList::const_iterator g = groups.begin(); g != groups.end(); ++g)
+		{
+			MaterialGroup group;
+			group.name = g->name;
+			group.materialName = g->materialName;
+			for (std::vector<int>::const_iterator p = g->primitives.begin();
+				p != g->primitives.end(); ++p)
+			{
+				std::map<int, int>::iterator i = primRemap.find(*p);
+				if (i != primRemap.end())
+				{
+					group.primitives.push_back(i->second);
+				}
+			}
+			if (!group.primitives.empty())
+			{
+				std::sort(group.primitives.begin(), group.primitives.end());
+				mMaterialGroups.push_back(group);
+			}
+		}
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_SubsetSource::~HoudiniOgre_SubsetSource()
+{
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_SubsetSource::getPointPosition(int point) const
+{
+	Ogre::Vector3 pos = mParent.getPointPosition(mPoints[point]);
+	return mTransform ? mXform * pos : pos;
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_SubsetSource::getNormal(int prim, int vertex) const
+{
+	Ogre::Vector3 normal = mParent.getNormal(mPrimitives[prim], vertex);
+	return mTransform ? mRot * normal : normal;
+}
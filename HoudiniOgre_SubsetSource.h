@@ -0,0 +1,126 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SubsetSource.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_SubsetSource__
+#define __HoudiniOgre_SubsetSource__
+
+#include "HoudiniOgre_GeometrySource.h"
+
+/** Geometry source presenting some of the primitives of another source.
+@remarks
+	Only the points used by the chosen primitives are visible, renumbered
+	in the order they're first used, and material groups are cut down to
+	the chosen primitives; so the subset looks like an object of its own,
+	and hashes like one (see HoudiniOgre_Hash::addLocalGeometry). Positions
+	and normals can optionally be transformed on the way through.
+@par
+	The parent source must outlive the subset.
+*/
+class HoudiniOgre_SubsetSource : public HoudiniOgre_GeometrySource
+{
+public:
+	/** Constructor.
+	@param parent The source to take primitives from
+	@param name Name of the subset
+	@param primitives Primitives of the parent to include, in order
+	@param xform Transform to apply to positions (and its rotation to normals)
+	*/
+	HoudiniOgre_SubsetSource(const HoudiniOgre_GeometrySource& parent,
+		const Ogre::String& name, const std::vector<int>& primitives,
+		const Ogre::Matrix4& xform = Ogre::Matrix4::IDENTITY);
+	virtual ~HoudiniOgre_SubsetSource();
+
+	const Ogre::String& getName() const { return mName; }
+	long getFrame() const { return mParent.getFrame(); }
+
+	int getPointCount() const { return static_cast<int>(mPoints.size()); }
+	int getPrimitiveCount() const { return static_cast<int>(mPrimitives.size()); }
+	bool isPolygon(int prim) const { return mParent.isPolygon(mPrimitives[prim]); }
+	int getPrimitiveVertexCount(int prim) const
+	{
+		return static_cast<int>(mVertexStarts[prim + 1] - mVertexStarts[prim]);
+	}
+	int getVertexPoint(int prim, int vertex) const
+	{
+		return mVertexPoints[mVertexStarts[prim] + vertex];
+	}
+	Ogre::Vector3 getPointPosition(int point) const;
+
+	bool hasNormals() const { return mParent.hasNormals(); }
+	Ogre::Vector3 getNormal(int prim, int vertex) const;
+	size_t getUVSetCount() const { return mParent.getUVSetCount(); }
+	void getUV(size_t uvSet, int prim, int vertex, float& u, float& v) const
+	{
+		mParent.getUV(uvSet, mPrimitives[prim], vertex, u, v);
+	}
+	bool hasColours() const { return mParent.hasColours(); }
+	Ogre::ColourValue getColour(int prim, int vertex) const
+	{
+		return mParent.getColour(mPrimitives[prim], vertex);
+	}
+	void logAttributeInfo() const { mParent.logAttributeInfo(); }
+
+	const Ogre::String& getMaterialName() const { return mParent.getMaterialName(); }
+	const MaterialGroupList& getMaterialGroups() const { return mMaterialGroups; }
+	void getWorldTransform(Ogre::Matrix4& xform, Ogre::Matrix3& rot) const
+	{
+		mParent.getWorldTransform(xform, rot);
+	}
+
+	size_t getCaptureRegionCount() const { return mParent.getCaptureRegionCount(); }
+	OBJ_Bone* getCaptureRegionBone(size_t region) const
+	{
+		return mParent.getCaptureRegionBone(region);
+	}
+	void getCaptureWeights(int point, std::vector<int>& regions,
+		std::vector<float>& weights) const
+	{
+		mParent.getCaptureWeights(mPoints[point], regions, weights);
+	}
+	void getAnimationCycles(int numFrames, int frameStart, float fps,
+		AnimationList& cycles) const
+	{
+		mParent.getAnimationCycles(numFrames, frameStart, fps, cycles);
+	}
+
+protected:
+	const HoudiniOgre_GeometrySource& mParent;
+	Ogre::String mName;
+	/// Parent primitive for each of ours
+	std::vector<int> mPrimitives;
+	/// Parent point for each of ours
+	std::vector<int> mPoints;
+	/// Our point for each vertex, primitive by primitive
+	std::vector<int> mVertexPoints;
+	/// Start of each primitive's vertices in mVertexPoints, plus the end
+	std::vector<size_t> mVertexStarts;
+	MaterialGroupList mMaterialGroups;
+	bool mTransform;
+	Ogre::Matrix4 mXform;
+	Ogre::Matrix3 mRot;
+
+};
+
+#endif
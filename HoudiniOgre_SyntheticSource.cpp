@@ -0,0 +1,107 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SyntheticSource.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_SyntheticSource.h"
+
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+
+//---------------------------------------------------------------------
+HoudiniOgre_SyntheticSource::HoudiniOgre_SyntheticSource(const Ogre::String& name,
+	int cells, size_t uvSets, float seamRatio, bool normals, bool colours,
+	size_t materialCount)
+: mName(name)
+, mMaterialName("BaseWhite")
+, mCells(cells)
+, mUVSets(uvSets)
+, mSeamStride(0)
+, mNormals(normals)
+, mColours(colours)
+{
+	if (seamRatio > 0.0f)
+	{
+		mSeamStride = std::max(1, static_cast<int>(1.0f / std::min(seamRatio, 1.0f) + 0.5f));
+	}
+
+	// Rows are split into equal bands, the first uses the object material
+	for (size_t m = 1; m < materialCount; ++m)
+	{
+		MaterialGroup group;
+		group.materialName = mMaterialName + Ogre::StringConverter::toString(m);
+		group.name = mName + "_" + group.materialName;
+		int firstRow = static_cast<int>(mCells * m / materialCount);
+		int endRow = static_cast<int>(mCells * (m + 1) / materialCount);
+		for (int prim = firstRow * mCells; prim < endRow * mCells; ++prim)
+		{
+			group.primitives.push_back(prim);
+		}
+		mMaterialGroups.push_back(group);
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_SyntheticSource::~HoudiniOgre_SyntheticSource()
+{
+}
+//---------------------------------------------------------------------
+int HoudiniOgre_SyntheticSource::getVertexPoint(int prim, int vertex) const
+{
+	int row = prim / mCells;
+	int col = prim % mCells;
+	// clockwise seen from above, as Houdini does it
+	static const int colOffset[4] = { 0, 0, 1, 1 };
+	static const int rowOffset[4] = { 0, 1, 1, 0 };
+	return (row + rowOffset[vertex]) * (mCells + 1) + col + colOffset[vertex];
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_SyntheticSource::getPointPosition(int point) const
+{
+	int row = point / (mCells + 1);
+	int col = point % (mCells + 1);
+	return Ogre::Vector3(static_cast<Ogre::Real>(col), 0, static_cast<Ogre::Real>(row));
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_SyntheticSource::getUV(size_t uvSet, int prim, int vertex,
+	float& u, float& v) const
+{
+	int point = getVertexPoint(prim, vertex);
+	int row = point / (mCells + 1);
+	int col = point % (mCells + 1);
+	float scale = 1.0f / mCells;
+	u = col * scale;
+	v = row * scale + uvSet;
+	// The quad on the right of a seam column starts a new UV island
+	int primCol = prim % mCells;
+	if (mSeamStride && col == primCol && col % mSeamStride == 0)
+	{
+		u += 1.0f;
+	}
+}
+//---------------------------------------------------------------------
+Ogre::ColourValue HoudiniOgre_SyntheticSource::getColour(int prim, int vertex) const
+{
+	int point = getVertexPoint(prim, vertex);
+	float scale = 1.0f / getPointCount();
+	return Ogre::ColourValue(point * scale, 1.0f - point * scale, 0.5f, 1.0f);
+}
@@ -0,0 +1,89 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_SyntheticSource.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_SyntheticSource__
+#define __HoudiniOgre_SyntheticSource__
+
+#include "HoudiniOgre_GeometrySource.h"
+
+/** Geometry source generating a flat grid of quads, for benchmarking.
+@remarks
+	The grid lies in the XZ plane with cells x cells quads sharing
+	(cells+1)^2 points. Normals and colours live on the points, texture
+	coordinates on the vertices. A fraction of the grid's columns can be
+	made into UV seams, where the quads either side use different texture
+	coordinates for the shared points; this is what forces the exporter to
+	split vertices, so it controls how much work the welding has to do.
+*/
+class HoudiniOgre_SyntheticSource : public HoudiniOgre_GeometrySource
+{
+public:
+	/** Constructor.
+	@param name Object name
+	@param cells Number of quads along each side
+	@param uvSets Number of texture coordinate sets (0 for none)
+	@param seamRatio Fraction of columns which are UV seams, 0 to 1
+	@param normals Whether to provide normals
+	@param colours Whether to provide vertex colours
+	@param materialCount Number of materials, assigned in bands of rows
+	*/
+	HoudiniOgre_SyntheticSource(const Ogre::String& name, int cells,
+		size_t uvSets = 1, float seamRatio = 0.0f, bool normals = true,
+		bool colours = false, size_t materialCount = 1);
+	virtual ~HoudiniOgre_SyntheticSource();
+
+	const Ogre::String& getName() const { return mName; }
+
+	int getPointCount() const { return (mCells + 1) * (mCells + 1); }
+	int getPrimitiveCount() const { return mCells * mCells; }
+	bool isPolygon(int prim) const { return true; }
+	int getPrimitiveVertexCount(int prim) const { return 4; }
+	int getVertexPoint(int prim, int vertex) const;
+	Ogre::Vector3 getPointPosition(int point) const;
+
+	bool hasNormals() const { return mNormals; }
+	Ogre::Vector3 getNormal(int prim, int vertex) const { return Ogre::Vector3::UNIT_Y; }
+	size_t getUVSetCount() const { return mUVSets; }
+	void getUV(size_t uvSet, int prim, int vertex, float& u, float& v) const;
+	bool hasColours() const { return mColours; }
+	Ogre::ColourValue getColour(int prim, int vertex) const;
+
+	const Ogre::String& getMaterialName() const { return mMaterialName; }
+	const MaterialGroupList& getMaterialGroups() const { return mMaterialGroups; }
+
+protected:
+	Ogre::String mName;
+	Ogre::String mMaterialName;
+	MaterialGroupList mMaterialGroups;
+	int mCells;
+	size_t mUVSets;
+	/// Every mSeamStride'th column is a seam (0 for none)
+	int mSeamStride;
+	bool mNormals;
+	bool mColours;
+
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Trace.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_Trace.h"
+#include "HoudiniOgre_Escape.h"
+
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	/// Spans recorded by one thread; only that thread appends to it
+	struct ThreadBuffer
+	{
+		int threadID;
+		std::deque<HoudiniOgre_Trace::Event> events;
+	};
+	typedef std::vector<ThreadBuffer*> ThreadBufferList;
+
+	/// Guards registration of buffers, and the trace file name
+	std::mutex gRegistryMutex;
+	/// Every buffer ever registered (they live as long as the process)
+	ThreadBufferList gBuffers;
+	Ogre::String gFilename;
+	std::chrono::steady_clock::time_point gStartTime;
+
+	thread_local ThreadBuffer* tBuffer = 0;
+
+	//---------------------------------------------------------------------
+	ThreadBuffer* getThreadBuffer()
+	{
+		if (!tBuffer)
+		{
+			std::lock_guard<std::mutex> lock(gRegistryMutex);
+			tBuffer = new ThreadBuffer();
+			tBuffer->threadID = static_cast<int>(gBuffers.size()) + 1;
+			gBuffers.push_back(tBuffer);
+		}
+		return tBuffer;
+	}
+	//---------------------------------------------------------------------
+	void writeEscaped(std::ostream& os, const Ogre::String& str)
+	{
+		os << '"' << HoudiniOgre_Escape::json(str) << '"';
+	}
+}
+
+std::atomic<bool> HoudiniOgre_Trace::msEnabled(false);
+//---------------------------------------------------------------------
+void HoudiniOgre_Trace::start(const Ogre::String& filename)
+{
+	{
+		std::lock_guard<std::mutex> lock(gRegistryMutex);
+		gFilename = filename;
+		gStartTime = std::chrono::steady_clock::now();
+		for (ThreadBufferList::iterator i = gBuffers.begin(); i != gBuffers.end(); ++i)
+		{
+			(*i)->events.clear();
+		}
+	}
+	msEnabled.store(true, std::memory_order_release);
+}
+//---------------------------------------------------------------------
+bool HoudiniOgre_Trace::stop()
+{
+	if (!msEnabled.exchange(false, std::memory_order_acq_rel))
+		return true;
+
+	std::lock_guard<std::mutex> lock(gRegistryMutex);
+
+	std::ofstream ofs(gFilename.c_str(), std::ios::out | std::ios::trunc);
+	if (!ofs)
+		return false;
+
+	ofs.precision(3);
+	ofs << std::fixed;
+	ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for (ThreadBufferList::iterator i = gBuffers.begin(); i != gBuffers.end(); ++i)
+	{
+		ThreadBuffer* buf = *i;
+		if (buf->events.empty())
+			continue;
+
+		// Name the thread so the viewer labels its track
+		if (!first)
+			ofs << ",\n";
+		first = false;
+		ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buf->threadID
+			<< ",\"args\":{\"name\":\"export thread " << buf->threadID << "\"}}";
+
+		for (std::deque<Event>::iterator e = buf->events.begin(); e != buf->events.end(); ++e)
+		{
+			ofs << ",\n{\"name\":\"" << e->name << "\",\"cat\":\"export\",\"ph\":\"X\""
+				<< ",\"ts\":" << e->start << ",\"dur\":" << e->duration
+				<< ",\"pid\":1,\"tid\":" << buf->threadID << ",\"args\":{";
+			bool firstArg = true;
+			if (!e->object.empty())
+			{
+				ofs << "\"object\":";
+				writeEscaped(ofs, e->object);
+				firstArg = false;
+			}
+			for (int a = 0; a < MAX_INT_ARGS; ++a)
+			{
+				if (!e->intArgNames[a])
+					continue;
+				if (!firstArg)
+					ofs << ",";
+				ofs << "\"" << e->intArgNames[a] << "\":" << e->intArgValues[a];
+				firstArg = false;
+			}
+			ofs << "}}";
+		}
+		buf->events.clear();
+	}
+	ofs << "\n]}\n";
+
+	return ofs.good();
+}
+//---------------------------------------------------------------------
+double HoudiniOgre_Trace::now()
+{
+	return std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - gStartTime).count();
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_Trace::record(const Event& evt)
+{
+	getThreadBuffer()->events.push_back(evt);
+}
+//---------------------------------------------------------------------
+//---------------------------------------------------------------------
+HoudiniOgre_TraceSpan::HoudiniOgre_TraceSpan(const char* name, const char* object,
+	const char* argName, long argValue)
+	: mActive(HoudiniOgre_Trace::isEnabled())
+{
+	if (mActive)
+	{
+		mEvent.name = name;
+		if (object)
+			mEvent.object = object;
+		for (int a = 0; a < HoudiniOgre_Trace::MAX_INT_ARGS; ++a)
+		{
+			mEvent.intArgNames[a] = 0;
+			mEvent.intArgValues[a] = 0;
+		}
+		if (argName)
+			addArg(argName, argValue);
+		mEvent.start = HoudiniOgre_Trace::now();
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_TraceSpan::~HoudiniOgre_TraceSpan()
+{
+	// Spans still open when recording stopped are discarded
+	if (mActive && HoudiniOgre_Trace::isEnabled())
+	{
+		mEvent.duration = HoudiniOgre_Trace::now() - mEvent.start;
+		HoudiniOgre_Trace::record(mEvent);
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_TraceSpan::addArg(const char* argName, long argValue)
+{
+	if (!mActive)
+		return;
+
+	for (int a = 0; a < HoudiniOgre_Trace::MAX_INT_ARGS; ++a)
+	{
+		if (!mEvent.intArgNames[a])
+		{
+			mEvent.intArgNames[a] = argName;
+			mEvent.intArgValues[a] = argValue;
+			return;
+		}
+	}
+}
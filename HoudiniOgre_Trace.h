@@ -0,0 +1,111 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_Trace.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_Trace__
+#define __HoudiniOgre_Trace__
+
+#include "OgreString.h"
+
+#include <atomic>
+
+/** Records a timeline of export activity as a Chrome trace-event file.
+@remarks
+	Each thread appends completed spans to a buffer that only it writes to,
+	so recording never takes a lock; a lock is only taken the first time a
+	thread records anything, to register its buffer. While no trace is
+	being recorded, opening a span costs a single flag test.
+@par
+	The file written by stop() can be opened in chrome://tracing or
+	https://ui.perfetto.dev. Spans must not be open on other threads when
+	stop() is called.
+*/
+class HoudiniOgre_Trace
+{
+public:
+	/// Maximum number of integer arguments a span can carry
+	static const int MAX_INT_ARGS = 2;
+
+	/// A completed span
+	struct Event
+	{
+		/// Span name, must be a string literal
+		const char* name;
+		/// Start time in microseconds since start() was called
+		double start;
+		/// Duration in microseconds
+		double duration;
+		/// Object (or file) this span relates to, may be blank
+		Ogre::String object;
+		/// Integer arguments (names must be string literals, 0 if unused)
+		const char* intArgNames[MAX_INT_ARGS];
+		long intArgValues[MAX_INT_ARGS];
+	};
+
+	/** Begin recording, the trace will be written to the given file
+		when stop() is called. */
+	static void start(const Ogre::String& filename);
+	/** Stop recording and write the trace file.
+	@returns false if the file could not be written
+	*/
+	static bool stop();
+	/// Are we recording at the moment?
+	static bool isEnabled() { return msEnabled.load(std::memory_order_relaxed); }
+	/// Time in microseconds since recording started
+	static double now();
+	/// Record a completed span against the calling thread
+	static void record(const Event& evt);
+
+protected:
+	static std::atomic<bool> msEnabled;
+
+};
+
+/** Times the enclosing scope and records it as a span in the trace.
+@remarks
+	Does nothing (beyond testing a flag) if no trace is being recorded,
+	so the object name is taken as a plain C string and only copied when
+	needed.
+*/
+class HoudiniOgre_TraceSpan
+{
+public:
+	HoudiniOgre_TraceSpan(const char* name, const char* object,
+		const char* argName = 0, long argValue = 0);
+	~HoudiniOgre_TraceSpan();
+
+	/// Attach an extra integer argument to the span
+	void addArg(const char* argName, long argValue);
+
+protected:
+	bool mActive;
+	HoudiniOgre_Trace::Event mEvent;
+
+private:
+	// not copyable
+	HoudiniOgre_TraceSpan(const HoudiniOgre_TraceSpan&);
+	HoudiniOgre_TraceSpan& operator=(const HoudiniOgre_TraceSpan&);
+};
+
+#endif
@@ -0,0 +1,404 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_VertexAnimation.cpp
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+#include "HoudiniOgre_VertexAnimation.h"
+#include "HoudiniOgre_Trace.h"
+#include "HoudiniOgre_Simd.h"
+#include "HoudiniOgre_Escape.h"
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "OgreException.h"
+#include "OgreBitwise.h"
+#include "OgreMatrix3.h"
+#include "OgreMatrix4.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#undef max
+#undef min
+
+namespace
+{
+	/// The D3D format numbers DDS files use as four CCs for 4 channel float textures
+	const Ogre::uint32 DDS_A16B16G16R16F = 113;
+	const Ogre::uint32 DDS_A32B32G32R32F = 116;
+
+	/// Write a DDS header for an uncompressed, single mip level texture
+	void writeDDSHeader(std::ofstream& ofs, size_t width, size_t height, 
+		Ogre::uint32 fourCC, size_t bytesPerTexel)
+	{
+		Ogre::uint32 header[31] = { 0 };
+		header[0] = 124;	// header size
+		header[1] = 0x100F;	// caps, height, width, pitch, pixel format
+		header[2] = static_cast<Ogre::uint32>(height);
+		header[3] = static_cast<Ogre::uint32>(width);
+		header[4] = static_cast<Ogre::uint32>(width * bytesPerTexel);
+		// pixel format, after depth, mip count and 11 reserved
+		header[18] = 32;	// pixel format size
+		header[19] = 0x4;	// four CC
+		header[20] = fourCC;
+		header[26] = 0x1000;	// texture
+		ofs.write("DDS ", 4);
+		ofs.write(reinterpret_cast<const char*>(header), sizeof(header));
+	}
+}
+//---------------------------------------------------------------------
+HoudiniOgre_VertexAnimation::HoudiniOgre_VertexAnimation()
+: mHalfFloat(true), mFps(1), mFrameCount(0), mWidth(0), mRowsPerFrame(0), 
+  mHasNormals(false)
+{
+}
+//---------------------------------------------------------------------
+HoudiniOgre_VertexAnimation::~HoudiniOgre_VertexAnimation()
+{
+	clear();
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_VertexAnimation::setCycles(const AnimationList& cycles, float fps)
+{
+	mCycles = cycles;
+	mFps = fps;
+	mFrameCount = 0;
+	for (AnimationList::const_iterator c = mCycles.begin(); c != mCycles.end(); ++c)
+	{
+		mFrameCount += static_cast<size_t>(std::max(0L, c->endFrame - c->startFrame + 1));
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_VertexAnimation::sample(size_t geometry, 
+	const HoudiniOgre_GeometrySource& source, 
+	const HoudiniOgre_GeometrySource::Columns& base, bool useObjectTransforms,
+	HoudiniOgre_MappedStore* store)
+{
+	HoudiniOgre_TraceSpan span("sampleVertexAnimation", source.getName().c_str(), 
+		"frames", static_cast<long>(mFrameCount));
+
+	std::unique_ptr<Samples> samples(new Samples(store));
+	samples->pointCount = base.positions.size();
+	samples->vertexPoints = base.vertexPoints;
+	size_t vertexCount = base.vertexPoints.size();
+	bool normals = !base.normals.empty();
+	samples->positions.reserve(samples->pointCount * mFrameCount);
+	if (normals)
+	{
+		samples->normals.reserve(vertexCount * mFrameCount);
+	}
+
+	for (AnimationList::const_iterator c = mCycles.begin(); c != mCycles.end(); ++c)
+	{
+		for (long frame = c->startFrame; frame <= c->endFrame; ++frame)
+		{
+			std::unique_ptr<HoudiniOgre_GeometrySource> frameSource(
+				source.createAtTime(static_cast<float>(frame) / mFps));
+			if (!frameSource.get())
+			{
+				Ogre::LogManager::getSingleton().logMessage("Vertex animation: " + 
+					source.getName() + " can't be read at other frames, it will hold still");
+				return;
+			}
+
+			HoudiniOgre_GeometrySource::Columns storage;
+			const HoudiniOgre_GeometrySource::Columns& columns = frameSource->gather(storage);
+			if (columns.positions.size() != samples->pointCount || 
+				columns.vertexPoints.size() != vertexCount)
+			{
+				OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS,
+					"The points or polygons of " + source.getName() + " change at frame " + 
+					Ogre::StringConverter::toString(frame) + 
+					", vertex animation textures need the same ones throughout",
+					"HoudiniOgre_VertexAnimation::sample");
+			}
+
+			Ogre::Matrix4 xform;
+			Ogre::Matrix3 rot;
+			if (useObjectTransforms)
+			{
+				frameSource->getWorldTransform(xform, rot);
+			}
+
+			size_t offset = samples->positions.size();
+			samples->positions.resize(offset + samples->pointCount);
+			if (samples->pointCount)
+			{
+				if (useObjectTransforms)
+				{
+					HoudiniOgre_Simd::transformPoints(xform, &columns.positions[0], 
+						&samples->positions[offset], samples->pointCount);
+				}
+				else
+				{
+					std::copy(columns.positions.begin(), columns.positions.end(), 
+						samples->positions.begin() + offset);
+				}
+			}
+
+			if (normals)
+			{
+				// normals which come and go hold the base frame's
+				const std::vector<Ogre::Vector3>& frameNormals = 
+					columns.normals.size() == vertexCount ? columns.normals : base.normals;
+				offset = samples->normals.size();
+				samples->normals.resize(offset + vertexCount);
+				if (useObjectTransforms)
+				{
+					HoudiniOgre_Simd::transformVectors(rot, &frameNormals[0], 
+						&samples->normals[offset], vertexCount);
+				}
+				else
+				{
+					std::copy(frameNormals.begin(), frameNormals.end(), 
+						samples->normals.begin() + offset);
+				}
+			}
+
+			if (store)
+				store->trim();
+		}
+	}
+
+	if (mSamples.size() <= geometry)
+	{
+		mSamples.resize(geometry + 1, 0);
+	}
+	delete mSamples[geometry];
+	mSamples[geometry] = samples.release();
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_VertexAnimation::begin(size_t vertexCount)
+{
+	mOrigins.clear();
+	mOrigins.reserve(vertexCount);
+	mSubMeshSets.clear();
+	mBounds.setNull();
+	mHasNormals = false;
+	mWidth = std::max(size_t(1), std::min(vertexCount, size_t(MAX_WIDTH)));
+	mRowsPerFrame = std::max(size_t(1), (vertexCount + mWidth - 1) / mWidth);
+	if (mRowsPerFrame * mFrameCount > size_t(MAX_HEIGHT))
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS,
+			"Vertex animation textures for " + Ogre::StringConverter::toString(vertexCount) + 
+			" vertices and " + Ogre::StringConverter::toString(mFrameCount) + 
+			" frames would be more than " + Ogre::StringConverter::toString(MAX_HEIGHT) + 
+			" texels high; at most " + Ogre::StringConverter::toString(MAX_HEIGHT / mRowsPerFrame) + 
+			" frames fit", "HoudiniOgre_VertexAnimation::begin");
+	}
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_VertexAnimation::addVertex(size_t geometry, size_t vertex, 
+	const Ogre::Vector3& position, const Ogre::Vector3& normal)
+{
+	size_t texel = mOrigins.size();
+	Origin origin;
+	origin.geometry = static_cast<Ogre::uint32>(geometry);
+	origin.vertex = static_cast<Ogre::uint32>(vertex);
+	origin.position = position;
+	origin.normal = normal;
+	mOrigins.push_back(origin);
+
+	// the middle of the texel, in the first frame's rows
+	size_t height = mRowsPerFrame * std::max(mFrameCount, size_t(1));
+	return Ogre::Vector3(
+		((texel % mWidth) + 0.5f) / mWidth,
+		((texel / mWidth) + 0.5f) / height,
+		0);
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_VertexAnimation::addSubMesh(unsigned short subMesh, 
+	unsigned short texCoordSet, bool hasNormals)
+{
+	mSubMeshSets.push_back(std::make_pair(subMesh, texCoordSet));
+	mHasNormals = mHasNormals || hasNormals;
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_VertexAnimation::getPosition(const Origin& origin, size_t frame) const
+{
+	const Samples* samples = origin.geometry < mSamples.size() ? mSamples[origin.geometry] : 0;
+	if (!samples)
+		return origin.position;
+	return samples->positions[frame * samples->pointCount + samples->vertexPoints[origin.vertex]];
+}
+//---------------------------------------------------------------------
+Ogre::Vector3 HoudiniOgre_VertexAnimation::getNormal(const Origin& origin, size_t frame) const
+{
+	const Samples* samples = origin.geometry < mSamples.size() ? mSamples[origin.geometry] : 0;
+	if (!samples || samples->normals.empty())
+		return origin.normal;
+	return samples->normals[frame * samples->vertexPoints.size() + origin.vertex];
+}
+//---------------------------------------------------------------------
+const Ogre::AxisAlignedBox& HoudiniOgre_VertexAnimation::computeBounds()
+{
+	mBounds.setNull();
+	for (size_t frame = 0; frame < mFrameCount; ++frame)
+	{
+		for (std::vector<Origin>::const_iterator o = mOrigins.begin(); o != mOrigins.end(); ++o)
+		{
+			mBounds.merge(getPosition(*o, frame));
+		}
+	}
+	return mBounds;
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_VertexAnimation::save(const Ogre::String& baseName) const
+{
+	HoudiniOgre_TraceSpan span("saveVertexAnimation", baseName.c_str(), 
+		"vertices", static_cast<long>(mOrigins.size()));
+
+	Ogre::String positionsFile = baseName + ".vat_pos.dds";
+	Ogre::String normalsFile = baseName + ".vat_nrm.dds";
+	writeTexture(positionsFile, false);
+	if (mHasNormals)
+	{
+		writeTexture(normalsFile, true);
+	}
+
+	Ogre::String layoutFile = baseName + ".vat.xml";
+	std::ofstream ofs(layoutFile.c_str());
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write vertex animation layout " + layoutFile,
+			"HoudiniOgre_VertexAnimation::save");
+	}
+
+	// only the names, the textures sit next to the layout
+	Ogre::String path, positionsName, normalsName;
+	Ogre::StringUtil::splitFilename(positionsFile, positionsName, path);
+	Ogre::StringUtil::splitFilename(normalsFile, normalsName, path);
+
+	const Ogre::Vector3& min = mBounds.isNull() ? Ogre::Vector3::ZERO : mBounds.getMinimum();
+	const Ogre::Vector3& max = mBounds.isNull() ? Ogre::Vector3::ZERO : mBounds.getMaximum();
+	ofs << "<vertexanimation width=\"" << mWidth
+		<< "\" height=\"" << mRowsPerFrame * mFrameCount
+		<< "\" rowsPerFrame=\"" << mRowsPerFrame
+		<< "\" frames=\"" << mFrameCount
+		<< "\" vertices=\"" << mOrigins.size()
+		<< "\" format=\"" << (mHalfFloat ? "half" : "float")
+		<< "\" fps=\"" << mFps
+		<< "\" positions=\"" << HoudiniOgre_Escape::xml(positionsName)
+		<< "\" normals=\"" << (mHasNormals ? HoudiniOgre_Escape::xml(normalsName) : Ogre::StringUtil::BLANK)
+		<< "\" min=\"" << min.x << " " << min.y << " " << min.z
+		<< "\" max=\"" << max.x << " " << max.y << " " << max.z << "\">\n";
+	for (size_t s = 0; s < mSubMeshSets.size(); ++s)
+	{
+		ofs << "\t<submesh index=\"" << mSubMeshSets[s].first
+			<< "\" texcoord=\"" << mSubMeshSets[s].second << "\"/>\n";
+	}
+	size_t frame = 0;
+	for (AnimationList::const_iterator c = mCycles.begin(); c != mCycles.end(); ++c)
+	{
+		size_t frames = static_cast<size_t>(std::max(0L, c->endFrame - c->startFrame + 1));
+		ofs << "\t<animation name=\"" << HoudiniOgre_Escape::xml(c->animationName)
+			<< "\" row=\"" << frame * mRowsPerFrame
+			<< "\" frames=\"" << frames << "\"/>\n";
+		frame += frames;
+	}
+	ofs << "</vertexanimation>\n";
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_VertexAnimation::writeTexture(const Ogre::String& filename, bool normals) const
+{
+	std::ofstream ofs(filename.c_str(), std::ios::binary);
+	if (!ofs)
+	{
+		OGRE_EXCEPT(Ogre::Exception::ERR_CANNOT_WRITE_TO_FILE,
+			"Unable to write vertex animation texture " + filename,
+			"HoudiniOgre_VertexAnimation::writeTexture");
+	}
+
+	writeDDSHeader(ofs, mWidth, mRowsPerFrame * mFrameCount, 
+		mHalfFloat ? DDS_A16B16G16R16F : DDS_A32B32G32R32F, 
+		mHalfFloat ? 4 * sizeof(Ogre::uint16) : 4 * sizeof(float));
+
+	// positions relative to the box, normals from -1..1 to 0..1
+	Ogre::Vector3 offset = Ogre::Vector3::UNIT_SCALE;
+	Ogre::Vector3 scale = Ogre::Vector3::UNIT_SCALE * 0.5f;
+	if (!normals && !mBounds.isNull())
+	{
+		Ogre::Vector3 size = mBounds.getMaximum() - mBounds.getMinimum();
+		offset = -mBounds.getMinimum();
+		scale = Ogre::Vector3(size.x > 0 ? 1 / size.x : 0,
+			size.y > 0 ? 1 / size.y : 0, size.z > 0 ? 1 / size.z : 0);
+	}
+
+	// a frame at a time, padding texels included
+	size_t frameTexels = mWidth * mRowsPerFrame;
+	std::vector<float> texels(frameTexels * 4, 0.0f);
+	std::vector<Ogre::uint16> halfTexels(mHalfFloat ? texels.size() : 0);
+	for (size_t frame = 0; frame < mFrameCount; ++frame)
+	{
+		for (size_t t = 0; t < mOrigins.size(); ++t)
+		{
+			Ogre::Vector3 v;
+			if (normals)
+			{
+				v = getNormal(mOrigins[t], frame);
+				v.normalise();
+			}
+			else
+			{
+				v = getPosition(mOrigins[t], frame);
+			}
+			v = (v + offset) * scale;
+			float* texel = &texels[t * 4];
+			texel[0] = v.x;
+			texel[1] = v.y;
+			texel[2] = v.z;
+			texel[3] = 1.0f;
+		}
+
+		if (mHalfFloat)
+		{
+			for (size_t i = 0; i < texels.size(); ++i)
+				halfTexels[i] = Ogre::Bitwise::floatToHalf(texels[i]);
+			ofs.write(reinterpret_cast<const char*>(&halfTexels[0]), 
+				halfTexels.size() * sizeof(Ogre::uint16));
+		}
+		else
+		{
+			ofs.write(reinterpret_cast<const char*>(&texels[0]), 
+				texels.size() * sizeof(float));
+		}
+	}
+}
+//---------------------------------------------------------------------
+void HoudiniOgre_VertexAnimation::clear()
+{
+	for (std::vector<Samples*>::iterator s = mSamples.begin(); s != mSamples.end(); ++s)
+	{
+		delete *s;
+	}
+	mSamples.clear();
+	mOrigins.clear();
+	mSubMeshSets.clear();
+	mCycles.clear();
+	mFrameCount = 0;
+	mWidth = 0;
+	mRowsPerFrame = 0;
+	mHasNormals = false;
+	mBounds.setNull();
+}
@@ -0,0 +1,170 @@
+/*
+-----------------------------------------------------------------------------
+HoudiniOgre_VertexAnimation.h
+
+Author: Steven Streeting 
+Copyright  2007 Torus Knot Software Ltd & EDM Studio, Inc
+
+This file is part of HoudiniOgre
+
+    HoudiniOgre is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    HoudiniOgre is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+-----------------------------------------------------------------------------
+*/
+
+#ifndef __HoudiniOgre_VertexAnimation__
+#define __HoudiniOgre_VertexAnimation__
+
+#include "HoudiniOgre_Prerequisites.h"
+#include "HoudiniOgre_GeometrySource.h"
+#include "HoudiniOgre_MappedStore.h"
+#include "OgreVector3.h"
+#include "OgreAxisAlignedBox.h"
+
+/** Vertex animation textures: every frame's vertex positions and normals
+	baked into images, so a single mesh can be played back on the GPU
+	without skinning it or streaming a mesh per frame.
+@remarks
+	Each geometry added to a mesh is sampled at every frame of the
+	animation cycles, then as the mesh's SubMeshes are baked every vertex
+	is given a texel, in baking order, and a lookup texture coordinate
+	pointing at the middle of it. Textures are width texels across (the
+	vertex count, up to MAX_WIDTH) and rowsPerFrame rows per frame, frames
+	following each other down the image, so a vertex shader reads frame f
+	at (u, v + f * rowsPerFrame / height). The height may be no more than
+	MAX_HEIGHT, which limits how many frames can be baked for a mesh of
+	a given size.
+@par
+	Positions are stored relative to the box containing every frame, as
+	(p - min) / (max - min), and normals as n * 0.5 + 0.5, both in RGB
+	with alpha 1 (0 in padding texels), as 16 or 32 bit floats in
+	uncompressed DDS files. save() writes <base>.vat_pos.dds,
+	<base>.vat_nrm.dds (if there are normals) and <base>.vat.xml, which
+	gives the layout, the box, and the first row and length of each
+	animation:
+@code
+	<vertexanimation width="" height="" rowsPerFrame="" frames="" vertices="" 
+		format="half|float" fps="" positions="" normals="" min="x y z" max="x y z">
+		<submesh index="" texcoord=""/>
+		<animation name="" row="" frames=""/>
+	</vertexanimation>
+@endcode
+*/
+class HoudiniOgre_VertexAnimation
+{
+public:
+	enum { MAX_WIDTH = 4096, MAX_HEIGHT = 16384 };
+
+	HoudiniOgre_VertexAnimation();
+	~HoudiniOgre_VertexAnimation();
+
+	/// Write 16 bit rather than 32 bit floats
+	void setHalfFloat(bool half) { mHalfFloat = half; }
+	/** Sample the frames of these animation cycles from now on (until
+		clear()), at fps frames per second. */
+	void setCycles(const AnimationList& cycles, float fps);
+	/// Have the cycles to sample been set?
+	bool hasCycles() const { return !mCycles.empty(); }
+	/// Number of frames in all the cycles
+	size_t getFrameCount() const { return mFrameCount; }
+
+	/** Sample one geometry at every frame.
+	@remarks
+		Sources which can't be read at other frames are logged and hold
+		still at the base frame; a source whose points or polygons change
+		between frames is an error, since its vertices couldn't be matched
+		up.
+	@param geometry The geometry's ID within the mesh
+	@param base The source's geometry at the frame the mesh is built from
+	@param store Where the samples go, 0 for the heap
+	*/
+	void sample(size_t geometry, const HoudiniOgre_GeometrySource& source,
+		const HoudiniOgre_GeometrySource::Columns& base, bool useObjectTransforms,
+		HoudiniOgre_MappedStore* store);
+
+	/** Lay out the textures for this many baked vertices, throws if they'd
+		be more than MAX_HEIGHT high */
+	void begin(size_t vertexCount);
+	/// Has begin() been called?
+	bool isStarted() const { return mWidth != 0; }
+	/** Give the next baked vertex a texel.
+	@param geometry, vertex Where the vertex came from: a geometry ID and
+		an index into its vertex columns
+	@param position, normal The vertex at the base frame, used for 
+		geometry which wasn't sampled
+	@returns The lookup texture coordinate, at the vertex's first frame
+	*/
+	Ogre::Vector3 addVertex(size_t geometry, size_t vertex, 
+		const Ogre::Vector3& position, const Ogre::Vector3& normal);
+	/// Record the texture coordinate set holding a SubMesh's lookups
+	void addSubMesh(unsigned short subMesh, unsigned short texCoordSet, bool hasNormals);
+	/** Find the box containing every vertex at every frame, once all the
+		vertices are added. */
+	const Ogre::AxisAlignedBox& computeBounds();
+	/// Write the textures and layout, throws on failure
+	void save(const Ogre::String& baseName) const;
+	/// Forget everything, including the cycles
+	void clear();
+
+protected:
+	typedef std::vector<Ogre::Vector3, HoudiniOgre_MappedAllocator<Ogre::Vector3> > Vector3List;
+	/// One geometry's points and normals at every frame
+	struct Samples
+	{
+		size_t pointCount;
+		/// Point of each vertex
+		std::vector<int> vertexPoints;
+		/// Position of every point, frame after frame
+		Vector3List positions;
+		/// Normal at every vertex, frame after frame (empty without normals)
+		Vector3List normals;
+
+		explicit Samples(HoudiniOgre_MappedStore* store)
+			: pointCount(0), positions(Vector3List::allocator_type(store)),
+			  normals(Vector3List::allocator_type(store)) {}
+	};
+	/// Where a baked vertex came from
+	struct Origin
+	{
+		Ogre::uint32 geometry;
+		Ogre::uint32 vertex;
+		Ogre::Vector3 position;
+		Ogre::Vector3 normal;
+	};
+
+	/// Position of a baked vertex at a frame
+	Ogre::Vector3 getPosition(const Origin& origin, size_t frame) const;
+	/// Normal of a baked vertex at a frame
+	Ogre::Vector3 getNormal(const Origin& origin, size_t frame) const;
+	/// Write one texture of positions or normals, frame after frame
+	void writeTexture(const Ogre::String& filename, bool normals) const;
+
+	bool mHalfFloat;
+	AnimationList mCycles;
+	float mFps;
+	size_t mFrameCount;
+	/// By geometry ID, 0 where not sampled
+	std::vector<Samples*> mSamples;
+	/// Each baked vertex, in texel order
+	std::vector<Origin> mOrigins;
+	size_t mWidth;
+	size_t mRowsPerFrame;
+	bool mHasNormals;
+	/// SubMesh index and lookup texture coordinate set
+	std::vector<std::pair<unsigned short, unsigned short> > mSubMeshSets;
+	Ogre::AxisAlignedBox mBounds;
+
+};
+
+#endif